@@ -47,8 +47,8 @@ else
    if(strcmpi(ext,'.stl'))
        hapticObjName=haptic.name;
        
-       [facets,vertices,color,nfacets,nvertices,ifacets,volName]=...
-           read_stl(varargin{1});
+       [facets,vertices,color,nfacets,nvertices,ifacets,volName,...
+           meshFacets,meshVertices]=read_stl(varargin{1});
        
        nameFields = regexp(hapticObjName,'___','split');
        switch nameFields{1}
@@ -58,9 +58,21 @@ else
                scale_factor = single(1.0);
                resolution= single(1.0);
                
+               % voxelization results are cached so that the same
+               % implant is only voxelized once
+               voxelCacheDir=fullfile(tempdir,'mod2polygon_cache');
+               if ~exist(voxelCacheDir,'dir')
+                   [status,msg]=mkdir(voxelCacheDir); %#ok<NASGU>
+                   if ~status
+                       voxelCacheDir='';
+                   end
+               end
+               
+               % the welded mesh gives the same voxels with a third
+               % of the vertices
                [voxelData,facetData,vsizeData,hwiData,voxelMap]=mod2polygon(volName,...
-                   nfacets,nvertices,ifacets,scale_factor,...
-                   vertices,resolution, maxTriPerVoxel);
+                   nfacets,numel(meshVertices)/3,meshFacets,scale_factor,...
+                   meshVertices,resolution, maxTriPerVoxel,voxelCacheDir);
                
                voxGridSize=vsizeData;
                hapticWrtImplantVec=hwiData;
@@ -18,9 +18,14 @@ function m = plot3(hgs,model_resolution_or_angle)
 %   For speed reasons the models are preloaded and saved in mat file
 %   format.  See README file in the robotSTLfiles directory in the private
 %   directory of the hgs_robot object
+%   Levels of detail of the models are built (once per matlab session)
+%   with mesh_lods.  Each part is drawn with the coarsest level that is
+%   accurate to half a pixel in the current view, so zooming out makes
+%   the live update faster.  The levels are selected again when the figure
+%   is resized or zoomed.
 %
 % See also: 
-%    hgs_robot/plot, patch, read_stl, transform_vertices
+%    hgs_robot/plot, patch, read_stl, transformVertices, mesh_lods
  
 % $Author: dmoses $
 % $Revision: 1707 $
@@ -62,17 +67,22 @@ end
 % Load the models file based on the robot version number
 if (configParams.ARM_HARDWARE_VERSION>=1.0) ...
         && (configParams.ARM_HARDWARE_VERSION<2.0)
-    m_model = load('robot_models_1X.mat',model_variable_name);
+    model_file = 'robot_models_1X.mat';
 elseif (configParams.ARM_HARDWARE_VERSION>=2.0) ...
         && (configParams.ARM_HARDWARE_VERSION<3.0)
-    m_model = load('robot_models_2X.mat',model_variable_name);
+    model_file = 'robot_models_2X.mat';
 else
     error('Unsupported Arm model number (arm hardware version = %f)',...
         configParams.ARM_HARDWARE_VERSION);
 end
+m_model = load(model_file,model_variable_name);
 
 m = m_model.(model_variable_name);
 
+% the levels of detail only depend on the model file, build them once
+lods = modelLevelsOfDetail(model_file,model_variable_name,m);
+lodLevels = zeros(1,length(m));
+
 for i=1:configParams.WAM_DOF+1
     m(i).patch = patch(...
         'faces',m(i).faces,...
@@ -104,6 +114,9 @@ axis equal;
 axis([-0.600,0.600,-0.600,0.600,-0.300,0.600]);
 set(gca,'Xlimmode','manual','ylimmode','manual');
 axis off
+selectLevelOfDetail;
+set(plot3Figure,'ResizeFcn',@viewChanged);
+addlistener(plot3Axes,'CameraViewAngle','PostSet',@viewChanged);
 
 % if this is a request for a live plot update setup a timer
 if live_plot_update
@@ -130,14 +143,42 @@ end
 %--------------------------------------------------------------------------
 
     function updatePlot(varargin)
+        selectLevelOfDetail;
         update_robot_pose(m,dhmatrix,get(hgs,'joint_angles'));
     end
 
+    function viewChanged(varargin)
+        % the timer of a live plot picks up the change, a static plot
+        % needs the pose again for the new vertices
+        if selectLevelOfDetail && ~live_plot_update
+            update_robot_pose(m,dhmatrix,joint_angles);
+        end
+    end
+
+    function changed = selectLevelOfDetail
+        % switch the parts whose level changed with the view, the pose
+        % update transforms the new vertices
+        changed = false;
+        for k=1:configParams.WAM_DOF+1
+            level = mesh_lods(lods{k},plot3Axes);
+            if (level~=lodLevels(k))
+                changed = true;
+                lodLevels(k) = level;
+                m(k).faces = lods{k}(level).faces;
+                m(k).verts = lods{k}(level).verts;
+                set(m(k).patch,'vertices',m(k).verts,'faces',m(k).faces);
+            end
+        end
+    end
+
     function update_robot_pose(models,dhmatrix,joint_angles)
-        joint_transforms = dh_to_transforms(dhmatrix,joint_angles);
-        for k=1:length(joint_angles)
-            set(models(k+1).patch,'Vertices',transform_vertices(...
-                models(k+1).verts,joint_transforms{k}));
+        % frame of every link, then move all the links in one call
+        [~,~,link_frames] = forwardKinematics(dhmatrix,joint_angles(:)');
+        numLinks = length(joint_angles);
+        link_verts = transformVertices({models(2:numLinks+1).verts},...
+            link_frames);
+        for k=1:numLinks
+            set(models(k+1).patch,'Vertices',link_verts{k});
         end
         drawnow
     end
@@ -150,34 +191,20 @@ end
      end
 
 end
+
 %--------------------------------------------------------------------------
-%----------------- Internal function to compute forward kinematics --------
-%--------------------------------------------------------------------------
-function transforms = dh_to_transforms(dh,joint_angles)
-sa  = sin(dh(:,2));
-ca  = cos(dh(:,2));
-st  = sin(dh(:,4)+joint_angles');
-ct  = cos(dh(:,4)+joint_angles');
-
-% stl model was generated in mm so convert dh to mm
-A   = dh(:,1);
-d   = dh(:,3);
-
-zr = zeros(length(joint_angles),1);
-ons = ones(length(joint_angles),1);
-
-tr1 = [ct       -st       zr     A];
-tr2 = [st.*ca    ct.*ca  -sa    -d.*sa];
-tr3 = [st.*sa    ct.*sa   ca     d.*ca];
-tr4 = [zr        zr       zr     ons];
-
-transforms{1}= [tr1(1,:);tr2(1,:);tr3(1,:);tr4(1,:)];
-for i=2:length(joint_angles)
-    transforms{i}= transforms{i-1}...
-        *[tr1(i,:);tr2(i,:);tr3(i,:);tr4(i,:)]; %#ok<AGROW>
+function lods = modelLevelsOfDetail(model_file,model_variable_name,m)
+% levels of detail of the parts of a model, kept for the matlab session
+persistent modelLods
+lodKey = regexprep([model_file,'_',model_variable_name],'\W','_');
+if ~isfield(modelLods,lodKey)
+    partLods = cell(1,length(m));
+    for i=1:length(m)
+        partLods{i} = mesh_lods(m(i).faces,m(i).verts);
+    end
+    modelLods.(lodKey) = partLods;
 end
-
+lods = modelLods.(lodKey);
 end
 
-
 % --------- END OF FILE ----------
\ No newline at end of file
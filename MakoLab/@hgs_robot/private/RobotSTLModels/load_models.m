@@ -1,5 +1,6 @@
 % simple script to save STL files in mat format to be used by the
-% plot3 and other functions
+% plot3 and other functions.  The shared vertices are welded to reduce the
+% cost of transforming the models
 
 % List files in High Resolution
 file_list = {...
@@ -13,7 +14,7 @@ file_list = {...
 
 for i=1:length(file_list)
     disp(file_list{i});
-    [m_high_res(i).faces, m_high_res(i).verts,m_high_res(i).color] = read_stl(file_list{i});
+    [m_high_res(i).faces, m_high_res(i).verts,m_high_res(i).color] = read_stl(file_list{i},0);
    
     % Convert everthing to meters
     m_high_res(i).verts = m_high_res(i).verts.*0.001;
@@ -32,7 +33,7 @@ file_list = {...
 
 for i=1:length(file_list)
     disp(file_list{i});
-    [m_low_res(i).faces, m_low_res(i).verts,m_low_res(i).color] = read_stl(file_list{i});
+    [m_low_res(i).faces, m_low_res(i).verts,m_low_res(i).color] = read_stl(file_list{i},0);
     
     % Convert to meters
     m_low_res(i).verts = m_low_res(i).verts.*0.001;
@@ -133,7 +133,10 @@ pause(.1)
 % #define ARM_MM				2
 % #define ARM_DEGREES			1
 % #define ARM_RADIANS			2
+% The units are part of the contract with mscribeStream, which expects
+% (and sets) millimeters and radians and restores ARM_6DOF when stopped.
 calllib(dllname,'ArmSetLengthUnits',2);
+calllib(dllname,'ArmSetAngleUnits',2);
 pause(.1)
 
 % set microsribe tip to Tip 1
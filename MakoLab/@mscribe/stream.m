@@ -0,0 +1,55 @@
+function result = stream(mscribe_obj,command,varargin)
+%STREAM Sample the microscribe continuously in a background thread
+%
+% Syntax:
+%   id = stream(mscribe_obj,'start')
+%       starts sampling the arm at 100 Hz in mscribeStream.
+%   id = stream(mscribe_obj,'start','parameter',value,...)
+%       passes the parameters to mscribeStream (SampleRate, Capacity).
+%   samples = stream(mscribe_obj,'read',id)
+%   samples = stream(mscribe_obj,'read',id,maxSamples)
+%       returns the queued samples, as mscribeStream('read',...).
+%   stream(mscribe_obj,'stop',id)
+%       stops the stream, the arm stays connected.
+%
+% Notes:
+%   The stream expects the DLL in millimeters and radians, as set by
+%   mscribe, and sets those units again in case they were changed.  While
+%   a stream runs the DLL also updates the joint angles at the sample
+%   rate, stopping the last stream restores the ARM_6DOF update of
+%   mscribe.
+%
+% Example:
+%   msArm = mscribe();
+%   id = stream(msArm,'start','SampleRate',200);
+%   pause(1);
+%   samples = stream(msArm,'read',id);
+%   stream(msArm,'stop',id);
+%
+% See also:
+%   mscribe, mscribe/get, mscribeStream
+%
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+switch command
+    case 'start'
+        if (libisloaded('armdll64')~=1)
+            error('MicroScribe library not loaded, connect with mscribe first');
+        end
+        result = mscribeStream('start',varargin{:});
+    case 'read'
+        result = mscribeStream('read',varargin{:});
+    case 'stop'
+        mscribeStream('stop',varargin{:});
+    otherwise
+        error('Unknown command, use start, read or stop');
+end
+
+
+%---- END OF FILE -----
@@ -10,15 +10,17 @@ function toolData=bx(ndi)
 %       quaternion
 %       position
 %       error
+%       errorMsg
 %       transform
+%       frame
 %
 % Notes:
-%   If the tool is missing, the transform is invalid. The quaternion is
-%   translated to transforms using the q2tr function in the robot package by
-%   Peter Corke
+%   If the tool is missing, the transform is invalid. The whole reply is
+%   parsed by the parseNdiBxReply mex, the quaternion is translated to
+%   transforms as by the q2tr function in the robot package by Peter Corke
 %
 % See also:
-%   ndi_camera, ndi_camera/setmode, ndi_camera/tx
+%   ndi_camera, ndi_camera/setmode, ndi_camera/tx, parseNdiBxReply
 % 
 
 % 
@@ -30,95 +32,42 @@ function toolData=bx(ndi)
 
 % send the command to the camera and wait for the response
 camReply = comm(ndi,'BX 0801',1,true);
-camReply = uint8(camReply);
-% extract the number of handles
-numHandles = camReply(7);
+
+% parse the whole reply at once, positions in meters
+bxData = parseNdiBxReply(uint8(camReply),0.001);
+numHandles = length(bxData.handle);
 
 if numHandles == 0
     warning('No Tools Loaded');
 end
 
-idx = 8;
 for i=1:numHandles
-    toolHandle = camReply(idx);
-    % check if the tool is missing or visible
-    switch camReply(idx+1)
+    toolHandle = bxData.handle(i);
+    switch bxData.status(i)
+        case 1
+            toolData(toolHandle).status = 'VISIBLE';
         case 2
             toolData(toolHandle).status = 'MISSING';
-            toolData(toolHandle).quaternion = [0 0 0 0];
-            toolData(toolHandle).position = [0 0 0];
-            toolData(toolHandle).error = 0;
-            toolData(toolHandle).errorMsg = 'NO_ERROR';
-            toolData(toolHandle).transform = zeros(4,4);
-            idx = idx+10;
         case 4
             toolData(toolHandle).status = 'DISABLED';
-            toolData(toolHandle).quaternion = [0 0 0 0];
-            toolData(toolHandle).position = [0 0 0];
-            toolData(toolHandle).error = 0;
-            toolData(toolHandle).errorMsg = 'NO_ERROR';
-            toolData(toolHandle).transform = zeros(4,4);
-            idx = idx+2;
-        case 1
-            toolData(toolHandle).status = 'VISIBLE';
-            q1=convertBytesToFloat(camReply(idx+2:idx+5));
-            q2=convertBytesToFloat(camReply(idx+6:idx+9));
-            q3=convertBytesToFloat(camReply(idx+10:idx+13));
-            q4=convertBytesToFloat(camReply(idx+14:idx+17));
-            
-
-            x=convertBytesToFloat(camReply(idx+18:idx+21))*0.001;
-            y=convertBytesToFloat(camReply(idx+22:idx+25))*0.001;
-            z=convertBytesToFloat(camReply(idx+26:idx+29))*0.001;
-
-            error = convertBytesToFloat(camReply(idx+30:idx+33));
+    end
+    toolData(toolHandle).quaternion = bxData.quaternion(i,:);
+    toolData(toolHandle).position = bxData.position(i,:);
+    toolData(toolHandle).error = bxData.error(i);
 
-            % error message for partially tracked tools
-            errorBits = camReply(idx+34);
-            if bitget(errorBits,8)
-                toolData(toolHandle).errorMsg = 'PartiallyOutOfVolume';
-            elseif bitget(errorBits,7)
-                toolData(toolHandle).errorMsg = 'OutOfVolume';
-            else
-                toolData(toolHandle).errorMsg = 'NO_ERROR';
-            end
-            
-            % prepare the response
-            toolData(toolHandle).quaternion = [q1 q2 q3 q4];
-            toolData(toolHandle).position = [x y z];
-            toolData(toolHandle).error = error;
-            toolData(toolHandle).transform = q2tr(...
-                toolData(toolHandle).quaternion);
-            toolData(toolHandle).transform(1:3,4)=[x y z]';
-            idx = idx+42;
+    % error message for partially tracked tools
+    if bxData.status(i)~=1
+        toolData(toolHandle).errorMsg = 'NO_ERROR';
+    elseif bitget(bxData.portStatus(i),8)
+        toolData(toolHandle).errorMsg = 'PartiallyOutOfVolume';
+    elseif bitget(bxData.portStatus(i),7)
+        toolData(toolHandle).errorMsg = 'OutOfVolume';
+    else
+        toolData(toolHandle).errorMsg = 'NO_ERROR';
     end
+    toolData(toolHandle).transform = bxData.transform(:,:,i);
+    toolData(toolHandle).frame = bxData.frame(i);
 end
 
 
-%Q2TR	Convert unit-quaternion to homogeneous transform
-%
-%	T = q2tr(Q)
-%
-%	Return the rotational homogeneous transform corresponding to the unit
-%	quaternion Q.
-%
-%	See also: TR2Q, Robot package
-
-%	Copyright (C) 1993 Peter Corke
-function t = q2tr(q)
-
-q = double(q);
-s = q(1);
-x = q(2);
-y = q(3);
-z = q(4);
-
-r = [	1-2*(y^2+z^2)	2*(x*y-s*z)	2*(x*z+s*y)
-    2*(x*y+s*z)	1-2*(x^2+z^2)	2*(y*z-s*x)
-    2*(x*z-s*y)	2*(y*z+s*x)	1-2*(x^2+y^2)	];
-t = eye(4,4);
-t(1:3,1:3) = r;
-t(4,4) = 1;
-
-
 %---- END OF FILE -----
\ No newline at end of file
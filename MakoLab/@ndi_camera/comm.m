@@ -54,9 +54,18 @@ switch (cameraObj.connection_type)
         if binaryData
             % this is direct connection through the serial port.
             % use simple serial communication
+            % read the header and then the length it announces, instead
+            % of waiting a fixed time for the reply
             fwrite(cameraObj.port,command);
-            pause(.1);
-            reply = fread(cameraObj.port,cameraObj.port.BytesAvailable,'uint8');
+            reply = fread(cameraObj.port,6,'uint8');
+            if ((length(reply)==6) && (reply(1)==196) && (reply(2)==165))
+                % binary reply, the data and its CRC follow the header
+                reply = [reply; fread(cameraObj.port,...
+                    reply(3)+256*reply(4)+2,'uint8')];
+            else
+                % an ascii reply (ERROR...), read up to the CR
+                reply = [reply; double(fgets(cameraObj.port))'];
+            end
         else
             fwrite(cameraObj.port,command);
             reply = fgets(cameraObj.port);
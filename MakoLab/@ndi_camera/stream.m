@@ -0,0 +1,66 @@
+function result = stream(ndi,command,varargin)
+%STREAM Track continuously with the ndi camera in a background reader
+%
+% Syntax:
+%   id = stream(ndi,'start')
+%       hands the serial port of the camera over to ndiStream and starts
+%       tracking continuously with BX 0801, positions in meters.  The port
+%       is closed in matlab until the stream is stopped, do not use the
+%       other methods in the meantime.
+%   id = stream(ndi,'start','parameter',value,...)
+%       passes the parameters to ndiStream (Command, Capacity, Scale).
+%   poses = stream(ndi,'read',id)
+%   poses = stream(ndi,'read',id,maxPoses)
+%       returns the queued poses, as ndiStream('read',...).
+%   stream(ndi,'stop',id)
+%       stops the stream and reopens the serial port in matlab.
+%
+% Notes:
+%   Only the camera on a local serial port is supported.  The camera must
+%   be initialized and its tools enabled and in tracking mode.
+%
+% Example:
+%   id = stream(ndi,'start');
+%   pause(1);
+%   poses = stream(ndi,'read',id);
+%   stream(ndi,'stop',id);
+%
+% See also:
+%   ndi_camera, ndi_camera/bx, ndiStream
+%
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+if (ndi.connection_type~=1)
+    error('Streaming is only supported for a camera on a local serial port');
+end
+
+switch command
+    case 'start'
+        % only one owner can open the port
+        portName = get(ndi.port,'Port');
+        baudRate = get(ndi.port,'BaudRate');
+        fclose(ndi.port);
+        try
+            result = ndiStream('start',portName,'BaudRate',baudRate,...
+                'Scale',0.001,varargin{:});
+        catch
+            fopen(ndi.port);
+            rethrow(lasterror);
+        end
+    case 'read'
+        result = ndiStream('read',varargin{:});
+    case 'stop'
+        ndiStream('stop',varargin{:});
+        fopen(ndi.port);
+    otherwise
+        error('Unknown command, use start, read or stop');
+end
+
+
+%---- END OF FILE -----
@@ -51,7 +51,7 @@ typedef time_t DOM_TimeStamp;
 /* DOM_Exception
  */
 
-unsigned short DOM_Exception;
+extern unsigned short DOM_Exception;	// made extern by Mako, dom.h is included by several files
 
 #define DOM_NO_ERR                      0
 #define DOM_INDEX_SIZE_ERR              1
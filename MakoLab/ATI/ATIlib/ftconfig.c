@@ -0,0 +1,1538 @@
+/****h* /ftconfig.c ***
+ * NAME
+ *      ftconfig.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      Portable implementation of the calibration file and configuration
+ *      routines of the ATI DAQ F/T library (ftconfig.h), so calibrations
+ *      can be loaded without atidaqft.dll.  The calibration file is read
+ *      by a small XML reader into the DOM_Node structures of dom.h (only
+ *      elements, attributes and text are kept), the coefficients are then
+ *      copied to a Calibration and the working matrix is computed.
+ *
+ * SEE ALSO
+ *      ftconfig.h, ftrt.c, loadFTCalibration.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "ftconfig.h"
+
+/* defines */
+#define MAX_CAL_FILE_SIZE (4 * 1024 * 1024)
+
+/* internal functions */
+static char *read_text_file(const char *fileName);
+static DOM_Node *xml_parse(const char *text);
+static DOM_Node *xml_parse_element(const char **text, DOM_Node *parent);
+static DOM_Node *xml_new_node(unsigned short nodeType, const char *name,
+        size_t nameLength);
+static DOM_NodeList *xml_new_list(void);
+static int xml_append(DOM_NodeList *list, DOM_Node *node);
+static char *xml_decode(const char *text, size_t length);
+static const char *xml_skip_markup(const char *text);
+static void xml_free_node(DOM_Node *node);
+static DOM_Node *xml_child(const DOM_Node *node, const char *name,
+        unsigned short index);
+static short transform_matrix(const Transform *xform, double result[6][6],
+        Units ForceUnits, Units TorqueUnits);
+static int units_match(const char *units, const char *name);
+static int read_flag(const DOM_Element *elem, char *attName,
+        char *defaultValue);
+static float read_float(const DOM_Element *elem, char *attName,
+        char *defaultValue);
+
+/****f*  ftconfig.c/createCalibration ******
+ * NAME
+ *	    createCalibration
+ *
+ * SYNOPSIS
+ *      Calibration *createCalibration(char *CalFilePath,
+ *              unsigned short index)
+ *
+ * INPUTS
+ *      char *CalFilePath
+ *              name of the ATI calibration file (.cal)
+ *      unsigned short index
+ *              number of the calibration in the file, starting at 1
+ *
+ * OUTPUT
+ *      Returns the calibration or NULL if the file could not be read or
+ *      the calibration is not found or is invalid.  The calibration must
+ *      be freed with destroyCalibration.
+ *
+ * PURPOSE
+ *	    Read the calibration and compute the working matrix for the
+ *	    default configuration (units of the calibration, no tool
+ *	    transform, temperature compensation enabled when available).
+ *
+ * NOTES
+ *      The gains of each Axis element are divided by its scale attribute.
+ *      The units of the BasicTransform are read from the element, or from
+ *      the Calibration element, and default to in and degrees.
+ *
+ **********************************
+ */
+Calibration *createCalibration(char *CalFilePath, unsigned short index)
+{
+    Calibration *cal;
+    DOM_Node *root, *calNode, *child;
+    NodeEntry *entry;
+    char *text, *temp;
+    float scale;
+    unsigned short numGauges, i, j;
+    int status = 0;
+
+    if ((CalFilePath == NULL) || (index < 1))
+    {
+        return NULL;
+    }
+    text = read_text_file(CalFilePath);
+    if (text == NULL)
+    {
+        return NULL;
+    }
+    root = xml_parse(text);
+    free(text);
+    if (root == NULL)
+    {
+        return NULL;
+    }
+
+    cal = (Calibration *)calloc(1, sizeof(Calibration));
+    calNode = xml_child(root, "Calibration", index);
+    if ((cal == NULL) || (strcmp(root->nodeName, "FTSensor") != 0)
+            || (calNode == NULL))
+    {
+        xml_free_node(root);
+        free(cal);
+        return NULL;
+    }
+
+    /* transducer */
+    status |= ReadAttribute(root, &temp, "NumGages", TRUE, "");
+    numGauges = (temp != NULL) ? (unsigned short)atoi(temp) : 0;
+    free(temp);
+    status |= ReadAttribute(root, &cal->Serial, "Serial", FALSE, "");
+    status |= ReadAttribute(root, &cal->BodyStyle, "BodyStyle", FALSE, "");
+    status |= ReadAttribute(root, &cal->Family, "Family", FALSE, "");
+
+    /* calibration */
+    status |= ReadAttribute(calNode, &cal->PartNumber, "PartNumber", FALSE,
+            "");
+    status |= ReadAttribute(calNode, &cal->CalDate, "CalDate", FALSE, "");
+    status |= ReadAttribute(calNode, &cal->ForceUnits, "ForceUnits", TRUE,
+            "");
+    status |= ReadAttribute(calNode, &cal->TorqueUnits, "TorqueUnits", TRUE,
+            "");
+    cal->TempCompAvailable = read_flag(calNode, "TempComp", "False");
+    cal->VoltageRange = (int)read_float(calNode, "OutputRange", "20");
+    cal->BiPolar = read_flag(calNode, "OutputBipolar", "True");
+    cal->HWTempComp = read_flag(calNode, "HWTempComp", "False");
+    status |= ReadAttribute(calNode, &cal->BasicTransform.DistUnits,
+            "DistUnits", FALSE, "in");
+    status |= ReadAttribute(calNode, &cal->BasicTransform.AngleUnits,
+            "AngleUnits", FALSE, "degrees");
+    if ((numGauges < 1) || (numGauges > MAX_GAUGES))
+    {
+        status = 1;
+    }
+    cal->rt.NumChannels = numGauges + 1;
+
+    for (entry = calNode->childNodes->first; (entry != NULL) && (status == 0);
+            entry = entry->next)
+    {
+        child = entry->node;
+        if (child->nodeType != DOM_ELEMENT_NODE)
+        {
+            continue;
+        }
+        if (strcmp(child->nodeName, "Axis") == 0)
+        {
+            i = cal->rt.NumAxes;
+            if (i >= MAX_AXES)
+            {
+                status = 1;
+                break;
+            }
+            status |= ReadAttribute(child, &cal->AxisNames[i], "Name", TRUE,
+                    "");
+            status |= ReadAttribute(child, &temp, "values", TRUE, "");
+            if (temp != NULL)
+            {
+                Separate(temp, cal->BasicMatrix[i], numGauges);
+            }
+            free(temp);
+            cal->MaxLoads[i] = read_float(child, "max", "0");
+            scale = read_float(child, "scale", "1");
+            if (scale == 0.0f)
+            {
+                status = 1;
+                break;
+            }
+            for (j = 0; j < numGauges; j++)
+            {
+                cal->BasicMatrix[i][j] /= scale;
+            }
+            cal->rt.NumAxes++;
+        }
+        else if (strcmp(child->nodeName, "BasicTransform") == 0)
+        {
+            cal->BasicTransform.TT[0] = read_float(child, "Dx", "0");
+            cal->BasicTransform.TT[1] = read_float(child, "Dy", "0");
+            cal->BasicTransform.TT[2] = read_float(child, "Dz", "0");
+            cal->BasicTransform.TT[3] = read_float(child, "Rx", "0");
+            cal->BasicTransform.TT[4] = read_float(child, "Ry", "0");
+            cal->BasicTransform.TT[5] = read_float(child, "Rz", "0");
+            if (DOM_Element_getAttribute(child, "DistUnits") != NULL)
+            {
+                free(cal->BasicTransform.DistUnits);
+                status |= ReadAttribute(child, &cal->BasicTransform.DistUnits,
+                        "DistUnits", TRUE, "");
+            }
+            if (DOM_Element_getAttribute(child, "AngleUnits") != NULL)
+            {
+                free(cal->BasicTransform.AngleUnits);
+                status |= ReadAttribute(child,
+                        &cal->BasicTransform.AngleUnits, "AngleUnits", TRUE,
+                        "");
+            }
+        }
+        else if ((strcmp(child->nodeName, "BiasSlopes") == 0)
+                || (strcmp(child->nodeName, "GainSlopes") == 0))
+        {
+            status |= ReadAttribute(child, &temp, "values", TRUE, "");
+            if (temp != NULL)
+            {
+                Separate(temp, (child->nodeName[0] == 'B')
+                        ? cal->rt.bias_slopes : cal->rt.gain_slopes,
+                        (unsigned short)(cal->rt.NumChannels - 1));
+            }
+            free(temp);
+        }
+        else if (strcmp(child->nodeName, "Thermistor") == 0)
+        {
+            /* the value is the text of the element or its value attribute */
+            if ((child->firstChild != NULL)
+                    && (child->firstChild->nodeType == DOM_TEXT_NODE))
+            {
+                cal->rt.thermistor = (float)atof(child->firstChild->nodeValue);
+            }
+            else
+            {
+                cal->rt.thermistor = read_float(child, "value", "0");
+            }
+        }
+    }
+    xml_free_node(root);
+
+    if ((status != 0) || (cal->rt.NumAxes == 0))
+    {
+        destroyCalibration(cal);
+        return NULL;
+    }
+
+    ResetDefaults(cal);
+    if (CalcMatrix(cal) != 0)
+    {
+        destroyCalibration(cal);
+        return NULL;
+    }
+    return cal;
+}
+
+/****f*  ftconfig.c/destroyCalibration ******
+ * NAME
+ *	    destroyCalibration
+ *
+ * SYNOPSIS
+ *      void destroyCalibration(Calibration *cal)
+ *
+ * INPUTS
+ *      Calibration *cal
+ *              calibration returned by createCalibration, can be NULL
+ *
+ * PURPOSE
+ *	    Free a calibration and its strings
+ *
+ **********************************
+ */
+void destroyCalibration(Calibration *cal)
+{
+    unsigned short i;
+
+    if (cal == NULL)
+    {
+        return;
+    }
+    for (i = 0; i < MAX_AXES; i++)
+    {
+        free(cal->AxisNames[i]);
+    }
+    free(cal->ForceUnits);
+    free(cal->TorqueUnits);
+    free(cal->BasicTransform.DistUnits);
+    free(cal->BasicTransform.AngleUnits);
+    free(cal->Serial);
+    free(cal->BodyStyle);
+    free(cal->PartNumber);
+    free(cal->Family);
+    free(cal->CalDate);
+    free(cal->cfg.ForceUnits);
+    free(cal->cfg.TorqueUnits);
+    free(cal->cfg.UserTransform.DistUnits);
+    free(cal->cfg.UserTransform.AngleUnits);
+    free(cal);
+}
+
+/****f*  ftconfig.c/SetToolTransform ******
+ * NAME
+ *	    SetToolTransform
+ *
+ * SYNOPSIS
+ *      short SetToolTransform(Calibration *cal, float Vector[6],
+ *              char *DistUnits, char *AngleUnits)
+ *
+ * INPUTS
+ *      Calibration *cal
+ *              calibration
+ *      float Vector[6]
+ *              position Dx, Dy, Dz of the new origin in the transducer
+ *              frame and rotations Rx, Ry, Rz of the new frame
+ *      char *DistUnits, *AngleUnits
+ *              units of the position and of the rotations
+ *
+ * OUTPUT
+ *      Returns 0 on success, 1 for an invalid calibration, 2 for invalid
+ *      distance units and 3 for invalid angle units
+ *
+ * PURPOSE
+ *	    Report the forces and torques in a tool frame, the working matrix
+ *	    is recompiled if the transform changes
+ *
+ **********************************
+ */
+short SetToolTransform(Calibration *cal, float Vector[6], char *DistUnits,
+        char *AngleUnits)
+{
+    unsigned short i;
+
+    if (cal == NULL)
+    {
+        return 1;
+    }
+    if (DistConv(DistUnits) == 0.0f)
+    {
+        return 2;
+    }
+    if (AngleConv(AngleUnits) == 0.0f)
+    {
+        return 3;
+    }
+    for (i = 0; i < 6; i++)
+    {
+        if (cal->cfg.UserTransform.TT[i] != Vector[i])
+        {
+            break;
+        }
+    }
+    if ((i == 6) && units_match(cal->cfg.UserTransform.DistUnits, DistUnits)
+            && units_match(cal->cfg.UserTransform.AngleUnits, AngleUnits))
+    {
+        return 0;
+    }
+    for (i = 0; i < 6; i++)
+    {
+        cal->cfg.UserTransform.TT[i] = Vector[i];
+    }
+    free(cal->cfg.UserTransform.DistUnits);
+    free(cal->cfg.UserTransform.AngleUnits);
+    cal->cfg.UserTransform.DistUnits = ATI_strdup(DistUnits);
+    cal->cfg.UserTransform.AngleUnits = ATI_strdup(AngleUnits);
+    return CalcMatrix(cal);
+}
+
+/****f*  ftconfig.c/SetForceUnits ******
+ * NAME
+ *	    SetForceUnits
+ *
+ * SYNOPSIS
+ *      short SetForceUnits(Calibration *cal, char *NewUnits)
+ *
+ * INPUTS
+ *      Calibration *cal
+ *              calibration
+ *      char *NewUnits
+ *              lb, klb, N, kN, g or kg
+ *
+ * OUTPUT
+ *      Returns 0 on success, 1 for an invalid calibration and 2 for
+ *      invalid units
+ *
+ * PURPOSE
+ *	    Set the units of the forces, the working matrix is recompiled if
+ *	    the units change
+ *
+ **********************************
+ */
+short SetForceUnits(Calibration *cal, char *NewUnits)
+{
+    if (cal == NULL)
+    {
+        return 1;
+    }
+    if (ForceConv(NewUnits) == 0.0f)
+    {
+        return 2;
+    }
+    if (units_match(cal->cfg.ForceUnits, NewUnits))
+    {
+        return 0;
+    }
+    free(cal->cfg.ForceUnits);
+    cal->cfg.ForceUnits = ATI_strdup(NewUnits);
+    return CalcMatrix(cal);
+}
+
+/****f*  ftconfig.c/SetTorqueUnits ******
+ * NAME
+ *	    SetTorqueUnits
+ *
+ * SYNOPSIS
+ *      short SetTorqueUnits(Calibration *cal, char *NewUnits)
+ *
+ * INPUTS
+ *      Calibration *cal
+ *              calibration
+ *      char *NewUnits
+ *              in-lb, ft-lb, N-m, N-mm or kg-cm
+ *
+ * OUTPUT
+ *      Returns 0 on success, 1 for an invalid calibration and 2 for
+ *      invalid units
+ *
+ * PURPOSE
+ *	    Set the units of the torques, the working matrix is recompiled if
+ *	    the units change
+ *
+ **********************************
+ */
+short SetTorqueUnits(Calibration *cal, char *NewUnits)
+{
+    if (cal == NULL)
+    {
+        return 1;
+    }
+    if (TorqueConv(NewUnits) == 0.0f)
+    {
+        return 2;
+    }
+    if (units_match(cal->cfg.TorqueUnits, NewUnits))
+    {
+        return 0;
+    }
+    free(cal->cfg.TorqueUnits);
+    cal->cfg.TorqueUnits = ATI_strdup(NewUnits);
+    return CalcMatrix(cal);
+}
+
+/****f*  ftconfig.c/SetTempComp ******
+ * NAME
+ *	    SetTempComp
+ *
+ * SYNOPSIS
+ *      short SetTempComp(Calibration *cal, int TCEnabled)
+ *
+ * INPUTS
+ *      Calibration *cal
+ *              calibration
+ *      int TCEnabled
+ *              1 to enable the software temperature compensation
+ *
+ * OUTPUT
+ *      Returns 0 on success, 1 for an invalid calibration and 2 if the
+ *      calibration has no temperature compensation
+ *
+ **********************************
+ */
+short SetTempComp(Calibration *cal, int TCEnabled)
+{
+    if (cal == NULL)
+    {
+        return 1;
+    }
+    if (TCEnabled && !cal->TempCompAvailable)
+    {
+        return 2;
+    }
+    cal->cfg.TempCompEnabled = (TCEnabled != 0);
+    return 0;
+}
+
+/****f*  ftconfig.c/Bias ******
+ * NAME
+ *	    Bias
+ *
+ * SYNOPSIS
+ *      void Bias(Calibration *cal, float voltages[])
+ *
+ * PURPOSE
+ *	    Store the voltages of the unloaded transducer, see RTBias
+ *
+ **********************************
+ */
+void Bias(Calibration *cal, float voltages[])
+{
+    RTBias(&cal->rt, voltages);
+}
+
+/****f*  ftconfig.c/ConvertToFT ******
+ * NAME
+ *	    ConvertToFT
+ *
+ * SYNOPSIS
+ *      void ConvertToFT(Calibration *cal, float voltages[], float result[])
+ *
+ * PURPOSE
+ *	    Convert one sample with the current configuration, see
+ *	    RTConvertToFT
+ *
+ **********************************
+ */
+void ConvertToFT(Calibration *cal, float voltages[], float result[])
+{
+    RTConvertToFT(&cal->rt, voltages, result, cal->cfg.TempCompEnabled);
+}
+
+/****f*  ftconfig.c/ResetDefaults ******
+ * NAME
+ *	    ResetDefaults
+ *
+ * SYNOPSIS
+ *      void ResetDefaults(Calibration *cal)
+ *
+ * PURPOSE
+ *	    Set the configuration to the units of the calibration, no tool
+ *	    transform and the temperature compensation enabled when
+ *	    available.  The working matrix must be recomputed by CalcMatrix.
+ *
+ **********************************
+ */
+void ResetDefaults(Calibration *cal)
+{
+    unsigned short i;
+
+    free(cal->cfg.ForceUnits);
+    free(cal->cfg.TorqueUnits);
+    free(cal->cfg.UserTransform.DistUnits);
+    free(cal->cfg.UserTransform.AngleUnits);
+    cal->cfg.ForceUnits = ATI_strdup(cal->ForceUnits);
+    cal->cfg.TorqueUnits = ATI_strdup(cal->TorqueUnits);
+    cal->cfg.UserTransform.DistUnits = ATI_strdup("in");
+    cal->cfg.UserTransform.AngleUnits = ATI_strdup("degrees");
+    for (i = 0; i < 6; i++)
+    {
+        cal->cfg.UserTransform.TT[i] = 0.0f;
+    }
+    cal->cfg.TempCompEnabled = cal->TempCompAvailable;
+}
+
+/****f*  ftconfig.c/CalcMatrix ******
+ * NAME
+ *	    CalcMatrix
+ *
+ * SYNOPSIS
+ *      short CalcMatrix(Calibration *cal)
+ *
+ * OUTPUT
+ *      Returns 0 on success, 1 for an invalid calibration and 2 for
+ *      invalid units
+ *
+ * PURPOSE
+ *	    Compile the working matrix from the basic matrix: the basic and
+ *	    the tool transforms (6 axis transducers only) and the scaling to
+ *	    the force and torque units of the configuration are combined in
+ *	    one 6x6 matrix, in double precision, which is applied to the basic
+ *	    matrix with a single product.  Each conversion is then one
+ *	    product of the working matrix by the gauge voltages.  Axes named
+ *	    F* are forces, T* torques.
+ *
+ **********************************
+ */
+short CalcMatrix(Calibration *cal)
+{
+    double basic[6][6];
+    double user[6][6];
+    double combined[MAX_AXES][6];
+    double forceScale, torqueScale, scale, sum;
+    unsigned short numGauges, i, j, k;
+
+    if ((cal == NULL) || (cal->rt.NumChannels < 2))
+    {
+        return 1;
+    }
+    numGauges = cal->rt.NumChannels - 1;
+    if ((ForceConv(cal->ForceUnits) == 0.0f)
+            || (TorqueConv(cal->TorqueUnits) == 0.0f)
+            || (ForceConv(cal->cfg.ForceUnits) == 0.0f)
+            || (TorqueConv(cal->cfg.TorqueUnits) == 0.0f))
+    {
+        return 2;
+    }
+
+    /* transforms, identity if they do not apply */
+    if (cal->rt.NumAxes == 6)
+    {
+        if ((transform_matrix(&cal->BasicTransform, basic, cal->ForceUnits,
+                        cal->TorqueUnits) != 0)
+                || (transform_matrix(&cal->cfg.UserTransform, user,
+                        cal->ForceUnits, cal->TorqueUnits) != 0))
+        {
+            return 2;
+        }
+        for (i = 0; i < 6; i++)
+        {
+            for (j = 0; j < 6; j++)
+            {
+                sum = 0.0;
+                for (k = 0; k < 6; k++)
+                {
+                    sum += user[i][k] * basic[k][j];
+                }
+                combined[i][j] = sum;
+            }
+        }
+    }
+    else
+    {
+        for (i = 0; i < cal->rt.NumAxes; i++)
+        {
+            for (j = 0; j < 6; j++)
+            {
+                combined[i][j] = (i == j) ? 1.0 : 0.0;
+            }
+        }
+    }
+
+    /* unit conversion of the rows */
+    forceScale = (double)ForceConv(cal->cfg.ForceUnits)
+        / ForceConv(cal->ForceUnits);
+    torqueScale = (double)TorqueConv(cal->cfg.TorqueUnits)
+        / TorqueConv(cal->TorqueUnits);
+    for (i = 0; i < cal->rt.NumAxes; i++)
+    {
+        if ((cal->AxisNames[i] != NULL) && (cal->AxisNames[i][0] == 'T'))
+        {
+            scale = torqueScale;
+        }
+        else if ((cal->AxisNames[i] != NULL) && (cal->AxisNames[i][0] == 'F'))
+        {
+            scale = forceScale;
+        }
+        else
+        {
+            scale = 1.0;
+        }
+        for (j = 0; j < 6; j++)
+        {
+            combined[i][j] *= scale;
+        }
+    }
+
+    /* working matrix */
+    for (i = 0; i < cal->rt.NumAxes; i++)
+    {
+        for (j = 0; j < numGauges; j++)
+        {
+            sum = 0.0;
+            for (k = 0; (k < cal->rt.NumAxes) && (k < 6); k++)
+            {
+                sum += combined[i][k] * cal->BasicMatrix[k][j];
+            }
+            cal->rt.working_matrix[i][j] = (float)sum;
+        }
+    }
+    return 0;
+}
+
+/****f*  ftconfig.c/GetMatrix ******
+ * NAME
+ *	    GetMatrix
+ *
+ * SYNOPSIS
+ *      short GetMatrix(Calibration *cal, float *result)
+ *
+ * OUTPUT
+ *      float *result
+ *              NumAxes x (NumChannels-1) working matrix, by rows
+ *      Returns 0 on success, 1 for an invalid calibration
+ *
+ **********************************
+ */
+short GetMatrix(Calibration *cal, float *result)
+{
+    unsigned short numGauges, i, j;
+
+    if ((cal == NULL) || (result == NULL))
+    {
+        return 1;
+    }
+    numGauges = cal->rt.NumChannels - 1;
+    for (i = 0; i < cal->rt.NumAxes; i++)
+    {
+        for (j = 0; j < numGauges; j++)
+        {
+            result[i * numGauges + j] = cal->rt.working_matrix[i][j];
+        }
+    }
+    return 0;
+}
+
+/****f*  ftconfig.c/TTM ******
+ * NAME
+ *	    TTM
+ *
+ * SYNOPSIS
+ *      short TTM(Transform xform, float result[6][6], Units ForceUnits,
+ *              Units TorqueUnits)
+ *
+ * INPUTS
+ *      Transform xform
+ *              position of the new origin and rotations of the new frame,
+ *              about x, then y, then z of the transducer frame
+ *      Units ForceUnits, TorqueUnits
+ *              units of the forces and torques transformed
+ *
+ * OUTPUT
+ *      float result[6][6]
+ *              matrix giving the forces and torques in the new frame
+ *      Returns 0 on success, 1 for invalid units
+ *
+ * PURPOSE
+ *	    With R the orientation of the new frame and d its origin, the
+ *	    forces become R'F and the torques R'(T - d x F), the distance
+ *	    converted to the length of the torque units.
+ *
+ **********************************
+ */
+short TTM(Transform xform, float result[6][6], Units ForceUnits,
+        Units TorqueUnits)
+{
+    double matrix[6][6];
+    unsigned short i, j;
+
+    if (transform_matrix(&xform, matrix, ForceUnits, TorqueUnits) != 0)
+    {
+        return 1;
+    }
+    for (i = 0; i < 6; i++)
+    {
+        for (j = 0; j < 6; j++)
+        {
+            result[i][j] = (float)matrix[i][j];
+        }
+    }
+    return 0;
+}
+
+/****f*  ftconfig.c/ForceConv ******
+ * NAME
+ *	    ForceConv, TorqueConv, DistConv, AngleConv
+ *
+ * SYNOPSIS
+ *      float ForceConv(char *Units)
+ *
+ * OUTPUT
+ *      Returns the value in Units of 1 lb, 1 in-lb, 1 in or 1 degree,
+ *      0 for unknown units
+ *
+ * NOTES
+ *      The units are not case sensitive, the spellings of the calibration
+ *      files (lbf, lbf-in, Nm...) are accepted.
+ *
+ **********************************
+ */
+float ForceConv(char *Units)
+{
+    if (units_match(Units, "lb") || units_match(Units, "lbf"))
+        return 1.0f;
+    if (units_match(Units, "klb") || units_match(Units, "klbf"))
+        return 0.001f;
+    if (units_match(Units, "N"))
+        return 4.448222f;
+    if (units_match(Units, "kN"))
+        return 0.004448222f;
+    if (units_match(Units, "g") || units_match(Units, "gf"))
+        return 453.5924f;
+    if (units_match(Units, "kg") || units_match(Units, "kgf"))
+        return 0.4535924f;
+    return 0.0f;
+}
+
+float TorqueConv(char *Units)
+{
+    if (units_match(Units, "in-lb") || units_match(Units, "lbf-in")
+            || units_match(Units, "lb-in"))
+        return 1.0f;
+    if (units_match(Units, "ft-lb") || units_match(Units, "lbf-ft")
+            || units_match(Units, "lb-ft"))
+        return 0.08333333f;
+    if (units_match(Units, "N-m") || units_match(Units, "Nm"))
+        return 0.1129848f;
+    if (units_match(Units, "N-mm") || units_match(Units, "Nmm"))
+        return 112.9848f;
+    if (units_match(Units, "kg-cm") || units_match(Units, "kgf-cm"))
+        return 1.152067f;
+    if (units_match(Units, "kN-m") || units_match(Units, "kNm"))
+        return 0.0001129848f;
+    return 0.0f;
+}
+
+float DistConv(char *Units)
+{
+    if (units_match(Units, "in"))
+        return 1.0f;
+    if (units_match(Units, "ft"))
+        return 0.08333333f;
+    if (units_match(Units, "m"))
+        return 0.0254f;
+    if (units_match(Units, "cm"))
+        return 2.54f;
+    if (units_match(Units, "mm"))
+        return 25.4f;
+    return 0.0f;
+}
+
+float AngleConv(char *Units)
+{
+    if (units_match(Units, "degrees") || units_match(Units, "deg")
+            || units_match(Units, "degree"))
+        return 1.0f;
+    if (units_match(Units, "radians") || units_match(Units, "rad")
+            || units_match(Units, "radian"))
+        return (float)(PI / 180.0);
+    return 0.0f;
+}
+
+/****f*  ftconfig.c/ReadAttribute ******
+ * NAME
+ *	    ReadAttribute
+ *
+ * SYNOPSIS
+ *      short ReadAttribute(const DOM_Element *elem, char **attValue,
+ *              char *attName, BOOL required, char *defaultValue)
+ *
+ * INPUTS
+ *      const DOM_Element *elem
+ *              element holding the attribute
+ *      char *attName
+ *              name of the attribute
+ *      BOOL required
+ *              TRUE if the attribute must be present
+ *      char *defaultValue
+ *              value of a missing optional attribute
+ *
+ * OUTPUT
+ *      char **attValue
+ *              copy of the value, to be freed, NULL on failure
+ *      Returns 0 on success, 1 if the memory could not be allocated and 2
+ *      if a required attribute is missing
+ *
+ **********************************
+ */
+short ReadAttribute(const DOM_Element *elem, char **attValue, char *attName,
+        BOOL required, char *defaultValue)
+{
+    const DOM_String *value;
+
+    *attValue = NULL;
+    value = DOM_Element_getAttribute(elem, attName);
+    if (value == NULL)
+    {
+        if (required)
+        {
+            return 2;
+        }
+        value = defaultValue;
+    }
+    *attValue = ATI_strdup(value);
+    return (*attValue == NULL) ? 1 : 0;
+}
+
+/****f*  ftconfig.c/Separate ******
+ * NAME
+ *	    Separate
+ *
+ * SYNOPSIS
+ *      void Separate(char *ValueList, float results[],
+ *              unsigned short numValues)
+ *
+ * PURPOSE
+ *	    Read numValues numbers separated by spaces, the missing values
+ *	    are set to 0
+ *
+ **********************************
+ */
+void Separate(char *ValueList, float results[], unsigned short numValues)
+{
+    char *value;
+    unsigned short position, next, i;
+
+    position = 0;
+    for (i = 0; i < numValues; i++)
+    {
+        position = FindText(ValueList, position);
+        next = FindSpace(ValueList, position);
+        value = mid(ValueList, position, (unsigned short)(next - position));
+        results[i] = (value != NULL) ? (float)atof(value) : 0.0f;
+        free(value);
+        position = next;
+    }
+}
+
+/****f*  ftconfig.c/FindText ******
+ * NAME
+ *	    FindText, FindSpace, mid
+ *
+ * SYNOPSIS
+ *      unsigned short FindText(char *str, unsigned short StartPos)
+ *      unsigned short FindSpace(char *str, unsigned short StartPos)
+ *      char *mid(char *instr, unsigned short startpos,
+ *              unsigned short length)
+ *
+ * PURPOSE
+ *	    String helpers of Separate: position of the next non space (or
+ *	    space) character, the end of the string if none, and a copy of
+ *	    part of a string (to be freed)
+ *
+ **********************************
+ */
+unsigned short FindText(char *str, unsigned short StartPos)
+{
+    while ((str[StartPos] != '\0') && isspace((unsigned char)str[StartPos]))
+    {
+        StartPos++;
+    }
+    return StartPos;
+}
+
+unsigned short FindSpace(char *str, unsigned short StartPos)
+{
+    while ((str[StartPos] != '\0') && !isspace((unsigned char)str[StartPos]))
+    {
+        StartPos++;
+    }
+    return StartPos;
+}
+
+char *mid(char *instr, unsigned short startpos, unsigned short length)
+{
+    char *result;
+
+    result = (char *)malloc(length + 1);
+    if (result != NULL)
+    {
+        memcpy(result, instr + startpos, length);
+        result[length] = '\0';
+    }
+    return result;
+}
+
+/****f*  ftconfig.c/ATI_strdup ******
+ * NAME
+ *	    ATI_strdup
+ *
+ * SYNOPSIS
+ *      char *ATI_strdup(const char *s)
+ *
+ * PURPOSE
+ *	    Copy a string with malloc, the DOM_String_dup of dom.h
+ *
+ **********************************
+ */
+char *ATI_strdup(const char *s)
+{
+    char *copy;
+
+    if (s == NULL)
+    {
+        return NULL;
+    }
+    copy = (char *)malloc(strlen(s) + 1);
+    if (copy != NULL)
+    {
+        strcpy(copy, s);
+    }
+    return copy;
+}
+
+/****f*  ftconfig.c/DOM_Element_getAttribute ******
+ * NAME
+ *	    DOM_Element_getAttribute
+ *
+ * SYNOPSIS
+ *      DOM_String *DOM_Element_getAttribute(const DOM_Element *element,
+ *              const DOM_String *name)
+ *
+ * OUTPUT
+ *      Returns the value of the attribute, NULL if the element does not
+ *      have it
+ *
+ **********************************
+ */
+DOM_String *DOM_Element_getAttribute(const DOM_Element *element,
+        const DOM_String *name)
+{
+    NodeEntry *entry;
+
+    if ((element == NULL) || (element->attributes == NULL))
+    {
+        return NULL;
+    }
+    for (entry = element->attributes->first; entry != NULL;
+            entry = entry->next)
+    {
+        if (strcmp(entry->node->nodeName, name) == 0)
+        {
+            return entry->node->nodeValue;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * read a whole file to a null terminated string
+ */
+static char *read_text_file(const char *fileName)
+{
+    FILE *file;
+    char *text;
+    long size;
+
+    file = fopen(fileName, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    if ((fseek(file, 0, SEEK_END) != 0) || ((size = ftell(file)) < 0)
+            || (size > MAX_CAL_FILE_SIZE) || (fseek(file, 0, SEEK_SET) != 0))
+    {
+        fclose(file);
+        return NULL;
+    }
+    text = (char *)malloc(size + 1);
+    if ((text != NULL) && (fread(text, 1, size, file) != (size_t)size))
+    {
+        free(text);
+        text = NULL;
+    }
+    if (text != NULL)
+    {
+        text[size] = '\0';
+    }
+    fclose(file);
+    return text;
+}
+
+/*
+ * parse an XML document, returns its root element (to be freed with
+ * xml_free_node) or NULL if the document is not well formed
+ */
+static DOM_Node *xml_parse(const char *text)
+{
+    DOM_Node *root;
+
+    text = xml_skip_markup(text);
+    if (*text != '<')
+    {
+        return NULL;
+    }
+    root = xml_parse_element(&text, NULL);
+    return root;
+}
+
+/*
+ * parse the element starting at *text, which is moved after the element
+ */
+static DOM_Node *xml_parse_element(const char **text, DOM_Node *parent)
+{
+    DOM_Node *element, *node;
+    const char *p, *start;
+    char quote;
+    size_t length;
+
+    /* tag name */
+    p = *text + 1;
+    start = p;
+    while ((*p != '\0') && !isspace((unsigned char)*p) && (*p != '>')
+            && (*p != '/'))
+    {
+        p++;
+    }
+    element = xml_new_node(DOM_ELEMENT_NODE, start, p - start);
+    if (element == NULL)
+    {
+        return NULL;
+    }
+    element->parentNode = parent;
+    element->u.Element.tagName = element->nodeName;
+
+    /* attributes */
+    for (;;)
+    {
+        while (isspace((unsigned char)*p))
+        {
+            p++;
+        }
+        if ((*p == '/') || (*p == '>') || (*p == '\0'))
+        {
+            break;
+        }
+        start = p;
+        while ((*p != '\0') && (*p != '=') && !isspace((unsigned char)*p))
+        {
+            p++;
+        }
+        node = xml_new_node(DOM_ATTRIBUTE_NODE, start, p - start);
+        if (xml_append(element->attributes, node) != 0)
+        {
+            xml_free_node(node);
+            xml_free_node(element);
+            return NULL;
+        }
+        while (isspace((unsigned char)*p))
+        {
+            p++;
+        }
+        if (*p++ != '=')
+        {
+            xml_free_node(element);
+            return NULL;
+        }
+        while (isspace((unsigned char)*p))
+        {
+            p++;
+        }
+        quote = *p++;
+        if ((quote != '"') && (quote != '\''))
+        {
+            xml_free_node(element);
+            return NULL;
+        }
+        start = p;
+        while ((*p != '\0') && (*p != quote))
+        {
+            p++;
+        }
+        if (*p++ == '\0')
+        {
+            xml_free_node(element);
+            return NULL;
+        }
+        node->nodeValue = xml_decode(start, p - 1 - start);
+        node->u.Attr.name = node->nodeName;
+        node->u.Attr.value = node->nodeValue;
+        node->u.Attr.specified = 1;
+    }
+    if (*p == '/')
+    {
+        /* empty element */
+        if (p[1] != '>')
+        {
+            xml_free_node(element);
+            return NULL;
+        }
+        *text = p + 2;
+        return element;
+    }
+    if (*p++ != '>')
+    {
+        xml_free_node(element);
+        return NULL;
+    }
+
+    /* content */
+    for (;;)
+    {
+        start = p;
+        while ((*p != '\0') && (*p != '<'))
+        {
+            p++;
+        }
+        if (*p == '\0')
+        {
+            xml_free_node(element);
+            return NULL;
+        }
+        for (length = 0; start + length < p; length++)
+        {
+            if (!isspace((unsigned char)start[length]))
+            {
+                break;
+            }
+        }
+        if (start + length < p)
+        {
+            node = xml_new_node(DOM_TEXT_NODE, "#text", 5);
+            if ((node == NULL) || (xml_append(element->childNodes, node) != 0))
+            {
+                xml_free_node(node);
+                xml_free_node(element);
+                return NULL;
+            }
+            node->parentNode = element;
+            node->nodeValue = xml_decode(start, p - start);
+            node->u.CharacterData.data = node->nodeValue;
+        }
+        if (p[1] == '/')
+        {
+            /* closing tag, must match */
+            length = strlen(element->nodeName);
+            if ((strncmp(p + 2, element->nodeName, length) != 0)
+                    || ((p[2 + length] != '>')
+                        && !isspace((unsigned char)p[2 + length]))
+                    || (strchr(p + 2 + length, '>') == NULL))
+            {
+                xml_free_node(element);
+                return NULL;
+            }
+            *text = strchr(p + 2 + length, '>') + 1;
+            break;
+        }
+        if ((p[1] == '!') || (p[1] == '?'))
+        {
+            p = xml_skip_markup(p);
+            continue;
+        }
+        node = xml_parse_element(&p, element);
+        if ((node == NULL) || (xml_append(element->childNodes, node) != 0))
+        {
+            xml_free_node(node);
+            xml_free_node(element);
+            return NULL;
+        }
+    }
+
+    /* links between the children */
+    element->firstChild = (element->childNodes->first != NULL)
+        ? element->childNodes->first->node : NULL;
+    element->lastChild = (element->childNodes->last != NULL)
+        ? element->childNodes->last->node : NULL;
+    return element;
+}
+
+/*
+ * allocate a node with its (empty) attribute and child lists
+ */
+static DOM_Node *xml_new_node(unsigned short nodeType, const char *name,
+        size_t nameLength)
+{
+    DOM_Node *node;
+
+    node = (DOM_Node *)calloc(1, sizeof(DOM_Node));
+    if (node == NULL)
+    {
+        return NULL;
+    }
+    node->nodeType = nodeType;
+    node->nodeName = xml_decode(name, nameLength);
+    node->childNodes = xml_new_list();
+    node->attributes = xml_new_list();
+    if ((node->nodeName == NULL) || (node->childNodes == NULL)
+            || (node->attributes == NULL))
+    {
+        xml_free_node(node);
+        return NULL;
+    }
+    return node;
+}
+
+static DOM_NodeList *xml_new_list(void)
+{
+    return (DOM_NodeList *)calloc(1, sizeof(DOM_NodeList));
+}
+
+/*
+ * add a node at the end of a list, returns 0 on success
+ */
+static int xml_append(DOM_NodeList *list, DOM_Node *node)
+{
+    NodeEntry *entry;
+
+    if (node == NULL)
+    {
+        return 1;
+    }
+    entry = (NodeEntry *)calloc(1, sizeof(NodeEntry));
+    if (entry == NULL)
+    {
+        return 1;
+    }
+    entry->node = node;
+    entry->prev = list->last;
+    if (list->last != NULL)
+    {
+        list->last->next = entry;
+        list->last->node->nextSibling = node;
+        node->previousSibling = list->last->node;
+    }
+    else
+    {
+        list->first = entry;
+    }
+    list->last = entry;
+    list->length++;
+    return 0;
+}
+
+/*
+ * copy text replacing the predefined entities
+ */
+static char *xml_decode(const char *text, size_t length)
+{
+    static const char *entities[5] = {"&amp;", "&lt;", "&gt;", "&quot;",
+        "&apos;"};
+    static const char characters[5] = {'&', '<', '>', '"', '\''};
+    char *result;
+    size_t i, j, k, entityLength;
+
+    result = (char *)malloc(length + 1);
+    if (result == NULL)
+    {
+        return NULL;
+    }
+    for (i = 0, j = 0; i < length; j++)
+    {
+        result[j] = text[i++];
+        if (result[j] != '&')
+        {
+            continue;
+        }
+        for (k = 0; k < 5; k++)
+        {
+            entityLength = strlen(entities[k]);
+            if ((i - 1 + entityLength <= length)
+                    && (strncmp(text + i - 1, entities[k], entityLength) == 0))
+            {
+                result[j] = characters[k];
+                i += entityLength - 1;
+                break;
+            }
+        }
+    }
+    result[j] = '\0';
+    return result;
+}
+
+/*
+ * skip spaces, the XML declaration, processing instructions, comments and
+ * the document type, returns the next element or text
+ */
+static const char *xml_skip_markup(const char *text)
+{
+    const char *end;
+
+    for (;;)
+    {
+        while (isspace((unsigned char)*text))
+        {
+            text++;
+        }
+        if (strncmp(text, "<!--", 4) == 0)
+        {
+            end = strstr(text + 4, "-->");
+            text = (end != NULL) ? end + 3 : text + strlen(text);
+        }
+        else if ((strncmp(text, "<?", 2) == 0) || (strncmp(text, "<!", 2) == 0))
+        {
+            end = strchr(text, '>');
+            text = (end != NULL) ? end + 1 : text + strlen(text);
+        }
+        else
+        {
+            return text;
+        }
+    }
+}
+
+/*
+ * free a node, its attributes and its children
+ */
+static void xml_free_node(DOM_Node *node)
+{
+    NodeEntry *entry, *next;
+    DOM_NodeList *lists[2];
+    int i;
+
+    if (node == NULL)
+    {
+        return;
+    }
+    lists[0] = node->attributes;
+    lists[1] = node->childNodes;
+    for (i = 0; i < 2; i++)
+    {
+        if (lists[i] == NULL)
+        {
+            continue;
+        }
+        for (entry = lists[i]->first; entry != NULL; entry = next)
+        {
+            next = entry->next;
+            xml_free_node(entry->node);
+            free(entry);
+        }
+        free(lists[i]);
+    }
+    free(node->nodeName);
+    free(node->nodeValue);
+    free(node);
+}
+
+/*
+ * index-th (from 1) child element of a node with the given name
+ */
+static DOM_Node *xml_child(const DOM_Node *node, const char *name,
+        unsigned short index)
+{
+    NodeEntry *entry;
+
+    for (entry = node->childNodes->first; entry != NULL; entry = entry->next)
+    {
+        if ((entry->node->nodeType == DOM_ELEMENT_NODE)
+                && (strcmp(entry->node->nodeName, name) == 0)
+                && (--index == 0))
+        {
+            return entry->node;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * double precision TTM, returns 0 on success
+ */
+static short transform_matrix(const Transform *xform, double result[6][6],
+        Units ForceUnits, Units TorqueUnits)
+{
+    double rotation[3][3];
+    double d[3];
+    double cx, sx, cy, sy, cz, sz;
+    double distScale, angleScale;
+    unsigned short i, j;
+
+    if ((DistConv(xform->DistUnits) == 0.0f)
+            || (AngleConv(xform->AngleUnits) == 0.0f)
+            || (ForceConv(ForceUnits) == 0.0f)
+            || (TorqueConv(TorqueUnits) == 0.0f))
+    {
+        return 1;
+    }
+
+    /* distances in torque length, angles in radians */
+    distScale = (double)TorqueConv(TorqueUnits)
+        / ((double)DistConv(xform->DistUnits) * ForceConv(ForceUnits));
+    angleScale = PI / 180.0 / AngleConv(xform->AngleUnits);
+    for (i = 0; i < 3; i++)
+    {
+        d[i] = xform->TT[i] * distScale;
+    }
+    cx = cos(xform->TT[3] * angleScale);
+    sx = sin(xform->TT[3] * angleScale);
+    cy = cos(xform->TT[4] * angleScale);
+    sy = sin(xform->TT[4] * angleScale);
+    cz = cos(xform->TT[5] * angleScale);
+    sz = sin(xform->TT[5] * angleScale);
+
+    /* transpose of Rx * Ry * Rz */
+    rotation[0][0] = cy * cz;
+    rotation[0][1] = sx * sy * cz + cx * sz;
+    rotation[0][2] = sx * sz - cx * sy * cz;
+    rotation[1][0] = -cy * sz;
+    rotation[1][1] = cx * cz - sx * sy * sz;
+    rotation[1][2] = sx * cz + cx * sy * sz;
+    rotation[2][0] = sy;
+    rotation[2][1] = -sx * cy;
+    rotation[2][2] = cx * cy;
+
+    for (i = 0; i < 3; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            result[i][j] = rotation[i][j];
+            result[i][j + 3] = 0.0;
+            result[i + 3][j + 3] = rotation[i][j];
+        }
+        /* -R' [d]x */
+        result[i + 3][0] = rotation[i][2] * d[1] - rotation[i][1] * d[2];
+        result[i + 3][1] = rotation[i][0] * d[2] - rotation[i][2] * d[0];
+        result[i + 3][2] = rotation[i][1] * d[0] - rotation[i][0] * d[1];
+    }
+    return 0;
+}
+
+/*
+ * case insensitive comparison of units
+ */
+static int units_match(const char *units, const char *name)
+{
+    if (units == NULL)
+    {
+        return 0;
+    }
+    while ((*units != '\0')
+            && (tolower((unsigned char)*units) == tolower((unsigned char)*name)))
+    {
+        units++;
+        name++;
+    }
+    return (*units == '\0') && (*name == '\0');
+}
+
+/*
+ * boolean attribute, True or False
+ */
+static int read_flag(const DOM_Element *elem, char *attName,
+        char *defaultValue)
+{
+    const char *value;
+
+    value = DOM_Element_getAttribute(elem, attName);
+    if (value == NULL)
+    {
+        value = defaultValue;
+    }
+    return units_match(value, "True") || units_match(value, "1");
+}
+
+/*
+ * numeric attribute
+ */
+static float read_float(const DOM_Element *elem, char *attName,
+        char *defaultValue)
+{
+    const char *value;
+
+    value = DOM_Element_getAttribute(elem, attName);
+    if (value == NULL)
+    {
+        value = defaultValue;
+    }
+    return (float)atof(value);
+}
+
+/*------------ END OF FILE ------------- */
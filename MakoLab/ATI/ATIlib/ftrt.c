@@ -0,0 +1,352 @@
+/****h* /ftrt.c ***
+ * NAME
+ *      ftrt.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      Portable implementation of the realtime force/torque conversion
+ *      interface of the ATI DAQ F/T library (ftrt.h), so voltages can be
+ *      converted without atidaqft.dll.  Besides the single sample
+ *      RTConvertToFT the library has a batch conversion for buffered
+ *      acquisitions: the temperature compensation and bias are applied
+ *      to each sample in the same pass as a fixed 6x8 matrix product,
+ *      the matrix being padded with zeros to MAX_AXES x MAX_GAUGES so
+ *      all the loops have constant bounds and are unrolled and
+ *      vectorized (over the axes) by the compiler.
+ *
+ * SEE ALSO
+ *      ftrt.h, convertVoltagesToFT.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <string.h>
+
+#include "ftrt.h"
+
+/* samples converted together, their gauges stay in cache between the */
+/* compensation and the matrix product */
+#define BATCH_BLOCK 64
+
+/* internal functions */
+static void prepare_batch(const RTCoefs *coefs, BOOL tempcomp,
+        float matrix[MAX_GAUGES][MAX_AXES], float bias[MAX_GAUGES],
+        float biasSlopes[MAX_GAUGES], float gainSlopes[MAX_GAUGES]);
+
+/****f*  ftrt.c/RTConvertToFT ******
+ * NAME
+ *	    RTConvertToFT
+ *
+ * SYNOPSIS
+ *      void RTConvertToFT(RTCoefs *coefs, float voltages[],
+ *              float result[], BOOL tempcomp)
+ *
+ * INPUTS
+ *      RTCoefs *coefs
+ *              calibration coefficients, NumChannels includes the
+ *              thermistor channel which comes last
+ *      float voltages[]
+ *              NumChannels voltages of one sample
+ *      BOOL tempcomp
+ *              TRUE to compensate the gauges for temperature
+ *
+ * OUTPUT
+ *      float result[]
+ *              NumAxes forces and torques
+ *
+ * PURPOSE
+ *	    Convert one sample.  The bias stored by RTBias is subtracted
+ *	    from the (compensated) gauge voltages, which are then
+ *	    multiplied by the working matrix.
+ *
+ **********************************
+ */
+void RTConvertToFT(RTCoefs *coefs, float voltages[], float result[],
+        BOOL tempcomp)
+{
+    float cvoltages[MAX_GAUGES];
+    unsigned short numGauges;
+    unsigned short i;
+
+    numGauges = coefs->NumChannels - 1;
+    for (i = 0; i < numGauges; i++)
+    {
+        if (tempcomp)
+        {
+            cvoltages[i] = TempComp(coefs, voltages[i], voltages[numGauges],
+                    i) - coefs->TCbias_vector[i];
+        }
+        else
+        {
+            cvoltages[i] = voltages[i] - coefs->bias_vector[i];
+        }
+    }
+    mmult(*coefs->working_matrix, coefs->NumAxes, numGauges, MAX_GAUGES,
+            cvoltages, 1, 1, result, 1);
+}
+
+/****f*  ftrt.c/RTConvertToFTBatch ******
+ * NAME
+ *	    RTConvertToFTBatch
+ *
+ * SYNOPSIS
+ *      void RTConvertToFTBatch(RTCoefs *coefs, const float voltages[],
+ *              unsigned int numSamples, unsigned int voltageStride,
+ *              float result[], BOOL tempcomp)
+ *
+ * INPUTS
+ *      RTCoefs *coefs
+ *              calibration coefficients, as for RTConvertToFT
+ *      const float voltages[]
+ *              numSamples samples, sample i starts at
+ *              voltages[i * voltageStride] with its NumChannels voltages
+ *      unsigned int numSamples
+ *              number of samples
+ *      unsigned int voltageStride
+ *              distance between samples, at least NumChannels (larger
+ *              for interleaved buffers with more channels)
+ *      BOOL tempcomp
+ *              TRUE to compensate the gauges for temperature
+ *
+ * OUTPUT
+ *      float result[]
+ *              NumAxes forces and torques per sample, sample i at
+ *              result[i * NumAxes]
+ *
+ * PURPOSE
+ *	    Convert a buffered acquisition.  Gives the same results as
+ *	    calling RTConvertToFT for each sample, the products are summed
+ *	    in the same order.
+ *
+ **********************************
+ */
+void RTConvertToFTBatch(RTCoefs *coefs, const float voltages[],
+        unsigned int numSamples, unsigned int voltageStride, float result[],
+        BOOL tempcomp)
+{
+    float matrix[MAX_GAUGES][MAX_AXES];
+    float bias[MAX_GAUGES];
+    float biasSlopes[MAX_GAUGES];
+    float gainSlopes[MAX_GAUGES];
+    float gauges[BATCH_BLOCK][MAX_GAUGES];
+    float sums[MAX_AXES];
+    const float *sample;
+    float *output;
+    float dt;
+    unsigned int numGauges, numAxes, first, count;
+    unsigned int i, j, k;
+
+    numGauges = coefs->NumChannels - 1;
+    numAxes = coefs->NumAxes;
+    prepare_batch(coefs, tempcomp, matrix, bias, biasSlopes, gainSlopes);
+
+    for (first = 0; first < numSamples; first += BATCH_BLOCK)
+    {
+        count = (numSamples - first < BATCH_BLOCK)
+            ? numSamples - first : BATCH_BLOCK;
+
+        /* compensated and biased gauges, the unused ones are 0 */
+        for (i = 0; i < count; i++)
+        {
+            sample = voltages + (first + i) * voltageStride;
+            dt = tempcomp ? sample[numGauges] - coefs->thermistor : 0.0f;
+            for (k = 0; k < MAX_GAUGES; k++)
+            {
+                gauges[i][k] = (k < numGauges) ? sample[k] : 0.0f;
+            }
+            for (k = 0; k < MAX_GAUGES; k++)
+            {
+                gauges[i][k] = (gauges[i][k] - biasSlopes[k] * dt)
+                    * (1.0f + gainSlopes[k] * dt) - bias[k];
+            }
+        }
+
+        /* fixed 8x6 product, the 6 axes are summed side by side (in */
+        /* gauge order, as mmult does) and the padding adds exact zeros */
+        output = result + first * numAxes;
+        for (i = 0; i < count; i++)
+        {
+            for (j = 0; j < MAX_AXES; j++)
+            {
+                sums[j] = 0.0f;
+            }
+            for (k = 0; k < MAX_GAUGES; k++)
+            {
+                for (j = 0; j < MAX_AXES; j++)
+                {
+                    sums[j] += matrix[k][j] * gauges[i][k];
+                }
+            }
+            for (j = 0; j < numAxes; j++)
+            {
+                output[i * numAxes + j] = sums[j];
+            }
+        }
+    }
+}
+
+/****f*  ftrt.c/RTBias ******
+ * NAME
+ *	    RTBias
+ *
+ * SYNOPSIS
+ *      void RTBias(RTCoefs *coefs, float voltages[])
+ *
+ * INPUTS
+ *      RTCoefs *coefs
+ *              calibration coefficients
+ *      float voltages[]
+ *              NumChannels voltages of the unloaded transducer
+ *
+ * PURPOSE
+ *	    Store the voltages to be subtracted from the following samples,
+ *	    both as measured and temperature compensated
+ *
+ **********************************
+ */
+void RTBias(RTCoefs *coefs, float voltages[])
+{
+    unsigned short numGauges;
+    unsigned short i;
+
+    numGauges = coefs->NumChannels - 1;
+    for (i = 0; i < coefs->NumChannels; i++)
+    {
+        coefs->bias_vector[i] = voltages[i];
+    }
+    for (i = 0; i < numGauges; i++)
+    {
+        coefs->TCbias_vector[i] = TempComp(coefs, voltages[i],
+                voltages[numGauges], i);
+    }
+}
+
+/****f*  ftrt.c/TempComp ******
+ * NAME
+ *	    TempComp
+ *
+ * SYNOPSIS
+ *      float TempComp(RTCoefs *coefs, float G, float T, unsigned short i)
+ *
+ * INPUTS
+ *      RTCoefs *coefs
+ *              calibration coefficients
+ *      float G
+ *              voltage of gauge i
+ *      float T
+ *              thermistor voltage
+ *      unsigned short i
+ *              gauge index
+ *
+ * OUTPUT
+ *      Returns the compensated gauge voltage
+ *
+ * PURPOSE
+ *	    Remove the bias drift and correct the gain drift of a gauge, both
+ *	    linear in the thermistor voltage change since calibration:
+ *	    (G - bias_slope * dT) * (1 + gain_slope * dT)
+ *
+ **********************************
+ */
+float TempComp(RTCoefs *coefs, float G, float T, unsigned short i)
+{
+    float dt;
+
+    dt = T - coefs->thermistor;
+    return (G - coefs->bias_slopes[i] * dt)
+        * (1.0f + coefs->gain_slopes[i] * dt);
+}
+
+/****f*  ftrt.c/mmult ******
+ * NAME
+ *	    mmult
+ *
+ * SYNOPSIS
+ *      void mmult(float *a, unsigned short ra, unsigned short ca,
+ *              unsigned short dca, float *b, unsigned short cb,
+ *              unsigned short dcb, float *c, unsigned short dcc)
+ *
+ * INPUTS
+ *      float *a
+ *              ra x ca matrix, rows dca floats apart
+ *      float *b
+ *              ca x cb matrix, rows dcb floats apart
+ *
+ * OUTPUT
+ *      float *c
+ *              ra x cb product, rows dcc floats apart
+ *
+ * PURPOSE
+ *	    Generic matrix product used by the single sample conversion
+ *
+ **********************************
+ */
+void mmult(float *a, unsigned short ra, unsigned short ca, unsigned short dca,
+        float *b, unsigned short cb, unsigned short dcb,
+        float *c, unsigned short dcc)
+{
+    float sum;
+    unsigned short i, j, k;
+
+    for (i = 0; i < ra; i++)
+    {
+        for (j = 0; j < cb; j++)
+        {
+            sum = 0.0f;
+            for (k = 0; k < ca; k++)
+            {
+                sum += a[i * dca + k] * b[k * dcb + j];
+            }
+            c[i * dcc + j] = sum;
+        }
+    }
+}
+
+/*
+ * copy the coefficients used by the batch conversion to zero padded
+ * arrays, the working matrix transposed.  Without temperature
+ * compensation the slopes are 0, which leaves the voltages unchanged
+ */
+static void prepare_batch(const RTCoefs *coefs, BOOL tempcomp,
+        float matrix[MAX_GAUGES][MAX_AXES], float bias[MAX_GAUGES],
+        float biasSlopes[MAX_GAUGES], float gainSlopes[MAX_GAUGES])
+{
+    unsigned int numGauges;
+    unsigned int j, k;
+
+    numGauges = coefs->NumChannels - 1;
+    memset(matrix, 0, MAX_AXES * MAX_GAUGES * sizeof(float));
+    memset(bias, 0, MAX_GAUGES * sizeof(float));
+    memset(biasSlopes, 0, MAX_GAUGES * sizeof(float));
+    memset(gainSlopes, 0, MAX_GAUGES * sizeof(float));
+
+    for (j = 0; j < coefs->NumAxes; j++)
+    {
+        for (k = 0; k < numGauges; k++)
+        {
+            matrix[k][j] = coefs->working_matrix[j][k];
+        }
+    }
+    for (k = 0; k < numGauges; k++)
+    {
+        if (tempcomp)
+        {
+            bias[k] = coefs->TCbias_vector[k];
+            biasSlopes[k] = coefs->bias_slopes[k];
+            gainSlopes[k] = coefs->gain_slopes[k];
+        }
+        else
+        {
+            bias[k] = coefs->bias_vector[k];
+        }
+    }
+}
+
+/*------------ END OF FILE ------------- */
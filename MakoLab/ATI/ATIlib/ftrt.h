@@ -30,8 +30,13 @@
 /*modifications
 Dec.23.2004b - Sam Skuce (ATI Industrial Automation) - added #undefs for TRUE and FALSE because they were
 causing redefined macro warnings
+2015 - Mako Surgical - added RTConvertToFTBatch for buffered acquisitions, implemented in ftrt.c
+2015 - Mako Surgical - added an include guard, ftrt.h is included by several headers
 */
 
+#ifndef FTRT_H
+#define FTRT_H
+
 #define MAX_AXES 6
 #define MAX_GAUGES 8
 
@@ -59,6 +64,10 @@ struct RTCoefs {
 
 void RTConvertToFT(RTCoefs *coefs, float voltages[],float result[],BOOL tempcomp);
 void RTBias(RTCoefs *coefs, float voltages[]);
+// converts numSamples samples of NumChannels voltages, voltageStride floats apart,
+// into numSamples*NumAxes forces and torques
+void RTConvertToFTBatch(RTCoefs *coefs, const float voltages[], unsigned int numSamples,
+						unsigned int voltageStride, float result[], BOOL tempcomp);
 
 //-------------------------------------------------
 //private routines
@@ -67,3 +76,5 @@ void mmult(float *a, unsigned short ra, unsigned short ca, unsigned short dca,
 		   float *b, unsigned short cb, unsigned short dcb,
 		   float *c, unsigned short dcc);
 float TempComp(RTCoefs *coefs,float G,float T,unsigned short i);
+
+#endif /* FTRT_H */
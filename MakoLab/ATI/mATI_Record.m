@@ -30,30 +30,17 @@ len = pnet(udp,'readpacket');
 
 % check that correct sized packet is received
 if len == 4*(9*DATASIZE)*NRECORDS,
-    for packi = 1:NRECORDS,  % use while loop to read all records
-    
-        % position of RDT record within a single output stream
-        rdt_sequence = pnet(udp,'read',DATASIZE,'uint32',BYTEORDER);
-
-        % internal sample number of the F/T record
-        ft_sequence = pnet(udp,'read',DATASIZE,'uint32',BYTEORDER);
-
-        % contains the system status code at the time of the record
-        status = pnet(udp,'read',DATASIZE,'uint32',BYTEORDER);
-
-        % F/T data in counts (must convert with counts/force and
-        % counts/torque from netftapi2.xml)
-        fx = pnet(udp,'read',DATASIZE,'int32',BYTEORDER);
-        fy = pnet(udp,'read',DATASIZE,'int32',BYTEORDER);
-        fz = pnet(udp,'read',DATASIZE,'int32',BYTEORDER);
-        tx = pnet(udp,'read',DATASIZE,'int32',BYTEORDER);
-        ty = pnet(udp,'read',DATASIZE,'int32',BYTEORDER);
-        tz = pnet(udp,'read',DATASIZE,'int32',BYTEORDER);
-
-        FT(packi,:) = [ double([fx, fy, fz])/cpf, double([tx, ty, tz])/cpt ];
-        s = rdt_sequence;
-
-    end
+    % read all the records at once, one record per column:
+    %   rdt_sequence, position of RDT record within a single output stream
+    %   ft_sequence, internal sample number of the F/T record
+    %   status, system status code at the time of the record
+    %   fx fy fz tx ty tz, F/T data in counts (must convert with
+    %       counts/force and counts/torque from netftapi2.xml)
+    records = pnet(udp,'read',[9*DATASIZE NRECORDS],'int32',BYTEORDER);
+    records = reshape(double(records),9*DATASIZE,NRECORDS);
+
+    FT = [ records(4:6,:)'/cpf, records(7:9,:)'/cpt ];
+    s = mod(records(1,end),2^32);
 
 % display error IF packet size is incorrect
 else
@@ -45,6 +45,7 @@
 %   ndi_camera/setmode    - Set the mode of the camera
 %   ndi_camera/tx         - Send the tx command to the ndi camera and parse the reply
 %   ndi_camera/bx         - Send the bx command to the ndi camera and parse the reply
+%   ndi_camera/stream     - Track continuously with the ndi camera in a background reader
 %
 % MakoLab Scripts
 %   phase_hgs             - Gui to help perfrom the phasing procedure on the Hgs Robot.
@@ -54,7 +55,11 @@
 % Miscellaneous functions
 %   read_stl              - Read an stl file to provide the facet and vertices data for patch command.
 %   show_stl              - display the model from an stl file
+%   mesh_lods             - Levels of detail of a patch model, selected by screen size
 %   transform_vertices    - Multiply a transform to all the vertices
+%   vec2tr                - convert 16 element vectors to 4x4 homogenous transforms
+%   tr2vec                - convert 4x4 homogenous transforms to 16 element vectors
+%   readArmConfig         - Read the parameters of an hgs_arm.cfg file
 %   setup_network         - changes a computers network settings to either DHCP or static
 %
 % GUI related functions
@@ -68,7 +73,22 @@
 %   parseCrisisReply      - Parse the reply received from CRISIS
 %   sendReceiveCrisisComm - Send command to CRISIS and receive the reply
 %   convertBytesToFloat   - Converts given 4 bytes to equivalent float number
+%   convertBytesToNumbers - Convert a buffer of bytes to arrays of numbers
 %   convertStructToString - converts matlab structures into strings that can be used for display
+%   loadStlFile           - Read a binary or ascii STL file
+%   decimateMesh          - Build levels of detail of a triangle mesh
+%   convertVoltagesToFT   - Convert buffered ATI F/T voltages to forces and torques
+%   loadFTCalibration     - Read an ATI F/T calibration file
+%   ftStream              - Stream ATI F/T samples converted in a background thread
+%   parseNdiBxReply       - Parse a binary BX reply of the NDI camera
+%   ndiStream             - Stream NDI tracking poses from a background reader
+%   fusionBuffer          - Time aligned buffer of arm, camera and F/T samples
+%   mscribeStream         - Sample the MicroScribe arm in a background thread
+%   registerPointPairs    - Rigid registration of paired point sets
+%   pivotCalibration      - Tool center point and pivot point from pivoting poses
+%   transformVertices     - Apply 4x4 transforms to blocks of vertices
+%   forwardKinematics     - Forward kinematics of the arm for arrays of joint angles
+%   kinematicCalibration  - Kinematic parameters of the arm from ball bar samples
 %
 % Makolab Demonstrations
 %   makolabdemo           - Simple Demo showing the use of the MakoLab package
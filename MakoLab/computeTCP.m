@@ -122,21 +122,14 @@ hexit = uicontrol(h,...
                 'String','Click exit to save and exit',...
                 'Callback','',...
                 'Enable','off');
-            % compute TCP
-            for i=1:count-1
-                A((i-1)*3+1:(i-1)*3+3,1:3) = T(1:3,1:3,i)-T(1:3,1:3,i+1);
-                b((i-1)*3+1:(i-1)*3+3,1)   = T(1:3,4,i+1)-T(1:3,4,i);
-            end
-
-            tcp_tool = (pinv(A)*b)';
+            % compute TCP and the measurement error
+            [tcp_tool, ~, rms_error] = pivotCalibration(T);
 
             % display result
             set(htext0,...
                 'FontSize',0.3,...
                 'String',{'TCP:'; num2str(tcp_tool)});
 
-            % find measurement error
-            rms_error = find_rms_error(T,tcp_tool);
             % display result
             set(htext,...
                 'FontSize',0.3,...
@@ -161,19 +154,14 @@ hexit = uicontrol(h,...
                 'Callback','',...
                 'Enable','off');
 
-            for i=1:count-1
-                A((i-1)*3+1:(i-1)*3+3,1:3) = T(1:3,1:3,i)-T(1:3,1:3,i+1);
-                b((i-1)*3+1:(i-1)*3+3,1)   = T(1:3,4,i+1)-T(1:3,4,i);
-            end
-            tcp_tool = (pinv(A)*b)';
+            % compute TCP and the measurement error
+            [tcp_tool, ~, rms_error] = pivotCalibration(T);
 
             % display result
             set(htext0,...
                 'FontSize',0.3,...
                 'String',{'TCP:'; num2str(tcp_tool)});
 
-            % find measurement error
-            rms_error = find_rms_error(T,tcp_tool);
             % display result
             set(htext,...
                 'FontSize',0.3,...
@@ -185,25 +173,4 @@ hexit = uicontrol(h,...
     end
 end
 
-function rms_error = find_rms_error(T,tcp_tool)
-
-P = [];
-% find the tool tip loacation for each measurement
-for count = 1:size(T,3)
-    t = T(1:4,1:4,count);
-    p = t*[tcp_tool,1]';
-    P = [P,p(1:3)];
-end
-% find mean loacation
-P_mean = mean(P,2);
-% find measurement error
-for n = 1:size(P,2)
-    P_err(n)= norm(P_mean - P(:,n));
-end
-% rms
-rms_error = sqrt(sum(P_err.^2)/size(P_err,2));
-
-end
-
-
 %------------- END OF FILE ----------------
@@ -0,0 +1,96 @@
+function lods = mesh_lods(faces,verts,targets)
+%MESH_LODS Levels of detail of a patch model, selected by screen size
+%
+% Syntax:
+%   lods = mesh_lods(faces,verts)
+%       builds levels of detail of the model given by faces (Nx3, one based)
+%       and verts (Mx3), as used by the patch command.  lods is a struct
+%       array with fields faces, verts and maxError, from the full model
+%       (maxError 0) to the coarsest level.  maxError is the largest
+%       distance of a level to the full model, in the units of verts.
+%   lods = mesh_lods(faces,verts,targets)
+%       targets specifies the facet counts of the levels, values below 1
+%       are fractions of the facet count of the full model.  The default is
+%       [0.5 0.25 0.1 0.04 0.015]
+%   level = mesh_lods(lods,axesHandle)
+%       selects the coarsest level whose error is below half a pixel in the
+%       current view of the axes axesHandle.
+%   level = mesh_lods(lods,pixelSize)
+%       selects the coarsest level whose error is below half of pixelSize
+%       (in the units of verts).
+%
+% Notes:
+%   The levels are built by decimateMesh.  Shared vertices are merged
+%   first, so the facets from read_stl can be used with or without
+%   welding.
+%   The pixel size of an axes is computed from its camera, so it follows
+%   zoom and camera motion.  Select the level again when the view changes
+%   and update the faces and vertices of the patch together.
+%
+% Example:
+%   [face,vert] = read_stl('ABCD.stl',0);
+%   lods = mesh_lods(face,vert);
+%   level = mesh_lods(lods,gca);
+%   patch('faces',lods(level).faces,'vertices',lods(level).verts);
+%
+% See also:
+%   decimateMesh, read_stl, show_stl, hgs_robot/plot3
+%
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+% level selection
+if isstruct(faces)
+    lods = faces;
+    if (isscalar(verts) && ishandle(verts) ...
+            && strcmp(get(verts,'type'),'axes'))
+        pixelSize = axesPixelSize(verts);
+    else
+        pixelSize = verts;
+    end
+    lods = find([lods.maxError] <= pixelSize/2,1,'last');
+    return;
+end
+
+if (nargin<3)
+    targets = [0.5 0.25 0.1 0.04 0.015];
+end
+
+% merge the shared vertices, decimation needs an indexed mesh
+[meshVerts,firstUse,vertexMap] = unique(double(verts),'rows'); %#ok<ASGLU>
+meshFaces = vertexMap(faces);
+
+[lodFacets,lodVertices,lodError] = decimateMesh(...
+    int32(meshFaces'-1),single(meshVerts'),targets);
+
+lods = struct('faces',meshFaces,'verts',meshVerts,'maxError',0);
+for i=1:length(lodFacets)
+    lods(i+1).faces = double(lodFacets{i}')+1;
+    lods(i+1).verts = double(lodVertices{i}');
+    lods(i+1).maxError = lodError(i);
+end
+
+% coarsest last, in case the targets were not in order
+[sortedError,order] = sort([lods.maxError]); %#ok<ASGLU>
+lods = lods(order);
+
+end
+
+%--------------------------------------------------------------------------
+% size of a pixel at the camera target
+%--------------------------------------------------------------------------
+function pixelSize = axesPixelSize(axesHandle)
+cameraDistance = norm(get(axesHandle,'CameraPosition')...
+    -get(axesHandle,'CameraTarget'));
+viewHeight = 2*cameraDistance*tan(get(axesHandle,'CameraViewAngle')*pi/360);
+axesPosition = getpixelposition(axesHandle);
+pixelSize = viewHeight/max(axesPosition(4),1);
+end
+
+
+% --------- END OF FILE ----------
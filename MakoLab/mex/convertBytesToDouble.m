@@ -6,8 +6,10 @@
 %       uintByteArray must be 8 elements long and of type uint8.  if the array
 %       is longer than 8 bytes only the first 8 bytes will be used.
 %
-% See also: 
+%   To convert many values in one call use convertBytesToNumbers.
 %
+% See also: 
+%   convertBytesToNumbers
 
 % 
 % $Author: dmoses $
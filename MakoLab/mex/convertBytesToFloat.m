@@ -6,8 +6,10 @@
 %       uintByteArray must be 4 elements long and of type uint8.  if the array
 %       is longer than 4 bytes only the first 4 bytes will be used.
 %
-% See also: 
+%   To convert many values in one call use convertBytesToNumbers.
 %
+% See also: 
+%   convertBytesToNumbers
 
 % 
 % $Author: dmoses $
@@ -0,0 +1,341 @@
+/****h* /convertBytesToNumbers.c ***
+ * NAME
+ *      convertBytesToNumbers.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function converts a buffer of bytes to arrays of numbers in
+ *      one call, according to a layout (type, offset, count, stride and
+ *      endianness of each array).  Replaces converting the values one by
+ *      one with convertBytesToFloat or convertBytesToDouble
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+#include <stdio.h>
+#include <string.h>
+
+/* defines */
+#define TRUE 1
+#define FALSE 0
+#define TYPE_NAME_LENGTH 16
+#define ERROR_MESSAGE_LENGTH 256
+
+typedef struct {
+    const char *name;
+    mxClassID classId;
+    size_t size;
+} NumberType;
+
+typedef struct {
+    const NumberType *type;
+    size_t offset;          /* bytes before the first value */
+    size_t count;           /* number of values */
+    size_t stride;          /* bytes from a value to the next */
+    int bigEndian;
+} Layout;
+
+static const NumberType numberTypes[] = {
+    {"double", mxDOUBLE_CLASS, 8},
+    {"single", mxSINGLE_CLASS, 4},
+    {"int8", mxINT8_CLASS, 1},
+    {"uint8", mxUINT8_CLASS, 1},
+    {"int16", mxINT16_CLASS, 2},
+    {"uint16", mxUINT16_CLASS, 2},
+    {"int32", mxINT32_CLASS, 4},
+    {"uint32", mxUINT32_CLASS, 4},
+    {"int64", mxINT64_CLASS, 8},
+    {"uint64", mxUINT64_CLASS, 8}
+};
+
+/* internal functions */
+static int getLayout(const mxArray *layoutArray, int index, size_t numBytes,
+        Layout *layout, char *errorMessage);
+static int getEndian(const mxArray *endianArray, int *bigEndian);
+static int getSize(const mxArray *sizeArray, size_t *value);
+static void convertValues(const unsigned char *bytes, const Layout *layout,
+        unsigned char *values);
+static int isBigEndianHost(void);
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    char errorMessage[ERROR_MESSAGE_LENGTH];
+    Layout layout;
+    const unsigned char *bytes;
+    size_t numBytes;
+    int numOutputs, i;
+
+    /* first check the inputs */
+    if ((nrhs < 2) || (nrhs > 3))
+    {
+        mexErrMsgTxt("Must specify the bytes and the layout");
+        return;
+    }
+    if (mxGetClassID(prhs[0]) != mxUINT8_CLASS)
+    {
+        mexErrMsgTxt("Datatype must be uint8");
+        return;
+    }
+    bytes = (const unsigned char *)mxGetData(prhs[0]);
+    numBytes = mxGetNumberOfElements(prhs[0]);
+
+    /* a type name, or a structure array with one element per output */
+    if (mxIsChar(prhs[1]))
+    {
+        numOutputs = 1;
+    }
+    else if (mxIsStruct(prhs[1]) && (nrhs == 2))
+    {
+        numOutputs = (int)mxGetNumberOfElements(prhs[1]);
+    }
+    else
+    {
+        mexErrMsgTxt("Layout must be a type name or a structure array");
+        return;
+    }
+    if ((nlhs > numOutputs) || ((numOutputs > 1) && (nlhs < numOutputs)))
+    {
+        mexErrMsgTxt("Must have one output per element of the layout");
+        return;
+    }
+
+    for (i = 0; i < numOutputs; i++)
+    {
+        if (!getLayout(prhs[1], mxIsChar(prhs[1]) ? -1 : i, numBytes,
+                    &layout, errorMessage))
+        {
+            mexErrMsgTxt(errorMessage);
+            return;
+        }
+        if ((nrhs == 3) && !getEndian(prhs[2], &layout.bigEndian))
+        {
+            mexErrMsgTxt("Endianness must be 'little' or 'big'");
+            return;
+        }
+
+        plhs[i] = mxCreateNumericMatrix((int)layout.count, 1,
+                layout.type->classId, mxREAL);
+        convertValues(bytes, &layout, (unsigned char *)mxGetData(plhs[i]));
+    }
+    return;
+}
+
+/*
+ * layout of the output index, from the type name if index is -1.  Returns
+ * FALSE with an error message if the layout is invalid or does not fit in
+ * the bytes
+ */
+static int getLayout(const mxArray *layoutArray, int index, size_t numBytes,
+        Layout *layout, char *errorMessage)
+{
+    char typeName[TYPE_NAME_LENGTH];
+    const mxArray *field;
+    size_t size;
+    size_t room;
+    int fits;
+    int i;
+
+    field = (index < 0) ? layoutArray
+        : mxGetField(layoutArray, index, "type");
+    if ((field == NULL) || !mxIsChar(field)
+            || (mxGetString(field, typeName, TYPE_NAME_LENGTH) != 0))
+    {
+        typeName[0] = '\0';
+    }
+    layout->type = NULL;
+    for (i = 0; i < (int)(sizeof(numberTypes) / sizeof(numberTypes[0])); i++)
+    {
+        if (strcmp(typeName, numberTypes[i].name) == 0)
+        {
+            layout->type = &numberTypes[i];
+        }
+    }
+    if (layout->type == NULL)
+    {
+        sprintf(errorMessage, "Layout %d: type must be double, single, "
+                "int8, uint8, int16, uint16, int32, uint32, int64 or uint64",
+                (index < 0) ? 1 : index + 1);
+        return FALSE;
+    }
+    size = layout->type->size;
+    layout->offset = 0;
+    layout->stride = size;
+    layout->count = numBytes / size;
+    layout->bigEndian = FALSE;
+    if (index < 0)
+    {
+        return TRUE;
+    }
+
+    /* the values are 0 based byte offsets, the count fills the bytes */
+    if (!getSize(mxGetField(layoutArray, index, "offset"), &layout->offset)
+            || !getSize(mxGetField(layoutArray, index, "stride"),
+                &layout->stride)
+            || !getEndian(mxGetField(layoutArray, index, "endian"),
+                &layout->bigEndian))
+    {
+        sprintf(errorMessage, "Layout %d: offset and stride must be "
+                "non negative integers, endian 'little' or 'big'", index + 1);
+        return FALSE;
+    }
+    if (layout->stride == 0)
+    {
+        layout->stride = size;
+    }
+    /* bytes left after the first value, offset and stride come from the */
+    /* caller so nothing is added that could wrap around */
+    fits = (layout->offset <= numBytes)
+        && (numBytes - layout->offset >= size);
+    room = fits ? numBytes - layout->offset - size : 0;
+    layout->count = fits ? room / layout->stride + 1 : 0;
+    field = mxGetField(layoutArray, index, "count");
+    if ((field != NULL) && !mxIsEmpty(field))
+    {
+        if (!getSize(field, &layout->count))
+        {
+            sprintf(errorMessage, "Layout %d: count must be a non negative "
+                    "integer", index + 1);
+            return FALSE;
+        }
+        if ((layout->count > 0)
+                && (!fits || (layout->count - 1 > room / layout->stride)))
+        {
+            sprintf(errorMessage, "Layout %d: %d values do not fit in the "
+                    "%d bytes", index + 1, (int)layout->count, (int)numBytes);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * endianness from 'little' or 'big', unchanged if the field is missing
+ */
+static int getEndian(const mxArray *endianArray, int *bigEndian)
+{
+    char endian[TYPE_NAME_LENGTH];
+
+    if ((endianArray == NULL) || mxIsEmpty(endianArray))
+    {
+        return TRUE;
+    }
+    if (!mxIsChar(endianArray)
+            || (mxGetString(endianArray, endian, TYPE_NAME_LENGTH) != 0))
+    {
+        return FALSE;
+    }
+    if (strcmp(endian, "big") == 0)
+    {
+        *bigEndian = TRUE;
+    }
+    else if (strcmp(endian, "little") == 0)
+    {
+        *bigEndian = FALSE;
+    }
+    else
+    {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * non negative integer, unchanged if the field is missing
+ */
+static int getSize(const mxArray *sizeArray, size_t *value)
+{
+    double number;
+
+    if ((sizeArray == NULL) || mxIsEmpty(sizeArray))
+    {
+        return TRUE;
+    }
+    if (!mxIsNumeric(sizeArray))
+    {
+        return FALSE;
+    }
+    number = mxGetScalar(sizeArray);
+    if ((number < 0) || (number != (double)(size_t)number))
+    {
+        return FALSE;
+    }
+    *value = (size_t)number;
+    return TRUE;
+}
+
+/*
+ * copy the values, reversing their bytes if the endianness differs from
+ * the host.  The inner loops have a constant trip count per type so the
+ * compiler can unroll and vectorize them
+ */
+static void convertValues(const unsigned char *bytes, const Layout *layout,
+        unsigned char *values)
+{
+    const unsigned char *source;
+    size_t size, count, stride, i, j;
+
+    size = layout->type->size;
+    count = layout->count;
+    stride = layout->stride;
+    source = bytes + layout->offset;
+
+    if ((layout->bigEndian == isBigEndianHost()) || (size == 1))
+    {
+        if (stride == size)
+        {
+            memcpy(values, source, count * size);
+            return;
+        }
+        for (i = 0; i < count; i++)
+        {
+            memcpy(values + i * size, source + i * stride, size);
+        }
+        return;
+    }
+
+    switch (size)
+    {
+        case 2:
+            for (i = 0; i < count; i++)
+            {
+                for (j = 0; j < 2; j++)
+                    values[i * 2 + j] = source[i * stride + 1 - j];
+            }
+            break;
+        case 4:
+            for (i = 0; i < count; i++)
+            {
+                for (j = 0; j < 4; j++)
+                    values[i * 4 + j] = source[i * stride + 3 - j];
+            }
+            break;
+        default:
+            for (i = 0; i < count; i++)
+            {
+                for (j = 0; j < 8; j++)
+                    values[i * 8 + j] = source[i * stride + 7 - j];
+            }
+            break;
+    }
+}
+
+static int isBigEndianHost(void)
+{
+    unsigned short one = 1;
+
+    return (*(unsigned char *)&one == 0);
+}
+
+/*----------- END OF FILE ------------ */
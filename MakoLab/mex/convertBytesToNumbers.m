@@ -0,0 +1,44 @@
+%CONVERTBYTESTONUMBERS Convert a buffer of bytes to arrays of numbers
+%
+% Syntax:
+%   values = convertBytesToNumbers(bytes,type)
+%       converts the uint8 array bytes to a column of values of the given
+%       type: double, single, int8, uint8, int16, uint16, int32, uint32,
+%       int64 or uint64.  The values are little endian, trailing bytes that
+%       do not make a whole value are ignored.
+%   values = convertBytesToNumbers(bytes,type,endian)
+%       endian is 'little' or 'big'.
+%   [values1,values2,...] = convertBytesToNumbers(bytes,layout)
+%       converts several arrays in one call, layout is a structure array
+%       with one element per output and the fields:
+%           type     type of the values, as above
+%           offset   bytes before the first value (default 0)
+%           count    number of values (default as many as fit)
+%           stride   bytes from the start of a value to the next (default
+%                    the size of the type, for packed values)
+%           endian   'little' (default) or 'big'
+%       The fields other than type can be missing or empty.
+%
+% Notes:
+%   Replaces the calls to convertBytesToFloat and convertBytesToDouble in
+%   loops, the whole buffer is converted in one pass.  The byte order is
+%   swapped only when the endianness differs from the computer.
+%
+% Example:
+%   % 3 packed floats at byte 2 and a big endian uint32 every 16 bytes
+%   layout = struct('type',{'single','uint32'},'offset',{2,0},...
+%       'count',{3,[]},'stride',{[],16},'endian',{'little','big'});
+%   [position,counter] = convertBytesToNumbers(uint8(reply),layout);
+%
+% See also:
+%    convertBytesToFloat, convertBytesToDouble, typecast
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
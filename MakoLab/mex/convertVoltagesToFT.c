@@ -0,0 +1,115 @@
+/****h* /convertVoltagesToFT.c ***
+ * NAME
+ *      convertVoltagesToFT.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function converts buffered ATI F/T transducer voltages to
+ *      forces and torques with the realtime calibration coefficients,
+ *      using the batch conversion of the portable ATI library (ftrt.c)
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+
+#include "ftrt.h"
+#include "rt_coefs.h"
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    char errorMessage[RT_COEFS_ERROR_LENGTH];
+    RTCoefs coefs;
+    float *voltages;
+    float *result;
+    double *ft;
+    BOOL tempcomp = FALSE;
+    int numSamples, numChannels, numGauges, numAxes;
+    int i, j;
+
+    /* first check the inputs */
+    if (nrhs < 2)
+    {
+        mexErrMsgTxt("Must specify the voltages and the calibration coefficients");
+        return;
+    }
+
+    if ((!mxIsDouble(prhs[0]) && !mxIsSingle(prhs[0]))
+            || mxIsComplex(prhs[0]))
+    {
+        mexErrMsgTxt("Voltages must be a real double or single array");
+        return;
+    }
+    numSamples = (int)mxGetM(prhs[0]);
+    numChannels = (int)mxGetN(prhs[0]);
+    numGauges = numChannels - 1;
+    if ((numGauges < 1) || (numGauges > MAX_GAUGES))
+    {
+        mexErrMsgTxt("Voltages must have 2 to 9 columns, the gauges and the thermistor");
+        return;
+    }
+
+    if (nrhs > 2)
+    {
+        tempcomp = mxIsLogicalScalarTrue(prhs[2])
+            || (mxIsNumeric(prhs[2]) && (mxGetScalar(prhs[2]) != 0));
+    }
+
+    if (get_rt_coefs(prhs[1], numChannels, tempcomp, &coefs,
+                errorMessage) != RT_COEFS_SUCCESS)
+    {
+        mexErrMsgTxt(errorMessage);
+        return;
+    }
+    numAxes = coefs.NumAxes;
+
+    /* one sample per row in matlab, the library wants one per stride */
+    voltages = (float *)mxMalloc((numSamples * numChannels + 1)
+            * sizeof(float));
+    result = (float *)mxMalloc((numSamples * numAxes + 1) * sizeof(float));
+    for (j = 0; j < numChannels; j++)
+    {
+        if (mxIsDouble(prhs[0]))
+        {
+            for (i = 0; i < numSamples; i++)
+                voltages[i * numChannels + j] =
+                    (float)mxGetPr(prhs[0])[j * numSamples + i];
+        }
+        else
+        {
+            for (i = 0; i < numSamples; i++)
+                voltages[i * numChannels + j] =
+                    ((float *)mxGetData(prhs[0]))[j * numSamples + i];
+        }
+    }
+
+    RTConvertToFTBatch(&coefs, voltages, numSamples, numChannels, result,
+            tempcomp);
+
+    plhs[0] = mxCreateDoubleMatrix(numSamples, numAxes, mxREAL);
+    ft = mxGetPr(plhs[0]);
+    for (i = 0; i < numSamples; i++)
+    {
+        for (j = 0; j < numAxes; j++)
+        {
+            ft[j * numSamples + i] = result[i * numAxes + j];
+        }
+    }
+
+    mxFree(voltages);
+    mxFree(result);
+    return;
+}
+
+/*----------- END OF FILE ------------ */
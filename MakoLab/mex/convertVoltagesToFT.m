@@ -0,0 +1,40 @@
+%CONVERTVOLTAGESTOFT Convert buffered ATI F/T voltages to forces and torques
+%
+% Syntax:
+%   ft = convertVoltagesToFT(voltages,rtCoefs)
+%       converts the transducer voltages, one sample per row, to forces
+%       and torques.  voltages is an Nx(G+1) double or single array, the G
+%       gauge voltages followed by the thermistor voltage.  rtCoefs is a
+%       structure with the realtime calibration coefficients (see RTCoefs
+%       in ftrt.h):
+%           working_matrix   Ax(G) matrix, one row per axis (up to 6)
+%           bias_vector      voltages subtracted from the gauges
+%                            (optional, see RTBias)
+%           TCbias_vector    temperature compensated voltages subtracted
+%                            from the gauges (optional)
+%           bias_slopes      bias drift of each gauge per thermistor volt
+%           gain_slopes      gain drift of each gauge per thermistor volt
+%           thermistor       thermistor voltage at calibration
+%       ft is an NxA double array, one sample per row.
+%   ft = convertVoltagesToFT(voltages,rtCoefs,tempComp)
+%       compensates the gauges for temperature if tempComp is true, the
+%       fields bias_slopes, gain_slopes and thermistor are then required.
+%
+% Notes:
+%   The results are the same as converting each sample with RTConvertToFT
+%   of the ATI DAQ F/T library, computed in single precision.  The
+%   conversion is done by the portable implementation of the library in
+%   ATI/ATIlib/ftrt.c, so no ATI dll is needed.
+%
+% See also:
+%    mATI_Record, mATI_Sample, mATI_Bias
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
@@ -0,0 +1,123 @@
+/****h* /decimateMesh.c ***
+ * NAME
+ *      decimateMesh.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function builds levels of detail of an indexed triangle mesh
+ *      by quadric error metric edge collapses.  The mesh is the same as
+ *      the one returned by loadStlFile.
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+#include <string.h>
+
+#include "mesh_decimate.h"
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    MeshLevel levels[MESH_MAX_LEVELS];
+    int32_t targetFacets[MESH_MAX_LEVELS];
+    mxArray *levelFacets, *levelVertices;
+    double *targets;
+    int32_t numFacets, numVertices, numLevels;
+    int32_t i;
+    int dims[2];
+
+    /* first check the inputs */
+    if (nrhs != 3)
+    {
+        mexErrMsgTxt("Must specify the facets, vertices and target facet counts");
+        return;
+    }
+
+    if (!mxIsInt32(prhs[0]) || (mxGetM(prhs[0]) != 3))
+    {
+        mexErrMsgTxt("Facets must be a 3xN int32 array of zero based indices");
+        return;
+    }
+
+    if (!mxIsSingle(prhs[1]) || (mxGetM(prhs[1]) != 3))
+    {
+        mexErrMsgTxt("Vertices must be a 3xM single array");
+        return;
+    }
+
+    if (!mxIsDouble(prhs[2]) || mxIsEmpty(prhs[2])
+            || (mxGetNumberOfElements(prhs[2]) > MESH_MAX_LEVELS))
+    {
+        mexErrMsgTxt("Target facet counts must be a vector of 1 to 32 values");
+        return;
+    }
+
+    numFacets = (int32_t)mxGetN(prhs[0]);
+    numVertices = (int32_t)mxGetN(prhs[1]);
+    numLevels = (int32_t)mxGetNumberOfElements(prhs[2]);
+
+    /* targets below 1 are fractions of the facet count */
+    targets = mxGetPr(prhs[2]);
+    for (i = 0; i < numLevels; i++)
+    {
+        if (targets[i] < 0)
+        {
+            mexErrMsgTxt("Target facet counts must not be negative");
+            return;
+        }
+        targetFacets[i] = (targets[i] < 1) ? (int32_t)(targets[i] * numFacets)
+            : ((targets[i] < numFacets) ? (int32_t)targets[i] : numFacets);
+    }
+
+    if (mesh_decimate((int32_t *)mxGetData(prhs[0]), numFacets,
+                (float *)mxGetData(prhs[1]), numVertices, targetFacets,
+                numLevels, levels) != MESH_DECIMATE_SUCCESS)
+    {
+        mexErrMsgTxt("Unable to decimate the mesh, check the facet indices");
+        return;
+    }
+
+    plhs[0] = mxCreateCellMatrix(1, numLevels);
+    if (nlhs > 1)
+        plhs[1] = mxCreateCellMatrix(1, numLevels);
+    if (nlhs > 2)
+        plhs[2] = mxCreateDoubleMatrix(1, numLevels, mxREAL);
+
+    for (i = 0; i < numLevels; i++)
+    {
+        dims[0] = 3;
+        dims[1] = levels[i].numFacets;
+        levelFacets = mxCreateNumericArray(2, dims, mxINT32_CLASS, mxREAL);
+        memcpy(mxGetData(levelFacets), levels[i].facets,
+                levels[i].numFacets * 3 * sizeof(int32_t));
+        mxSetCell(plhs[0], i, levelFacets);
+
+        if (nlhs > 1)
+        {
+            dims[1] = levels[i].numVertices;
+            levelVertices = mxCreateNumericArray(2, dims, mxSINGLE_CLASS,
+                    mxREAL);
+            memcpy(mxGetData(levelVertices), levels[i].vertices,
+                    levels[i].numVertices * 3 * sizeof(float));
+            mxSetCell(plhs[1], i, levelVertices);
+        }
+        if (nlhs > 2)
+            mxGetPr(plhs[2])[i] = levels[i].maxError;
+    }
+
+    mesh_free_levels(levels, numLevels);
+    return;
+}
+
+/*----------- END OF FILE ------------ */
@@ -0,0 +1,40 @@
+%DECIMATEMESH Build levels of detail of a triangle mesh
+%
+% Syntax:
+%   [lodFacets,lodVertices,lodError] = decimateMesh(ifacets,vertices,targetFacets)
+%       simplifies the mesh given by ifacets, a 3xN int32 array of zero
+%       based vertex indices, and vertices, a 3xM single array (the outputs
+%       of loadStlFile with welding).  targetFacets is a vector with the
+%       facet count of each level, values below 1 are fractions of N.
+%       lodFacets and lodVertices are cell arrays with one level per
+%       target, in the same format as the inputs and in the order of
+%       targetFacets.  lodError is the largest distance (in the units of
+%       the vertices) between a level and the original surface, as
+%       estimated by the quadric error metric.
+%
+% Notes:
+%   The cheapest edge (by the quadric error metric) is collapsed to the
+%   point closest to the planes of the facets it replaces, until the
+%   facet count of a level is reached.  The levels are produced from the
+%   largest to the smallest target from one simplification, so each
+%   level is a simplification of the larger ones.
+%   Edges whose collapse would fold a facet over or make the mesh non
+%   manifold are skipped, so a level can keep more facets than its target.
+%   Open edges (used by a single facet) are kept in place by a high
+%   penalty.  Facets that use the same vertex twice are dropped.
+%   The mesh must be welded (see loadStlFile), facets that do not share
+%   their vertices can not be simplified.
+%   At most 32 levels can be requested at once.
+%
+% See also:
+%    loadStlFile, mesh_lods, show_stl, hgs_robot/plot3
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
@@ -0,0 +1,291 @@
+/****h* /forwardKinematics.c ***
+ * NAME
+ *      forwardKinematics.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function computes the forward kinematics of the arm, with the
+ *      Jacobians and the link frames, for arrays of joint angle samples
+ *      (forward_kinematics.c).  The arm is given by its DH matrix or by the
+ *      configuration parameters of the hgs_arm.cfg file.
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+#include <string.h>
+
+#include "forward_kinematics.h"
+
+/* defines */
+#define OPTION_LENGTH 16
+
+/* internal functions */
+static void getModel(FkModel *model, const mxArray *arm,
+        const char *calibration);
+static void getDhMatrix(FkModel *model, const double *dh, uint32_t numJoints,
+        int rowMajor);
+static void getFlange(FkModel *model, const mxArray *flange, int rowMajor);
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    char option[OPTION_LENGTH];
+    char calibration[OPTION_LENGTH];
+    FkModel model;
+    FkProblem problem;
+    const mxArray *flange = NULL;
+    const mxArray *tool = NULL;
+    int dims[4];
+    uint32_t numSamples, numJoints;
+    int32_t numThreads;
+    int i;
+
+    /* first check the inputs */
+    if ((nrhs < 2) || (nrhs % 2 != 0))
+    {
+        mexErrMsgTxt("Must specify the arm and the joint angles, then parameter/value pairs");
+        return;
+    }
+
+    strcpy(calibration, "nominal");
+    numThreads = fk_number_of_processors();
+    for (i = 2; i < nrhs; i += 2)
+    {
+        if (!mxIsChar(prhs[i])
+                || (mxGetString(prhs[i], option, OPTION_LENGTH) != 0))
+        {
+            mexErrMsgTxt("Parameter names must be strings");
+            return;
+        }
+        if (strcmp(option, "Flange") == 0)
+        {
+            flange = prhs[i + 1];
+        }
+        else if (strcmp(option, "Tool") == 0)
+        {
+            tool = prhs[i + 1];
+        }
+        else if (strcmp(option, "Calibration") == 0)
+        {
+            if (!mxIsChar(prhs[i + 1])
+                    || (mxGetString(prhs[i + 1], calibration,
+                            OPTION_LENGTH) != 0)
+                    || ((strcmp(calibration, "nominal") != 0)
+                        && (strcmp(calibration, "lefty") != 0)
+                        && (strcmp(calibration, "righty") != 0)))
+            {
+                mexErrMsgTxt("Calibration must be nominal, lefty or righty");
+                return;
+            }
+        }
+        else if (strcmp(option, "Threads") == 0)
+        {
+            if (!mxIsNumeric(prhs[i + 1]) || mxIsEmpty(prhs[i + 1]))
+            {
+                mexErrMsgTxt("Threads must be a number");
+                return;
+            }
+            numThreads = (mxGetScalar(prhs[i + 1]) >= 1)
+                ? (int32_t)mxGetScalar(prhs[i + 1]) : 1;
+        }
+        else
+        {
+            mexErrMsgTxt("Unknown parameter, use Flange, Tool, Calibration or Threads");
+            return;
+        }
+    }
+
+    getModel(&model, prhs[0], calibration);
+    if (flange != NULL)
+    {
+        getFlange(&model, flange, 0);
+    }
+    numJoints = model.numJoints;
+
+    /* one sample per row, extra columns are ignored, or a single vector */
+    if (!mxIsDouble(prhs[1]) || mxIsComplex(prhs[1])
+            || (mxGetNumberOfDimensions(prhs[1]) != 2))
+    {
+        mexErrMsgTxt("Joint angles must be a NxDOF double array");
+        return;
+    }
+    if ((mxGetN(prhs[1]) == 1) && (mxGetM(prhs[1]) == numJoints))
+    {
+        numSamples = 1;
+    }
+    else if (mxGetN(prhs[1]) >= numJoints)
+    {
+        numSamples = (uint32_t)mxGetM(prhs[1]);
+    }
+    else
+    {
+        mexErrMsgTxt("Joint angles must have a column per joint of the arm");
+        return;
+    }
+
+    problem.model = &model;
+    problem.jointAngles = mxGetPr(prhs[1]);
+    problem.numSamples = numSamples;
+    problem.tool = NULL;
+    problem.toolPerSample = 0;
+    if (tool != NULL)
+    {
+        if (!mxIsDouble(tool) || mxIsComplex(tool)
+                || !((mxGetNumberOfElements(tool) == 3)
+                    || ((mxGetM(tool) == numSamples) && (mxGetN(tool) == 3))))
+        {
+            mexErrMsgTxt("Tool must be a 3 element vector or a Nx3 array");
+            return;
+        }
+        problem.tool = mxGetPr(tool);
+        problem.toolPerSample = (mxGetNumberOfElements(tool) != 3);
+    }
+
+    dims[0] = 4;
+    dims[1] = 4;
+    dims[2] = (int)numSamples;
+    plhs[0] = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+    problem.transforms = mxGetPr(plhs[0]);
+    problem.jacobians = NULL;
+    problem.frames = NULL;
+    if (nlhs > 1)
+    {
+        dims[0] = 6;
+        dims[1] = (int)numJoints;
+        plhs[1] = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+        problem.jacobians = mxGetPr(plhs[1]);
+    }
+    if (nlhs > 2)
+    {
+        dims[0] = 4;
+        dims[1] = 4;
+        dims[2] = (int)numJoints;
+        dims[3] = (int)numSamples;
+        plhs[2] = mxCreateNumericArray(4, dims, mxDOUBLE_CLASS, mxREAL);
+        problem.frames = mxGetPr(plhs[2]);
+    }
+
+    fk_evaluate(&problem, numThreads);
+    return;
+}
+
+/*
+ * the model from a DOFx4 DH matrix, or from the fields of the
+ * configuration parameters where the matrices are stored row by row
+ */
+static void getModel(FkModel *model, const mxArray *arm,
+        const char *calibration)
+{
+    const mxArray *dh, *flange;
+
+    memset(model, 0, sizeof(FkModel));
+    model->flange[0] = model->flange[5] = 1;
+    model->flange[10] = model->flange[15] = 1;
+
+    if (!mxIsStruct(arm))
+    {
+        if (!mxIsDouble(arm) || mxIsComplex(arm)
+                || (mxGetNumberOfDimensions(arm) != 2)
+                || (mxGetN(arm) != 4) || mxIsEmpty(arm))
+        {
+            mexErrMsgTxt("The arm must be a DOFx4 DH matrix or the configuration parameters");
+            return;
+        }
+        getDhMatrix(model, mxGetPr(arm), (uint32_t)mxGetM(arm), 0);
+        return;
+    }
+
+    if (strcmp(calibration, "lefty") == 0)
+    {
+        dh = mxGetField(arm, 0, "CALIBRATED_DH_LEFTY");
+        flange = mxGetField(arm, 0, "CALIBRATED_FLANGE_LEFTY");
+    }
+    else if (strcmp(calibration, "righty") == 0)
+    {
+        dh = mxGetField(arm, 0, "CALIBRATED_DH_RIGHTY");
+        flange = mxGetField(arm, 0, "CALIBRATED_FLANGE_RIGHTY");
+    }
+    else
+    {
+        dh = mxGetField(arm, 0, "NOMINAL_DH_MATRIX");
+        flange = mxGetField(arm, 0, "NOMINAL_FLANGE_TRANSFORM");
+    }
+    if ((dh == NULL) || !mxIsDouble(dh) || mxIsComplex(dh) || mxIsEmpty(dh)
+            || (mxGetNumberOfElements(dh) % 4 != 0))
+    {
+        mexErrMsgTxt("The configuration parameters have no DH matrix for this calibration");
+        return;
+    }
+    getDhMatrix(model, mxGetPr(dh),
+            (uint32_t)(mxGetNumberOfElements(dh) / 4), 1);
+    if (flange != NULL)
+    {
+        getFlange(model, flange, 1);
+    }
+}
+
+static void getDhMatrix(FkModel *model, const double *dh, uint32_t numJoints,
+        int rowMajor)
+{
+    uint32_t j;
+    int k;
+
+    if (numJoints > FK_MAX_JOINTS)
+    {
+        mexErrMsgTxt("Too many joints in the DH matrix");
+        return;
+    }
+    model->numJoints = numJoints;
+    for (j = 0; j < numJoints; j++)
+    {
+        for (k = 0; k < 4; k++)
+        {
+            model->dh[j][k] = rowMajor ? dh[4 * j + k] : dh[k * numJoints + j];
+        }
+    }
+}
+
+/*
+ * a 4x4 transform, or x y z and the xyz fixed angles of the kinematic
+ * calibration
+ */
+static void getFlange(FkModel *model, const mxArray *flange, int rowMajor)
+{
+    const double *values;
+    int r, c;
+
+    if (!mxIsDouble(flange) || mxIsComplex(flange)
+            || ((mxGetNumberOfElements(flange) != 16)
+                && (mxGetNumberOfElements(flange) != 6)))
+    {
+        mexErrMsgTxt("Flange must be a 4x4 transform or a 6 element vector");
+        return;
+    }
+    values = mxGetPr(flange);
+    if (mxGetNumberOfElements(flange) == 6)
+    {
+        fk_flange_from_vector(values, model->flange);
+        return;
+    }
+    for (r = 0; r < 4; r++)
+    {
+        for (c = 0; c < 4; c++)
+        {
+            model->flange[4 * c + r] = rowMajor ? values[4 * r + c]
+                : values[4 * c + r];
+        }
+    }
+}
+
+/*----------- END OF FILE ------------ */
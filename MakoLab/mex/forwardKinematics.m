@@ -0,0 +1,55 @@
+%FORWARDKINEMATICS Forward kinematics of the arm for arrays of joint angles
+%
+% Syntax:
+%   T = forwardKinematics(dh,jointAngles)
+%       dh is the DOFx4 DH matrix of the arm, one row per joint of
+%       a, alpha, d and theta offset (Craig convention, as in the
+%       hgs_arm.cfg files).  jointAngles is an NxDOF array, one sample per
+%       row (extra columns are ignored), or a single vector of DOF angles.
+%       Returns the 4x4xN transforms of the last link in the base frame.
+%   T = forwardKinematics(cfgParams,jointAngles)
+%       cfgParams holds the configuration parameters of the arm, as
+%       returned by commDataPair(hgs,'get_cfg_params') or readArmConfig.
+%       The NOMINAL_DH_MATRIX and NOMINAL_FLANGE_TRANSFORM are used.
+%   [T,J] = forwardKinematics(...)
+%       also returns the 6xDOFxN Jacobians of the tool point, linear
+%       velocity (rows 1:3) and angular velocity (rows 4:6) in the base
+%       frame per unit joint velocity.
+%   [T,J,frames] = forwardKinematics(...)
+%       also returns the 4x4xDOFxN frames of every link, without the
+%       flange and the tool.
+%   [...] = forwardKinematics(...,'Flange',flange)
+%       the flange is appended after the last link, a 4x4 transform or
+%       the 6 element vector [x y z rx ry rz] of the kinematic calibration
+%       (xyz fixed angles).  Overrides the flange of cfgParams.
+%   [...] = forwardKinematics(...,'Tool',point)
+%       T is moved to the tool point given in the flange frame, a 3
+%       element vector or an Nx3 array (one point per sample).
+%   [...] = forwardKinematics(cfgParams,...,'Calibration',calibration)
+%       calibration is 'nominal' (default), 'lefty' or 'righty' to use the
+%       CALIBRATED_DH_* and CALIBRATED_FLANGE_* parameters.
+%   [...] = forwardKinematics(...,'Threads',numThreads)
+%       uses at most numThreads threads (default one per processor).
+%
+% Notes:
+%   The samples are split evenly over the threads, jobs of less than 4096
+%   samples per thread do not start threads.  Angles are in radians and
+%   the lengths in the units of the DH matrix (meters in the cfg files).
+%
+% Example:
+%   cfgParams = readArmConfig('hgs_arm3_0.cfg.default');
+%   [T,J] = forwardKinematics(cfgParams,jointAngles,'Tool',[0 0 0.1]);
+%   tipPositions = reshape(T(1:3,4,:),3,[])';
+%
+% See also:
+%    readArmConfig, transformVertices, hgs_robot/plot3
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
@@ -0,0 +1,447 @@
+/****h* /forward_kinematics.c ***
+ * NAME
+ *      forward_kinematics.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      This library evaluates the forward kinematics of the arm for many
+ *      joint angle samples.  The samples are taken in blocks and the frame
+ *      of the blocks is kept one coefficient per array, so multiplying by
+ *      the link transform is a loop over the samples of the block with
+ *      the DH constants in registers, a form the compilers vectorize.  The
+ *      Jacobian is the geometric one of the tool point in the base frame,
+ *      a joint i adds z(i) x (p - o(i)) to the linear and z(i) to the
+ *      angular velocity.  The samples are split into equal ranges, one per
+ *      thread.
+ *
+ * SEE ALSO
+ *      forward_kinematics.h, forwardKinematics.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <math.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif /* _WIN32 */
+
+#include "forward_kinematics.h"
+
+/* samples first to first + count - 1 */
+typedef struct {
+    const FkProblem *problem;
+    uint32_t first;
+    uint32_t count;
+} RangeJob;
+
+/* internal functions */
+static void evaluate_range(RangeJob *job);
+static void evaluate_block(const FkProblem *problem, uint32_t first,
+        uint32_t count);
+static void run_jobs(RangeJob *jobs, int32_t numJobs);
+
+/****f*  forward_kinematics.c/fk_flange_from_vector ******
+ * NAME
+ *	    fk_flange_from_vector
+ *
+ * SYNOPSIS
+ *      void fk_flange_from_vector(const double vector[6], double flange[16])
+ *
+ * INPUTS
+ *      const double vector[6]
+ *              flange as x, y, z and the xyz fixed angles about x, y and z
+ *              (Craig p. 46), as identified by the kinematic calibration
+ *
+ * OUTPUT
+ *      double flange[16]
+ *              4x4 transform, column major
+ *
+ **********************************
+ */
+void fk_flange_from_vector(const double vector[6], double flange[16])
+{
+    double cg = cos(vector[3]), sg = sin(vector[3]);
+    double cb = cos(vector[4]), sb = sin(vector[4]);
+    double ca = cos(vector[5]), sa = sin(vector[5]);
+
+    flange[0] = ca * cb;
+    flange[1] = sa * cb;
+    flange[2] = -sb;
+    flange[3] = 0;
+    flange[4] = ca * sb * sg - sa * cg;
+    flange[5] = sa * sb * sg + ca * cg;
+    flange[6] = cb * sg;
+    flange[7] = 0;
+    flange[8] = ca * sb * cg + sa * sg;
+    flange[9] = sa * sb * cg - ca * sg;
+    flange[10] = cb * cg;
+    flange[11] = 0;
+    flange[12] = vector[0];
+    flange[13] = vector[1];
+    flange[14] = vector[2];
+    flange[15] = 1;
+}
+
+/****f*  forward_kinematics.c/fk_flange_to_vector ******
+ * NAME
+ *	    fk_flange_to_vector
+ *
+ * SYNOPSIS
+ *      void fk_flange_to_vector(const double flange[16], double vector[6])
+ *
+ * INPUTS
+ *      const double flange[16]
+ *              4x4 transform, column major
+ *
+ * OUTPUT
+ *      double vector[6]
+ *              x, y, z and the xyz fixed angles, the inverse of
+ *              fk_flange_from_vector.  At +-90 degrees about y the angle
+ *              about z is taken as 0
+ *
+ **********************************
+ */
+void fk_flange_to_vector(const double flange[16], double vector[6])
+{
+    double cb;
+
+    vector[0] = flange[12];
+    vector[1] = flange[13];
+    vector[2] = flange[14];
+    cb = sqrt(flange[0] * flange[0] + flange[1] * flange[1]);
+    vector[4] = atan2(-flange[2], cb);
+    if (cb > FK_GIMBAL_TOLERANCE)
+    {
+        vector[5] = atan2(flange[1], flange[0]);
+        vector[3] = atan2(flange[6], flange[10]);
+    }
+    else
+    {
+        vector[5] = 0;
+        vector[3] = (flange[2] < 0) ? atan2(flange[4], flange[5])
+            : -atan2(flange[4], flange[5]);
+    }
+}
+
+/****f*  forward_kinematics.c/fk_evaluate ******
+ * NAME
+ *	    fk_evaluate
+ *
+ * SYNOPSIS
+ *      void fk_evaluate(const FkProblem *problem, int32_t numThreads)
+ *
+ * INPUTS
+ *      const FkProblem *problem
+ *              model, joint angles and tool points of the samples, and
+ *              where to put the results
+ *      int32_t numThreads
+ *              most threads to use, fewer are started for small jobs
+ *
+ * OUTPUT
+ *      the transforms of the tool frame, and the Jacobians and the link
+ *      frames when their arrays are given
+ *
+ **********************************
+ */
+void fk_evaluate(const FkProblem *problem, int32_t numThreads)
+{
+    RangeJob jobs[FK_MAX_THREADS];
+    uint32_t total;
+    int32_t numJobs, j;
+
+    total = problem->numSamples;
+    numJobs = (int32_t)(total / FK_MIN_THREAD_SAMPLES);
+    if (numJobs > numThreads)
+    {
+        numJobs = numThreads;
+    }
+    if (numJobs > FK_MAX_THREADS)
+    {
+        numJobs = FK_MAX_THREADS;
+    }
+    if (numJobs < 1)
+    {
+        numJobs = 1;
+    }
+
+    for (j = 0; j < numJobs; j++)
+    {
+        jobs[j].problem = problem;
+        jobs[j].first = (uint32_t)((uint64_t)total * j / numJobs);
+        jobs[j].count = (uint32_t)((uint64_t)total * (j + 1) / numJobs)
+            - jobs[j].first;
+    }
+    run_jobs(jobs, numJobs);
+}
+
+/****f*  forward_kinematics.c/fk_number_of_processors ******
+ * NAME
+ *	    fk_number_of_processors
+ *
+ * SYNOPSIS
+ *      int32_t fk_number_of_processors(void)
+ *
+ * OUTPUT
+ *      Returns the number of processors, the default number of threads
+ *
+ **********************************
+ */
+int32_t fk_number_of_processors(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return (int32_t)systemInfo.dwNumberOfProcessors;
+#else
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    return (processors > 0) ? (int32_t)processors : 1;
+#endif /* _WIN32 */
+}
+
+static void evaluate_range(RangeJob *job)
+{
+    uint32_t start, end, count;
+
+    end = job->first + job->count;
+    for (start = job->first; start < end; start += FK_BLOCK_SAMPLES)
+    {
+        count = ((end - start) < FK_BLOCK_SAMPLES)
+            ? (end - start) : FK_BLOCK_SAMPLES;
+        evaluate_block(job->problem, start, count);
+    }
+}
+
+/*
+ * evaluate count (at most FK_BLOCK_SAMPLES) samples starting at first.
+ * t holds the top 3 rows of the frame, t[4 * row + column][sample]
+ */
+static void evaluate_block(const FkProblem *problem, uint32_t first,
+        uint32_t count)
+{
+    double t[12][FK_BLOCK_SAMPLES];
+    double ct[FK_BLOCK_SAMPLES], st[FK_BLOCK_SAMPLES];
+    double e[3][FK_BLOCK_SAMPLES];
+    double axes[FK_MAX_JOINTS][6][FK_BLOCK_SAMPLES];
+    const FkModel *model = problem->model;
+    const double *f = model->flange;
+    const double *angles;
+    double *out;
+    double a, ca, sa, d, offset, t0, t1, t2, t3, dx, dy, dz;
+    uint32_t numJoints = model->numJoints;
+    uint32_t n = problem->numSamples;
+    uint32_t s, j;
+    int r, c;
+
+    for (r = 0; r < 12; r++)
+    {
+        for (s = 0; s < count; s++)
+        {
+            t[r][s] = ((r % 5) == 0);
+        }
+    }
+
+    for (j = 0; j < numJoints; j++)
+    {
+        a = model->dh[j][0];
+        ca = cos(model->dh[j][1]);
+        sa = sin(model->dh[j][1]);
+        d = model->dh[j][2];
+        offset = model->dh[j][3];
+        angles = problem->jointAngles + (size_t)j * n + first;
+        for (s = 0; s < count; s++)
+        {
+            ct[s] = cos(angles[s] + offset);
+            st[s] = sin(angles[s] + offset);
+        }
+
+        /* t = t * [ct -st 0 a; st*ca ct*ca -sa -sa*d; st*sa ct*sa ca ca*d] */
+        for (r = 0; r < 3; r++)
+        {
+            for (s = 0; s < count; s++)
+            {
+                t0 = t[4 * r][s];
+                t1 = t[4 * r + 1][s];
+                t2 = t[4 * r + 2][s];
+                t3 = t[4 * r + 3][s];
+                t[4 * r][s] = t0 * ct[s] + (t1 * ca + t2 * sa) * st[s];
+                t[4 * r + 1][s] = -t0 * st[s] + (t1 * ca + t2 * sa) * ct[s];
+                t[4 * r + 2][s] = t2 * ca - t1 * sa;
+                t[4 * r + 3][s] = t0 * a + (t2 * ca - t1 * sa) * d + t3;
+            }
+        }
+
+        if (problem->jacobians != NULL)
+        {
+            for (r = 0; r < 3; r++)
+            {
+                for (s = 0; s < count; s++)
+                {
+                    axes[j][r][s] = t[4 * r + 2][s];
+                    axes[j][3 + r][s] = t[4 * r + 3][s];
+                }
+            }
+        }
+        if (problem->frames != NULL)
+        {
+            for (s = 0; s < count; s++)
+            {
+                out = problem->frames
+                    + 16 * ((size_t)(first + s) * numJoints + j);
+                for (r = 0; r < 3; r++)
+                {
+                    for (c = 0; c < 4; c++)
+                    {
+                        out[4 * c + r] = t[4 * r + c][s];
+                    }
+                }
+                out[3] = out[7] = out[11] = 0;
+                out[15] = 1;
+            }
+        }
+    }
+
+    /* tool point in the last link frame, flange * [tool; 1] */
+    for (r = 0; r < 3; r++)
+    {
+        for (s = 0; s < count; s++)
+        {
+            e[r][s] = f[12 + r];
+        }
+        if (problem->tool == NULL)
+        {
+            continue;
+        }
+        for (c = 0; c < 3; c++)
+        {
+            if (problem->toolPerSample)
+            {
+                for (s = 0; s < count; s++)
+                {
+                    e[r][s] += f[4 * c + r]
+                        * problem->tool[(size_t)c * n + first + s];
+                }
+            }
+            else
+            {
+                for (s = 0; s < count; s++)
+                {
+                    e[r][s] += f[4 * c + r] * problem->tool[c];
+                }
+            }
+        }
+    }
+
+    for (s = 0; s < count; s++)
+    {
+        out = problem->transforms + 16 * (size_t)(first + s);
+        for (r = 0; r < 3; r++)
+        {
+            for (c = 0; c < 3; c++)
+            {
+                out[4 * c + r] = t[4 * r][s] * f[4 * c]
+                    + t[4 * r + 1][s] * f[4 * c + 1]
+                    + t[4 * r + 2][s] * f[4 * c + 2];
+            }
+            out[12 + r] = t[4 * r][s] * e[0][s] + t[4 * r + 1][s] * e[1][s]
+                + t[4 * r + 2][s] * e[2][s] + t[4 * r + 3][s];
+        }
+        out[3] = out[7] = out[11] = 0;
+        out[15] = 1;
+    }
+
+    if (problem->jacobians == NULL)
+    {
+        return;
+    }
+    for (s = 0; s < count; s++)
+    {
+        out = problem->jacobians + 6 * (size_t)numJoints * (first + s);
+        t0 = problem->transforms[16 * (size_t)(first + s) + 12];
+        t1 = problem->transforms[16 * (size_t)(first + s) + 13];
+        t2 = problem->transforms[16 * (size_t)(first + s) + 14];
+        for (j = 0; j < numJoints; j++)
+        {
+            dx = t0 - axes[j][3][s];
+            dy = t1 - axes[j][4][s];
+            dz = t2 - axes[j][5][s];
+            out[6 * j] = axes[j][1][s] * dz - axes[j][2][s] * dy;
+            out[6 * j + 1] = axes[j][2][s] * dx - axes[j][0][s] * dz;
+            out[6 * j + 2] = axes[j][0][s] * dy - axes[j][1][s] * dx;
+            out[6 * j + 3] = axes[j][0][s];
+            out[6 * j + 4] = axes[j][1][s];
+            out[6 * j + 5] = axes[j][2][s];
+        }
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI range_thread(LPVOID argument)
+{
+    evaluate_range((RangeJob *)argument);
+    return 0;
+}
+#else
+static void *range_thread(void *argument)
+{
+    evaluate_range((RangeJob *)argument);
+    return NULL;
+}
+#endif /* _WIN32 */
+
+/*
+ * run the jobs, the first one in the calling thread and the others in
+ * their own thread.  A job whose thread could not be started is run by
+ * the calling thread
+ */
+static void run_jobs(RangeJob *jobs, int32_t numJobs)
+{
+    int32_t started[FK_MAX_THREADS];
+#ifdef _WIN32
+    HANDLE threads[FK_MAX_THREADS];
+#else
+    pthread_t threads[FK_MAX_THREADS];
+#endif /* _WIN32 */
+    int32_t i;
+
+    for (i = 1; i < numJobs; i++)
+    {
+#ifdef _WIN32
+        threads[i] = CreateThread(NULL, 0, range_thread, jobs + i, 0, NULL);
+        started[i] = (threads[i] != NULL);
+#else
+        started[i] = (pthread_create(threads + i, NULL, range_thread,
+                    jobs + i) == 0);
+#endif /* _WIN32 */
+    }
+
+    evaluate_range(jobs);
+
+    for (i = 1; i < numJobs; i++)
+    {
+        if (!started[i])
+        {
+            evaluate_range(jobs + i);
+            continue;
+        }
+#ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif /* _WIN32 */
+    }
+}
+
+/*------------ END OF FILE ------------- */
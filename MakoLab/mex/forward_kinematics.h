@@ -0,0 +1,79 @@
+/****h* /forward_kinematics.h ***
+ * NAME
+ * 		forward_kinematics.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Forward kinematics of a serial arm described by the DH
+ *              parameters of the hgs_arm.cfg files (NOMINAL_DH_MATRIX,
+ *              CALIBRATED_DH_LEFTY/RIGHTY): one row per joint of a, alpha,
+ *              d and theta offset, Craig convention
+ *                  T(i-1,i) = Rx(alpha) Dx(a) Rz(theta + offset) Dz(d)
+ *              followed by the flange transform and a tool point.  Whole
+ *              arrays of joint angle samples are evaluated in one call,
+ *              with the Jacobians and the frame of every link on request.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __FORWARD_KINEMATICS_H__ /* make sure that forward_kinematics is not redeclared */
+#define __FORWARD_KINEMATICS_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#endif
+
+/* defines */
+#define FK_MAX_JOINTS 16
+#define FK_MAX_THREADS 16
+
+/* samples per thread below which no extra thread is started */
+#define FK_MIN_THREAD_SAMPLES 4096
+
+/* cosine of the angle about y below which the flange angles are singular */
+#define FK_GIMBAL_TOLERANCE 1e-12
+
+/* samples evaluated together, the inner loops run over a block */
+#define FK_BLOCK_SAMPLES 32
+
+typedef struct {
+    uint32_t numJoints;
+    double dh[FK_MAX_JOINTS][4];    /* a, alpha, d, theta offset */
+    double flange[16];              /* 4x4 column major, after the last link */
+} FkModel;
+
+typedef struct {
+    const FkModel *model;
+    const double *jointAngles;  /* numSamples x numJoints, column major */
+    const double *tool;         /* NULL, one point or numSamples x 3 */
+    int32_t toolPerSample;      /* tool holds one point per sample */
+    uint32_t numSamples;
+    double *transforms;         /* 4x4 x numSamples, the tool frame */
+    double *jacobians;          /* 6 x numJoints x numSamples or NULL */
+    double *frames;             /* 4x4 x numJoints x numSamples or NULL */
+} FkProblem;
+
+/* function definations */
+void fk_flange_from_vector(const double vector[6], double flange[16]);
+
+void fk_flange_to_vector(const double flange[16], double vector[6]);
+
+void fk_evaluate(const FkProblem *problem, int32_t numThreads);
+
+int32_t fk_number_of_processors(void);
+
+#endif /* __FORWARD_KINEMATICS_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,446 @@
+/****h* /ftStream.c ***
+ * NAME
+ *      ftStream.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function streams force/torque data acquired and converted in
+ *      a background thread (ft_stream.c), optionally low pass filtered and
+ *      decimated (ft_filter.c); matlab drains the samples in blocks.  The streams stay open between calls, the mex file is
+ *      locked in memory while a stream is open.
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ft_stream.h"
+#include "rt_coefs.h"
+#include "stream_clock.h"
+
+/* defines */
+#define FT_MAX_STREAMS 8
+#define COMMAND_LENGTH 16
+#define OPTION_LENGTH 32
+#define FILE_NAME_LENGTH 1024
+#define DEFAULT_CAPACITY 65536
+
+/* open streams, the stream id is the index plus one */
+static FtStream *streams[FT_MAX_STREAMS];
+static int lockedStreams = 0;
+
+/* internal functions */
+static void startStream(mxArray *plhs[], int nrhs,
+        const mxArray *prhs[]);
+static void readStream(int nlhs, mxArray *plhs[], FtStream *stream,
+        uint32_t maxSamples);
+static void streamStatus(mxArray *plhs[], FtStream *stream);
+static void stopStream(int index);
+static void stopAllStreams(void);
+static int getStreamIndex(const mxArray *idArray);
+static int getFilterOption(const mxArray *value, double *values,
+        int maxValues, int columns);
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    char command[COMMAND_LENGTH];
+    uint32_t maxSamples;
+    int index;
+
+    /* first check the inputs */
+    if ((nrhs < 1) || !mxIsChar(prhs[0])
+            || (mxGetString(prhs[0], command, COMMAND_LENGTH) != 0))
+    {
+        mexErrMsgTxt("Must specify a command: start, read, status, stop or clock");
+        return;
+    }
+
+    if (strcmp(command, "start") == 0)
+    {
+        startStream(plhs, nrhs - 1, prhs + 1);
+    }
+    else if (strcmp(command, "clock") == 0)
+    {
+        plhs[0] = mxCreateDoubleScalar(stream_clock());
+    }
+    else if ((strcmp(command, "stop") == 0) && (nrhs == 1))
+    {
+        stopAllStreams();
+    }
+    else if ((strcmp(command, "read") == 0)
+            || (strcmp(command, "status") == 0)
+            || (strcmp(command, "stop") == 0))
+    {
+        if (nrhs < 2)
+        {
+            mexErrMsgTxt("Must specify the stream id");
+            return;
+        }
+        index = getStreamIndex(prhs[1]);
+        if (strcmp(command, "stop") == 0)
+        {
+            stopStream(index);
+        }
+        else if (strcmp(command, "status") == 0)
+        {
+            streamStatus(plhs, streams[index]);
+        }
+        else
+        {
+            maxSamples = 0xffffffffU;
+            if ((nrhs > 2) && mxIsNumeric(prhs[2])
+                    && (mxGetScalar(prhs[2]) >= 0))
+            {
+                maxSamples = (uint32_t)mxGetScalar(prhs[2]);
+            }
+            readStream(nlhs, plhs, streams[index], maxSamples);
+        }
+    }
+    else
+    {
+        mexErrMsgTxt("Unknown command, use start, read, status, stop or clock");
+    }
+    return;
+}
+
+/*
+ * id = ftStream('start',rtCoefs,'parameter',value,...)
+ */
+static void startStream(mxArray *plhs[], int nrhs,
+        const mxArray *prhs[])
+{
+    char errorMessage[RT_COEFS_ERROR_LENGTH];
+    char option[OPTION_LENGTH];
+    char fileName[FILE_NAME_LENGTH];
+    double taps[FT_FILTER_MAX_TAPS];
+    double sections[FT_FILTER_MAX_SECTIONS * FT_FILTER_SECTION_SIZE];
+    RTCoefs coefs;
+    FtSource source;
+    FtFilter filter;
+    FtStream *stream;
+    double sampleRate = 0;
+    int decimation = 1;
+    int numTaps = 0;
+    int numSections = 0;
+    uint32_t capacity = DEFAULT_CAPACITY;
+    int32_t tempComp = 0;
+    int32_t loop = 0;
+    int index, i;
+
+    if ((nrhs < 1) || (nrhs % 2 != 1))
+    {
+        mexErrMsgTxt("Must specify the calibration coefficients and parameter/value pairs");
+        return;
+    }
+
+    fileName[0] = '\0';
+    for (i = 1; i < nrhs; i += 2)
+    {
+        if (!mxIsChar(prhs[i])
+                || (mxGetString(prhs[i], option, OPTION_LENGTH) != 0))
+        {
+            mexErrMsgTxt("Parameter names must be strings");
+            return;
+        }
+        if (strcmp(option, "ReplayFile") == 0)
+        {
+            if (!mxIsChar(prhs[i + 1]) || (mxGetString(prhs[i + 1],
+                            fileName, FILE_NAME_LENGTH) != 0))
+            {
+                mexErrMsgTxt("ReplayFile must be a file name");
+                return;
+            }
+        }
+        else if (strcmp(option, "FIR") == 0)
+        {
+            numTaps = getFilterOption(prhs[i + 1], taps,
+                    FT_FILTER_MAX_TAPS, 1);
+            if (numTaps < 0)
+            {
+                mexErrMsgTxt("FIR must be a vector of up to 256 taps");
+                return;
+            }
+        }
+        else if (strcmp(option, "SOS") == 0)
+        {
+            numSections = getFilterOption(prhs[i + 1], sections,
+                    FT_FILTER_MAX_SECTIONS, FT_FILTER_SECTION_SIZE);
+            if (numSections < 0)
+            {
+                mexErrMsgTxt("SOS must be a matrix of up to 8 sections [b0 b1 b2 a0 a1 a2]");
+                return;
+            }
+        }
+        else if (!mxIsNumeric(prhs[i + 1]) && !mxIsLogical(prhs[i + 1]))
+        {
+            mexErrMsgTxt("Parameter values must be numeric");
+            return;
+        }
+        else if (strcmp(option, "SampleRate") == 0)
+        {
+            sampleRate = mxGetScalar(prhs[i + 1]);
+        }
+        else if (strcmp(option, "Decimation") == 0)
+        {
+            decimation = (mxGetScalar(prhs[i + 1]) >= 1)
+                ? (int)mxGetScalar(prhs[i + 1]) : 1;
+        }
+        else if (strcmp(option, "Capacity") == 0)
+        {
+            capacity = (mxGetScalar(prhs[i + 1]) >= 1)
+                ? (uint32_t)mxGetScalar(prhs[i + 1]) : 1;
+        }
+        else if (strcmp(option, "TempComp") == 0)
+        {
+            tempComp = (mxGetScalar(prhs[i + 1]) != 0);
+        }
+        else if (strcmp(option, "Loop") == 0)
+        {
+            loop = (mxGetScalar(prhs[i + 1]) != 0);
+        }
+        else
+        {
+            mexErrMsgTxt("Unknown parameter, use ReplayFile, SampleRate, Capacity, TempComp, Loop, Decimation, FIR or SOS");
+            return;
+        }
+    }
+
+    if (get_rt_coefs(prhs[0], 0, tempComp, &coefs, errorMessage)
+            != RT_COEFS_SUCCESS)
+    {
+        mexErrMsgTxt(errorMessage);
+        return;
+    }
+
+    /* decimating without a filter averages the samples of each output */
+    if ((decimation > 1) && (numTaps == 0) && (numSections == 0))
+    {
+        numTaps = (decimation < FT_FILTER_MAX_TAPS) ? decimation
+            : FT_FILTER_MAX_TAPS;
+        for (i = 0; i < numTaps; i++)
+        {
+            taps[i] = 1.0 / numTaps;
+        }
+    }
+    if (ft_filter_init(&filter, coefs.NumAxes, decimation, taps, numTaps,
+                sections, numSections) != FT_FILTER_SUCCESS)
+    {
+        mexErrMsgTxt("Invalid filter, a0 of a section is 0");
+        return;
+    }
+
+    /* the replay file is the only source without the DAQ hardware */
+    if (fileName[0] == '\0')
+    {
+        mexErrMsgTxt("Must specify the sample source (ReplayFile)");
+        return;
+    }
+
+    for (index = 0; index < FT_MAX_STREAMS; index++)
+    {
+        if (streams[index] == NULL)
+            break;
+    }
+    if (index == FT_MAX_STREAMS)
+    {
+        mexErrMsgTxt("Too many open streams, stop one first");
+        return;
+    }
+
+    if (ft_replay_open(&source, fileName, coefs.NumChannels, sampleRate,
+                loop) != FT_STREAM_SUCCESS)
+    {
+        sprintf(errorMessage, "Unable to read %d voltages per line from "
+                "the replay file", (int)coefs.NumChannels);
+        mexErrMsgTxt(errorMessage);
+        return;
+    }
+
+    /* the stream lives until stopped, outside of the matlab memory */
+    stream = (FtStream *)malloc(sizeof(FtStream));
+    if ((stream == NULL) || (ft_stream_start(stream, &coefs, tempComp,
+                    &source, ((decimation > 1) || (numTaps > 0)
+                        || (numSections > 0)) ? &filter : NULL,
+                    capacity) != FT_STREAM_SUCCESS))
+    {
+        if (stream == NULL)
+            source.close(&source);
+        free(stream);
+        mexErrMsgTxt("Unable to start the stream");
+        return;
+    }
+    streams[index] = stream;
+    if (lockedStreams++ == 0)
+    {
+        mexLock();
+        mexAtExit(stopAllStreams);
+    }
+    plhs[0] = mxCreateDoubleScalar(index + 1);
+}
+
+/*
+ * [ft,t,sequence] = ftStream('read',id,maxSamples)
+ */
+static void readStream(int nlhs, mxArray *plhs[], FtStream *stream,
+        uint32_t maxSamples)
+{
+    FtSample *samples;
+    double *ft, *t, *sequence;
+    uint32_t numSamples, numAxes, i, j;
+
+    numSamples = ring_count(&stream->ring);
+    if (numSamples > maxSamples)
+    {
+        numSamples = maxSamples;
+    }
+    samples = (FtSample *)mxMalloc((numSamples + 1) * sizeof(FtSample));
+    numSamples = ft_stream_read(stream, samples, numSamples);
+
+    numAxes = stream->coefs.NumAxes;
+    plhs[0] = mxCreateDoubleMatrix(numSamples, numAxes, mxREAL);
+    ft = mxGetPr(plhs[0]);
+    for (i = 0; i < numSamples; i++)
+    {
+        for (j = 0; j < numAxes; j++)
+        {
+            ft[j * numSamples + i] = samples[i].wrench[j];
+        }
+    }
+    if (nlhs > 1)
+    {
+        plhs[1] = mxCreateDoubleMatrix(numSamples, 1, mxREAL);
+        t = mxGetPr(plhs[1]);
+        for (i = 0; i < numSamples; i++)
+            t[i] = samples[i].timestamp;
+    }
+    if (nlhs > 2)
+    {
+        plhs[2] = mxCreateDoubleMatrix(numSamples, 1, mxREAL);
+        sequence = mxGetPr(plhs[2]);
+        for (i = 0; i < numSamples; i++)
+            sequence[i] = samples[i].sequence;
+    }
+    mxFree(samples);
+}
+
+/*
+ * status = ftStream('status',id)
+ */
+static void streamStatus(mxArray *plhs[], FtStream *stream)
+{
+    static const char *fieldNames[] = {"running", "ended", "error",
+        "queued", "produced", "emitted", "dropped"};
+
+    plhs[0] = mxCreateStructMatrix(1, 1, 7, fieldNames);
+    mxSetField(plhs[0], 0, "running",
+            mxCreateLogicalScalar(stream->status == FT_STREAM_RUNNING));
+    mxSetField(plhs[0], 0, "ended",
+            mxCreateLogicalScalar(stream->status == FT_STREAM_ENDED));
+    mxSetField(plhs[0], 0, "error",
+            mxCreateLogicalScalar(stream->status == FT_STREAM_ERROR));
+    mxSetField(plhs[0], 0, "queued",
+            mxCreateDoubleScalar(ring_count(&stream->ring)));
+    mxSetField(plhs[0], 0, "produced",
+            mxCreateDoubleScalar(stream->produced));
+    mxSetField(plhs[0], 0, "emitted",
+            mxCreateDoubleScalar(stream->emitted));
+    mxSetField(plhs[0], 0, "dropped",
+            mxCreateDoubleScalar(stream->dropped));
+}
+
+/*
+ * stop and free a stream, the mex file is unlocked with the last one
+ */
+static void stopStream(int index)
+{
+    ft_stream_stop(streams[index]);
+    free(streams[index]);
+    streams[index] = NULL;
+    if (--lockedStreams == 0)
+    {
+        mexUnlock();
+    }
+}
+
+static void stopAllStreams(void)
+{
+    int index;
+
+    for (index = 0; index < FT_MAX_STREAMS; index++)
+    {
+        if (streams[index] != NULL)
+            stopStream(index);
+    }
+}
+
+/*
+ * index of an open stream, errors out on an invalid id
+ */
+static int getStreamIndex(const mxArray *idArray)
+{
+    int index;
+
+    index = mxIsNumeric(idArray) ? (int)mxGetScalar(idArray) - 1 : -1;
+    if ((index < 0) || (index >= FT_MAX_STREAMS) || (streams[index] == NULL))
+    {
+        mexErrMsgTxt("Invalid stream id");
+        return 0;
+    }
+    return index;
+}
+
+/*
+ * copy the rows of a real matrix with the given number of columns (a
+ * vector if 1) row major, returns the number of rows or -1 if invalid
+ */
+static int getFilterOption(const mxArray *value, double *values,
+        int maxValues, int columns)
+{
+    int rows, i, j;
+
+    if (!mxIsDouble(value) || mxIsComplex(value))
+    {
+        return -1;
+    }
+    if (columns == 1)
+    {
+        rows = (int)mxGetNumberOfElements(value);
+    }
+    else if ((int)mxGetN(value) == columns)
+    {
+        rows = (int)mxGetM(value);
+    }
+    else
+    {
+        return -1;
+    }
+    if (rows > maxValues)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < rows; i++)
+    {
+        for (j = 0; j < columns; j++)
+        {
+            values[i * columns + j] = mxGetPr(value)[j * rows + i];
+        }
+    }
+    return rows;
+}
+
+/*----------- END OF FILE ------------ */
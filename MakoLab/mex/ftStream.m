@@ -0,0 +1,80 @@
+%FTSTREAM Stream ATI F/T samples converted in a background thread
+%
+% Syntax:
+%   id = ftStream('start',cal,'parameter',value,...)
+%       starts acquiring voltages in a background thread, converts them to
+%       forces and torques with the realtime coefficients of cal (as
+%       returned by loadFTCalibration) and queues the timestamped samples.
+%       The parameters are:
+%           ReplayFile   text file with one sample of NumChannels voltages
+%                        (gauges then thermistor) per line, as written by
+%                        save -ascii.  Stands in for the DAQ hardware.
+%           SampleRate   samples per second released by the replay (default
+%                        0, as fast as the samples are read)
+%           Loop         true to restart at the end of the file
+%           TempComp     true for temperature compensation
+%           Capacity     samples queued between two reads (default 65536)
+%           Decimation   queue one sample every Decimation converted
+%                        samples (default 1)
+%           FIR          FIR low pass filter taps, as the b argument of
+%                        filter (up to 256), evaluated at the output rate
+%           SOS          second order sections [b0 b1 b2 a0 a1 a2], one
+%                        row per section (up to 8), as returned by tf2sos,
+%                        run at the input rate before the FIR
+%                        Decimating without FIR or SOS averages the samples
+%                        of each output (up to the last 256).
+%       returns the id of the stream.
+%   [ft,t,sequence] = ftStream('read',id)
+%       returns the queued samples, one row per sample: ft has a column
+%       per axis, t is the timestamp in seconds of ftStream('clock') and
+%       sequence the output sample number since the start.  Never waits, ft is
+%       empty if no sample is queued.
+%   [ft,t,sequence] = ftStream('read',id,maxSamples)
+%       returns at most maxSamples of the oldest queued samples.
+%   status = ftStream('status',id)
+%       returns a structure with the fields running, ended (end of the
+%       replay), error, queued (samples ready to read), produced (samples
+%       converted), emitted (samples out of the filter) and dropped
+%       (samples lost to a full queue).
+%   ftStream('stop',id)
+%       stops the acquisition and discards the queued samples.
+%   ftStream('stop')
+%       stops all the streams.
+%   t = ftStream('clock')
+%       current time of the clock used for the timestamps.
+%
+% Notes:
+%   The acquisition thread and matlab share a lock free ring buffer, so
+%   reading never stalls the acquisition.  A source paced by SampleRate
+%   does not wait for matlab, samples that do not fit in the queue are
+%   dropped and leave a gap in the sequence numbers; read often enough or
+%   increase Capacity.  Unpaced replays wait for space instead.
+%   The filter state has a fixed size, so a stream can be filtered and
+%   decimated for any length of time in bounded memory, instead of
+%   recording the full rate data and filtering it afterwards.  The filters
+%   are causal: the timestamp of an output is that of its last input,
+%   delayed by the group delay of the filter.
+%   The mex file stays locked in memory while a stream is open.
+%
+% Example:
+%   cal = loadFTCalibration('FT4566.cal');
+%   id = ftStream('start',cal,'ReplayFile','voltages.txt','SampleRate',1000);
+%   pause(0.5);
+%   [ft,t] = ftStream('read',id);
+%   ftStream('stop',id);
+%   % 1 kHz to 100 Hz with a 4th order butterworth anti aliasing filter
+%   [z,p,k] = butter(4,40/500);
+%   id = ftStream('start',cal,'ReplayFile','voltages.txt','SampleRate',1000,...
+%       'SOS',zp2sos(z,p,k),'Decimation',10);
+%
+% See also:
+%    loadFTCalibration, convertVoltagesToFT
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+% --------- END OF FILE ----------
@@ -0,0 +1,249 @@
+/****h* /ft_filter.c ***
+ * NAME
+ *      ft_filter.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      Streaming low pass filter and decimator for force/torque samples.
+ *      The biquads have to run on every input, the FIR is only evaluated
+ *      when an output is due, which is the saving of a polyphase
+ *      decimator.  All the axes of a sample are filtered together, the
+ *      inner loops run over the axes so the compiler can vectorize them.
+ *
+ * SEE ALSO
+ *      ft_filter.h, ft_stream.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <string.h>
+
+#include "ft_filter.h"
+
+/****f*  ft_filter.c/ft_filter_init ******
+ * NAME
+ *	    ft_filter_init
+ *
+ * SYNOPSIS
+ *      int32_t ft_filter_init(FtFilter *filter, int32_t numAxes,
+ *              int32_t decimation, const double *taps, int32_t numTaps,
+ *              const double *sections, int32_t numSections)
+ *
+ * INPUTS
+ *      int32_t numAxes
+ *              values per sample, up to MAX_AXES
+ *      int32_t decimation
+ *              one output for every decimation inputs, 1 for none
+ *      const double *taps
+ *              numTaps FIR coefficients, newest sample first (as for the
+ *              matlab filter function); numTaps can be 0 for no FIR
+ *      const double *sections
+ *              numSections rows of FT_FILTER_SECTION_SIZE coefficients
+ *              b0 b1 b2 a0 a1 a2, row major; numSections can be 0
+ *
+ * OUTPUT
+ *      FtFilter *filter
+ *              filter at rest, ready for ft_filter_process
+ *      Returns FT_FILTER_SUCCESS or FT_FILTER_FAILURE if a size is out of
+ *      range or a0 is 0
+ *
+ * NOTES
+ *      Without a FIR the outputs are the biquad outputs of every
+ *      decimation'th input, so the sections must do the anti aliasing.
+ *
+ **********************************
+ */
+int32_t ft_filter_init(FtFilter *filter, int32_t numAxes, int32_t decimation,
+        const double *taps, int32_t numTaps, const double *sections,
+        int32_t numSections)
+{
+    const double *section;
+    int32_t i;
+
+    memset(filter, 0, sizeof(FtFilter));
+    if ((numAxes < 1) || (numAxes > MAX_AXES) || (decimation < 1)
+            || (numTaps < 0) || (numTaps > FT_FILTER_MAX_TAPS)
+            || (numSections < 0) || (numSections > FT_FILTER_MAX_SECTIONS))
+    {
+        return FT_FILTER_FAILURE;
+    }
+
+    for (i = 0; i < numSections; i++)
+    {
+        section = sections + i * FT_FILTER_SECTION_SIZE;
+        if (section[3] == 0)
+        {
+            return FT_FILTER_FAILURE;
+        }
+        filter->b[i][0] = section[0] / section[3];
+        filter->b[i][1] = section[1] / section[3];
+        filter->b[i][2] = section[2] / section[3];
+        filter->a[i][0] = section[4] / section[3];
+        filter->a[i][1] = section[5] / section[3];
+    }
+
+    /* reversed so the taps line up with the history, oldest first */
+    for (i = 0; i < numTaps; i++)
+    {
+        filter->taps[i] = taps[numTaps - 1 - i];
+    }
+
+    filter->numAxes = numAxes;
+    filter->decimation = decimation;
+    filter->numSections = numSections;
+    filter->numTaps = numTaps;
+    ft_filter_reset(filter);
+    return FT_FILTER_SUCCESS;
+}
+
+/****f*  ft_filter.c/ft_filter_reset ******
+ * NAME
+ *	    ft_filter_reset
+ *
+ * SYNOPSIS
+ *      void ft_filter_reset(FtFilter *filter)
+ *
+ * PURPOSE
+ *	    Clear the state, the next input is filtered as if preceded by
+ *	    zeros and the first output is due after decimation inputs
+ *
+ **********************************
+ */
+void ft_filter_reset(FtFilter *filter)
+{
+    memset(filter->state, 0, sizeof(filter->state));
+    memset(filter->history, 0, sizeof(filter->history));
+    filter->position = 0;
+    filter->phase = filter->decimation;
+}
+
+/****f*  ft_filter.c/ft_filter_process ******
+ * NAME
+ *	    ft_filter_process
+ *
+ * SYNOPSIS
+ *      uint32_t ft_filter_process(FtFilter *filter, const float *input,
+ *              const double *inputTimes, uint32_t numSamples, float *output,
+ *              double *outputTimes)
+ *
+ * INPUTS
+ *      const float *input
+ *              numSamples samples of numAxes values, as returned by
+ *              RTConvertToFTBatch
+ *      const double *inputTimes
+ *              timestamps of the inputs, can be NULL
+ *
+ * OUTPUT
+ *      float *output
+ *              filtered samples of numAxes values, at most
+ *              numSamples / decimation + 1
+ *      double *outputTimes
+ *              timestamps of the outputs, those of the last input of each
+ *              output, can be NULL
+ *      Returns the number of output samples
+ *
+ * NOTES
+ *      The output can be the input, an output is written after its last
+ *      input has been read.  The decimation phase carries over between
+ *      calls, so the blocks can have any size.
+ *
+ **********************************
+ */
+uint32_t ft_filter_process(FtFilter *filter, const float *input,
+        const double *inputTimes, uint32_t numSamples, float *output,
+        double *outputTimes)
+{
+    double x[MAX_AXES], y[MAX_AXES], sum[MAX_AXES];
+    double *z0, *z1;
+    const double *window;
+    double tap;
+    int32_t numAxes, newest;
+    uint32_t numOutputs, n;
+    int32_t i, j, k;
+
+    numAxes = filter->numAxes;
+    numOutputs = 0;
+    for (n = 0; n < numSamples; n++)
+    {
+        for (j = 0; j < numAxes; j++)
+        {
+            x[j] = input[n * numAxes + j];
+        }
+
+        /* every section filters all the axes at once */
+        for (k = 0; k < filter->numSections; k++)
+        {
+            z0 = filter->state[k][0];
+            z1 = filter->state[k][1];
+            for (j = 0; j < numAxes; j++)
+            {
+                y[j] = filter->b[k][0] * x[j] + z0[j];
+                z0[j] = filter->b[k][1] * x[j] - filter->a[k][0] * y[j]
+                    + z1[j];
+                z1[j] = filter->b[k][2] * x[j] - filter->a[k][1] * y[j];
+                x[j] = y[j];
+            }
+        }
+
+        /* the history keeps each input twice, numTaps apart */
+        if (filter->numTaps > 0)
+        {
+            newest = filter->position;
+            for (j = 0; j < numAxes; j++)
+            {
+                filter->history[newest][j] = x[j];
+                filter->history[newest + filter->numTaps][j] = x[j];
+            }
+            filter->position = (newest + 1 == filter->numTaps) ? 0
+                : newest + 1;
+        }
+
+        if (--filter->phase > 0)
+        {
+            continue;
+        }
+        filter->phase = filter->decimation;
+
+        /* the last numTaps inputs start at the oldest one */
+        if (filter->numTaps > 0)
+        {
+            window = filter->history[filter->position];
+            for (j = 0; j < numAxes; j++)
+            {
+                sum[j] = 0;
+            }
+            for (i = 0; i < filter->numTaps; i++)
+            {
+                tap = filter->taps[i];
+                for (j = 0; j < numAxes; j++)
+                {
+                    sum[j] += tap * window[i * MAX_AXES + j];
+                }
+            }
+            for (j = 0; j < numAxes; j++)
+            {
+                x[j] = sum[j];
+            }
+        }
+
+        for (j = 0; j < numAxes; j++)
+        {
+            output[numOutputs * numAxes + j] = (float)x[j];
+        }
+        if ((outputTimes != NULL) && (inputTimes != NULL))
+        {
+            outputTimes[numOutputs] = inputTimes[n];
+        }
+        numOutputs++;
+    }
+    return numOutputs;
+}
+
+/*------------ END OF FILE ------------- */
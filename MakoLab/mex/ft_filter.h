@@ -0,0 +1,80 @@
+/****h* /ft_filter.h ***
+ * NAME
+ * 		ft_filter.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Streaming low pass filter and decimator for force/torque
+ *              samples.  A cascade of biquad sections runs at the input
+ *              rate, followed by a FIR filter only evaluated at the output
+ *              rate.  The state is fixed in size, so the memory is bounded
+ *              whatever the length of the stream.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __FT_FILTER_H__ /* make sure that ft_filter is not redeclared */
+#define __FT_FILTER_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#endif
+
+#include "ftrt.h"
+
+/* defines */
+#define FT_FILTER_SUCCESS 1
+#define FT_FILTER_FAILURE -1
+
+#define FT_FILTER_MAX_TAPS 256
+#define FT_FILTER_MAX_SECTIONS 8
+
+/* coefficients of a second order section, as a row of the matlab sos */
+/* matrix: b0 b1 b2 a0 a1 a2 */
+#define FT_FILTER_SECTION_SIZE 6
+
+typedef struct {
+    int32_t numAxes;
+    int32_t decimation;         /* one output every decimation inputs */
+    int32_t phase;              /* inputs until the next output */
+
+    /* biquads, direct form II transposed, normalized by a0 */
+    int32_t numSections;
+    double b[FT_FILTER_MAX_SECTIONS][3];
+    double a[FT_FILTER_MAX_SECTIONS][2];
+    double state[FT_FILTER_MAX_SECTIONS][2][MAX_AXES];
+
+    /* FIR, the taps are stored oldest sample first and the history twice */
+    /* so the last numTaps inputs are always contiguous */
+    int32_t numTaps;
+    int32_t position;           /* oldest input of the history */
+    double taps[FT_FILTER_MAX_TAPS];
+    double history[2 * FT_FILTER_MAX_TAPS][MAX_AXES];
+} FtFilter;
+
+/* function definations */
+int32_t ft_filter_init(FtFilter *filter, int32_t numAxes, int32_t decimation,
+        const double *taps, int32_t numTaps, const double *sections,
+        int32_t numSections);
+
+void ft_filter_reset(FtFilter *filter);
+
+uint32_t ft_filter_process(FtFilter *filter, const float *input,
+        const double *inputTimes, uint32_t numSamples, float *output,
+        double *outputTimes);
+
+#endif /* __FT_FILTER_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,489 @@
+/****h* /ft_stream.c ***
+ * NAME
+ *      ft_stream.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      Continuous force/torque acquisition in a background thread.  The
+ *      producer converts blocks of FT_STREAM_BLOCK samples with
+ *      RTConvertToFTBatch, optionally filters and decimates them, and
+ *      pushes them to a single producer, single consumer ring buffer, so
+ *      the consumer never blocks the acquisition.  Every output sample
+ *      gets a sequence number; samples lost to a full ring (real time
+ *      sources only) leave a gap in the sequence and are counted.
+ *
+ * SEE ALSO
+ *      ft_stream.h, ring_buffer.c, ftStream.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif /* _WIN32 */
+
+#include "ft_stream.h"
+#include "stream_clock.h"
+
+/* defines */
+#define MAX_REPLAY_FILE_SIZE (1024 * 1024 * 1024)
+
+typedef struct {
+    float *voltages;            /* numSamples samples of numChannels */
+    int32_t numSamples;
+    int32_t next;               /* next sample to replay */
+    uint32_t replayed;          /* samples replayed since the start */
+    double sampleRate;          /* samples per second, 0 for no pacing */
+    double startTime;           /* clock of the first sample */
+    int32_t loop;               /* restart at the end of the file */
+} ReplaySource;
+
+/* internal functions */
+#ifdef _WIN32
+static DWORD WINAPI producer_thread(LPVOID argument);
+#else
+static void *producer_thread(void *argument);
+#endif /* _WIN32 */
+static void produce(FtStream *stream);
+static int32_t replay_read(FtSource *source, float *voltages,
+        double *timestamps, int32_t maxSamples);
+static void replay_close(FtSource *source);
+static int32_t parse_voltages(const char *text, int32_t numChannels,
+        float **voltages, int32_t *numSamples);
+
+/****f*  ft_stream.c/ft_stream_start ******
+ * NAME
+ *	    ft_stream_start
+ *
+ * SYNOPSIS
+ *      int32_t ft_stream_start(FtStream *stream, const RTCoefs *coefs,
+ *              int32_t tempComp, const FtSource *source,
+ *              const FtFilter *filter, uint32_t capacity)
+ *
+ * INPUTS
+ *      const RTCoefs *coefs
+ *              realtime coefficients, NumChannels must match the source
+ *      int32_t tempComp
+ *              non zero to compensate the gauges for temperature
+ *      const FtSource *source
+ *              opened source, owned by the stream from now on (closed by
+ *              ft_stream_stop, or here on failure)
+ *      const FtFilter *filter
+ *              filter and decimator for the wrenches (copied, from its
+ *              current state), NULL to queue every converted sample
+ *      uint32_t capacity
+ *              samples buffered between the producer and the consumer
+ *
+ * OUTPUT
+ *      FtStream *stream
+ *              running stream, to be stopped by ft_stream_stop
+ *      Returns FT_STREAM_SUCCESS or FT_STREAM_FAILURE
+ *
+ **********************************
+ */
+int32_t ft_stream_start(FtStream *stream, const RTCoefs *coefs,
+        int32_t tempComp, const FtSource *source, const FtFilter *filter,
+        uint32_t capacity)
+{
+    int32_t started;
+
+    memset(stream, 0, sizeof(FtStream));
+    stream->coefs = *coefs;
+    stream->tempComp = tempComp;
+    stream->source = *source;
+    if (filter != NULL)
+    {
+        stream->filter = *filter;
+        stream->filtered = 1;
+    }
+    if ((source->numChannels != coefs->NumChannels)
+            || (stream->filtered && (filter->numAxes != coefs->NumAxes))
+            || (ring_create(&stream->ring, capacity, sizeof(FtSample))
+                != RING_BUFFER_SUCCESS))
+    {
+        stream->source.close(&stream->source);
+        return FT_STREAM_FAILURE;
+    }
+
+    stream->running = 1;
+    stream->status = FT_STREAM_RUNNING;
+#ifdef _WIN32
+    stream->thread = CreateThread(NULL, 0, producer_thread, stream, 0, NULL);
+    started = (stream->thread != NULL);
+#else
+    started = (pthread_create(&stream->thread, NULL, producer_thread,
+                stream) == 0);
+#endif /* _WIN32 */
+    if (!started)
+    {
+        ring_destroy(&stream->ring);
+        stream->source.close(&stream->source);
+        stream->running = 0;
+        return FT_STREAM_FAILURE;
+    }
+    return FT_STREAM_SUCCESS;
+}
+
+/****f*  ft_stream.c/ft_stream_read ******
+ * NAME
+ *	    ft_stream_read
+ *
+ * SYNOPSIS
+ *      uint32_t ft_stream_read(FtStream *stream, FtSample *samples,
+ *              uint32_t maxSamples)
+ *
+ * OUTPUT
+ *      FtSample *samples
+ *              oldest queued samples, at most maxSamples
+ *      Returns the number of samples, 0 if none is queued
+ *
+ * PURPOSE
+ *	    Drain the stream without waiting, from the consumer thread
+ *
+ **********************************
+ */
+uint32_t ft_stream_read(FtStream *stream, FtSample *samples,
+        uint32_t maxSamples)
+{
+    return ring_pop(&stream->ring, samples, maxSamples);
+}
+
+/****f*  ft_stream.c/ft_stream_stop ******
+ * NAME
+ *	    ft_stream_stop
+ *
+ * SYNOPSIS
+ *      void ft_stream_stop(FtStream *stream)
+ *
+ * PURPOSE
+ *	    Stop the producer, close the source and free the queued samples
+ *
+ **********************************
+ */
+void ft_stream_stop(FtStream *stream)
+{
+    stream->running = 0;
+#ifdef _WIN32
+    WaitForSingleObject(stream->thread, INFINITE);
+    CloseHandle(stream->thread);
+#else
+    pthread_join(stream->thread, NULL);
+#endif /* _WIN32 */
+    stream->source.close(&stream->source);
+    ring_destroy(&stream->ring);
+}
+
+/****f*  ft_stream.c/ft_replay_open ******
+ * NAME
+ *	    ft_replay_open
+ *
+ * SYNOPSIS
+ *      int32_t ft_replay_open(FtSource *source, const char *fileName,
+ *              int32_t numChannels, double sampleRate, int32_t loop)
+ *
+ * INPUTS
+ *      const char *fileName
+ *              text file with one sample of numChannels voltages per line,
+ *              as written by save -ascii
+ *      double sampleRate
+ *              replay rate in samples per second, 0 to replay as fast as
+ *              the stream is read
+ *      int32_t loop
+ *              non zero to restart at the end of the file
+ *
+ * OUTPUT
+ *      FtSource *source
+ *              source replaying the recorded voltages
+ *      Returns FT_STREAM_SUCCESS or FT_STREAM_FAILURE if the file can not
+ *      be read or a line does not have numChannels values
+ *
+ * PURPOSE
+ *	    Stand in for the DAQ hardware, the samples are released at the
+ *	    sample rate and timestamped from the replay start
+ *
+ **********************************
+ */
+int32_t ft_replay_open(FtSource *source, const char *fileName,
+        int32_t numChannels, double sampleRate, int32_t loop)
+{
+    ReplaySource *replay;
+    FILE *file;
+    char *text;
+    long size;
+    int32_t status;
+
+    file = fopen(fileName, "rb");
+    if (file == NULL)
+    {
+        return FT_STREAM_FAILURE;
+    }
+    text = NULL;
+    if ((fseek(file, 0, SEEK_END) == 0) && ((size = ftell(file)) >= 0)
+            && (size <= MAX_REPLAY_FILE_SIZE)
+            && (fseek(file, 0, SEEK_SET) == 0))
+    {
+        text = (char *)malloc(size + 1);
+        if ((text != NULL) && (fread(text, 1, size, file) != (size_t)size))
+        {
+            free(text);
+            text = NULL;
+        }
+        if (text != NULL)
+        {
+            text[size] = '\0';
+        }
+    }
+    fclose(file);
+    if (text == NULL)
+    {
+        return FT_STREAM_FAILURE;
+    }
+
+    replay = (ReplaySource *)calloc(1, sizeof(ReplaySource));
+    if (replay == NULL)
+    {
+        free(text);
+        return FT_STREAM_FAILURE;
+    }
+    status = parse_voltages(text, numChannels, &replay->voltages,
+            &replay->numSamples);
+    free(text);
+    if ((status != FT_STREAM_SUCCESS) || (replay->numSamples == 0))
+    {
+        free(replay->voltages);
+        free(replay);
+        return FT_STREAM_FAILURE;
+    }
+    replay->sampleRate = (sampleRate > 0) ? sampleRate : 0;
+    replay->startTime = -1;
+    replay->loop = loop;
+
+    source->read = replay_read;
+    source->close = replay_close;
+    source->numChannels = numChannels;
+    source->realTime = (replay->sampleRate > 0);
+    source->context = replay;
+    return FT_STREAM_SUCCESS;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI producer_thread(LPVOID argument)
+{
+    produce((FtStream *)argument);
+    return 0;
+}
+#else
+static void *producer_thread(void *argument)
+{
+    produce((FtStream *)argument);
+    return NULL;
+}
+#endif /* _WIN32 */
+
+/*
+ * producer loop: read a block, convert and filter it and queue it until
+ * stopped or the source ends
+ */
+static void produce(FtStream *stream)
+{
+    float voltages[FT_STREAM_BLOCK * (MAX_GAUGES + 1)];
+    float wrenches[FT_STREAM_BLOCK * MAX_AXES];
+    double timestamps[FT_STREAM_BLOCK];
+    FtSample samples[FT_STREAM_BLOCK];
+    uint32_t numAxes, count, queued;
+    uint32_t i, j;
+    int32_t numRead;
+
+    numAxes = stream->coefs.NumAxes;
+    memset(samples, 0, sizeof(samples));
+    while (stream->running)
+    {
+        numRead = stream->source.read(&stream->source, voltages, timestamps,
+                FT_STREAM_BLOCK);
+        if (numRead < 0)
+        {
+            stream->status = (numRead == FT_SOURCE_END) ? FT_STREAM_ENDED
+                : FT_STREAM_ERROR;
+            break;
+        }
+        if (numRead == 0)
+        {
+            stream_sleep();
+            continue;
+        }
+        count = (uint32_t)numRead;
+
+        RTConvertToFTBatch(&stream->coefs, voltages, count,
+                stream->source.numChannels, wrenches, stream->tempComp);
+        stream->produced += count;
+
+        /* decimated in place */
+        if (stream->filtered)
+        {
+            count = ft_filter_process(&stream->filter, wrenches, timestamps,
+                    count, wrenches, timestamps);
+        }
+        for (i = 0; i < count; i++)
+        {
+            samples[i].timestamp = timestamps[i];
+            samples[i].sequence = stream->emitted + i;
+            for (j = 0; j < numAxes; j++)
+            {
+                samples[i].wrench[j] = wrenches[i * numAxes + j];
+            }
+        }
+        stream->emitted += count;
+
+        /* a real time source can not wait for the consumer */
+        queued = ring_push(&stream->ring, samples, count);
+        while ((queued < count) && !stream->source.realTime
+                && stream->running)
+        {
+            stream_sleep();
+            queued += ring_push(&stream->ring, samples + queued,
+                    count - queued);
+        }
+        stream->dropped += count - queued;
+    }
+}
+
+/*
+ * read function of the replay source
+ */
+static int32_t replay_read(FtSource *source, float *voltages,
+        double *timestamps, int32_t maxSamples)
+{
+    ReplaySource *replay = (ReplaySource *)source->context;
+    double now;
+    uint32_t due;
+    int32_t count, i;
+
+    now = stream_clock();
+    if (replay->startTime < 0)
+    {
+        replay->startTime = now;
+    }
+
+    /* samples due since the start */
+    count = maxSamples;
+    if (replay->sampleRate > 0)
+    {
+        due = (uint32_t)((now - replay->startTime) * replay->sampleRate) + 1
+            - replay->replayed;
+        if (due < (uint32_t)count)
+        {
+            count = (int32_t)due;
+        }
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (replay->next == replay->numSamples)
+        {
+            if (!replay->loop)
+            {
+                return (i > 0) ? i : FT_SOURCE_END;
+            }
+            replay->next = 0;
+        }
+        memcpy(voltages + i * source->numChannels,
+                replay->voltages + replay->next * source->numChannels,
+                source->numChannels * sizeof(float));
+        timestamps[i] = (replay->sampleRate > 0)
+            ? replay->startTime + replay->replayed / replay->sampleRate : now;
+        replay->next++;
+        replay->replayed++;
+    }
+    return count;
+}
+
+static void replay_close(FtSource *source)
+{
+    ReplaySource *replay = (ReplaySource *)source->context;
+
+    if (replay != NULL)
+    {
+        free(replay->voltages);
+        free(replay);
+    }
+    source->context = NULL;
+}
+
+/*
+ * read the samples of a text file, one per line.  Returns FT_STREAM_FAILURE
+ * if a line does not have numChannels values
+ */
+static int32_t parse_voltages(const char *text, int32_t numChannels,
+        float **voltages, int32_t *numSamples)
+{
+    const char *line, *next;
+    char *end;
+    float *values, *grown;
+    int32_t capacity, numValues, lineValues;
+    double value;
+
+    *voltages = NULL;
+    *numSamples = 0;
+    capacity = 0;
+    numValues = 0;
+    values = NULL;
+    for (line = text; *line != '\0'; line = next)
+    {
+        next = strchr(line, '\n');
+        next = (next != NULL) ? next + 1 : line + strlen(line);
+        lineValues = 0;
+        for (;;)
+        {
+            while ((line < next) && ((*line == ' ') || (*line == '\t')
+                        || (*line == ',') || (*line == '\r')))
+            {
+                line++;
+            }
+            if ((line == next) || (*line == '\n') || (*line == '%'))
+            {
+                break;
+            }
+            value = strtod(line, &end);
+            if ((end == line) || (end > next) || (lineValues == numChannels))
+            {
+                free(values);
+                return FT_STREAM_FAILURE;
+            }
+            if (numValues == capacity)
+            {
+                capacity = (capacity > 0) ? 2 * capacity : 1024 * numChannels;
+                grown = (float *)realloc(values, capacity * sizeof(float));
+                if (grown == NULL)
+                {
+                    free(values);
+                    return FT_STREAM_FAILURE;
+                }
+                values = grown;
+            }
+            values[numValues++] = (float)value;
+            lineValues++;
+            line = end;
+        }
+        if ((lineValues != 0) && (lineValues != numChannels))
+        {
+            free(values);
+            return FT_STREAM_FAILURE;
+        }
+    }
+    *voltages = values;
+    *numSamples = numValues / numChannels;
+    return FT_STREAM_SUCCESS;
+}
+
+/*------------ END OF FILE ------------- */
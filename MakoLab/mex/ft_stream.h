@@ -0,0 +1,114 @@
+/****h* /ft_stream.h ***
+ * NAME
+ * 		ft_stream.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Continuous force/torque acquisition.  A producer thread
+ *              reads voltages from a sample source, converts them with the
+ *              realtime ATI coefficients and queues the timestamped
+ *              wrenches in a lock free ring buffer, which the consumer
+ *              drains in blocks.  The wrenches can be low pass filtered
+ *              and decimated on the way (ft_filter.c).  The source is
+ *              pluggable, a file replay source stands in for the DAQ
+ *              hardware.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __FT_STREAM_H__ /* make sure that ft_stream is not redeclared */
+#define __FT_STREAM_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#include <pthread.h>
+#endif
+
+#include "ftrt.h"
+#include "ft_filter.h"
+#include "ring_buffer.h"
+
+/* defines */
+#define FT_STREAM_SUCCESS 1
+#define FT_STREAM_FAILURE -1
+
+/* samples read and converted together by the producer */
+#define FT_STREAM_BLOCK 64
+
+/* status of the producer */
+#define FT_STREAM_RUNNING 1
+#define FT_STREAM_ENDED 2
+#define FT_STREAM_ERROR 3
+
+/* values returned by the read function of a source */
+#define FT_SOURCE_END -1
+#define FT_SOURCE_ERROR -2
+
+typedef struct {
+    double timestamp;           /* seconds of stream_clock */
+    uint32_t sequence;          /* output sample number since the start */
+    float wrench[MAX_AXES];     /* forces and torques */
+} FtSample;
+
+typedef struct FtSource FtSource;
+
+/* a source of voltages, read by the producer thread only */
+struct FtSource {
+    /* reads up to maxSamples samples of numChannels voltages (gauges then */
+    /* thermistor) and their timestamps, returns the number of samples */
+    /* read, 0 if none is ready yet, FT_SOURCE_END or FT_SOURCE_ERROR */
+    int32_t (*read)(FtSource *source, float *voltages, double *timestamps,
+            int32_t maxSamples);
+    void (*close)(FtSource *source);
+    int32_t numChannels;
+    int32_t realTime;           /* samples not queued in time are lost */
+    void *context;
+};
+
+typedef struct {
+    RTCoefs coefs;
+    int32_t tempComp;
+    FtSource source;
+    int32_t filtered;           /* non zero if filter is applied */
+    FtFilter filter;
+    RingBuffer ring;
+#ifdef _WIN32
+    void *thread;
+#else
+    pthread_t thread;
+#endif
+    volatile int32_t running;   /* cleared to stop the producer */
+    volatile int32_t status;    /* FT_STREAM_RUNNING, _ENDED or _ERROR */
+    volatile uint32_t produced; /* samples read from the source */
+    volatile uint32_t emitted;  /* samples out of the filter */
+    volatile uint32_t dropped;  /* samples lost because the ring was full */
+} FtStream;
+
+/* function definations */
+int32_t ft_stream_start(FtStream *stream, const RTCoefs *coefs,
+        int32_t tempComp, const FtSource *source, const FtFilter *filter,
+        uint32_t capacity);
+
+uint32_t ft_stream_read(FtStream *stream, FtSample *samples,
+        uint32_t maxSamples);
+
+void ft_stream_stop(FtStream *stream);
+
+int32_t ft_replay_open(FtSource *source, const char *fileName,
+        int32_t numChannels, double sampleRate, int32_t loop);
+
+#endif /* __FT_STREAM_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
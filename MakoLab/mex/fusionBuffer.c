@@ -0,0 +1,515 @@
+/****h* /fusionBuffer.c ***
+ * NAME
+ *      fusionBuffer.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function keeps the timestamped samples of several sensors
+ *      (arm, camera, F/T...) and interpolates all of them at a common set
+ *      of times in one call (fusion_buffer.c).  The buffers stay in memory
+ *      between calls, the mex file is locked in memory while a buffer
+ *      exists.
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fusion_buffer.h"
+
+/* defines */
+#define FUSION_MAX_BUFFERS 8
+#define FUSION_MAX_SOURCES 16
+#define COMMAND_LENGTH 16
+#define OPTION_LENGTH 32
+#define DEFAULT_CAPACITY 65536
+
+typedef struct {
+    int numSources;
+    FusionSource sources[FUSION_MAX_SOURCES];
+} FusionBuffer;
+
+/* open buffers, the buffer id is the index plus one */
+static FusionBuffer *buffers[FUSION_MAX_BUFFERS];
+static int lockedBuffers = 0;
+
+/* internal functions */
+static void createBuffer(mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+static void pushSamples(FusionBuffer *buffer, int nrhs,
+        const mxArray *prhs[]);
+static void queryBuffer(int nlhs, mxArray *plhs[], FusionBuffer *buffer,
+        const mxArray *timesArray);
+static void bufferRange(mxArray *plhs[], FusionBuffer *buffer);
+static void destroyBuffer(int index);
+static void destroyAllBuffers(void);
+static int getBufferIndex(const mxArray *idArray);
+static int getSourceIndex(const FusionBuffer *buffer,
+        const mxArray *sourceArray);
+static double getOption(const mxArray *value, int index);
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    char command[COMMAND_LENGTH];
+    FusionBuffer *buffer;
+    int index, i;
+
+    /* first check the inputs */
+    if ((nrhs < 1) || !mxIsChar(prhs[0])
+            || (mxGetString(prhs[0], command, COMMAND_LENGTH) != 0))
+    {
+        mexErrMsgTxt("Must specify a command: create, push, query, range, clear or destroy");
+        return;
+    }
+
+    if (strcmp(command, "create") == 0)
+    {
+        createBuffer(plhs, nrhs - 1, prhs + 1);
+        return;
+    }
+    if ((strcmp(command, "destroy") == 0) && (nrhs == 1))
+    {
+        destroyAllBuffers();
+        return;
+    }
+    if ((strcmp(command, "push") != 0) && (strcmp(command, "query") != 0)
+            && (strcmp(command, "range") != 0)
+            && (strcmp(command, "clear") != 0)
+            && (strcmp(command, "destroy") != 0))
+    {
+        mexErrMsgTxt("Unknown command, use create, push, query, range, clear or destroy");
+        return;
+    }
+    if (nrhs < 2)
+    {
+        mexErrMsgTxt("Must specify the buffer id");
+        return;
+    }
+    index = getBufferIndex(prhs[1]);
+    buffer = buffers[index];
+
+    if (strcmp(command, "push") == 0)
+    {
+        pushSamples(buffer, nrhs - 2, prhs + 2);
+    }
+    else if (strcmp(command, "query") == 0)
+    {
+        if (nrhs < 3)
+        {
+            mexErrMsgTxt("Must specify the query times");
+            return;
+        }
+        queryBuffer(nlhs, plhs, buffer, prhs[2]);
+    }
+    else if (strcmp(command, "range") == 0)
+    {
+        bufferRange(plhs, buffer);
+    }
+    else if (strcmp(command, "clear") == 0)
+    {
+        for (i = 0; i < buffer->numSources; i++)
+        {
+            if ((nrhs < 3) || (i == getSourceIndex(buffer, prhs[2])))
+                fusion_source_clear(&buffer->sources[i]);
+        }
+    }
+    else
+    {
+        destroyBuffer(index);
+    }
+    return;
+}
+
+/*
+ * id = fusionBuffer('create',sources,'parameter',value,...)
+ */
+static void createBuffer(mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    char option[OPTION_LENGTH];
+    char typeName[OPTION_LENGTH];
+    const mxArray *capacityArray = NULL;
+    const mxArray *maxGapArray = NULL;
+    const mxArray *sourceArray;
+    FusionBuffer *buffer;
+    double capacity, maxGap;
+    int32_t type;
+    uint32_t width;
+    int numSources, index, i;
+
+    if ((nrhs < 1) || (nrhs % 2 != 1) || !mxIsCell(prhs[0]))
+    {
+        mexErrMsgTxt("Must specify the sources as a cell array and parameter/value pairs");
+        return;
+    }
+    numSources = (int)mxGetNumberOfElements(prhs[0]);
+    if ((numSources < 1) || (numSources > FUSION_MAX_SOURCES))
+    {
+        mexErrMsgTxt("Must have 1 to 16 sources");
+        return;
+    }
+    for (i = 1; i < nrhs; i += 2)
+    {
+        if (!mxIsChar(prhs[i])
+                || (mxGetString(prhs[i], option, OPTION_LENGTH) != 0))
+        {
+            mexErrMsgTxt("Parameter names must be strings");
+            return;
+        }
+        if (!mxIsDouble(prhs[i + 1]) || ((mxGetNumberOfElements(prhs[i + 1])
+                        != 1) && ((int)mxGetNumberOfElements(prhs[i + 1])
+                        != numSources)))
+        {
+            mexErrMsgTxt("Parameter values must be a number or one number per source");
+            return;
+        }
+        if (strcmp(option, "Capacity") == 0)
+        {
+            capacityArray = prhs[i + 1];
+        }
+        else if (strcmp(option, "MaxGap") == 0)
+        {
+            maxGapArray = prhs[i + 1];
+        }
+        else
+        {
+            mexErrMsgTxt("Unknown parameter, use Capacity or MaxGap");
+            return;
+        }
+    }
+
+    for (index = 0; index < FUSION_MAX_BUFFERS; index++)
+    {
+        if (buffers[index] == NULL)
+            break;
+    }
+    if (index == FUSION_MAX_BUFFERS)
+    {
+        mexErrMsgTxt("Too many buffers, destroy one first");
+        return;
+    }
+
+    /* the buffer lives until destroyed, outside of the matlab memory */
+    buffer = (FusionBuffer *)calloc(1, sizeof(FusionBuffer));
+    if (buffer == NULL)
+    {
+        mexErrMsgTxt("Unable to allocate the buffer");
+        return;
+    }
+    for (i = 0; i < numSources; i++)
+    {
+        /* 'pose' or the number of values of a vector source */
+        sourceArray = mxGetCell(prhs[0], i);
+        type = 0;
+        width = 0;
+        if ((sourceArray != NULL) && mxIsChar(sourceArray)
+                && (mxGetString(sourceArray, typeName, OPTION_LENGTH) == 0)
+                && (strcmp(typeName, "pose") == 0))
+        {
+            type = FUSION_POSE;
+        }
+        else if ((sourceArray != NULL) && mxIsNumeric(sourceArray)
+                && !mxIsEmpty(sourceArray) && (mxGetScalar(sourceArray) >= 1))
+        {
+            type = FUSION_LINEAR;
+            width = (uint32_t)mxGetScalar(sourceArray);
+        }
+        capacity = (capacityArray != NULL) ? getOption(capacityArray, i)
+            : DEFAULT_CAPACITY;
+        maxGap = (maxGapArray != NULL) ? getOption(maxGapArray, i)
+            : mxGetInf();
+        if ((capacity < 1) || (capacity > 0x80000000U)
+                || (fusion_source_create(&buffer->sources[i], type, width,
+                        (uint32_t)capacity, maxGap) != FUSION_SUCCESS))
+        {
+            buffer->numSources = i;
+            for (i = 0; i < buffer->numSources; i++)
+                fusion_source_destroy(&buffer->sources[i]);
+            free(buffer);
+            mexErrMsgTxt("Sources must be 'pose' or a number of values, capacity and MaxGap positive");
+            return;
+        }
+    }
+    buffer->numSources = numSources;
+
+    buffers[index] = buffer;
+    if (lockedBuffers++ == 0)
+    {
+        mexLock();
+        mexAtExit(destroyAllBuffers);
+    }
+    plhs[0] = mxCreateDoubleScalar(index + 1);
+}
+
+/*
+ * fusionBuffer('push',id,source,t,values)
+ */
+static void pushSamples(FusionBuffer *buffer, int nrhs,
+        const mxArray *prhs[])
+{
+    FusionSource *source;
+    const double *values;
+    double *records;
+    const mwSize *dims;
+    int numSamples, width, i, j;
+    int32_t result;
+
+    if (nrhs != 3)
+    {
+        mexErrMsgTxt("Must specify the source, the times and the values");
+        return;
+    }
+    source = &buffer->sources[getSourceIndex(buffer, prhs[0])];
+    if (!mxIsDouble(prhs[1]) || !mxIsDouble(prhs[2])
+            || mxIsComplex(prhs[2]))
+    {
+        mexErrMsgTxt("Times and values must be double");
+        return;
+    }
+    numSamples = (int)mxGetNumberOfElements(prhs[1]);
+    width = (int)source->width;
+    values = mxGetPr(prhs[2]);
+    dims = mxGetDimensions(prhs[2]);
+
+    /* one row per sample, the records are one sample after the other */
+    records = (double *)mxMalloc(((size_t)numSamples * width + 1)
+            * sizeof(double));
+    if ((source->type == FUSION_POSE) && (dims[0] == 4) && (dims[1] == 4)
+            && ((int)mxGetNumberOfElements(prhs[2]) == 16 * numSamples))
+    {
+        for (i = 0; i < numSamples; i++)
+        {
+            fusion_transform_to_pose(values + 16 * i, records + i * width);
+        }
+    }
+    else if (((int)mxGetM(prhs[2]) == numSamples)
+            && ((int)mxGetN(prhs[2]) == width)
+            && (mxGetNumberOfDimensions(prhs[2]) == 2))
+    {
+        for (i = 0; i < numSamples; i++)
+        {
+            for (j = 0; j < width; j++)
+            {
+                records[i * width + j] = values[j * numSamples + i];
+            }
+        }
+    }
+    else
+    {
+        mxFree(records);
+        mexErrMsgTxt("Values must have one row per time and one column per "
+                "value of the source, or be 4x4xN transforms for a pose source");
+        return;
+    }
+
+    result = fusion_source_push(source, mxGetPr(prhs[1]), records,
+            (uint32_t)numSamples);
+    mxFree(records);
+    if (result != FUSION_SUCCESS)
+    {
+        mexErrMsgTxt("Times must increase and follow the samples already pushed");
+        return;
+    }
+}
+
+/*
+ * [values1,...,valuesN,valid] = fusionBuffer('query',id,t)
+ */
+static void queryBuffer(int nlhs, mxArray *plhs[], FusionBuffer *buffer,
+        const mxArray *timesArray)
+{
+    FusionSource *source;
+    unsigned char *valid;
+    double *records, *values;
+    double nan;
+    int dims[3];
+    int numTimes, numOutputs, width, i, j, k;
+
+    if ((nlhs > buffer->numSources + 1) || !mxIsDouble(timesArray))
+    {
+        mexErrMsgTxt("Must have at most one output per source and the "
+                "validity, the times must be double");
+        return;
+    }
+    numTimes = (int)mxGetNumberOfElements(timesArray);
+    nan = mxGetNaN();
+    valid = (unsigned char *)mxMalloc(numTimes + 1);
+    if (nlhs > buffer->numSources)
+    {
+        plhs[buffer->numSources] = mxCreateLogicalMatrix(numTimes,
+                buffer->numSources);
+    }
+
+    /* only the sources returned are interpolated */
+    numOutputs = (nlhs > buffer->numSources) ? buffer->numSources
+        : ((nlhs > 0) ? nlhs : 1);
+    for (k = 0; k < numOutputs; k++)
+    {
+        source = &buffer->sources[k];
+        width = (int)source->width;
+        records = (double *)mxMalloc(((size_t)numTimes * width + 1)
+                * sizeof(double));
+        fusion_source_query(source, mxGetPr(timesArray), (uint32_t)numTimes,
+                records, valid);
+
+        /* poses as 4x4xN transforms, vectors one row per time */
+        if (source->type == FUSION_POSE)
+        {
+            dims[0] = 4;
+            dims[1] = 4;
+            dims[2] = numTimes;
+            plhs[k] = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+            values = mxGetPr(plhs[k]);
+            for (i = 0; i < numTimes; i++)
+            {
+                if (valid[i])
+                {
+                    fusion_pose_to_transform(records + i * width,
+                            values + 16 * i);
+                }
+                else
+                {
+                    for (j = 0; j < 16; j++)
+                        values[16 * i + j] = nan;
+                }
+            }
+        }
+        else
+        {
+            plhs[k] = mxCreateDoubleMatrix(numTimes, width, mxREAL);
+            values = mxGetPr(plhs[k]);
+            for (i = 0; i < numTimes; i++)
+            {
+                for (j = 0; j < width; j++)
+                {
+                    values[j * numTimes + i] = valid[i]
+                        ? records[i * width + j] : nan;
+                }
+            }
+        }
+        mxFree(records);
+
+        if (nlhs > buffer->numSources)
+        {
+            for (i = 0; i < numTimes; i++)
+            {
+                mxGetLogicals(plhs[buffer->numSources])[k * numTimes + i] =
+                    (mxLogical)valid[i];
+            }
+        }
+    }
+    mxFree(valid);
+}
+
+/*
+ * range = fusionBuffer('range',id)
+ */
+static void bufferRange(mxArray *plhs[], FusionBuffer *buffer)
+{
+    FusionSource *source;
+    double *range;
+    uint32_t first;
+    int numSources, i;
+
+    numSources = buffer->numSources;
+    plhs[0] = mxCreateDoubleMatrix(numSources, 3, mxREAL);
+    range = mxGetPr(plhs[0]);
+    for (i = 0; i < numSources; i++)
+    {
+        source = &buffer->sources[i];
+        first = (source->head - source->count) & (source->capacity - 1);
+        range[i] = (source->count > 0) ? source->times[first] : mxGetNaN();
+        range[numSources + i] = (source->count > 0)
+            ? source->times[(source->head - 1) & (source->capacity - 1)]
+            : mxGetNaN();
+        range[2 * numSources + i] = source->count;
+    }
+}
+
+/*
+ * free a buffer, the mex file is unlocked with the last one
+ */
+static void destroyBuffer(int index)
+{
+    int i;
+
+    for (i = 0; i < buffers[index]->numSources; i++)
+    {
+        fusion_source_destroy(&buffers[index]->sources[i]);
+    }
+    free(buffers[index]);
+    buffers[index] = NULL;
+    if (--lockedBuffers == 0)
+    {
+        mexUnlock();
+    }
+}
+
+static void destroyAllBuffers(void)
+{
+    int index;
+
+    for (index = 0; index < FUSION_MAX_BUFFERS; index++)
+    {
+        if (buffers[index] != NULL)
+            destroyBuffer(index);
+    }
+}
+
+/*
+ * index of an existing buffer, errors out on an invalid id
+ */
+static int getBufferIndex(const mxArray *idArray)
+{
+    int index;
+
+    index = mxIsNumeric(idArray) ? (int)mxGetScalar(idArray) - 1 : -1;
+    if ((index < 0) || (index >= FUSION_MAX_BUFFERS)
+            || (buffers[index] == NULL))
+    {
+        mexErrMsgTxt("Invalid buffer id");
+        return 0;
+    }
+    return index;
+}
+
+/*
+ * index of a source from its number (1 based), errors out if invalid
+ */
+static int getSourceIndex(const FusionBuffer *buffer,
+        const mxArray *sourceArray)
+{
+    int index;
+
+    index = (mxIsNumeric(sourceArray) && !mxIsEmpty(sourceArray))
+        ? (int)mxGetScalar(sourceArray) - 1 : -1;
+    if ((index < 0) || (index >= buffer->numSources))
+    {
+        mexErrMsgTxt("Invalid source number");
+        return 0;
+    }
+    return index;
+}
+
+/*
+ * value of a source from a scalar or a vector with one value per source
+ */
+static double getOption(const mxArray *value, int index)
+{
+    return (mxGetNumberOfElements(value) == 1) ? mxGetScalar(value)
+        : mxGetPr(value)[index];
+}
+
+/*----------- END OF FILE ------------ */
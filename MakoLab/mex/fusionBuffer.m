@@ -0,0 +1,73 @@
+%FUSIONBUFFER Time aligned buffer of arm, camera and F/T samples
+%
+% Syntax:
+%   id = fusionBuffer('create',sources,'parameter',value,...)
+%       creates a buffer with one source per element of the cell array
+%       sources: 'pose' for rigid body poses, or the number of values of a
+%       vector source (joint angles, wrenches...).  The parameters are,
+%       a number for all the sources or one per source:
+%           Capacity     samples kept per source, the oldest are
+%                        overwritten (default 65536)
+%           MaxGap       longest interval between two samples that is
+%                        interpolated, in seconds (default Inf); longer
+%                        intervals are sensor dropouts
+%       returns the id of the buffer.
+%   fusionBuffer('push',id,source,t,values)
+%       adds the samples of the source (1 based, in the order of sources).
+%       t holds the timestamps, increasing and after the samples already
+%       pushed.  values has one row per sample, or is 4x4xN homogeneous
+%       transforms for a pose source ([q0 qx qy qz x y z] rows are also
+%       accepted).
+%   [values1,...,valuesN] = fusionBuffer('query',id,t)
+%       interpolates the sources at the times t: linearly for vectors, by
+%       SLERP of the rotation and linearly for the translation for poses.
+%       A pose source returns 4x4xM transforms, a vector source one row
+%       per time.  Times outside the samples of a source or in a dropout
+%       are NaN.  Only the sources with an output are interpolated.
+%   [values1,...,valuesN,valid] = fusionBuffer('query',id,t)
+%       also returns valid, logical with one row per time and one column
+%       per source.
+%   range = fusionBuffer('range',id)
+%       returns [first last count] of the samples of each source, one row
+%       per source.
+%   fusionBuffer('clear',id)
+%   fusionBuffer('clear',id,source)
+%       discards the samples of all the sources or of one source.
+%   fusionBuffer('destroy',id)
+%       frees the buffer.
+%   fusionBuffer('destroy')
+%       frees all the buffers.
+%
+% Notes:
+%   Timestamps from ftStream and ndiStream share the same clock and can be
+%   pushed as read.  Samples of other sources must be timestamped on the
+%   same clock (ftStream('clock')) when they are taken.  Push only the
+%   poses of visible tools, the transform of a missing tool is 0.
+%   The samples are kept outside of matlab, the mex file stays locked in
+%   memory while a buffer exists.  Sorted query times are the fastest, the
+%   search restarts from the previous time.
+%
+% Example:
+%   id = fusionBuffer('create',{'pose',6},'MaxGap',[0.05 0.01]);
+%   poses = ndiStream('read',cameraId);
+%   tool = (poses.handle==1) & (poses.status==1);
+%   fusionBuffer('push',id,1,poses.timestamp(tool),poses.transform(:,:,tool));
+%   [ft,t] = ftStream('read',ftId);
+%   fusionBuffer('push',id,2,t,ft);
+%   range = fusionBuffer('range',id);
+%   t = max(range(:,1)):0.01:min(range(:,2));
+%   [T,wrench,valid] = fusionBuffer('query',id,t);
+%   fusionBuffer('destroy',id);
+%
+% See also:
+%    ndiStream, ftStream
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
@@ -0,0 +1,540 @@
+/****h* /fusion_buffer.c ***
+ * NAME
+ *      fusion_buffer.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      Ring of timestamped samples of a sensor, interpolated at arbitrary
+ *      times.  The samples are stored contiguously, one record of width
+ *      values per sample, and located by binary search on the timestamps;
+ *      a sorted set of query times restarts each search from the previous
+ *      result.  Poses are kept as a unit quaternion and a position, the
+ *      rotation is interpolated by SLERP and the position linearly.
+ *
+ * SEE ALSO
+ *      fusion_buffer.h, fusionBuffer.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fusion_buffer.h"
+
+/* defines */
+/* below this angle between the quaternions SLERP is replaced by a */
+/* normalized linear interpolation, sin(theta) is too small to divide by */
+#define SLERP_MIN_COSINE 0.9995
+
+/* internal functions */
+static double time_at(const FusionSource *source, uint32_t index);
+static const double *values_at(const FusionSource *source, uint32_t index);
+static uint32_t find_lower(const FusionSource *source, double time,
+        uint32_t lower);
+static void interpolate(const FusionSource *source, const double *before,
+        const double *after, double fraction, double *values);
+static void normalize_quaternion(double *quaternion);
+
+/****f*  fusion_buffer.c/fusion_source_create ******
+ * NAME
+ *	    fusion_source_create
+ *
+ * SYNOPSIS
+ *      int32_t fusion_source_create(FusionSource *source, int32_t type,
+ *              uint32_t width, uint32_t capacity, double maxGap)
+ *
+ * INPUTS
+ *      int32_t type
+ *              FUSION_LINEAR or FUSION_POSE
+ *      uint32_t width
+ *              values per sample of a linear source, ignored for poses
+ *      uint32_t capacity
+ *              minimum number of samples kept, rounded up to a power of 2
+ *      double maxGap
+ *              samples further apart are not interpolated (the sensor
+ *              dropped out), in seconds
+ *
+ * OUTPUT
+ *      FusionSource *source
+ *              empty source, to be freed by fusion_source_destroy
+ *      Returns FUSION_SUCCESS or FUSION_FAILURE if the arguments are
+ *      invalid or the memory could not be allocated
+ *
+ **********************************
+ */
+int32_t fusion_source_create(FusionSource *source, int32_t type,
+        uint32_t width, uint32_t capacity, double maxGap)
+{
+    uint32_t size;
+
+    memset(source, 0, sizeof(FusionSource));
+    if (type == FUSION_POSE)
+    {
+        width = FUSION_POSE_WIDTH;
+    }
+    else if (type != FUSION_LINEAR)
+    {
+        return FUSION_FAILURE;
+    }
+    if ((width == 0) || (capacity == 0) || (capacity > 0x80000000U)
+            || !(maxGap > 0))
+    {
+        return FUSION_FAILURE;
+    }
+    size = 1;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+
+    source->times = (double *)malloc((size_t)size * sizeof(double));
+    source->values = (double *)malloc((size_t)size * width * sizeof(double));
+    if ((source->times == NULL) || (source->values == NULL))
+    {
+        fusion_source_destroy(source);
+        return FUSION_FAILURE;
+    }
+    source->type = type;
+    source->width = width;
+    source->capacity = size;
+    source->maxGap = maxGap;
+    return FUSION_SUCCESS;
+}
+
+/****f*  fusion_buffer.c/fusion_source_destroy ******
+ * NAME
+ *	    fusion_source_destroy
+ *
+ * SYNOPSIS
+ *      void fusion_source_destroy(FusionSource *source)
+ *
+ **********************************
+ */
+void fusion_source_destroy(FusionSource *source)
+{
+    free(source->times);
+    free(source->values);
+    source->times = NULL;
+    source->values = NULL;
+    source->capacity = 0;
+    source->count = 0;
+}
+
+/****f*  fusion_buffer.c/fusion_source_clear ******
+ * NAME
+ *	    fusion_source_clear
+ *
+ * SYNOPSIS
+ *      void fusion_source_clear(FusionSource *source)
+ *
+ * PURPOSE
+ *	    Discard the samples, the next ones can start at any time
+ *
+ **********************************
+ */
+void fusion_source_clear(FusionSource *source)
+{
+    source->head = 0;
+    source->count = 0;
+}
+
+/****f*  fusion_buffer.c/fusion_source_push ******
+ * NAME
+ *	    fusion_source_push
+ *
+ * SYNOPSIS
+ *      int32_t fusion_source_push(FusionSource *source,
+ *              const double *times, const double *values,
+ *              uint32_t numSamples)
+ *
+ * INPUTS
+ *      const double *times
+ *              timestamps of the samples, increasing and after the last
+ *              sample of the source
+ *      const double *values
+ *              numSamples records of width values; the quaternion of a
+ *              pose is normalized
+ *
+ * OUTPUT
+ *      Returns FUSION_SUCCESS, or FUSION_NOT_INCREASING and the source is
+ *      unchanged
+ *
+ * NOTES
+ *      The oldest samples are overwritten when the source is full
+ *
+ **********************************
+ */
+int32_t fusion_source_push(FusionSource *source, const double *times,
+        const double *values, uint32_t numSamples)
+{
+    double last;
+    double *record;
+    uint32_t width, mask, i;
+
+    last = (source->count > 0) ? time_at(source, source->count - 1)
+        : -HUGE_VAL;
+    for (i = 0; i < numSamples; i++)
+    {
+        if (!(times[i] > last))
+        {
+            return FUSION_NOT_INCREASING;
+        }
+        last = times[i];
+    }
+
+    /* only the last capacity samples are kept */
+    if (numSamples > source->capacity)
+    {
+        times += numSamples - source->capacity;
+        values += (size_t)(numSamples - source->capacity) * source->width;
+        source->head += numSamples - source->capacity;
+        numSamples = source->capacity;
+    }
+
+    width = source->width;
+    mask = source->capacity - 1;
+    for (i = 0; i < numSamples; i++)
+    {
+        source->times[source->head & mask] = times[i];
+        record = source->values + (size_t)(source->head & mask) * width;
+        memcpy(record, values + (size_t)i * width, width * sizeof(double));
+        if (source->type == FUSION_POSE)
+        {
+            normalize_quaternion(record);
+        }
+        source->head++;
+    }
+    source->count += numSamples;
+    if (source->count > source->capacity)
+    {
+        source->count = source->capacity;
+    }
+    return FUSION_SUCCESS;
+}
+
+/****f*  fusion_buffer.c/fusion_source_query ******
+ * NAME
+ *	    fusion_source_query
+ *
+ * SYNOPSIS
+ *      uint32_t fusion_source_query(const FusionSource *source,
+ *              const double *times, uint32_t numTimes, double *values,
+ *              unsigned char *valid)
+ *
+ * INPUTS
+ *      const double *times
+ *              query times, in any order; sorted times are the fastest
+ *
+ * OUTPUT
+ *      double *values
+ *              numTimes records of width values, unchanged if not valid
+ *      unsigned char *valid
+ *              1 if the time is within the samples of the source and the
+ *              samples around it are at most maxGap apart, 0 otherwise
+ *      Returns the number of valid times
+ *
+ **********************************
+ */
+uint32_t fusion_source_query(const FusionSource *source,
+        const double *times, uint32_t numTimes, double *values,
+        unsigned char *valid)
+{
+    const double *before, *after;
+    double first, last, timeBefore, timeAfter, previous;
+    double *record;
+    uint32_t width, lower, numValid, i;
+
+    width = source->width;
+    numValid = 0;
+    lower = 0;
+    previous = HUGE_VAL;
+    first = (source->count > 0) ? time_at(source, 0) : HUGE_VAL;
+    last = (source->count > 0) ? time_at(source, source->count - 1)
+        : -HUGE_VAL;
+
+    for (i = 0; i < numTimes; i++)
+    {
+        record = values + (size_t)i * width;
+        valid[i] = 0;
+
+        /* also rejects NaN */
+        if (!((times[i] >= first) && (times[i] <= last)))
+        {
+            continue;
+        }
+
+        /* sorted queries keep searching from the previous sample */
+        if (times[i] < previous)
+        {
+            lower = 0;
+        }
+        previous = times[i];
+        lower = find_lower(source, times[i], lower);
+        timeBefore = time_at(source, lower);
+        before = values_at(source, lower);
+
+        if (times[i] == timeBefore)
+        {
+            memcpy(record, before, width * sizeof(double));
+        }
+        else
+        {
+            timeAfter = time_at(source, lower + 1);
+            if (timeAfter - timeBefore > source->maxGap)
+            {
+                continue;
+            }
+            after = values_at(source, lower + 1);
+            interpolate(source, before, after,
+                    (times[i] - timeBefore) / (timeAfter - timeBefore),
+                    record);
+        }
+        valid[i] = 1;
+        numValid++;
+    }
+    return numValid;
+}
+
+/****f*  fusion_buffer.c/fusion_transform_to_pose ******
+ * NAME
+ *	    fusion_transform_to_pose
+ *
+ * SYNOPSIS
+ *      void fusion_transform_to_pose(const double transform[16],
+ *              double pose[FUSION_POSE_WIDTH])
+ *
+ * INPUTS
+ *      const double transform[16]
+ *              4x4 homogeneous transform, column major as in matlab
+ *
+ * OUTPUT
+ *      double pose[FUSION_POSE_WIDTH]
+ *              unit quaternion q0 qx qy qz (q0 >= 0) and position x y z
+ *
+ * NOTES
+ *      The quaternion is computed from the largest of its components to
+ *      keep the precision for any rotation
+ *
+ **********************************
+ */
+void fusion_transform_to_pose(const double transform[16],
+        double pose[FUSION_POSE_WIDTH])
+{
+    const double *t = transform;
+    double trace, s;
+    int32_t i;
+
+    /* t[row + 4 * column] */
+    trace = t[0] + t[5] + t[10];
+    if ((trace > t[0]) && (trace > t[5]) && (trace > t[10]))
+    {
+        s = 2 * sqrt(1 + trace);
+        pose[0] = s / 4;
+        pose[1] = (t[6] - t[9]) / s;
+        pose[2] = (t[8] - t[2]) / s;
+        pose[3] = (t[1] - t[4]) / s;
+    }
+    else if ((t[0] >= t[5]) && (t[0] >= t[10]))
+    {
+        s = 2 * sqrt(1 + t[0] - t[5] - t[10]);
+        pose[0] = (t[6] - t[9]) / s;
+        pose[1] = s / 4;
+        pose[2] = (t[4] + t[1]) / s;
+        pose[3] = (t[8] + t[2]) / s;
+    }
+    else if (t[5] >= t[10])
+    {
+        s = 2 * sqrt(1 - t[0] + t[5] - t[10]);
+        pose[0] = (t[8] - t[2]) / s;
+        pose[1] = (t[4] + t[1]) / s;
+        pose[2] = s / 4;
+        pose[3] = (t[9] + t[6]) / s;
+    }
+    else
+    {
+        s = 2 * sqrt(1 - t[0] - t[5] + t[10]);
+        pose[0] = (t[1] - t[4]) / s;
+        pose[1] = (t[8] + t[2]) / s;
+        pose[2] = (t[9] + t[6]) / s;
+        pose[3] = s / 4;
+    }
+    if (pose[0] < 0)
+    {
+        for (i = 0; i < 4; i++)
+            pose[i] = -pose[i];
+    }
+    normalize_quaternion(pose);
+    pose[4] = t[12];
+    pose[5] = t[13];
+    pose[6] = t[14];
+}
+
+/****f*  fusion_buffer.c/fusion_pose_to_transform ******
+ * NAME
+ *	    fusion_pose_to_transform
+ *
+ * SYNOPSIS
+ *      void fusion_pose_to_transform(const double pose[FUSION_POSE_WIDTH],
+ *              double transform[16])
+ *
+ * OUTPUT
+ *      double transform[16]
+ *              4x4 homogeneous transform, column major as in matlab
+ *
+ **********************************
+ */
+void fusion_pose_to_transform(const double pose[FUSION_POSE_WIDTH],
+        double transform[16])
+{
+    double s, x, y, z;
+
+    s = pose[0];
+    x = pose[1];
+    y = pose[2];
+    z = pose[3];
+
+    transform[0] = 1 - 2 * (y * y + z * z);
+    transform[1] = 2 * (x * y + s * z);
+    transform[2] = 2 * (x * z - s * y);
+    transform[3] = 0;
+    transform[4] = 2 * (x * y - s * z);
+    transform[5] = 1 - 2 * (x * x + z * z);
+    transform[6] = 2 * (y * z + s * x);
+    transform[7] = 0;
+    transform[8] = 2 * (x * z + s * y);
+    transform[9] = 2 * (y * z - s * x);
+    transform[10] = 1 - 2 * (x * x + y * y);
+    transform[11] = 0;
+    transform[12] = pose[4];
+    transform[13] = pose[5];
+    transform[14] = pose[6];
+    transform[15] = 1;
+}
+
+/*
+ * timestamp and values of a sample, index 0 is the oldest kept
+ */
+static double time_at(const FusionSource *source, uint32_t index)
+{
+    return source->times[(source->head - source->count + index)
+        & (source->capacity - 1)];
+}
+
+static const double *values_at(const FusionSource *source, uint32_t index)
+{
+    return source->values + (size_t)((source->head - source->count + index)
+            & (source->capacity - 1)) * source->width;
+}
+
+/*
+ * last sample at or before time, searching from lower.  The interval
+ * searched grows exponentially from lower, so a query close to the
+ * previous one costs a few steps
+ */
+static uint32_t find_lower(const FusionSource *source, double time,
+        uint32_t lower)
+{
+    uint32_t upper, step, middle;
+
+    /* time_at(lower) <= time, find upper with time < time_at(upper) */
+    step = 1;
+    upper = lower + step;
+    while ((upper < source->count) && (time_at(source, upper) <= time))
+    {
+        lower = upper;
+        step <<= 1;
+        upper = lower + step;
+    }
+    if (upper > source->count)
+    {
+        upper = source->count;
+    }
+
+    while (upper - lower > 1)
+    {
+        middle = lower + (upper - lower) / 2;
+        if (time_at(source, middle) <= time)
+        {
+            lower = middle;
+        }
+        else
+        {
+            upper = middle;
+        }
+    }
+    return lower;
+}
+
+/*
+ * values at fraction (0..1) of the way from before to after
+ */
+static void interpolate(const FusionSource *source, const double *before,
+        const double *after, double fraction, double *values)
+{
+    double cosine, angle, weightBefore, weightAfter, sign;
+    uint32_t j;
+
+    if (source->type == FUSION_LINEAR)
+    {
+        for (j = 0; j < source->width; j++)
+        {
+            values[j] = before[j] + fraction * (after[j] - before[j]);
+        }
+        return;
+    }
+
+    /* q and -q are the same rotation, take the shortest path */
+    cosine = before[0] * after[0] + before[1] * after[1]
+        + before[2] * after[2] + before[3] * after[3];
+    sign = 1;
+    if (cosine < 0)
+    {
+        cosine = -cosine;
+        sign = -1;
+    }
+    if (cosine > SLERP_MIN_COSINE)
+    {
+        weightBefore = 1 - fraction;
+        weightAfter = fraction;
+    }
+    else
+    {
+        angle = acos(cosine);
+        weightBefore = sin((1 - fraction) * angle) / sin(angle);
+        weightAfter = sin(fraction * angle) / sin(angle);
+    }
+    for (j = 0; j < 4; j++)
+    {
+        values[j] = weightBefore * before[j] + sign * weightAfter * after[j];
+    }
+    normalize_quaternion(values);
+    for (j = 4; j < FUSION_POSE_WIDTH; j++)
+    {
+        values[j] = before[j] + fraction * (after[j] - before[j]);
+    }
+}
+
+static void normalize_quaternion(double *quaternion)
+{
+    double norm;
+    int32_t j;
+
+    norm = sqrt(quaternion[0] * quaternion[0] + quaternion[1] * quaternion[1]
+            + quaternion[2] * quaternion[2] + quaternion[3] * quaternion[3]);
+    if (norm > 0)
+    {
+        for (j = 0; j < 4; j++)
+            quaternion[j] /= norm;
+    }
+}
+
+/*------------ END OF FILE ------------- */
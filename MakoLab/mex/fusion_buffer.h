@@ -0,0 +1,80 @@
+/****h* /fusion_buffer.h ***
+ * NAME
+ * 		fusion_buffer.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Time aligned buffer of a sensor stream.  The samples of a
+ *              source (arm joints, camera poses, F/T wrenches...) are kept
+ *              in a ring, oldest overwritten, with increasing timestamps,
+ *              and the source is interpolated at any set of times: linearly
+ *              for vectors, by SLERP of the rotation for poses.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __FUSION_BUFFER_H__ /* make sure that fusion_buffer is not redeclared */
+#define __FUSION_BUFFER_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#endif
+
+/* defines */
+#define FUSION_SUCCESS 1
+#define FUSION_FAILURE -1
+#define FUSION_NOT_INCREASING -2    /* a timestamp is not after the last one */
+
+/* kind of source */
+#define FUSION_LINEAR 1             /* vector, linear interpolation */
+#define FUSION_POSE 2               /* [q0 qx qy qz x y z], SLERP */
+
+#define FUSION_POSE_WIDTH 7
+
+typedef struct {
+    int32_t type;               /* FUSION_LINEAR or FUSION_POSE */
+    uint32_t width;             /* values per sample */
+    uint32_t capacity;          /* samples kept, a power of 2 */
+    uint32_t head;              /* samples pushed, free running */
+    uint32_t count;             /* samples kept, at most capacity */
+    double maxGap;              /* longest interval interpolated, seconds */
+    double *times;              /* capacity timestamps */
+    double *values;             /* capacity samples of width values */
+} FusionSource;
+
+/* function definations */
+int32_t fusion_source_create(FusionSource *source, int32_t type,
+        uint32_t width, uint32_t capacity, double maxGap);
+
+void fusion_source_destroy(FusionSource *source);
+
+void fusion_source_clear(FusionSource *source);
+
+int32_t fusion_source_push(FusionSource *source, const double *times,
+        const double *values, uint32_t numSamples);
+
+uint32_t fusion_source_query(const FusionSource *source,
+        const double *times, uint32_t numTimes, double *values,
+        unsigned char *valid);
+
+void fusion_transform_to_pose(const double transform[16],
+        double pose[FUSION_POSE_WIDTH]);
+
+void fusion_pose_to_transform(const double pose[FUSION_POSE_WIDTH],
+        double transform[16]);
+
+#endif /* __FUSION_BUFFER_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,480 @@
+/****h* /kinematicCalibration.c ***
+ * NAME
+ *      kinematicCalibration.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function identifies the kinematic parameters of the arm from
+ *      ball bar samples (kinematic_calibration.c), starting from given
+ *      parameters or from those of the hgs_arm.cfg file.
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+#include <string.h>
+
+#include "kinematic_calibration.h"
+
+/* defines */
+#define OPTION_LENGTH 32
+
+/* internal functions */
+static void getParameters(KcParameters *parameters, const mxArray *initial,
+        const char *calibration);
+static void getConfigParameters(KcParameters *parameters,
+        const mxArray *initial, const char *calibration);
+static const double *getField(const mxArray *structure, const char *name,
+        size_t numElements, int required);
+static void getConstant(KcProblem *problem, uint32_t numJoints,
+        const mxArray *constant);
+static mxArray *createParameters(const KcParameters *parameters);
+static mxArray *createInfo(const KcInfo *info);
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    char option[OPTION_LENGTH];
+    char calibration[OPTION_LENGTH];
+    KcParameters parameters;
+    KcProblem problem;
+    KcOptions options;
+    KcInfo info;
+    const mxArray *constant = NULL;
+    const mxArray *length = NULL;
+    const mxArray *base = NULL;
+    uint32_t numSamples, numJoints;
+    int i;
+
+    /* first check the inputs */
+    if ((nrhs < 3) || (nrhs % 2 != 1))
+    {
+        mexErrMsgTxt("Must specify the initial parameters, the joint angles and the ball positions, then parameter/value pairs");
+        return;
+    }
+
+    strcpy(calibration, "nominal");
+    kc_default_options(&options);
+    for (i = 3; i < nrhs; i += 2)
+    {
+        if (!mxIsChar(prhs[i])
+                || (mxGetString(prhs[i], option, OPTION_LENGTH) != 0))
+        {
+            mexErrMsgTxt("Parameter names must be strings");
+            return;
+        }
+        if (strcmp(option, "Constant") == 0)
+        {
+            constant = prhs[i + 1];
+        }
+        else if (strcmp(option, "Calibration") == 0)
+        {
+            if (!mxIsChar(prhs[i + 1])
+                    || (mxGetString(prhs[i + 1], calibration,
+                            OPTION_LENGTH) != 0)
+                    || ((strcmp(calibration, "nominal") != 0)
+                        && (strcmp(calibration, "lefty") != 0)
+                        && (strcmp(calibration, "righty") != 0)))
+            {
+                mexErrMsgTxt("Calibration must be nominal, lefty or righty");
+                return;
+            }
+        }
+        else if (strcmp(option, "BallbarLength") == 0)
+        {
+            length = prhs[i + 1];
+        }
+        else if (strcmp(option, "BasePosition") == 0)
+        {
+            base = prhs[i + 1];
+        }
+        else if (!mxIsNumeric(prhs[i + 1]) || mxIsEmpty(prhs[i + 1]))
+        {
+            mexErrMsgTxt("Unknown parameter or value, use Constant, Calibration, BallbarLength, BasePosition, MaxIterations, GradientTolerance, StepTolerance or Threads");
+            return;
+        }
+        else if (strcmp(option, "MaxIterations") == 0)
+        {
+            options.maxIterations = (mxGetScalar(prhs[i + 1]) > 0)
+                ? (int32_t)mxGetScalar(prhs[i + 1]) : 0;
+        }
+        else if (strcmp(option, "GradientTolerance") == 0)
+        {
+            options.gradientTolerance = mxGetScalar(prhs[i + 1]);
+        }
+        else if (strcmp(option, "StepTolerance") == 0)
+        {
+            options.stepTolerance = mxGetScalar(prhs[i + 1]);
+        }
+        else if (strcmp(option, "Threads") == 0)
+        {
+            options.numThreads = (mxGetScalar(prhs[i + 1]) >= 1)
+                ? (int32_t)mxGetScalar(prhs[i + 1]) : 1;
+        }
+        else
+        {
+            mexErrMsgTxt("Unknown parameter, use Constant, Calibration, BallbarLength, BasePosition, MaxIterations, GradientTolerance, StepTolerance or Threads");
+            return;
+        }
+    }
+
+    getParameters(&parameters, prhs[0], calibration);
+    if (length != NULL)
+    {
+        if (!mxIsDouble(length) || (mxGetNumberOfElements(length) != 1))
+        {
+            mexErrMsgTxt("BallbarLength must be a number");
+            return;
+        }
+        parameters.length = mxGetScalar(length);
+    }
+    if (base != NULL)
+    {
+        if (!mxIsDouble(base) || (mxGetNumberOfElements(base) != 3))
+        {
+            mexErrMsgTxt("BasePosition must be a 3 element vector");
+            return;
+        }
+        memcpy(parameters.base, mxGetPr(base), 3 * sizeof(double));
+    }
+    numJoints = parameters.numJoints;
+
+    /* one sample per row, extra columns are ignored */
+    if (!mxIsDouble(prhs[1]) || mxIsComplex(prhs[1])
+            || (mxGetNumberOfDimensions(prhs[1]) != 2)
+            || (mxGetN(prhs[1]) < numJoints))
+    {
+        mexErrMsgTxt("Joint angles must be a NxDOF double array");
+        return;
+    }
+    numSamples = (uint32_t)mxGetM(prhs[1]);
+    if (!mxIsDouble(prhs[2]) || mxIsComplex(prhs[2])
+            || (mxGetM(prhs[2]) != numSamples) || (mxGetN(prhs[2]) != 3))
+    {
+        mexErrMsgTxt("Ball positions must be a Nx3 double array, one row per sample");
+        return;
+    }
+
+    memset(&problem, 0, sizeof(KcProblem));
+    problem.jointAngles = mxGetPr(prhs[1]);
+    problem.ballPositions = mxGetPr(prhs[2]);
+    problem.numSamples = numSamples;
+    getConstant(&problem, numJoints, constant);
+
+    if (kc_calibrate(&problem, &parameters, &options, &info) != KC_SUCCESS)
+    {
+        mexErrMsgTxt("Unable to allocate the calibration");
+        return;
+    }
+
+    plhs[0] = createParameters(&parameters);
+    if (nlhs > 1)
+    {
+        plhs[1] = mxCreateDoubleMatrix(numSamples, 1, mxREAL);
+    }
+    if (nlhs > 2)
+    {
+        plhs[2] = createInfo(&info);
+    }
+    if (nlhs > 3)
+    {
+        plhs[3] = mxCreateDoubleMatrix(numSamples, info.numFree, mxREAL);
+    }
+    if ((nlhs > 1) && (kc_residuals(&problem, &parameters, mxGetPr(plhs[1]),
+                    (nlhs > 3) ? mxGetPr(plhs[3]) : NULL,
+                    options.numThreads) != KC_SUCCESS))
+    {
+        mexErrMsgTxt("Unable to allocate the residuals");
+        return;
+    }
+    return;
+}
+
+/*
+ * the parameters from the fields dh, flange, lbb and basepos, or from
+ * the configuration parameters of the arm
+ */
+static void getParameters(KcParameters *parameters, const mxArray *initial,
+        const char *calibration)
+{
+    const mxArray *dh, *flange;
+    const double *values;
+    uint32_t numJoints, j;
+    int k;
+
+    memset(parameters, 0, sizeof(KcParameters));
+    if (!mxIsStruct(initial))
+    {
+        mexErrMsgTxt("The initial parameters must be a structure");
+        return;
+    }
+    dh = mxGetField(initial, 0, "dh");
+    if (dh == NULL)
+    {
+        getConfigParameters(parameters, initial, calibration);
+        return;
+    }
+
+    if (!mxIsDouble(dh) || mxIsComplex(dh)
+            || (mxGetNumberOfDimensions(dh) != 2) || (mxGetN(dh) != 4)
+            || mxIsEmpty(dh) || (mxGetM(dh) > FK_MAX_JOINTS))
+    {
+        mexErrMsgTxt("dh must be a DOFx4 DH matrix");
+        return;
+    }
+    numJoints = (uint32_t)mxGetM(dh);
+    parameters->numJoints = numJoints;
+    for (j = 0; j < numJoints; j++)
+    {
+        for (k = 0; k < 4; k++)
+        {
+            parameters->dh[j][k] = mxGetPr(dh)[k * numJoints + j];
+        }
+    }
+
+    flange = mxGetField(initial, 0, "flange");
+    if ((flange == NULL) || !mxIsDouble(flange)
+            || ((mxGetNumberOfElements(flange) != 6)
+                && (mxGetNumberOfElements(flange) != 16)))
+    {
+        mexErrMsgTxt("flange must be a 6 element vector or a 4x4 transform");
+        return;
+    }
+    if (mxGetNumberOfElements(flange) == 16)
+    {
+        fk_flange_to_vector(mxGetPr(flange), parameters->flange);
+    }
+    else
+    {
+        memcpy(parameters->flange, mxGetPr(flange), 6 * sizeof(double));
+    }
+
+    values = getField(initial, "lbb", 1, 1);
+    parameters->length = values[0];
+    values = getField(initial, "basepos", 3, 1);
+    memcpy(parameters->base, values, 3 * sizeof(double));
+}
+
+/*
+ * NOMINAL_DH_MATRIX or CALIBRATED_DH_*, and the matching flange, ball bar
+ * length and base ball, all stored row by row as in the cfg file
+ */
+static void getConfigParameters(KcParameters *parameters,
+        const mxArray *initial, const char *calibration)
+{
+    const mxArray *dh;
+    const double *values;
+    double flange[16];
+    uint32_t numJoints, j;
+    int k, l;
+
+    if (strcmp(calibration, "lefty") == 0)
+    {
+        dh = mxGetField(initial, 0, "CALIBRATED_DH_LEFTY");
+        values = getField(initial, "CALIBRATED_FLANGE_LEFTY", 16, 0);
+    }
+    else if (strcmp(calibration, "righty") == 0)
+    {
+        dh = mxGetField(initial, 0, "CALIBRATED_DH_RIGHTY");
+        values = getField(initial, "CALIBRATED_FLANGE_RIGHTY", 16, 0);
+    }
+    else
+    {
+        dh = mxGetField(initial, 0, "NOMINAL_DH_MATRIX");
+        values = getField(initial, "NOMINAL_FLANGE_TRANSFORM", 16, 0);
+    }
+    if ((dh == NULL) || !mxIsDouble(dh) || mxIsEmpty(dh)
+            || (mxGetNumberOfElements(dh) % 4 != 0)
+            || (mxGetNumberOfElements(dh) > 4 * FK_MAX_JOINTS))
+    {
+        mexErrMsgTxt("The initial parameters need dh or the DH matrix of the configuration parameters");
+        return;
+    }
+    numJoints = (uint32_t)(mxGetNumberOfElements(dh) / 4);
+    parameters->numJoints = numJoints;
+    for (j = 0; j < numJoints; j++)
+    {
+        for (k = 0; k < 4; k++)
+        {
+            parameters->dh[j][k] = mxGetPr(dh)[4 * j + k];
+        }
+    }
+    if (values != NULL)
+    {
+        for (k = 0; k < 4; k++)
+        {
+            for (l = 0; l < 4; l++)
+            {
+                flange[4 * l + k] = values[4 * k + l];
+            }
+        }
+        fk_flange_to_vector(flange, parameters->flange);
+    }
+
+    values = getField(initial, "BALLBAR_LENGTH_1", 1, 0);
+    if (values != NULL)
+    {
+        parameters->length = values[0];
+    }
+    values = getField(initial, (strcmp(calibration, "righty") == 0)
+            ? "BASEBALL_RIGHT_CALIB" : "BASEBALL_LEFT_CALIB", 3, 0);
+    if (values != NULL)
+    {
+        memcpy(parameters->base, values, 3 * sizeof(double));
+    }
+}
+
+/*
+ * data of a double field with numElements elements, NULL if the field is
+ * missing and not required
+ */
+static const double *getField(const mxArray *structure, const char *name,
+        size_t numElements, int required)
+{
+    const mxArray *field;
+
+    field = mxGetField(structure, 0, name);
+    if ((field == NULL) && !required)
+    {
+        return NULL;
+    }
+    if ((field == NULL) || !mxIsDouble(field) || mxIsComplex(field)
+            || (mxGetNumberOfElements(field) != numElements))
+    {
+        mexErrMsgTxt("Invalid or missing field in the initial parameters");
+        return NULL;
+    }
+    return mxGetPr(field);
+}
+
+/*
+ * parameters held constant, the fields dh, flange, lbb and basepos of
+ * constant are non zero for a constant parameter.  The defaults are
+ * those of kin_cal: the first DH row, the flange z and rotation about z,
+ * and the ball bar length
+ */
+static void getConstant(KcProblem *problem, uint32_t numJoints,
+        const mxArray *constant)
+{
+    static const char *fieldNames[] = {"dh", "flange", "lbb", "basepos"};
+    const mxArray *field;
+    uint32_t offsets[4], sizes[4], j;
+    int f, k;
+
+    for (k = 0; k < 4; k++)
+    {
+        problem->isConstant[k] = 1;
+    }
+    problem->isConstant[4 * numJoints + 2] = 1;
+    problem->isConstant[4 * numJoints + 5] = 1;
+    problem->isConstant[4 * numJoints + 6] = 1;
+    if (constant == NULL)
+    {
+        return;
+    }
+    if (!mxIsStruct(constant))
+    {
+        mexErrMsgTxt("Constant must be a structure with the fields dh, flange, lbb and basepos");
+        return;
+    }
+
+    offsets[0] = 0;
+    sizes[0] = 4 * numJoints;
+    offsets[1] = 4 * numJoints;
+    sizes[1] = 6;
+    offsets[2] = 4 * numJoints + 6;
+    sizes[2] = 1;
+    offsets[3] = 4 * numJoints + 7;
+    sizes[3] = 3;
+    for (f = 0; f < 4; f++)
+    {
+        field = mxGetField(constant, 0, fieldNames[f]);
+        if (field == NULL)
+        {
+            continue;
+        }
+        if (!(mxIsDouble(field) || mxIsLogical(field))
+                || (mxGetNumberOfElements(field) != sizes[f]))
+        {
+            mexErrMsgTxt("The fields of Constant must have the size of the parameters");
+            return;
+        }
+        for (j = 0; j < sizes[f]; j++)
+        {
+            /* the DH matrix is numbered row by row, as packparams does */
+            k = (f == 0) ? (int)((j % 4) * numJoints + j / 4) : (int)j;
+            problem->isConstant[offsets[f] + j] = mxIsLogical(field)
+                ? (mxGetLogicals(field)[k] != 0) : (mxGetPr(field)[k] != 0);
+        }
+    }
+}
+
+/*
+ * structure with the fields dh, flange, flangeTransform, lbb and basepos
+ */
+static mxArray *createParameters(const KcParameters *parameters)
+{
+    static const char *fieldNames[] = {"dh", "flange", "flangeTransform",
+        "lbb", "basepos"};
+    mxArray *result, *field;
+    uint32_t numJoints = parameters->numJoints;
+    uint32_t j;
+    int k;
+
+    result = mxCreateStructMatrix(1, 1, 5, fieldNames);
+    field = mxCreateDoubleMatrix(numJoints, 4, mxREAL);
+    for (j = 0; j < numJoints; j++)
+    {
+        for (k = 0; k < 4; k++)
+        {
+            mxGetPr(field)[k * numJoints + j] = parameters->dh[j][k];
+        }
+    }
+    mxSetField(result, 0, "dh", field);
+    field = mxCreateDoubleMatrix(6, 1, mxREAL);
+    memcpy(mxGetPr(field), parameters->flange, 6 * sizeof(double));
+    mxSetField(result, 0, "flange", field);
+    field = mxCreateDoubleMatrix(4, 4, mxREAL);
+    fk_flange_from_vector(parameters->flange, mxGetPr(field));
+    mxSetField(result, 0, "flangeTransform", field);
+    mxSetField(result, 0, "lbb", mxCreateDoubleScalar(parameters->length));
+    field = mxCreateDoubleMatrix(3, 1, mxREAL);
+    memcpy(mxGetPr(field), parameters->base, 3 * sizeof(double));
+    mxSetField(result, 0, "basepos", field);
+    return result;
+}
+
+static mxArray *createInfo(const KcInfo *info)
+{
+    static const char *fieldNames[] = {"iterations", "stopReason",
+        "rmsError", "gradientNorm", "conditionNumber", "numParameters"};
+    static const char *stopReasons[] = {"none", "gradient", "step",
+        "iterations"};
+    mxArray *result;
+
+    result = mxCreateStructMatrix(1, 1, 6, fieldNames);
+    mxSetField(result, 0, "iterations",
+            mxCreateDoubleScalar(info->iterations));
+    mxSetField(result, 0, "stopReason",
+            mxCreateString(stopReasons[info->stopReason]));
+    mxSetField(result, 0, "rmsError", mxCreateDoubleScalar(info->rmsError));
+    mxSetField(result, 0, "gradientNorm",
+            mxCreateDoubleScalar(info->gradientNorm));
+    mxSetField(result, 0, "conditionNumber",
+            mxCreateDoubleScalar(info->conditionNumber));
+    mxSetField(result, 0, "numParameters",
+            mxCreateDoubleScalar(info->numFree));
+    return result;
+}
+
+/*----------- END OF FILE ------------ */
@@ -0,0 +1,79 @@
+%KINEMATICCALIBRATION Kinematic parameters of the arm from ball bar samples
+%
+% Syntax:
+%   fit = kinematicCalibration(initial,jointAngles,ballPositions)
+%       identifies the DH matrix, the flange, the ball bar length and the
+%       center of the base ball that best explain the ball bar samples:
+%       for every sample the distance from the base ball to the end
+%       effector ball is the ball bar length.  jointAngles is an NxDOF
+%       array, one sample per row (extra columns are ignored), and
+%       ballPositions the Nx3 positions of the end effector ball in the
+%       flange frame.
+%       initial holds the starting parameters in the fields
+%           dh       DOFx4 DH matrix, rows of a, alpha, d and theta offset
+%           flange   [x y z rx ry rz] (xyz fixed angles) or a 4x4 transform
+%           lbb      ball bar length
+%           basepos  3 element center of the base ball
+%       or is the configuration parameters of the arm (commDataPair(hgs,
+%       'get_cfg_params') or readArmConfig) to start from the nominal or
+%       the last calibration, see Calibration.
+%       fit has the fields dh, flange (6x1), flangeTransform (4x4), lbb
+%       and basepos.
+%   [fit,residuals] = kinematicCalibration(...)
+%       also returns the Nx1 errors |tip - basepos| - lbb at the fit.
+%   [fit,residuals,info] = kinematicCalibration(...)
+%       also returns the fields iterations, stopReason ('gradient', 'step',
+%       'iterations' or 'none'), rmsError, gradientNorm, conditionNumber
+%       (of the Jacobian) and numParameters (parameters not held constant).
+%   [fit,residuals,info,jacobian] = kinematicCalibration(...)
+%       also returns the NxnumParameters Jacobian of the residuals at the
+%       fit, the columns in the order of the DH matrix row by row, the
+%       flange, lbb and basepos.
+%   [...] = kinematicCalibration(...,'Constant',constant)
+%       constant has the fields dh (DOFx4), flange (6), lbb and basepos
+%       (3), non zero or true for the parameters held constant.  Missing
+%       fields keep the defaults, the first row of the DH matrix, the
+%       flange z and rz, and lbb are constant.
+%   [...] = kinematicCalibration(cfgParams,...,'Calibration',calibration)
+%       calibration is 'nominal' (default), 'lefty' or 'righty' to start
+%       from the NOMINAL_* or CALIBRATED_*_LEFTY/RIGHTY parameters.  lbb
+%       is BALLBAR_LENGTH_1 and basepos BASEBALL_LEFT_CALIB (or
+%       BASEBALL_RIGHT_CALIB for righty) when present.
+%   [...] = kinematicCalibration(...,'BallbarLength',lbb)
+%   [...] = kinematicCalibration(...,'BasePosition',basepos)
+%       override the starting lbb and basepos.
+%   [...] = kinematicCalibration(...,'MaxIterations',n)
+%       at most n iterations (default 1000), 0 only evaluates the initial
+%       parameters.
+%   [...] = kinematicCalibration(...,'GradientTolerance',tol)
+%   [...] = kinematicCalibration(...,'StepTolerance',tol)
+%       stop when the largest term of J'r is below tol (default 1e-7), or
+%       the step is below tol relative to the parameters (default 1e-9).
+%   [...] = kinematicCalibration(...,'Threads',numThreads)
+%       uses at most numThreads threads (default one per processor).
+%
+% Notes:
+%   The parameters are solved by Levenberg-Marquardt as sec_LM, with
+%   analytic derivatives and the damping scaled by the diagonal of J'J.
+%   Each thread sums J'J and J'r over its share of the samples, jobs of
+%   less than 1024 samples per thread do not start threads.  Angles are
+%   in radians and the lengths in meters.
+%
+% Example:
+%   cfgParams = readArmConfig('hgs_arm3_0.cfg.default');
+%   [fit,residuals,info] = kinematicCalibration(cfgParams,jointAngles,...
+%       eePositions,'Calibration','lefty');
+%   if info.conditionNumber > 600, warning('poorly conditioned'); end
+%
+% See also:
+%    forwardKinematics, readArmConfig, kin_cal, mainKincalFunction
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
@@ -0,0 +1,910 @@
+/****h* /kinematic_calibration.c ***
+ * NAME
+ *      kinematic_calibration.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      This library solves the ball bar kinematic calibration by
+ *      Levenberg-Marquardt (Nielsen's damping update, as sec_LM) with the
+ *      damping scaled by the diagonal of J'J, so meters and radians mix
+ *      well.  The Jacobian of a sample is analytic, from the link frames
+ *      of the forward kinematics and the unit vector u from the base ball
+ *      to the tip p:
+ *          a(i)        u . x(i-1)
+ *          alpha(i)    u . x(i-1) x (p - o(i-1))
+ *          d(i)        u . z(i)
+ *          offset(i)   u . z(i) x (p - o(i))
+ *      and for the flange the same with its translation and rotation axes.
+ *      The full Jacobian is never formed by the solver, each thread adds
+ *      the J'J and J'r of its samples, so an iteration costs one pass over
+ *      the samples split over the threads and a Cholesky solve of the
+ *      size of the free parameters.
+ *
+ * SEE ALSO
+ *      kinematic_calibration.h, forward_kinematics.c, kinematicCalibration.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif /* _WIN32 */
+
+#include "kinematic_calibration.h"
+
+/* samples given to the forward kinematics at once by a thread */
+#define BLOCK_SAMPLES 256
+
+/*
+ * damping of a parameter relative to the largest diagonal term of J'J at
+ * the least, so a parameter the samples hardly see does not get a huge step
+ */
+#define MIN_DAMPING 1e-10
+
+/* Jacobi sweeps before giving up on the off diagonal terms */
+#define MAX_JACOBI_SWEEPS 50
+
+/* samples first to first + count - 1, with the sums of the samples */
+typedef struct {
+    const KcProblem *problem;
+    const FkModel *model;
+    const KcParameters *parameters;
+    const uint32_t *freeIndex;
+    uint32_t numFree;
+    uint32_t first;
+    uint32_t count;
+    double *residuals;          /* all the samples, or NULL */
+    double *jacobian;           /* numSamples x numFree, or NULL */
+    double *a;                  /* J'J, upper triangle, or NULL */
+    double g[KC_MAX_PARAMETERS];    /* J'r */
+    double cost;                /* r'r */
+    int32_t status;
+} EvaluationJob;
+
+/* internal functions */
+static void to_vector(const KcParameters *parameters, double *x);
+static void from_vector(const double *x, KcParameters *parameters);
+static void to_model(const KcParameters *parameters, FkModel *model);
+static int32_t evaluate(const KcProblem *problem,
+        const KcParameters *parameters, const uint32_t *freeIndex,
+        uint32_t numFree, int32_t numThreads, double *residuals,
+        double *jacobian, double *a, double *g, double *cost);
+static void evaluate_range(EvaluationJob *job);
+static void sample_derivatives(const KcParameters *parameters,
+        const double *flange, const double *frames, uint32_t numJoints,
+        const double *tip, const double *u, const double *ball,
+        double *derivatives);
+static int32_t cholesky_solve(double *a, double *b, uint32_t n);
+static double condition_number(double *a, uint32_t n);
+static void run_jobs(EvaluationJob *jobs, int32_t numJobs);
+
+/****f*  kinematic_calibration.c/kc_default_options ******
+ * NAME
+ *	    kc_default_options
+ *
+ * SYNOPSIS
+ *      void kc_default_options(KcOptions *options)
+ *
+ * OUTPUT
+ *      KcOptions *options
+ *              the defaults of sec_LM, 1000 iterations, gradient 1e-7,
+ *              step 1e-9 and damping 1e-3, one thread per processor
+ *
+ **********************************
+ */
+void kc_default_options(KcOptions *options)
+{
+    options->maxIterations = 1000;
+    options->gradientTolerance = 1e-7;
+    options->stepTolerance = 1e-9;
+    options->initialDamping = 1e-3;
+    options->numThreads = fk_number_of_processors();
+}
+
+/****f*  kinematic_calibration.c/kc_number_of_parameters ******
+ * NAME
+ *	    kc_number_of_parameters
+ *
+ * SYNOPSIS
+ *      uint32_t kc_number_of_parameters(uint32_t numJoints)
+ *
+ * OUTPUT
+ *      Returns the length of the parameter vector: the DH matrix row by
+ *      row, the 6 flange terms, the length and the 3 base terms
+ *
+ **********************************
+ */
+uint32_t kc_number_of_parameters(uint32_t numJoints)
+{
+    return 4 * numJoints + 10;
+}
+
+/****f*  kinematic_calibration.c/kc_calibrate ******
+ * NAME
+ *	    kc_calibrate
+ *
+ * SYNOPSIS
+ *      int32_t kc_calibrate(const KcProblem *problem,
+ *              KcParameters *parameters, const KcOptions *options,
+ *              KcInfo *info)
+ *
+ * INPUTS
+ *      const KcProblem *problem
+ *              samples and the parameters held constant
+ *      KcParameters *parameters
+ *              starting parameters, the nominal or the last calibration
+ *      const KcOptions *options
+ *              iterations, tolerances and threads
+ *
+ * OUTPUT
+ *      KcParameters *parameters
+ *              parameters at the end of the iterations
+ *      KcInfo *info
+ *              iterations, why they stopped, rms error, gradient and the
+ *              condition number of the Jacobian
+ *      Returns KC_SUCCESS, or KC_FAILURE when out of memory
+ *
+ **********************************
+ */
+int32_t kc_calibrate(const KcProblem *problem, KcParameters *parameters,
+        const KcOptions *options, KcInfo *info)
+{
+    uint32_t freeIndex[KC_MAX_PARAMETERS];
+    double x[KC_MAX_PARAMETERS], newX[KC_MAX_PARAMETERS];
+    double g[KC_MAX_PARAMETERS], h[KC_MAX_PARAMETERS];
+    double diagonal[KC_MAX_PARAMETERS];
+    KcParameters trial;
+    double *a, *work;
+    double cost, newCost, mu, nu, gain, predicted, norm, stepNorm, xNorm;
+    double maxDiagonal, minDiagonal;
+    uint32_t numParameters, numFree, k, l;
+
+    memset(info, 0, sizeof(KcInfo));
+    numParameters = kc_number_of_parameters(parameters->numJoints);
+    numFree = 0;
+    for (k = 0; k < numParameters; k++)
+    {
+        if (!problem->isConstant[k])
+            freeIndex[numFree++] = k;
+    }
+    info->numFree = numFree;
+
+    a = (double *)malloc(2 * (numFree * numFree + 1) * sizeof(double));
+    if (a == NULL)
+    {
+        return KC_FAILURE;
+    }
+    work = a + numFree * numFree + 1;
+
+    if (evaluate(problem, parameters, freeIndex, numFree,
+                options->numThreads, NULL, NULL, a, g, &cost) != KC_SUCCESS)
+    {
+        free(a);
+        return KC_FAILURE;
+    }
+    to_vector(parameters, x);
+    mu = options->initialDamping;
+    nu = 2;
+
+    while (numFree > 0)
+    {
+        norm = 0;
+        for (k = 0; k < numFree; k++)
+        {
+            if (fabs(g[k]) > norm)
+                norm = fabs(g[k]);
+        }
+        if (norm <= options->gradientTolerance)
+        {
+            info->stopReason = KC_STOP_GRADIENT;
+            break;
+        }
+        if (info->iterations >= options->maxIterations)
+        {
+            info->stopReason = KC_STOP_ITERATIONS;
+            break;
+        }
+        info->iterations++;
+
+        /* (J'J + mu D) h = -J'r, D the diagonal of J'J */
+        maxDiagonal = 0;
+        for (k = 0; k < numFree; k++)
+        {
+            if (a[k * numFree + k] > maxDiagonal)
+                maxDiagonal = a[k * numFree + k];
+        }
+        minDiagonal = (maxDiagonal > 0) ? MIN_DAMPING * maxDiagonal : 1;
+        for (k = 0; k < numFree; k++)
+        {
+            diagonal[k] = (a[k * numFree + k] > minDiagonal)
+                ? a[k * numFree + k] : minDiagonal;
+            h[k] = -g[k];
+            for (l = 0; l < numFree; l++)
+            {
+                work[k * numFree + l] = a[k * numFree + l];
+            }
+            work[k * numFree + k] += mu * diagonal[k];
+        }
+        if (cholesky_solve(work, h, numFree) != KC_SUCCESS)
+        {
+            mu *= nu;
+            nu *= 2;
+            continue;
+        }
+
+        stepNorm = 0;
+        xNorm = 0;
+        memcpy(newX, x, sizeof(x));
+        for (k = 0; k < numFree; k++)
+        {
+            stepNorm += h[k] * h[k];
+            xNorm += x[freeIndex[k]] * x[freeIndex[k]];
+            newX[freeIndex[k]] += h[k];
+        }
+        stepNorm = sqrt(stepNorm);
+        xNorm = sqrt(xNorm);
+        if (stepNorm <= options->stepTolerance
+                * (xNorm + options->stepTolerance))
+        {
+            info->stopReason = KC_STOP_STEP;
+            break;
+        }
+
+        trial = *parameters;
+        from_vector(newX, &trial);
+        if (evaluate(problem, &trial, freeIndex, numFree,
+                    options->numThreads, NULL, NULL, NULL, NULL,
+                    &newCost) != KC_SUCCESS)
+        {
+            free(a);
+            return KC_FAILURE;
+        }
+
+        /* costs are r'r, the predicted decrease is h'(mu D h - g) */
+        predicted = 0;
+        for (k = 0; k < numFree; k++)
+        {
+            predicted += h[k] * (mu * diagonal[k] * h[k] - g[k]);
+        }
+        if ((predicted > 0) && (newCost < cost))
+        {
+            gain = (cost - newCost) / predicted;
+            *parameters = trial;
+            memcpy(x, newX, sizeof(x));
+            if (evaluate(problem, parameters, freeIndex, numFree,
+                        options->numThreads, NULL, NULL, a, g,
+                        &cost) != KC_SUCCESS)
+            {
+                free(a);
+                return KC_FAILURE;
+            }
+            gain = 1 - pow(2 * gain - 1, 3);
+            mu *= (gain > 1.0 / 3) ? gain : 1.0 / 3;
+            nu = 2;
+        }
+        else
+        {
+            mu *= nu;
+            nu *= 2;
+        }
+    }
+
+    norm = 0;
+    for (k = 0; k < numFree; k++)
+    {
+        if (fabs(g[k]) > norm)
+            norm = fabs(g[k]);
+    }
+    info->gradientNorm = norm;
+    info->rmsError = (problem->numSamples > 0)
+        ? sqrt(cost / problem->numSamples) : 0;
+    info->conditionNumber = (numFree > 0)
+        ? condition_number(a, numFree) : 1;
+    free(a);
+    return KC_SUCCESS;
+}
+
+/****f*  kinematic_calibration.c/kc_residuals ******
+ * NAME
+ *	    kc_residuals
+ *
+ * SYNOPSIS
+ *      int32_t kc_residuals(const KcProblem *problem,
+ *              const KcParameters *parameters, double *residuals,
+ *              double *jacobian, int32_t numThreads)
+ *
+ * OUTPUT
+ *      double *residuals
+ *              |tip - base| - length of every sample
+ *      double *jacobian
+ *              NULL, or the numSamples x numFree Jacobian of the residuals
+ *              with respect to the parameters not held constant, column
+ *              major
+ *      Returns KC_SUCCESS, or KC_FAILURE when out of memory
+ *
+ **********************************
+ */
+int32_t kc_residuals(const KcProblem *problem,
+        const KcParameters *parameters, double *residuals, double *jacobian,
+        int32_t numThreads)
+{
+    uint32_t freeIndex[KC_MAX_PARAMETERS];
+    uint32_t numParameters, numFree, k;
+    double cost;
+
+    numParameters = kc_number_of_parameters(parameters->numJoints);
+    numFree = 0;
+    for (k = 0; k < numParameters; k++)
+    {
+        if (!problem->isConstant[k])
+            freeIndex[numFree++] = k;
+    }
+    return evaluate(problem, parameters, freeIndex, numFree, numThreads,
+            residuals, jacobian, NULL, NULL, &cost);
+}
+
+static void to_vector(const KcParameters *parameters, double *x)
+{
+    uint32_t n = parameters->numJoints;
+    uint32_t j;
+    int k;
+
+    for (j = 0; j < n; j++)
+    {
+        for (k = 0; k < 4; k++)
+        {
+            x[4 * j + k] = parameters->dh[j][k];
+        }
+    }
+    for (k = 0; k < 6; k++)
+    {
+        x[4 * n + k] = parameters->flange[k];
+    }
+    x[4 * n + 6] = parameters->length;
+    for (k = 0; k < 3; k++)
+    {
+        x[4 * n + 7 + k] = parameters->base[k];
+    }
+}
+
+static void from_vector(const double *x, KcParameters *parameters)
+{
+    uint32_t n = parameters->numJoints;
+    uint32_t j;
+    int k;
+
+    for (j = 0; j < n; j++)
+    {
+        for (k = 0; k < 4; k++)
+        {
+            parameters->dh[j][k] = x[4 * j + k];
+        }
+    }
+    for (k = 0; k < 6; k++)
+    {
+        parameters->flange[k] = x[4 * n + k];
+    }
+    parameters->length = x[4 * n + 6];
+    for (k = 0; k < 3; k++)
+    {
+        parameters->base[k] = x[4 * n + 7 + k];
+    }
+}
+
+static void to_model(const KcParameters *parameters, FkModel *model)
+{
+    memset(model, 0, sizeof(FkModel));
+    model->numJoints = parameters->numJoints;
+    memcpy(model->dh, parameters->dh, sizeof(model->dh));
+    fk_flange_from_vector(parameters->flange, model->flange);
+}
+
+/*
+ * one pass over the samples split over the threads: the residuals and
+ * the Jacobian when asked for, r'r, and J'J (full) and J'r when a is given
+ */
+static int32_t evaluate(const KcProblem *problem,
+        const KcParameters *parameters, const uint32_t *freeIndex,
+        uint32_t numFree, int32_t numThreads, double *residuals,
+        double *jacobian, double *a, double *g, double *cost)
+{
+    EvaluationJob jobs[KC_MAX_THREADS];
+    FkModel model;
+    uint32_t total = problem->numSamples;
+    uint32_t k, l;
+    int32_t numJobs, j, status;
+
+    to_model(parameters, &model);
+    numJobs = (int32_t)(total / KC_MIN_THREAD_SAMPLES);
+    if (numJobs > numThreads)
+    {
+        numJobs = numThreads;
+    }
+    if (numJobs > KC_MAX_THREADS)
+    {
+        numJobs = KC_MAX_THREADS;
+    }
+    if (numJobs < 1)
+    {
+        numJobs = 1;
+    }
+
+    status = KC_SUCCESS;
+    for (j = 0; j < numJobs; j++)
+    {
+        memset(jobs + j, 0, sizeof(EvaluationJob));
+        jobs[j].problem = problem;
+        jobs[j].model = &model;
+        jobs[j].parameters = parameters;
+        jobs[j].freeIndex = freeIndex;
+        jobs[j].numFree = numFree;
+        jobs[j].first = (uint32_t)((uint64_t)total * j / numJobs);
+        jobs[j].count = (uint32_t)((uint64_t)total * (j + 1) / numJobs)
+            - jobs[j].first;
+        jobs[j].residuals = residuals;
+        jobs[j].jacobian = jacobian;
+        if ((a != NULL) && (numFree > 0))
+        {
+            /* the first job adds to the result */
+            jobs[j].a = (j == 0) ? a : (double *)calloc(numFree * numFree,
+                    sizeof(double));
+            if (jobs[j].a == NULL)
+                status = KC_FAILURE;
+        }
+    }
+    if ((a != NULL) && (numFree > 0))
+    {
+        memset(a, 0, numFree * numFree * sizeof(double));
+    }
+
+    if (status == KC_SUCCESS)
+    {
+        run_jobs(jobs, numJobs);
+    }
+
+    *cost = 0;
+    if (g != NULL)
+    {
+        memset(g, 0, numFree * sizeof(double));
+    }
+    for (j = 0; j < numJobs; j++)
+    {
+        if (jobs[j].status != KC_SUCCESS)
+            status = KC_FAILURE;
+        *cost += jobs[j].cost;
+        if (g != NULL)
+        {
+            for (k = 0; k < numFree; k++)
+            {
+                g[k] += jobs[j].g[k];
+            }
+        }
+        if ((j > 0) && (jobs[j].a != NULL))
+        {
+            for (k = 0; k < numFree * numFree; k++)
+            {
+                a[k] += jobs[j].a[k];
+            }
+            free(jobs[j].a);
+        }
+    }
+
+    /* the jobs only fill the upper triangle */
+    if ((a != NULL) && (status == KC_SUCCESS))
+    {
+        for (k = 0; k < numFree; k++)
+        {
+            for (l = 0; l < k; l++)
+            {
+                a[k * numFree + l] = a[l * numFree + k];
+            }
+        }
+    }
+    return status;
+}
+
+static void evaluate_range(EvaluationJob *job)
+{
+    const KcProblem *problem = job->problem;
+    const FkModel *model = job->model;
+    uint32_t numJoints = model->numJoints;
+    uint32_t numSamples = problem->numSamples;
+    uint32_t numFree = job->numFree;
+    int32_t derivatives = (job->a != NULL) || (job->jacobian != NULL);
+    double derivative[KC_MAX_PARAMETERS], row[KC_MAX_PARAMETERS];
+    double u[3], tip[3], ball[3];
+    double *angles, *tool, *transforms, *frames;
+    double distance, r;
+    FkProblem fk;
+    uint32_t start, end, count, s, i, j, k, l;
+
+    job->status = KC_SUCCESS;
+    angles = (double *)malloc(((numJoints + 3 + 16) * BLOCK_SAMPLES
+                + (derivatives ? 16 * numJoints * BLOCK_SAMPLES : 0))
+            * sizeof(double));
+    if (angles == NULL)
+    {
+        job->status = KC_FAILURE;
+        return;
+    }
+    tool = angles + numJoints * BLOCK_SAMPLES;
+    transforms = tool + 3 * BLOCK_SAMPLES;
+    frames = derivatives ? (transforms + 16 * BLOCK_SAMPLES) : NULL;
+
+    fk.model = model;
+    fk.jointAngles = angles;
+    fk.tool = tool;
+    fk.toolPerSample = 1;
+    fk.transforms = transforms;
+    fk.jacobians = NULL;
+    fk.frames = frames;
+
+    end = job->first + job->count;
+    for (start = job->first; start < end; start += BLOCK_SAMPLES)
+    {
+        count = ((end - start) < BLOCK_SAMPLES) ? (end - start)
+            : BLOCK_SAMPLES;
+
+        /* the block of samples made contiguous for the kinematics */
+        for (j = 0; j < numJoints; j++)
+        {
+            memcpy(angles + j * count,
+                    problem->jointAngles + (size_t)j * numSamples + start,
+                    count * sizeof(double));
+        }
+        for (j = 0; j < 3; j++)
+        {
+            memcpy(tool + j * count,
+                    problem->ballPositions + (size_t)j * numSamples + start,
+                    count * sizeof(double));
+        }
+        fk.numSamples = count;
+        fk_evaluate(&fk, 1);
+
+        for (s = 0; s < count; s++)
+        {
+            i = start + s;
+            distance = 0;
+            for (j = 0; j < 3; j++)
+            {
+                tip[j] = transforms[16 * s + 12 + j];
+                u[j] = tip[j] - job->parameters->base[j];
+                distance += u[j] * u[j];
+            }
+            distance = sqrt(distance);
+            for (j = 0; j < 3; j++)
+            {
+                u[j] = (distance > 0) ? u[j] / distance : 0;
+            }
+            r = distance - job->parameters->length;
+            job->cost += r * r;
+            if (job->residuals != NULL)
+            {
+                job->residuals[i] = r;
+            }
+            if (!derivatives)
+            {
+                continue;
+            }
+
+            for (j = 0; j < 3; j++)
+            {
+                ball[j] = tool[j * count + s];
+            }
+            sample_derivatives(job->parameters, model->flange,
+                    frames + 16 * (size_t)numJoints * s, numJoints, tip, u,
+                    ball, derivative);
+            for (k = 0; k < numFree; k++)
+            {
+                row[k] = derivative[job->freeIndex[k]];
+            }
+            if (job->jacobian != NULL)
+            {
+                for (k = 0; k < numFree; k++)
+                {
+                    job->jacobian[(size_t)k * numSamples + i] = row[k];
+                }
+            }
+            if (job->a != NULL)
+            {
+                for (k = 0; k < numFree; k++)
+                {
+                    job->g[k] += row[k] * r;
+                    for (l = k; l < numFree; l++)
+                    {
+                        job->a[k * numFree + l] += row[k] * row[l];
+                    }
+                }
+            }
+        }
+    }
+    free(angles);
+}
+
+/*
+ * derivatives of the residual of a sample with respect to all the
+ * parameters.  frames are the 4x4 link frames of the sample, tip and u
+ * the ball center and the unit vector from the base to it, ball the ball
+ * center in the flange frame
+ */
+static void sample_derivatives(const KcParameters *parameters,
+        const double *flange, const double *frames, uint32_t numJoints,
+        const double *tip, const double *u, const double *ball,
+        double *derivatives)
+{
+    static const double baseAxis[3] = {1, 0, 0};
+    static const double baseOrigin[3] = {0, 0, 0};
+    const double *x, *origin, *z, *last;
+    double axes[3][3], w[3], m[3], d[3], c[3];
+    double ca, sa;
+    uint32_t j;
+    int k, l;
+
+    for (j = 0; j < numJoints; j++)
+    {
+        /* Rx(alpha) Dx(a) act along the x axis of the previous frame */
+        x = (j == 0) ? baseAxis : frames + 16 * (j - 1);
+        origin = (j == 0) ? baseOrigin : frames + 16 * (j - 1) + 12;
+        for (k = 0; k < 3; k++)
+        {
+            d[k] = tip[k] - origin[k];
+        }
+        c[0] = x[1] * d[2] - x[2] * d[1];
+        c[1] = x[2] * d[0] - x[0] * d[2];
+        c[2] = x[0] * d[1] - x[1] * d[0];
+        derivatives[4 * j] = u[0] * x[0] + u[1] * x[1] + u[2] * x[2];
+        derivatives[4 * j + 1] = u[0] * c[0] + u[1] * c[1] + u[2] * c[2];
+
+        /* Rz(theta) Dz(d) act along the z axis of the link frame */
+        z = frames + 16 * j + 8;
+        origin = frames + 16 * j + 12;
+        for (k = 0; k < 3; k++)
+        {
+            d[k] = tip[k] - origin[k];
+        }
+        c[0] = z[1] * d[2] - z[2] * d[1];
+        c[1] = z[2] * d[0] - z[0] * d[2];
+        c[2] = z[0] * d[1] - z[1] * d[0];
+        derivatives[4 * j + 2] = u[0] * z[0] + u[1] * z[1] + u[2] * z[2];
+        derivatives[4 * j + 3] = u[0] * c[0] + u[1] * c[1] + u[2] * c[2];
+    }
+
+    /* u and the ball (w = R ball) in the last link frame */
+    last = frames + 16 * (numJoints - 1);
+    for (k = 0; k < 3; k++)
+    {
+        m[k] = last[4 * k] * u[0] + last[4 * k + 1] * u[1]
+            + last[4 * k + 2] * u[2];
+        w[k] = flange[k] * ball[0] + flange[4 + k] * ball[1]
+            + flange[8 + k] * ball[2];
+        derivatives[4 * numJoints + k] = m[k];
+    }
+
+    /* R = Rz(rz) Ry(ry) Rx(rx), the rotations about the axes Rz Ry x, */
+    /* Rz y and z */
+    ca = cos(parameters->flange[5]);
+    sa = sin(parameters->flange[5]);
+    for (k = 0; k < 3; k++)
+    {
+        axes[0][k] = flange[k];
+    }
+    axes[1][0] = -sa;
+    axes[1][1] = ca;
+    axes[1][2] = 0;
+    axes[2][0] = 0;
+    axes[2][1] = 0;
+    axes[2][2] = 1;
+    for (l = 0; l < 3; l++)
+    {
+        c[0] = axes[l][1] * w[2] - axes[l][2] * w[1];
+        c[1] = axes[l][2] * w[0] - axes[l][0] * w[2];
+        c[2] = axes[l][0] * w[1] - axes[l][1] * w[0];
+        derivatives[4 * numJoints + 3 + l] = m[0] * c[0] + m[1] * c[1]
+            + m[2] * c[2];
+    }
+
+    derivatives[4 * numJoints + 6] = -1;
+    for (k = 0; k < 3; k++)
+    {
+        derivatives[4 * numJoints + 7 + k] = -u[k];
+    }
+}
+
+/*
+ * solve a x = b in place (b becomes x) for a symmetric positive definite
+ * n x n, a is destroyed.  Fails if a is not positive definite
+ */
+static int32_t cholesky_solve(double *a, double *b, uint32_t n)
+{
+    double sum;
+    uint32_t i, j, k;
+
+    for (j = 0; j < n; j++)
+    {
+        sum = a[j * n + j];
+        for (k = 0; k < j; k++)
+        {
+            sum -= a[j * n + k] * a[j * n + k];
+        }
+        if (!(sum > 0))
+        {
+            return KC_FAILURE;
+        }
+        a[j * n + j] = sqrt(sum);
+        for (i = j + 1; i < n; i++)
+        {
+            sum = a[i * n + j];
+            for (k = 0; k < j; k++)
+            {
+                sum -= a[i * n + k] * a[j * n + k];
+            }
+            a[i * n + j] = sum / a[j * n + j];
+        }
+    }
+    for (i = 0; i < n; i++)
+    {
+        sum = b[i];
+        for (k = 0; k < i; k++)
+        {
+            sum -= a[i * n + k] * b[k];
+        }
+        b[i] = sum / a[i * n + i];
+    }
+    for (i = n; i-- > 0;)
+    {
+        sum = b[i];
+        for (k = i + 1; k < n; k++)
+        {
+            sum -= a[k * n + i] * b[k];
+        }
+        b[i] = sum / a[i * n + i];
+    }
+    return KC_SUCCESS;
+}
+
+/*
+ * condition number of J from J'J, the square root of the ratio of its
+ * extreme eigen values found by cyclic Jacobi rotations.  a is destroyed
+ */
+static double condition_number(double *a, uint32_t n)
+{
+    double off, theta, t, c, s, apq, app, aqq, akp, akq;
+    double maxValue, minValue;
+    uint32_t p, q, k;
+    int sweep;
+
+    for (sweep = 0; sweep < MAX_JACOBI_SWEEPS; sweep++)
+    {
+        off = 0;
+        for (p = 0; p < n; p++)
+        {
+            for (q = p + 1; q < n; q++)
+            {
+                off += fabs(a[p * n + q]);
+            }
+        }
+        if (off == 0)
+        {
+            break;
+        }
+        for (p = 0; p < n; p++)
+        {
+            for (q = p + 1; q < n; q++)
+            {
+                apq = a[p * n + q];
+                if (apq == 0)
+                {
+                    continue;
+                }
+                app = a[p * n + p];
+                aqq = a[q * n + q];
+                theta = 0.5 * (aqq - app) / apq;
+                t = 1 / (fabs(theta) + sqrt(1 + theta * theta));
+                if (theta < 0)
+                    t = -t;
+                c = 1 / sqrt(1 + t * t);
+                s = t * c;
+                for (k = 0; k < n; k++)
+                {
+                    if ((k == p) || (k == q))
+                        continue;
+                    akp = a[k * n + p];
+                    akq = a[k * n + q];
+                    a[k * n + p] = a[p * n + k] = c * akp - s * akq;
+                    a[k * n + q] = a[q * n + k] = s * akp + c * akq;
+                }
+                a[p * n + p] = app - t * apq;
+                a[q * n + q] = aqq + t * apq;
+                a[p * n + q] = a[q * n + p] = 0;
+            }
+        }
+    }
+
+    maxValue = a[0];
+    minValue = a[0];
+    for (k = 1; k < n; k++)
+    {
+        if (a[k * n + k] > maxValue)
+            maxValue = a[k * n + k];
+        if (a[k * n + k] < minValue)
+            minValue = a[k * n + k];
+    }
+    if (!(minValue > 0))
+    {
+        return HUGE_VAL;
+    }
+    return sqrt(maxValue / minValue);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI range_thread(LPVOID argument)
+{
+    evaluate_range((EvaluationJob *)argument);
+    return 0;
+}
+#else
+static void *range_thread(void *argument)
+{
+    evaluate_range((EvaluationJob *)argument);
+    return NULL;
+}
+#endif /* _WIN32 */
+
+/*
+ * run the jobs, the first one in the calling thread and the others in
+ * their own thread.  A job whose thread could not be started is run by
+ * the calling thread
+ */
+static void run_jobs(EvaluationJob *jobs, int32_t numJobs)
+{
+    int32_t started[KC_MAX_THREADS];
+#ifdef _WIN32
+    HANDLE threads[KC_MAX_THREADS];
+#else
+    pthread_t threads[KC_MAX_THREADS];
+#endif /* _WIN32 */
+    int32_t i;
+
+    for (i = 1; i < numJobs; i++)
+    {
+#ifdef _WIN32
+        threads[i] = CreateThread(NULL, 0, range_thread, jobs + i, 0, NULL);
+        started[i] = (threads[i] != NULL);
+#else
+        started[i] = (pthread_create(threads + i, NULL, range_thread,
+                    jobs + i) == 0);
+#endif /* _WIN32 */
+    }
+
+    evaluate_range(jobs);
+
+    for (i = 1; i < numJobs; i++)
+    {
+        if (!started[i])
+        {
+            evaluate_range(jobs + i);
+            continue;
+        }
+#ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif /* _WIN32 */
+    }
+}
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,104 @@
+/****h* /kinematic_calibration.h ***
+ * NAME
+ * 		kinematic_calibration.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Kinematic calibration of the arm from ball bar data: the DH
+ *              parameters, the flange, the ball bar length and the center
+ *              of the base ball minimizing the errors
+ *                  r = |tip(q) - base| - length
+ *              over the samples, tip being the end effector ball of the
+ *              sample (forward_kinematics.h).  The parameters are solved by
+ *              Levenberg-Marquardt with analytic derivatives, any of them
+ *              can be held constant.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __KINEMATIC_CALIBRATION_H__ /* make sure that kinematic_calibration is not redeclared */
+#define __KINEMATIC_CALIBRATION_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#endif
+
+#include "forward_kinematics.h"
+
+/* defines */
+#define KC_SUCCESS 1
+#define KC_FAILURE -1
+
+#define KC_MAX_THREADS 16
+
+/* dh (row by row), flange, length and base */
+#define KC_MAX_PARAMETERS (4 * FK_MAX_JOINTS + 10)
+
+/* samples per thread below which no extra thread is started */
+#define KC_MIN_THREAD_SAMPLES 1024
+
+/* reasons the solver stopped */
+#define KC_STOP_GRADIENT 1
+#define KC_STOP_STEP 2
+#define KC_STOP_ITERATIONS 3
+
+typedef struct {
+    uint32_t numJoints;
+    double dh[FK_MAX_JOINTS][4];    /* a, alpha, d, theta offset */
+    double flange[6];               /* x, y, z, xyz fixed angles */
+    double length;                  /* ball bar length */
+    double base[3];                 /* center of the base ball */
+} KcParameters;
+
+typedef struct {
+    const double *jointAngles;      /* numSamples x numJoints, column major */
+    const double *ballPositions;    /* numSamples x 3, in the flange frame */
+    uint32_t numSamples;
+    /* parameters held constant, same order as the parameter vector */
+    int32_t isConstant[KC_MAX_PARAMETERS];
+} KcProblem;
+
+typedef struct {
+    int32_t maxIterations;
+    double gradientTolerance;       /* on the largest gradient term */
+    double stepTolerance;           /* relative to the parameter norm */
+    double initialDamping;          /* relative to the diagonal */
+    int32_t numThreads;
+} KcOptions;
+
+typedef struct {
+    int32_t iterations;
+    int32_t stopReason;
+    uint32_t numFree;
+    double rmsError;
+    double gradientNorm;
+    double conditionNumber;         /* of the Jacobian of the free parameters */
+} KcInfo;
+
+/* function definations */
+void kc_default_options(KcOptions *options);
+
+int32_t kc_calibrate(const KcProblem *problem, KcParameters *parameters,
+        const KcOptions *options, KcInfo *info);
+
+int32_t kc_residuals(const KcProblem *problem,
+        const KcParameters *parameters, double *residuals, double *jacobian,
+        int32_t numThreads);
+
+uint32_t kc_number_of_parameters(uint32_t numJoints);
+
+#endif /* __KINEMATIC_CALIBRATION_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,322 @@
+/****h* /loadFTCalibration.c ***
+ * NAME
+ *      loadFTCalibration.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function reads an ATI F/T calibration file with the portable
+ *      ATI library (ftconfig.c) and returns the calibration and the
+ *      realtime coefficients as a matlab structure.  The output units and
+ *      the tool transform are compiled into the working matrix.
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ftconfig.h"
+
+/* defines */
+#define FILE_NAME_LENGTH 1024
+#define ERROR_MESSAGE_LENGTH 1100
+#define UNITS_LENGTH 32
+
+/* internal functions */
+static void configure(Calibration *cal, int numOptions,
+        const mxArray *options[]);
+static int getUnits(const mxArray *value, char *units);
+static mxArray *createRowVector(const float *values, int numValues);
+static mxArray *createMatrix(float matrix[MAX_AXES][MAX_GAUGES], int numRows,
+        int numColumns);
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    static const char *fieldNames[] = {"Serial", "BodyStyle", "PartNumber",
+        "Family", "CalDate", "ForceUnits", "TorqueUnits", "AxisNames",
+        "MaxLoads", "BasicMatrix", "BasicTransform", "DistUnits",
+        "AngleUnits", "TempCompAvailable", "VoltageRange", "BiPolar",
+        "HWTempComp", "OutputForceUnits", "OutputTorqueUnits",
+        "ToolTransform", "NumChannels", "working_matrix", "bias_slopes",
+        "gain_slopes", "thermistor"};
+    char fileName[FILE_NAME_LENGTH];
+    char errorMessage[ERROR_MESSAGE_LENGTH];
+    Calibration *cal;
+    mxArray *axisNames;
+    unsigned short index = 1;
+    int numGauges, numAxes;
+    int i;
+
+    /* first check the inputs */
+    if ((nrhs < 1) || !mxIsChar(prhs[0]))
+    {
+        mexErrMsgTxt("Must specify the calibration file name");
+        return;
+    }
+    if (mxGetString(prhs[0], fileName, FILE_NAME_LENGTH) != 0)
+    {
+        mexErrMsgTxt("Calibration file name is too long");
+        return;
+    }
+    if ((nrhs > 1) && !mxIsEmpty(prhs[1]))
+    {
+        if (!mxIsNumeric(prhs[1]) || (mxGetScalar(prhs[1]) < 1))
+        {
+            mexErrMsgTxt("Calibration index must be a number from 1");
+            return;
+        }
+        index = (unsigned short)mxGetScalar(prhs[1]);
+    }
+
+    cal = createCalibration(fileName, index);
+    if (cal == NULL)
+    {
+        sprintf(errorMessage, "Unable to load calibration %d from %s",
+                (int)index, fileName);
+        mexErrMsgTxt(errorMessage);
+        return;
+    }
+    if (nrhs > 2)
+    {
+        configure(cal, nrhs - 2, prhs + 2);
+    }
+    numGauges = cal->rt.NumChannels - 1;
+    numAxes = cal->rt.NumAxes;
+
+    plhs[0] = mxCreateStructMatrix(1, 1,
+            sizeof(fieldNames) / sizeof(fieldNames[0]), fieldNames);
+    mxSetField(plhs[0], 0, "Serial", mxCreateString(cal->Serial));
+    mxSetField(plhs[0], 0, "BodyStyle", mxCreateString(cal->BodyStyle));
+    mxSetField(plhs[0], 0, "PartNumber", mxCreateString(cal->PartNumber));
+    mxSetField(plhs[0], 0, "Family", mxCreateString(cal->Family));
+    mxSetField(plhs[0], 0, "CalDate", mxCreateString(cal->CalDate));
+    mxSetField(plhs[0], 0, "ForceUnits", mxCreateString(cal->ForceUnits));
+    mxSetField(plhs[0], 0, "TorqueUnits", mxCreateString(cal->TorqueUnits));
+
+    axisNames = mxCreateCellMatrix(1, numAxes);
+    for (i = 0; i < numAxes; i++)
+    {
+        mxSetCell(axisNames, i, mxCreateString(cal->AxisNames[i]));
+    }
+    mxSetField(plhs[0], 0, "AxisNames", axisNames);
+    mxSetField(plhs[0], 0, "MaxLoads", createRowVector(cal->MaxLoads,
+                numAxes));
+    mxSetField(plhs[0], 0, "BasicMatrix", createMatrix(cal->BasicMatrix,
+                numAxes, numGauges));
+    mxSetField(plhs[0], 0, "BasicTransform",
+            createRowVector(cal->BasicTransform.TT, 6));
+    mxSetField(plhs[0], 0, "DistUnits",
+            mxCreateString(cal->BasicTransform.DistUnits));
+    mxSetField(plhs[0], 0, "AngleUnits",
+            mxCreateString(cal->BasicTransform.AngleUnits));
+    mxSetField(plhs[0], 0, "TempCompAvailable",
+            mxCreateLogicalScalar(cal->TempCompAvailable != 0));
+    mxSetField(plhs[0], 0, "VoltageRange",
+            mxCreateDoubleScalar(cal->VoltageRange));
+    mxSetField(plhs[0], 0, "BiPolar",
+            mxCreateLogicalScalar(cal->BiPolar != 0));
+    mxSetField(plhs[0], 0, "HWTempComp",
+            mxCreateLogicalScalar(cal->HWTempComp != 0));
+    mxSetField(plhs[0], 0, "OutputForceUnits",
+            mxCreateString(cal->cfg.ForceUnits));
+    mxSetField(plhs[0], 0, "OutputTorqueUnits",
+            mxCreateString(cal->cfg.TorqueUnits));
+    mxSetField(plhs[0], 0, "ToolTransform",
+            createRowVector(cal->cfg.UserTransform.TT, 6));
+
+    /* realtime coefficients, as used by convertVoltagesToFT */
+    mxSetField(plhs[0], 0, "NumChannels",
+            mxCreateDoubleScalar(cal->rt.NumChannels));
+    mxSetField(plhs[0], 0, "working_matrix",
+            createMatrix(cal->rt.working_matrix, numAxes, numGauges));
+    mxSetField(plhs[0], 0, "bias_slopes",
+            createRowVector(cal->rt.bias_slopes, numGauges));
+    mxSetField(plhs[0], 0, "gain_slopes",
+            createRowVector(cal->rt.gain_slopes, numGauges));
+    mxSetField(plhs[0], 0, "thermistor",
+            mxCreateDoubleScalar(cal->rt.thermistor));
+
+    destroyCalibration(cal);
+    return;
+}
+
+/*
+ * apply the parameter/value options.  The settings only update the
+ * configuration, the working matrix is compiled once at the end
+ */
+static void configure(Calibration *cal, int numOptions,
+        const mxArray *options[])
+{
+    char name[UNITS_LENGTH];
+    char forceUnits[UNITS_LENGTH];
+    char torqueUnits[UNITS_LENGTH];
+    char distUnits[UNITS_LENGTH];
+    char angleUnits[UNITS_LENGTH];
+    float toolTransform[6];
+    int status = 0;
+    int i, j;
+
+    /* the units read from the file are known, so they are short */
+    strncpy(forceUnits, cal->cfg.ForceUnits, UNITS_LENGTH - 1);
+    strncpy(torqueUnits, cal->cfg.TorqueUnits, UNITS_LENGTH - 1);
+    strncpy(distUnits, cal->BasicTransform.DistUnits, UNITS_LENGTH - 1);
+    strncpy(angleUnits, cal->BasicTransform.AngleUnits, UNITS_LENGTH - 1);
+    forceUnits[UNITS_LENGTH - 1] = '\0';
+    torqueUnits[UNITS_LENGTH - 1] = '\0';
+    distUnits[UNITS_LENGTH - 1] = '\0';
+    angleUnits[UNITS_LENGTH - 1] = '\0';
+    for (j = 0; j < 6; j++)
+    {
+        toolTransform[j] = 0.0f;
+    }
+
+    if (numOptions % 2 != 0)
+    {
+        destroyCalibration(cal);
+        mexErrMsgTxt("Options must be parameter/value pairs");
+        return;
+    }
+    for (i = 0; i < numOptions; i += 2)
+    {
+        if (!mxIsChar(options[i])
+                || (mxGetString(options[i], name, UNITS_LENGTH) != 0))
+        {
+            destroyCalibration(cal);
+            mexErrMsgTxt("Option names must be strings");
+            return;
+        }
+        if (strcmp(name, "ForceUnits") == 0)
+        {
+            status = getUnits(options[i + 1], forceUnits);
+        }
+        else if (strcmp(name, "TorqueUnits") == 0)
+        {
+            status = getUnits(options[i + 1], torqueUnits);
+        }
+        else if (strcmp(name, "DistUnits") == 0)
+        {
+            status = getUnits(options[i + 1], distUnits);
+        }
+        else if (strcmp(name, "AngleUnits") == 0)
+        {
+            status = getUnits(options[i + 1], angleUnits);
+        }
+        else if (strcmp(name, "ToolTransform") == 0)
+        {
+            if (!mxIsDouble(options[i + 1])
+                    || (mxGetNumberOfElements(options[i + 1]) != 6))
+            {
+                destroyCalibration(cal);
+                mexErrMsgTxt("ToolTransform must be [Dx Dy Dz Rx Ry Rz]");
+                return;
+            }
+            for (j = 0; j < 6; j++)
+            {
+                toolTransform[j] = (float)mxGetPr(options[i + 1])[j];
+            }
+        }
+        else
+        {
+            destroyCalibration(cal);
+            mexErrMsgTxt("Unknown option, use ForceUnits, TorqueUnits, "
+                    "ToolTransform, DistUnits or AngleUnits");
+            return;
+        }
+        if (status != 0)
+        {
+            destroyCalibration(cal);
+            mexErrMsgTxt("Units must be strings");
+            return;
+        }
+    }
+
+    if ((ForceConv(forceUnits) == 0.0f) || (TorqueConv(torqueUnits) == 0.0f)
+            || (DistConv(distUnits) == 0.0f)
+            || (AngleConv(angleUnits) == 0.0f))
+    {
+        destroyCalibration(cal);
+        mexErrMsgTxt("Unknown units");
+        return;
+    }
+    free(cal->cfg.ForceUnits);
+    free(cal->cfg.TorqueUnits);
+    free(cal->cfg.UserTransform.DistUnits);
+    free(cal->cfg.UserTransform.AngleUnits);
+    cal->cfg.ForceUnits = ATI_strdup(forceUnits);
+    cal->cfg.TorqueUnits = ATI_strdup(torqueUnits);
+    cal->cfg.UserTransform.DistUnits = ATI_strdup(distUnits);
+    cal->cfg.UserTransform.AngleUnits = ATI_strdup(angleUnits);
+    for (j = 0; j < 6; j++)
+    {
+        cal->cfg.UserTransform.TT[j] = toolTransform[j];
+    }
+    if (CalcMatrix(cal) != 0)
+    {
+        destroyCalibration(cal);
+        mexErrMsgTxt("Unable to compute the working matrix");
+        return;
+    }
+}
+
+/*
+ * copy a units option, returns 0 on success
+ */
+static int getUnits(const mxArray *value, char *units)
+{
+    if (!mxIsChar(value) || (mxGetString(value, units, UNITS_LENGTH) != 0))
+    {
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * double row vector from float values
+ */
+static mxArray *createRowVector(const float *values, int numValues)
+{
+    mxArray *vector;
+    int i;
+
+    vector = mxCreateDoubleMatrix(1, numValues, mxREAL);
+    for (i = 0; i < numValues; i++)
+    {
+        mxGetPr(vector)[i] = values[i];
+    }
+    return vector;
+}
+
+/*
+ * double matrix from the top left part of a calibration matrix
+ */
+static mxArray *createMatrix(float matrix[MAX_AXES][MAX_GAUGES], int numRows,
+        int numColumns)
+{
+    mxArray *result;
+    int i, j;
+
+    result = mxCreateDoubleMatrix(numRows, numColumns, mxREAL);
+    for (i = 0; i < numRows; i++)
+    {
+        for (j = 0; j < numColumns; j++)
+        {
+            mxGetPr(result)[j * numRows + i] = matrix[i][j];
+        }
+    }
+    return result;
+}
+
+/*----------- END OF FILE ------------ */
@@ -0,0 +1,65 @@
+%LOADFTCALIBRATION Read an ATI F/T calibration file
+%
+% Syntax:
+%   cal = loadFTCalibration(calFile)
+%       reads the first calibration of the ATI calibration file calFile
+%       (.cal, as shipped with the transducer) and returns a structure with
+%       the fields of the Calibration struct of ftconfig.h:
+%           Serial, BodyStyle, PartNumber, Family, CalDate
+%           ForceUnits, TorqueUnits   units of the calibration
+%           AxisNames                 cell array, one name per axis
+%           MaxLoads                  rated load of each axis
+%           BasicMatrix               axes x gauges calibration matrix
+%           BasicTransform            [Dx Dy Dz Rx Ry Rz] built in transform
+%           DistUnits, AngleUnits     units of BasicTransform
+%           TempCompAvailable, VoltageRange, BiPolar, HWTempComp
+%           OutputForceUnits, OutputTorqueUnits, ToolTransform
+%                                     configuration of the working matrix
+%       and the realtime coefficients of RTCoefs in ftrt.h:
+%           NumChannels               gauges plus the thermistor
+%           working_matrix            axes x gauges conversion matrix
+%           bias_slopes, gain_slopes  temperature compensation, per gauge
+%           thermistor                thermistor voltage at calibration
+%   cal = loadFTCalibration(calFile,index)
+%       reads the calibration number index (from 1) of the file.
+%   cal = loadFTCalibration(calFile,index,'parameter',value,...)
+%       configures the working matrix with the parameters:
+%           ForceUnits     lb, klb, N, kN, g or kg
+%           TorqueUnits    in-lb, ft-lb, N-m, N-mm or kg-cm
+%           ToolTransform  [Dx Dy Dz Rx Ry Rz], origin of the tool frame in
+%                          the transducer frame and its rotations about x,
+%                          then y, then z
+%           DistUnits      in, ft, m, cm or mm (default DistUnits of the
+%                          calibration)
+%           AngleUnits     degrees or radians (default AngleUnits of the
+%                          calibration)
+%       index can be [] for the first calibration.
+%
+% Notes:
+%   The basic transform, the tool transform and the unit conversion are
+%   compiled into the working matrix once, so each conversion is a single
+%   product of the working matrix by the gauge voltages.  Without options
+%   the working matrix is in the units of the calibration, as computed by
+%   createCalibration of the ATI DAQ F/T library.  The structure can be
+%   passed directly to convertVoltagesToFT.
+%   The file is read by the portable implementation of the library in
+%   ATI/ATIlib/ftconfig.c, so no ATI dll is needed.
+%
+% Example:
+%   cal = loadFTCalibration('FT4566.cal');
+%   ft = convertVoltagesToFT(voltages,cal,cal.TempCompAvailable);
+%   cal = loadFTCalibration('FT4566.cal',[],'ForceUnits','N',...
+%       'TorqueUnits','N-m','ToolTransform',[0 0 45 0 0 90],'DistUnits','mm');
+%
+% See also:
+%    convertVoltagesToFT, mATI_Connect
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
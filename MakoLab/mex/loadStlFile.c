@@ -0,0 +1,459 @@
+/****h* /loadStlFile.c ***
+ * NAME
+ *      loadStlFile.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function reads a binary or ascii STL file.  The file is
+ *      memory mapped and decoded in bulk into the output arrays.
+ *      Optionally the duplicated vertices are welded into an indexed
+ *      mesh and the result is kept in a mesh cache file that later
+ *      calls read back without parsing the STL file.
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mapped_file.h"
+#include "stl_mesh.h"
+
+#ifdef _WIN32
+#define snprintf _snprintf
+#endif
+
+/* defines */
+#define TRUE 1
+#define FALSE 0
+#define MAX_FILE_NAME_LENGTH 1024
+#define ERROR_MESSAGE_LENGTH 512
+#define PRECISION_LENGTH 8
+
+/* outputs of the mex function */
+typedef struct {
+    mxArray *facets;
+    mxArray *vertices;
+    mxArray *normals;
+    mxArray *attributes;
+    int32_t format;
+    int32_t nameLength;
+    const char *name;
+    double bounds[6];
+} StlOutputs;
+
+/* internal functions */
+static void setOutputs(int nlhs, mxArray *plhs[], StlOutputs *outputs);
+static void computePreciseBounds(const double *vertices, int32_t numVertices,
+        double *bounds);
+static int32_t readMeshCache(const char *cacheFile, uint64_t sourceSize,
+        int64_t sourceTime, float weldTolerance, StlOutputs *outputs);
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    char fileName[MAX_FILE_NAME_LENGTH];
+    char fullName[MAX_FILE_NAME_LENGTH];
+    char cacheDir[MAX_FILE_NAME_LENGTH];
+    char cacheFile[MAX_FILE_NAME_LENGTH];
+    char errorMessage[ERROR_MESSAGE_LENGTH];
+    char decodeError[ERROR_MESSAGE_LENGTH];
+    char precision[PRECISION_LENGTH];
+    MappedFile stlFile;
+    StlInfo info;
+    StlOutputs outputs;
+    StlCacheHeader cacheHeader;
+    uint64_t cacheKey;
+    uint64_t sourceSize = 0;
+    int64_t sourceTime = 0;
+    int32_t *ifacets;
+    float *stlVertices;
+    double *preciseVertices = NULL;
+    float bounds[6];
+    int32_t i;
+    int32_t status;
+    int32_t numUnique;
+    int32_t numKept;
+    int32_t useCache = FALSE;
+    int32_t preciseOutput = FALSE;
+    float weldTolerance = -1;
+    int dims[2];
+
+    /* first check the inputs */
+    if (nrhs < 1)
+    {
+        mexErrMsgTxt("Must specify the STL file name");
+        return;
+    }
+
+    if (!mxIsChar(prhs[0])
+            || mxGetString(prhs[0], fileName, MAX_FILE_NAME_LENGTH))
+    {
+        mexErrMsgTxt("File name must be a string shorter than 1024 chars");
+        return;
+    }
+
+    /* a negative tolerance keeps all the vertices */
+    if (nrhs > 1)
+    {
+        if (!mxIsNumeric(prhs[1]) || (mxGetNumberOfElements(prhs[1]) != 1))
+        {
+            mexErrMsgTxt("Weld tolerance must be a scalar");
+            return;
+        }
+        weldTolerance = (float)mxGetScalar(prhs[1]);
+    }
+
+    /* optional precision of the vertices */
+    if (nrhs > 3)
+    {
+        if (!mxIsChar(prhs[3])
+                || mxGetString(prhs[3], precision, PRECISION_LENGTH)
+                || ((strcmp(precision, "single") != 0)
+                    && (strcmp(precision, "double") != 0)))
+        {
+            mexErrMsgTxt("Precision must be 'single' or 'double'");
+            return;
+        }
+        preciseOutput = (strcmp(precision, "double") == 0);
+    }
+
+    /* optional cache directory, an empty string disables the cache. */
+    /* The cache only holds single precision vertices */
+    if ((nrhs > 2) && !mxIsEmpty(prhs[2]) && !preciseOutput)
+    {
+        if (!mxIsChar(prhs[2])
+                || mxGetString(prhs[2], cacheDir, MAX_FILE_NAME_LENGTH - 32))
+        {
+            mexErrMsgTxt("Cache directory must be a string shorter than 990 chars");
+            return;
+        }
+        /* the cache file is named after the absolute STL file name and */
+        /* the tolerance, its header tells whether the STL file changed */
+        /* since.  A name that does not fit disables the cache */
+        if ((file_stamp(fileName, &sourceSize, &sourceTime)
+                    == MAPPED_FILE_SUCCESS)
+                && (full_path(fileName, fullName, sizeof(fullName))
+                    == MAPPED_FILE_SUCCESS))
+        {
+            cacheKey = hash_bytes(MAPPED_FILE_HASH_SEED, fullName,
+                    strlen(fullName));
+            cacheKey = hash_bytes(cacheKey, &weldTolerance,
+                    sizeof(weldTolerance));
+            status = snprintf(cacheFile, sizeof(cacheFile), "%s/%08x%08x%s",
+                    cacheDir, (unsigned int)(cacheKey >> 32),
+                    (unsigned int)(cacheKey & 0xffffffff), STL_CACHE_EXT);
+            useCache = (status >= 0) && (status < (int)sizeof(cacheFile));
+        }
+    }
+
+    if (useCache && readMeshCache(cacheFile, sourceSize, sourceTime,
+                weldTolerance, &outputs))
+    {
+        setOutputs(nlhs, plhs, &outputs);
+        return;
+    }
+
+    if (map_file_read(fileName, &stlFile) != MAPPED_FILE_SUCCESS)
+    {
+        snprintf(errorMessage, sizeof(errorMessage), "File %.400s could not "
+                "be opened, check name or path.", fileName);
+        mexErrMsgTxt(errorMessage);
+        return;
+    }
+
+    if (stl_inspect(stlFile.data, stlFile.size, &info, decodeError)
+            != STL_SUCCESS)
+    {
+        unmap_file(&stlFile);
+        sprintf(errorMessage, "%.400s: %.100s", fileName, decodeError);
+        mexErrMsgTxt(errorMessage);
+        return;
+    }
+
+    /* preallocate all the outputs from the facet count */
+    dims[0] = 3;
+    dims[1] = info.numFacets;
+    outputs.facets = mxCreateNumericArray(2, dims, mxINT32_CLASS, mxREAL);
+    outputs.normals = mxCreateNumericArray(2, dims, mxSINGLE_CLASS, mxREAL);
+    dims[1] = info.numFacets * 3;
+    if (preciseOutput)
+    {
+        /* the single precision copy is only used to weld the vertices */
+        outputs.vertices = mxCreateNumericArray(2, dims, mxDOUBLE_CLASS,
+                mxREAL);
+        preciseVertices = mxGetPr(outputs.vertices);
+        stlVertices = (float *)mxMalloc(
+                (info.numFacets > 0 ? info.numFacets : 1) * 9 * sizeof(float));
+    }
+    else
+    {
+        outputs.vertices = mxCreateNumericArray(2, dims, mxSINGLE_CLASS,
+                mxREAL);
+        stlVertices = (float *)mxGetData(outputs.vertices);
+    }
+    dims[0] = 1;
+    dims[1] = info.numFacets;
+    outputs.attributes = mxCreateNumericArray(2, dims, mxUINT16_CLASS,
+            mxREAL);
+
+    /* ascii coordinates are parsed straight into the double output */
+    status = stl_decode(stlFile.data, stlFile.size, &info, stlVertices,
+            (info.format == STL_FORMAT_ASCII) ? preciseVertices : NULL,
+            (float *)mxGetData(outputs.normals),
+            (uint16_t *)mxGetData(outputs.attributes), decodeError);
+    if (status != STL_SUCCESS)
+    {
+        unmap_file(&stlFile);
+        if (preciseOutput)
+        {
+            mxFree(stlVertices);
+        }
+        mxDestroyArray(outputs.facets);
+        mxDestroyArray(outputs.normals);
+        mxDestroyArray(outputs.vertices);
+        mxDestroyArray(outputs.attributes);
+        sprintf(errorMessage, "%.400s: %.100s", fileName, decodeError);
+        mexErrMsgTxt(errorMessage);
+        return;
+    }
+    unmap_file(&stlFile);
+
+    /* fill the copy the decoder did not write */
+    if (preciseOutput)
+    {
+        for (i = 0; i < info.numFacets * 9; i++)
+        {
+            if (info.format == STL_FORMAT_ASCII)
+                stlVertices[i] = (float)preciseVertices[i];
+            else
+                preciseVertices[i] = (double)stlVertices[i];
+        }
+    }
+
+    ifacets = (int32_t *)mxGetData(outputs.facets);
+    if (weldTolerance >= 0)
+    {
+        if (stl_weld_vertices(stlVertices, info.numFacets * 3,
+                    weldTolerance, ifacets, &numUnique) != STL_SUCCESS)
+        {
+            mexErrMsgTxt("Unable to allocate memory to weld the vertices");
+            return;
+        }
+        /* the unique vertices are numbered in order of first use, */
+        /* move the double ones to the same place */
+        if (preciseOutput)
+        {
+            numKept = 0;
+            for (i = 0; i < info.numFacets * 3; i++)
+            {
+                if (ifacets[i] == numKept)
+                {
+                    memmove(preciseVertices + numKept * 3,
+                            preciseVertices + i * 3, 3 * sizeof(double));
+                    numKept++;
+                }
+            }
+        }
+        /* shrink the vertex list to the unique vertices */
+        mxSetN(outputs.vertices, numUnique);
+        mxSetData(outputs.vertices, mxRealloc(mxGetData(outputs.vertices),
+                    (numUnique > 0 ? numUnique : 1) * 3
+                    * mxGetElementSize(outputs.vertices)));
+    }
+    else
+    {
+        /* the vertices are in facet order, so just number them */
+        for (i = 0; i < info.numFacets * 3; i++)
+        {
+            ifacets[i] = i;
+        }
+    }
+
+    outputs.format = info.format;
+    outputs.nameLength = info.nameLength;
+    outputs.name = info.name;
+    if (preciseOutput)
+    {
+        mxFree(stlVertices);
+        computePreciseBounds(mxGetPr(outputs.vertices),
+                (int32_t)mxGetN(outputs.vertices), outputs.bounds);
+    }
+    else
+    {
+        stl_compute_bounds((float *)mxGetData(outputs.vertices),
+                (int32_t)mxGetN(outputs.vertices), bounds);
+        for (i = 0; i < 6; i++)
+        {
+            outputs.bounds[i] = (double)bounds[i];
+        }
+    }
+
+    if (useCache)
+    {
+        cacheHeader.sourceSize = sourceSize;
+        cacheHeader.sourceTime = sourceTime;
+        cacheHeader.weldTolerance = weldTolerance;
+        cacheHeader.format = info.format;
+        cacheHeader.numFacets = info.numFacets;
+        cacheHeader.numVertices = (int32_t)mxGetN(outputs.vertices);
+        cacheHeader.nameLength = info.nameLength;
+        memcpy(cacheHeader.bounds, bounds, sizeof(bounds));
+        if (stl_cache_write(cacheFile, &cacheHeader, ifacets,
+                    (float *)mxGetData(outputs.vertices),
+                    (float *)mxGetData(outputs.normals),
+                    (uint16_t *)mxGetData(outputs.attributes), info.name)
+                != STL_SUCCESS)
+        {
+            mexWarnMsgTxt("loadStlFile: unable to write the mesh cache file");
+        }
+    }
+
+    setOutputs(nlhs, plhs, &outputs);
+    return;
+}
+
+/*
+ * hand the outputs to matlab, the arrays that are not requested are
+ * released
+ */
+static void setOutputs(int nlhs, mxArray *plhs[], StlOutputs *outputs)
+{
+    int32_t i;
+    int dims[2];
+
+    plhs[0] = outputs->facets;
+    if (nlhs > 1)
+        plhs[1] = outputs->vertices;
+    else
+        mxDestroyArray(outputs->vertices);
+    if (nlhs > 2)
+        plhs[2] = outputs->normals;
+    else
+        mxDestroyArray(outputs->normals);
+    if (nlhs > 3)
+        plhs[3] = outputs->attributes;
+    else
+        mxDestroyArray(outputs->attributes);
+    if (nlhs > 4)
+    {
+        /* the header may hold zeros, keep it as is */
+        dims[0] = 1;
+        dims[1] = outputs->nameLength;
+        plhs[4] = mxCreateCharArray(2, dims);
+        for (i = 0; i < outputs->nameLength; i++)
+        {
+            ((mxChar *)mxGetData(plhs[4]))[i] =
+                (mxChar)(unsigned char)outputs->name[i];
+        }
+    }
+    if (nlhs > 5)
+    {
+        plhs[5] = mxCreateDoubleScalar(
+                (outputs->format == STL_FORMAT_ASCII) ? TRUE : FALSE);
+    }
+    if (nlhs > 6)
+    {
+        /* minimum in the first row, maximum in the second */
+        plhs[6] = mxCreateDoubleMatrix(2, 3, mxREAL);
+        for (i = 0; i < 3; i++)
+        {
+            mxGetPr(plhs[6])[i * 2] = outputs->bounds[i];
+            mxGetPr(plhs[6])[i * 2 + 1] = outputs->bounds[i + 3];
+        }
+    }
+}
+
+/*
+ * fill the outputs from a valid mesh cache file.  Returns FALSE if there
+ * is no cache file for this STL file or if it is out of date
+ */
+static int32_t readMeshCache(const char *cacheFile, uint64_t sourceSize,
+        int64_t sourceTime, float weldTolerance, StlOutputs *outputs)
+{
+    static char name[STL_MAX_NAME_LENGTH + 1];
+    MappedFile cache;
+    const StlCacheHeader *header;
+    int32_t i;
+    int dims[2];
+
+    if (map_file_read(cacheFile, &cache) != MAPPED_FILE_SUCCESS)
+    {
+        return FALSE;
+    }
+    header = stl_cache_check(cache.data, cache.size, sourceSize, sourceTime,
+            weldTolerance);
+    if (header == NULL)
+    {
+        unmap_file(&cache);
+        return FALSE;
+    }
+
+    /* the blocks are copied as they are, no parsing */
+    dims[0] = 3;
+    dims[1] = header->numFacets;
+    outputs->facets = mxCreateNumericArray(2, dims, mxINT32_CLASS, mxREAL);
+    memcpy(mxGetData(outputs->facets), cache.data + header->facetOffset,
+            (size_t)header->numFacets * 3 * sizeof(int32_t));
+    outputs->normals = mxCreateNumericArray(2, dims, mxSINGLE_CLASS, mxREAL);
+    memcpy(mxGetData(outputs->normals), cache.data + header->normalOffset,
+            (size_t)header->numFacets * 3 * sizeof(float));
+    dims[1] = header->numVertices;
+    outputs->vertices = mxCreateNumericArray(2, dims, mxSINGLE_CLASS, mxREAL);
+    memcpy(mxGetData(outputs->vertices), cache.data + header->vertexOffset,
+            (size_t)header->numVertices * 3 * sizeof(float));
+    dims[0] = 1;
+    dims[1] = header->numFacets;
+    outputs->attributes = mxCreateNumericArray(2, dims, mxUINT16_CLASS,
+            mxREAL);
+    memcpy(mxGetData(outputs->attributes),
+            cache.data + header->attributeOffset,
+            (size_t)header->numFacets * sizeof(uint16_t));
+
+    memcpy(name, cache.data + header->nameOffset, header->nameLength);
+    outputs->name = name;
+    outputs->nameLength = header->nameLength;
+    outputs->format = header->format;
+    for (i = 0; i < 6; i++)
+    {
+        outputs->bounds[i] = (double)header->bounds[i];
+    }
+
+    unmap_file(&cache);
+    return TRUE;
+}
+
+/*
+ * bounding box of double precision vertices, minimum x y z followed by
+ * maximum x y z, all 0 if there are no vertices
+ */
+static void computePreciseBounds(const double *vertices, int32_t numVertices,
+        double *bounds)
+{
+    int32_t i, j;
+
+    memset(bounds, 0, 6 * sizeof(double));
+    for (i = 0; i < numVertices; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            if ((i == 0) || (vertices[i * 3 + j] < bounds[j]))
+                bounds[j] = vertices[i * 3 + j];
+            if ((i == 0) || (vertices[i * 3 + j] > bounds[j + 3]))
+                bounds[j + 3] = vertices[i * 3 + j];
+        }
+    }
+}
+
+/*----------- END OF FILE ------------ */
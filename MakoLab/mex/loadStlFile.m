@@ -0,0 +1,68 @@
+%LOADSTLFILE Read a binary or ascii STL file
+%
+% Syntax:
+%   [ifacets,vertices,normals,attributes,header,isAscii] = loadStlFile(stlFileName)
+%       reads the STL file stlFileName.  The file is memory mapped and
+%       decoded in one pass.
+%       ifacets is a 3xN int32 array with the zero based vertex indices of
+%       the N facets, vertices a 3xM single array with one vertex per
+%       column, normals the 3xN single array of facet normals stored in the
+%       file and attributes the 1xN uint16 attribute (color) word of every
+%       facet (0 for ascii files).  header is the 80 byte header of a binary
+%       file or the first line of an ascii file and isAscii is true for
+%       ascii files.
+%       ifacets and vertices can be passed directly to mod2polygon.
+%   [...] = loadStlFile(stlFileName,weldTolerance)
+%       welds the vertices shared by neighbouring facets and returns an
+%       indexed mesh: vertices only holds the unique vertices (in order of
+%       first use) and ifacets indexes into them.  With a weldTolerance of
+%       0 only identical vertices are merged and the geometry is unchanged.
+%       A positive weldTolerance quantizes the coordinates to a grid of
+%       that spacing and merges the vertices on the same grid point.  A
+%       negative weldTolerance disables welding.
+%   [...] = loadStlFile(stlFileName,weldTolerance,cacheDir)
+%       keeps the decoded mesh in a cache file in the directory cacheDir.
+%       If the cache file of stlFileName is up to date the outputs are
+%       copied from it without reading the STL file, otherwise the STL file
+%       is decoded and the cache file (re)written.  An empty cacheDir
+%       disables the cache.
+%   [...] = loadStlFile(stlFileName,weldTolerance,cacheDir,precision)
+%       precision is 'single' (default) or 'double', the class of the
+%       vertices.  With 'double' the coordinates of ascii files keep the
+%       full precision of the file, binary files hold single precision
+%       coordinates anyway.  The cache is not used with 'double'.
+%   [ifacets,vertices,normals,attributes,header,isAscii,bounds] = loadStlFile(...)
+%       also returns the 2x3 bounding box of the vertices, minimum x,y,z
+%       in the first row and maximum x,y,z in the second row.
+%
+% Notes:
+%   A file whose size matches the facet count in the binary header is read
+%   as binary, even if the header starts with "solid".  Other files must
+%   start with "solid" and are read as ascii.  Large ascii files are split
+%   at facet boundaries and parsed by one thread per processor.
+%   Without welding the vertices are listed in facet order (M = 3N) and
+%   ifacets is simply 0..M-1.  A closed mesh typically has M close to N/2
+%   after welding.  Vertices closer than a positive weldTolerance can
+%   still fall on different grid points and are then not merged.
+%   With the default precision the coordinates of ascii files are rounded
+%   to single precision, the same as binary files.  Welding compares the
+%   single precision coordinates in both cases.
+%   The cache file is named after the absolute path of the STL file and
+%   weldTolerance, so relative names share the cache file.  It records the
+%   size and modification time of the STL file and is ignored (and
+%   rewritten) when the size or time differ or the cache format version
+%   changed.  A cache file that can not be written or replaced (e.g. while
+%   another MATLAB session has it open) only gives a warning.
+%
+% See also:
+%    read_stl, show_stl, mod2polygon
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
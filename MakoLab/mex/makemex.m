@@ -64,8 +64,10 @@ compileOptions = varargin;
 % Add additional options if any as shown below
 if (ispc)
    socketLib = {'wsock32.lib'};
+   mscribeSource = {'-I../extern/mscribe','mscribe_dll.cpp'};
 else
     socketLib = {};
+    mscribeSource = {};
 end
 
 % now start recompiling
@@ -76,10 +78,32 @@ mex(compileOptions{:},'matlabtoCrisisComm.c','crisis_communication.c')
 mex(compileOptions{:},'closeCrisisConnection.c',socketLib{:}) 
 mex(compileOptions{:},'convertBytesToFloat.c')
 mex(compileOptions{:},'convertBytesToDouble.c')
+mex(compileOptions{:},'convertBytesToNumbers.c')
 mex(compileOptions{:},'parseCrisisReply.c','crisis_communication.c')
 mex(compileOptions{:},'parseCrisisReplyByLocation.c','crisis_communication.c')
-mex(compileOptions{:},'mod2polygon.c')
+mex(compileOptions{:},'mod2polygon.c','mapped_file.c')
 mex(compileOptions{:},'convertStructToString.c')
+mex(compileOptions{:},'loadStlFile.c','stl_mesh.c','mapped_file.c')
+mex(compileOptions{:},'decimateMesh.c','mesh_decimate.c')
+mex(compileOptions{:},'-I../ATI/ATIlib','convertVoltagesToFT.c',...
+    'rt_coefs.c','../ATI/ATIlib/ftrt.c')
+mex(compileOptions{:},'-I../ATI/ATIlib','loadFTCalibration.c',...
+    '../ATI/ATIlib/ftconfig.c','../ATI/ATIlib/ftrt.c')
+mex(compileOptions{:},'-I../ATI/ATIlib','ftStream.c','ft_stream.c',...
+    'ft_filter.c','ring_buffer.c','rt_coefs.c','stream_clock.c',...
+    '../ATI/ATIlib/ftrt.c')
+mex(compileOptions{:},'parseNdiBxReply.c','ndi_bx.c')
+mex(compileOptions{:},'ndiStream.c','ndi_stream.c','ndi_bx.c',...
+    'ring_buffer.c','stream_clock.c')
+mex(compileOptions{:},'fusionBuffer.c','fusion_buffer.c')
+mex(compileOptions{:},'mscribeStream.c','mscribe_stream.c',...
+    'ring_buffer.c','stream_clock.c',mscribeSource{:})
+mex(compileOptions{:},'registerPointPairs.c','point_registration.c')
+mex(compileOptions{:},'pivotCalibration.c','pivot_calibration.c')
+mex(compileOptions{:},'transformVertices.c','vertex_transform.c')
+mex(compileOptions{:},'forwardKinematics.c','forward_kinematics.c')
+mex(compileOptions{:},'kinematicCalibration.c','kinematic_calibration.c',...
+    'forward_kinematics.c')
 display('All mex files successfully compiled');
 catch
     % There was a compile error
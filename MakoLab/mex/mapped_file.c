@@ -0,0 +1,429 @@
+/****h* /mapped_file.c ***
+ * NAME
+ *      mapped_file.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      This library provides the platform specific pieces needed by
+ *      the mex functions that keep binary caches on disk: read only
+ *      memory mapping, atomic (write then rename) file creation, a
+ *      content hash for cache keys and the file size and modification
+ *      time and the absolute path name to detect stale entries.
+ *
+ * SEE ALSO
+ *      mapped_file.h
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ****************/
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif /* _WIN32 */
+
+#include "mapped_file.h"
+
+/* 64 bit FNV-1a prime */
+#define FNV_PRIME 0x100000001b3ULL
+
+/* maximum length of a file name handled by write_file_atomic */
+#define MAX_FILE_NAME_LENGTH 1024
+
+/****f*  mapped_file.c/map_file_read ******
+ * NAME
+ *	    map_file_read
+ *
+ * SYNOPSIS
+ *      int32_t map_file_read(const char *fileName,
+ *              MappedFile *mappedFile)
+ *
+ * INPUTS
+ *      const char *fileName
+ *              name of the file to be mapped
+ *
+ * OUTPUT
+ *      MappedFile *mappedFile
+ *              mapping information.  data points to the first byte of
+ *              the file and size is the file size
+ *
+ *      int32_t  status
+ *              MAPPED_FILE_SUCCESS if the file was mapped
+ *              MAPPED_FILE_FAILURE if the file does not exist, is empty
+ *              or could not be mapped
+ *
+ * PURPOSE
+ *	    Map a whole file read only into memory
+ *
+ * NOTES
+ *      Every successful call must be matched by a call to unmap_file
+ *
+ **********************************
+ */
+int32_t map_file_read(const char *fileName, MappedFile *mappedFile)
+{
+#ifdef _WIN32
+    LARGE_INTEGER fileSize;
+
+    memset(mappedFile, 0, sizeof(MappedFile));
+    mappedFile->fileHandle = CreateFileA(fileName, GENERIC_READ,
+            FILE_SHARE_READ, NULL, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (mappedFile->fileHandle == INVALID_HANDLE_VALUE)
+    {
+        mappedFile->fileHandle = NULL;
+        return MAPPED_FILE_FAILURE;
+    }
+
+    if (!GetFileSizeEx(mappedFile->fileHandle, &fileSize)
+            || (fileSize.QuadPart == 0))
+    {
+        unmap_file(mappedFile);
+        return MAPPED_FILE_FAILURE;
+    }
+    mappedFile->size = (size_t)fileSize.QuadPart;
+
+    mappedFile->mapHandle = CreateFileMappingA(mappedFile->fileHandle,
+            NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mappedFile->mapHandle == NULL)
+    {
+        unmap_file(mappedFile);
+        return MAPPED_FILE_FAILURE;
+    }
+
+    mappedFile->data = (const unsigned char *)MapViewOfFile(
+            mappedFile->mapHandle, FILE_MAP_READ, 0, 0, 0);
+    if (mappedFile->data == NULL)
+    {
+        unmap_file(mappedFile);
+        return MAPPED_FILE_FAILURE;
+    }
+#else
+    struct stat fileStat;
+    void *view;
+
+    memset(mappedFile, 0, sizeof(MappedFile));
+    if ((mappedFile->fd = open(fileName, O_RDONLY)) < 0)
+    {
+        return MAPPED_FILE_FAILURE;
+    }
+
+    if ((fstat(mappedFile->fd, &fileStat) != 0) || (fileStat.st_size == 0))
+    {
+        unmap_file(mappedFile);
+        return MAPPED_FILE_FAILURE;
+    }
+    mappedFile->size = (size_t)fileStat.st_size;
+
+    view = mmap(NULL, mappedFile->size, PROT_READ, MAP_PRIVATE,
+            mappedFile->fd, 0);
+    if (view == MAP_FAILED)
+    {
+        unmap_file(mappedFile);
+        return MAPPED_FILE_FAILURE;
+    }
+    mappedFile->data = (const unsigned char *)view;
+#endif /* _WIN32 */
+
+    return MAPPED_FILE_SUCCESS;
+}
+
+/****f*  mapped_file.c/unmap_file ******
+ * NAME
+ *	    unmap_file
+ *
+ * SYNOPSIS
+ *      void unmap_file(MappedFile *mappedFile)
+ *
+ * INPUTS
+ *      MappedFile *mappedFile
+ *              mapping returned by map_file_read
+ *
+ * PURPOSE
+ *	    Release the view and close the file.  Safe to call on a
+ *	    partially initialized mapping
+ *
+ **********************************
+ */
+void unmap_file(MappedFile *mappedFile)
+{
+#ifdef _WIN32
+    if (mappedFile->data != NULL)
+        UnmapViewOfFile((LPCVOID)mappedFile->data);
+    if (mappedFile->mapHandle != NULL)
+        CloseHandle(mappedFile->mapHandle);
+    if (mappedFile->fileHandle != NULL)
+        CloseHandle(mappedFile->fileHandle);
+    mappedFile->mapHandle = NULL;
+    mappedFile->fileHandle = NULL;
+#else
+    if (mappedFile->data != NULL)
+        munmap((void *)mappedFile->data, mappedFile->size);
+    if (mappedFile->fd >= 0)
+        close(mappedFile->fd);
+    mappedFile->fd = -1;
+#endif /* _WIN32 */
+    mappedFile->data = NULL;
+    mappedFile->size = 0;
+}
+
+/****f*  mapped_file.c/write_file_atomic ******
+ * NAME
+ *	    write_file_atomic
+ *
+ * SYNOPSIS
+ *      int32_t write_file_atomic(const char *fileName,
+ *              const void *const *blocks,
+ *              const size_t *blockSizes,
+ *              int32_t numberOfBlocks)
+ *
+ * INPUTS
+ *      const char *fileName
+ *              name of the file to be created
+ *      const void *const *blocks
+ *              list of memory blocks to be written one after the other
+ *      const size_t *blockSizes
+ *              size in bytes of each block
+ *      int32_t numberOfBlocks
+ *              number of entries in blocks and blockSizes
+ *
+ * OUTPUT
+ *      int32_t  status
+ *              MAPPED_FILE_SUCCESS if the file was written
+ *              MAPPED_FILE_FAILURE otherwise
+ *
+ * PURPOSE
+ *	    Write a file so that readers never see it partially written.
+ *	    The data goes to a temporary file next to the target which is
+ *	    then renamed over it.
+ *
+ * NOTES
+ *      An existing target is replaced.  On windows that fails while
+ *      another process has the target open or mapped, the temporary
+ *      file is then removed and MAPPED_FILE_FAILURE returned
+ *
+ **********************************
+ */
+int32_t write_file_atomic(const char *fileName,
+        const void *const *blocks,
+        const size_t *blockSizes,
+        int32_t numberOfBlocks)
+{
+    char tempName[MAX_FILE_NAME_LENGTH];
+    FILE *fid;
+    int32_t i;
+    int32_t status = MAPPED_FILE_SUCCESS;
+
+#ifdef _WIN32
+    if (_snprintf(tempName, sizeof(tempName), "%s.%d.tmp",
+                fileName, _getpid()) < 0)
+#else
+    if (snprintf(tempName, sizeof(tempName), "%s.%d.tmp",
+                fileName, (int)getpid()) >= (int)sizeof(tempName))
+#endif
+    {
+        return MAPPED_FILE_FAILURE;
+    }
+
+    if ((fid = fopen(tempName, "wb")) == NULL)
+    {
+        return MAPPED_FILE_FAILURE;
+    }
+
+    for (i = 0; i < numberOfBlocks; i++)
+    {
+        if ((blockSizes[i] > 0)
+                && (fwrite(blocks[i], 1, blockSizes[i], fid) != blockSizes[i]))
+        {
+            status = MAPPED_FILE_FAILURE;
+            break;
+        }
+    }
+
+    if ((fclose(fid) != 0) || (status != MAPPED_FILE_SUCCESS))
+    {
+        remove(tempName);
+        return MAPPED_FILE_FAILURE;
+    }
+
+#ifdef _WIN32
+    /* rename does not replace an existing file on windows */
+    if (!MoveFileExA(tempName, fileName, MOVEFILE_REPLACE_EXISTING))
+#else
+    if (rename(tempName, fileName) != 0)
+#endif /* _WIN32 */
+    {
+        remove(tempName);
+        return MAPPED_FILE_FAILURE;
+    }
+
+    return MAPPED_FILE_SUCCESS;
+}
+
+/****f*  mapped_file.c/hash_bytes ******
+ * NAME
+ *	    hash_bytes
+ *
+ * SYNOPSIS
+ *      uint64_t hash_bytes(uint64_t hash, const void *data, size_t length)
+ *
+ * INPUTS
+ *      uint64_t hash
+ *              running hash.  Use MAPPED_FILE_HASH_SEED for the first
+ *              block
+ *      const void *data
+ *              bytes to be added to the hash
+ *      size_t length
+ *              number of bytes
+ *
+ * OUTPUT
+ *      uint64_t hash
+ *              updated hash
+ *
+ * PURPOSE
+ *	    64 bit FNV-1a hash.  Blocks can be chained by passing the
+ *	    result of one call as the hash of the next.
+ *
+ * NOTES
+ *      This is a cache key, not a cryptographic hash
+ *
+ **********************************
+ */
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t length)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        hash ^= (uint64_t)bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/****f*  mapped_file.c/file_stamp ******
+ * NAME
+ *	    file_stamp
+ *
+ * SYNOPSIS
+ *      int32_t file_stamp(const char *fileName, uint64_t *fileSize,
+ *              int64_t *modifiedTime)
+ *
+ * INPUTS
+ *      const char *fileName
+ *              name of the file
+ *
+ * OUTPUT
+ *      uint64_t *fileSize
+ *              size of the file in bytes
+ *      int64_t *modifiedTime
+ *              last modification time (seconds since the epoch)
+ *
+ *      int32_t  status
+ *              MAPPED_FILE_SUCCESS or MAPPED_FILE_FAILURE if the file
+ *              does not exist
+ *
+ * PURPOSE
+ *	    Cheap check whether a file changed since a cache entry was
+ *	    made from it, without reading it
+ *
+ **********************************
+ */
+int32_t file_stamp(const char *fileName, uint64_t *fileSize,
+        int64_t *modifiedTime)
+{
+#ifdef _WIN32
+    struct __stat64 fileStat;
+
+    if (_stat64(fileName, &fileStat) != 0)
+#else
+    struct stat fileStat;
+
+    if (stat(fileName, &fileStat) != 0)
+#endif /* _WIN32 */
+    {
+        return MAPPED_FILE_FAILURE;
+    }
+    *fileSize = (uint64_t)fileStat.st_size;
+    *modifiedTime = (int64_t)fileStat.st_mtime;
+    return MAPPED_FILE_SUCCESS;
+}
+
+/****f*  mapped_file.c/full_path ******
+ * NAME
+ *	    full_path
+ *
+ * SYNOPSIS
+ *      int32_t full_path(const char *fileName, char *fullName,
+ *              size_t length)
+ *
+ * INPUTS
+ *      const char *fileName
+ *              name of an existing file, relative or absolute
+ *      size_t length
+ *              size of the fullName buffer
+ *
+ * OUTPUT
+ *      char *fullName
+ *              absolute path of the file
+ *
+ *      int32_t  status
+ *              MAPPED_FILE_SUCCESS or MAPPED_FILE_FAILURE if the file
+ *              does not exist or the path does not fit
+ *
+ * PURPOSE
+ *	    Name a file independently of the current directory, so that
+ *	    a cache key made from it is the same for every way the file
+ *	    is referred to
+ *
+ * NOTES
+ *      On windows the path is made absolute and "." and ".." are
+ *      removed, elsewhere the symbolic links are resolved as well
+ *
+ **********************************
+ */
+int32_t full_path(const char *fileName, char *fullName, size_t length)
+{
+#ifdef _WIN32
+    if (_fullpath(fullName, fileName, length) == NULL)
+    {
+        return MAPPED_FILE_FAILURE;
+    }
+#else
+    char *resolvedName;
+
+    if ((resolvedName = realpath(fileName, NULL)) == NULL)
+    {
+        return MAPPED_FILE_FAILURE;
+    }
+    if (strlen(resolvedName) >= length)
+    {
+        free(resolvedName);
+        return MAPPED_FILE_FAILURE;
+    }
+    strcpy(fullName, resolvedName);
+    free(resolvedName);
+#endif /* _WIN32 */
+    return MAPPED_FILE_SUCCESS;
+}
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,73 @@
+/****h* /mapped_file.h ***
+ * NAME
+ * 		mapped_file.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Portable helpers to memory map files read only, write
+ *              files atomically, hash their content and get their size,
+ *              modification time and absolute path.  Used by the mex functions that
+ *              keep binary caches on disk.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __MAPPED_FILE_H__ /* make sure that mapped_file is not redeclared */
+#define __MAPPED_FILE_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#endif
+
+#include <stddef.h>
+
+/* defines */
+#define MAPPED_FILE_SUCCESS 1
+#define MAPPED_FILE_FAILURE -1
+
+/* offset basis for the 64 bit FNV-1a hash */
+#define MAPPED_FILE_HASH_SEED 0xcbf29ce484222325ULL
+
+typedef struct {
+    const unsigned char *data;  /* start of the mapped view */
+    size_t size;                /* size of the file in bytes */
+#ifdef _WIN32
+    void *fileHandle;
+    void *mapHandle;
+#else
+    int fd;
+#endif
+} MappedFile;
+
+/* function definations */
+int32_t map_file_read(const char *fileName, MappedFile *mappedFile);
+
+void unmap_file(MappedFile *mappedFile);
+
+int32_t write_file_atomic(const char *fileName,
+        const void *const *blocks,
+        const size_t *blockSizes,
+        int32_t numberOfBlocks);
+
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t length);
+
+int32_t file_stamp(const char *fileName, uint64_t *fileSize,
+        int64_t *modifiedTime);
+
+int32_t full_path(const char *fileName, char *fullName, size_t length);
+
+#endif /* __MAPPED_FILE_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
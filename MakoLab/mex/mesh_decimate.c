@@ -0,0 +1,979 @@
+/****h* /mesh_decimate.c ***
+ * NAME
+ *      mesh_decimate.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      This library simplifies an indexed triangle mesh (such as the
+ *      welded mesh from loadStlFile) with the quadric error metric of
+ *      Garland and Heckbert.  Every vertex accumulates the area weighted
+ *      planes of its facets, the edges are kept in a priority queue
+ *      ordered by the error of collapsing them to their optimal point and
+ *      the cheapest edge is collapsed until the facet count of the next
+ *      level of detail is reached.  Collapses that would fold a facet
+ *      over or make the mesh non manifold are skipped.
+ *
+ * SEE ALSO
+ *      mesh_decimate.h, decimateMesh.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "mesh_decimate.h"
+
+/* a quadric is the symmetric 4x4 matrix a11 a12 a13 a14 a22 a23 a24 */
+/* a33 a34 a44 followed by the facet area it was accumulated from */
+#define QUADRIC_SIZE 11
+#define QUADRIC_AREA 10
+
+/* open edges are held in place by planes perpendicular to their facet */
+/* weighted by this factor times the squared edge length */
+#define BOUNDARY_WEIGHT 1000.0
+
+/* the optimal point is only used if the quadric is well conditioned */
+#define MIN_RELATIVE_DETERMINANT 1.0e-10
+
+/* a 4-ary heap halves the depth of the priority queue, the children */
+/* of an entry share a cache line */
+#define HEAP_ARITY 4
+#define INITIAL_HEAP_SIZE 1024
+
+/* a closed mesh has 1.5 edges per facet, the queue is cleared of out of */
+/* date entries when it holds more than this many entries per facet */
+#define STALE_HEAP_FACTOR 2
+#define NO_CORNER -1
+#define NO_COLLAPSE -1
+
+/* a candidate edge collapse, the stamps tell if it is out of date */
+typedef struct {
+    double cost;
+    double position[3];
+    int32_t vertex[2];
+    uint32_t stamp[2];
+} EdgeCollapse;
+
+/* the priority queue only moves the costs, the collapses stay in a pool */
+typedef struct {
+    double cost;
+    int32_t collapse;
+} HeapKey;
+
+typedef struct {
+    int32_t numVertices;
+    int32_t numFacets;
+    int32_t liveFacets;
+    double *position;       /* 3 per vertex */
+    double *quadric;        /* QUADRIC_SIZE per vertex */
+    uint32_t *stamp;        /* changed when the vertex moves */
+    char *vertexAlive;
+    int32_t *corner;        /* current vertex of the 3 corners of a facet */
+    char *facetAlive;
+    int32_t *next;          /* corners of a vertex as a linked list */
+    int32_t *head;
+    int32_t *tail;
+    int32_t *mark;          /* scratch marks for the neighbour searches */
+    int32_t markId;
+    HeapKey *heap;
+    int32_t heapSize;
+    int32_t heapCapacity;
+    EdgeCollapse *pool;     /* unused entries are linked through vertex[0] */
+    int32_t poolSize;
+    int32_t freeCollapse;
+    double maxCost;
+} Mesh;
+
+/* internal functions */
+static int32_t init_mesh(Mesh *mesh, const int32_t *facets,
+        int32_t numFacets, const float *vertices, int32_t numVertices);
+static void free_mesh(Mesh *mesh);
+static void add_plane(double *quadric, const double *normal, double d,
+        double weight);
+static int32_t add_boundary_planes(Mesh *mesh);
+static int compare_edges(const void *a, const void *b);
+static void evaluate_edge(const Mesh *mesh, int32_t v1, int32_t v2,
+        EdgeCollapse *edge);
+static double quadric_error(const double *q, const double *p);
+static int32_t push_edge(Mesh *mesh, int32_t v1, int32_t v2);
+static void pop_edge(Mesh *mesh, EdgeCollapse *edge);
+static void sift_down(Mesh *mesh, int32_t parent, HeapKey key);
+static void compact_heap(Mesh *mesh);
+static int32_t edge_is_current(const Mesh *mesh, const EdgeCollapse *edge);
+static int32_t collapse_is_valid(Mesh *mesh, const EdgeCollapse *edge);
+static int32_t collapse_edge(Mesh *mesh, const EdgeCollapse *edge);
+static int32_t save_level(const Mesh *mesh, MeshLevel *level);
+static void facet_normal(const double *p0, const double *p1,
+        const double *p2, double *normal);
+
+/****f*  mesh_decimate.c/mesh_decimate ******
+ * NAME
+ *	    mesh_decimate
+ *
+ * SYNOPSIS
+ *      int32_t mesh_decimate(const int32_t *facets, int32_t numFacets,
+ *              const float *vertices, int32_t numVertices,
+ *              const int32_t *targetFacets, int32_t numLevels,
+ *              MeshLevel *levels)
+ *
+ * INPUTS
+ *      const int32_t *facets
+ *              3 zero based vertex indices per facet
+ *      int32_t numFacets
+ *              number of facets
+ *      const float *vertices
+ *              3 coordinates per vertex
+ *      int32_t numVertices
+ *              number of vertices
+ *      const int32_t *targetFacets
+ *              facet count of each level of detail, in any order
+ *      int32_t numLevels
+ *              number of levels, at most MESH_MAX_LEVELS
+ *
+ * OUTPUT
+ *      MeshLevel *levels
+ *              one level per target, in the order of the targets.  The
+ *              arrays are allocated here and released with
+ *              mesh_free_levels
+ *
+ *      Returns MESH_DECIMATE_SUCCESS, or MESH_DECIMATE_FAILURE if the
+ *      inputs are invalid or memory could not be allocated
+ *
+ * PURPOSE
+ *	    Build levels of detail of a mesh.  The mesh is simplified once,
+ *	    from the largest target to the smallest, and a copy is taken
+ *	    every time a target is reached so each level is a
+ *	    simplification of the previous one.
+ *
+ * NOTES
+ *      A level can keep more facets than its target if no more edges can
+ *      be collapsed without damaging the mesh.  maxError is the largest
+ *      root mean square distance of a collapsed vertex to the original
+ *      facets it replaced, so it is in the units of the vertices
+ *
+ **********************************
+ */
+int32_t mesh_decimate(const int32_t *facets, int32_t numFacets,
+        const float *vertices, int32_t numVertices,
+        const int32_t *targetFacets, int32_t numLevels, MeshLevel *levels)
+{
+    Mesh mesh;
+    EdgeCollapse edge;
+    int32_t order[MESH_MAX_LEVELS];
+    int32_t i, j, swap;
+
+    if ((numLevels < 1) || (numLevels > MESH_MAX_LEVELS)
+            || (numFacets < 0) || (numVertices < 0))
+    {
+        return MESH_DECIMATE_FAILURE;
+    }
+    for (i = 0; i < numFacets * 3; i++)
+    {
+        if ((facets[i] < 0) || (facets[i] >= numVertices))
+        {
+            return MESH_DECIMATE_FAILURE;
+        }
+    }
+    memset(levels, 0, numLevels * sizeof(MeshLevel));
+
+    /* the levels are produced from the largest target down */
+    for (i = 0; i < numLevels; i++)
+    {
+        order[i] = i;
+    }
+    for (i = 1; i < numLevels; i++)
+    {
+        for (j = i; (j > 0)
+                && (targetFacets[order[j - 1]] < targetFacets[order[j]]); j--)
+        {
+            swap = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = swap;
+        }
+    }
+
+    if (init_mesh(&mesh, facets, numFacets, vertices, numVertices)
+            != MESH_DECIMATE_SUCCESS)
+    {
+        free_mesh(&mesh);
+        return MESH_DECIMATE_FAILURE;
+    }
+
+    for (i = 0; i < numLevels; i++)
+    {
+        while ((mesh.liveFacets > targetFacets[order[i]])
+                && (mesh.heapSize > 0))
+        {
+            pop_edge(&mesh, &edge);
+            if (!collapse_is_valid(&mesh, &edge))
+            {
+                continue;
+            }
+            if (collapse_edge(&mesh, &edge) != MESH_DECIMATE_SUCCESS)
+            {
+                free_mesh(&mesh);
+                mesh_free_levels(levels, numLevels);
+                return MESH_DECIMATE_FAILURE;
+            }
+            if (mesh.heapSize > STALE_HEAP_FACTOR * mesh.liveFacets)
+            {
+                compact_heap(&mesh);
+            }
+        }
+        if (save_level(&mesh, &levels[order[i]]) != MESH_DECIMATE_SUCCESS)
+        {
+            free_mesh(&mesh);
+            mesh_free_levels(levels, numLevels);
+            return MESH_DECIMATE_FAILURE;
+        }
+    }
+
+    free_mesh(&mesh);
+    return MESH_DECIMATE_SUCCESS;
+}
+
+/****f*  mesh_decimate.c/mesh_free_levels ******
+ * NAME
+ *	    mesh_free_levels
+ *
+ * SYNOPSIS
+ *      void mesh_free_levels(MeshLevel *levels, int32_t numLevels)
+ *
+ * INPUTS
+ *      MeshLevel *levels
+ *              levels filled by mesh_decimate
+ *      int32_t numLevels
+ *              number of levels
+ *
+ * PURPOSE
+ *	    Release the arrays of the levels of detail
+ *
+ **********************************
+ */
+void mesh_free_levels(MeshLevel *levels, int32_t numLevels)
+{
+    int32_t i;
+
+    for (i = 0; i < numLevels; i++)
+    {
+        free(levels[i].facets);
+        free(levels[i].vertices);
+        levels[i].facets = NULL;
+        levels[i].vertices = NULL;
+    }
+}
+
+/*
+ * allocate the working mesh, accumulate the quadrics and queue every
+ * edge
+ */
+static int32_t init_mesh(Mesh *mesh, const int32_t *facets,
+        int32_t numFacets, const float *vertices, int32_t numVertices)
+{
+    double normal[3], length;
+    double *p0;
+    int32_t i, k, c, v;
+
+    memset(mesh, 0, sizeof(Mesh));
+    mesh->numVertices = numVertices;
+    mesh->numFacets = numFacets;
+    mesh->liveFacets = numFacets;
+
+    mesh->position = (double *)malloc((numVertices * 3 + 1) * sizeof(double));
+    mesh->quadric = (double *)calloc(numVertices * QUADRIC_SIZE + 1,
+            sizeof(double));
+    mesh->stamp = (uint32_t *)calloc(numVertices + 1, sizeof(uint32_t));
+    mesh->vertexAlive = (char *)calloc(numVertices + 1, 1);
+    mesh->corner = (int32_t *)malloc((numFacets * 3 + 1) * sizeof(int32_t));
+    mesh->facetAlive = (char *)malloc(numFacets + 1);
+    mesh->next = (int32_t *)malloc((numFacets * 3 + 1) * sizeof(int32_t));
+    mesh->head = (int32_t *)malloc((numVertices + 1) * sizeof(int32_t));
+    mesh->tail = (int32_t *)malloc((numVertices + 1) * sizeof(int32_t));
+    mesh->mark = (int32_t *)calloc(numVertices + 1, sizeof(int32_t));
+    mesh->heapCapacity = INITIAL_HEAP_SIZE;
+    mesh->heap = (HeapKey *)malloc(mesh->heapCapacity * sizeof(HeapKey));
+    mesh->pool = (EdgeCollapse *)malloc(mesh->heapCapacity
+            * sizeof(EdgeCollapse));
+    mesh->freeCollapse = NO_COLLAPSE;
+    if ((mesh->position == NULL) || (mesh->quadric == NULL)
+            || (mesh->stamp == NULL) || (mesh->vertexAlive == NULL)
+            || (mesh->corner == NULL) || (mesh->facetAlive == NULL)
+            || (mesh->next == NULL) || (mesh->head == NULL)
+            || (mesh->tail == NULL) || (mesh->mark == NULL)
+            || (mesh->heap == NULL) || (mesh->pool == NULL))
+    {
+        return MESH_DECIMATE_FAILURE;
+    }
+
+    for (i = 0; i < numVertices * 3; i++)
+    {
+        mesh->position[i] = vertices[i];
+    }
+    for (i = 0; i < numVertices; i++)
+    {
+        mesh->head[i] = NO_CORNER;
+        mesh->tail[i] = NO_CORNER;
+    }
+
+    /* link the corners to their vertex and add the facet planes */
+    memcpy(mesh->corner, facets, numFacets * 3 * sizeof(int32_t));
+    memset(mesh->facetAlive, 1, numFacets);
+    for (i = 0; i < numFacets; i++)
+    {
+        /* facets that use a vertex twice have no area, drop them */
+        if ((facets[i * 3] == facets[i * 3 + 1])
+                || (facets[i * 3 + 1] == facets[i * 3 + 2])
+                || (facets[i * 3 + 2] == facets[i * 3]))
+        {
+            mesh->facetAlive[i] = 0;
+            mesh->liveFacets--;
+            continue;
+        }
+        for (k = 0; k < 3; k++)
+        {
+            c = i * 3 + k;
+            v = facets[c];
+            mesh->vertexAlive[v] = 1;
+            mesh->next[c] = NO_CORNER;
+            if (mesh->tail[v] == NO_CORNER)
+                mesh->head[v] = c;
+            else
+                mesh->next[mesh->tail[v]] = c;
+            mesh->tail[v] = c;
+        }
+
+        p0 = mesh->position + facets[i * 3] * 3;
+        facet_normal(p0, mesh->position + facets[i * 3 + 1] * 3,
+                mesh->position + facets[i * 3 + 2] * 3, normal);
+        length = sqrt(normal[0] * normal[0] + normal[1] * normal[1]
+                + normal[2] * normal[2]);
+        if (length == 0.0)
+        {
+            continue;
+        }
+        normal[0] /= length;
+        normal[1] /= length;
+        normal[2] /= length;
+        for (k = 0; k < 3; k++)
+        {
+            v = facets[i * 3 + k];
+            add_plane(mesh->quadric + v * QUADRIC_SIZE, normal,
+                    -(normal[0] * p0[0] + normal[1] * p0[1]
+                        + normal[2] * p0[2]), length * 0.5);
+            mesh->quadric[v * QUADRIC_SIZE + QUADRIC_AREA] += length * 0.5;
+        }
+    }
+
+    /* the open edges are found while queueing the edges */
+    return add_boundary_planes(mesh);
+}
+
+static void free_mesh(Mesh *mesh)
+{
+    free(mesh->position);
+    free(mesh->quadric);
+    free(mesh->stamp);
+    free(mesh->vertexAlive);
+    free(mesh->corner);
+    free(mesh->facetAlive);
+    free(mesh->next);
+    free(mesh->head);
+    free(mesh->tail);
+    free(mesh->mark);
+    free(mesh->heap);
+    free(mesh->pool);
+}
+
+/*
+ * add weight * (n.p + d)^2 to a quadric, the area is kept by the caller
+ */
+static void add_plane(double *quadric, const double *normal, double d,
+        double weight)
+{
+    quadric[0] += weight * normal[0] * normal[0];
+    quadric[1] += weight * normal[0] * normal[1];
+    quadric[2] += weight * normal[0] * normal[2];
+    quadric[3] += weight * normal[0] * d;
+    quadric[4] += weight * normal[1] * normal[1];
+    quadric[5] += weight * normal[1] * normal[2];
+    quadric[6] += weight * normal[1] * d;
+    quadric[7] += weight * normal[2] * normal[2];
+    quadric[8] += weight * normal[2] * d;
+    quadric[9] += weight * d * d;
+}
+
+/*
+ * sort the edges of all the facets, hold the edges used by a single
+ * facet with a perpendicular plane and then queue every distinct edge
+ */
+static int32_t add_boundary_planes(Mesh *mesh)
+{
+    uint64_t *edges;
+    double edgeVector[3], facetNormal[3], normal[3], length, weight;
+    const double *p0, *p1;
+    int32_t numEdges, i, j, k, a, b, facet, third;
+
+    numEdges = mesh->numFacets * 3;
+    if ((edges = (uint64_t *)malloc((numEdges + 1) * sizeof(uint64_t)))
+            == NULL)
+    {
+        return MESH_DECIMATE_FAILURE;
+    }
+
+    /* key: low vertex in the upper and high vertex in the lower half, */
+    /* the dropped facets give a 0 key that is skipped */
+    for (i = 0; i < numEdges; i++)
+    {
+        if (!mesh->facetAlive[i / 3])
+        {
+            edges[i] = 0;
+            continue;
+        }
+        a = mesh->corner[i];
+        b = mesh->corner[(i % 3 == 2) ? i - 2 : i + 1];
+        if (a > b)
+        {
+            k = a;
+            a = b;
+            b = k;
+        }
+        edges[i] = ((uint64_t)a << 32) | (uint64_t)b;
+    }
+    qsort(edges, numEdges, sizeof(uint64_t), compare_edges);
+
+    for (i = 0; i < numEdges; i = j)
+    {
+        for (j = i + 1; (j < numEdges) && (edges[j] == edges[i]); j++)
+            ;
+        a = (int32_t)(edges[i] >> 32);
+        b = (int32_t)(edges[i] & 0xffffffff);
+        if ((a == b) || (j - i > 1))
+        {
+            continue;
+        }
+
+        /* open edge, find its facet through the corners of a */
+        third = a;
+        for (k = mesh->head[a]; k != NO_CORNER; k = mesh->next[k])
+        {
+            facet = k / 3;
+            if ((mesh->corner[facet * 3] == b)
+                    || (mesh->corner[facet * 3 + 1] == b)
+                    || (mesh->corner[facet * 3 + 2] == b))
+            {
+                third = mesh->corner[facet * 3] + mesh->corner[facet * 3 + 1]
+                    + mesh->corner[facet * 3 + 2] - a - b;
+                break;
+            }
+        }
+        p0 = mesh->position + a * 3;
+        p1 = mesh->position + b * 3;
+        facet_normal(p0, p1, mesh->position + third * 3, facetNormal);
+        edgeVector[0] = p1[0] - p0[0];
+        edgeVector[1] = p1[1] - p0[1];
+        edgeVector[2] = p1[2] - p0[2];
+        normal[0] = edgeVector[1] * facetNormal[2]
+            - edgeVector[2] * facetNormal[1];
+        normal[1] = edgeVector[2] * facetNormal[0]
+            - edgeVector[0] * facetNormal[2];
+        normal[2] = edgeVector[0] * facetNormal[1]
+            - edgeVector[1] * facetNormal[0];
+        length = sqrt(normal[0] * normal[0] + normal[1] * normal[1]
+                + normal[2] * normal[2]);
+        if (length == 0.0)
+        {
+            continue;
+        }
+        normal[0] /= length;
+        normal[1] /= length;
+        normal[2] /= length;
+        weight = BOUNDARY_WEIGHT * (edgeVector[0] * edgeVector[0]
+                + edgeVector[1] * edgeVector[1]
+                + edgeVector[2] * edgeVector[2]);
+        add_plane(mesh->quadric + a * QUADRIC_SIZE, normal,
+                -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]),
+                weight);
+        add_plane(mesh->quadric + b * QUADRIC_SIZE, normal,
+                -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]),
+                weight);
+    }
+
+    /* the quadrics are complete, cost the edges */
+    for (i = 0; i < numEdges; i = j)
+    {
+        for (j = i + 1; (j < numEdges) && (edges[j] == edges[i]); j++)
+            ;
+        a = (int32_t)(edges[i] >> 32);
+        b = (int32_t)(edges[i] & 0xffffffff);
+        if ((a != b) && (push_edge(mesh, a, b) != MESH_DECIMATE_SUCCESS))
+        {
+            free(edges);
+            return MESH_DECIMATE_FAILURE;
+        }
+    }
+
+    free(edges);
+    return MESH_DECIMATE_SUCCESS;
+}
+
+static int compare_edges(const void *a, const void *b)
+{
+    uint64_t ea = *(const uint64_t *)a;
+    uint64_t eb = *(const uint64_t *)b;
+
+    return (ea < eb) ? -1 : ((ea > eb) ? 1 : 0);
+}
+
+/*
+ * cost of collapsing v1 and v2 to the point minimizing the sum of their
+ * quadrics, or to the better of the end and middle points if that point
+ * is not well defined
+ */
+static void evaluate_edge(const Mesh *mesh, int32_t v1, int32_t v2,
+        EdgeCollapse *edge)
+{
+    double q[QUADRIC_SIZE];
+    double candidate[3], cost, det, scale;
+    const double *p1, *p2;
+    int32_t i, k;
+
+    for (i = 0; i < QUADRIC_SIZE; i++)
+    {
+        q[i] = mesh->quadric[v1 * QUADRIC_SIZE + i]
+            + mesh->quadric[v2 * QUADRIC_SIZE + i];
+    }
+    edge->vertex[0] = v1;
+    edge->vertex[1] = v2;
+    edge->stamp[0] = mesh->stamp[v1];
+    edge->stamp[1] = mesh->stamp[v2];
+
+    /* solve A x = -b with A the upper 3x3 block by Cramer's rule */
+    det = q[0] * (q[4] * q[7] - q[5] * q[5])
+        - q[1] * (q[1] * q[7] - q[5] * q[2])
+        + q[2] * (q[1] * q[5] - q[4] * q[2]);
+    scale = (q[0] + q[4] + q[7]) / 3.0;
+    if (fabs(det) > MIN_RELATIVE_DETERMINANT * scale * scale * scale)
+    {
+        edge->position[0] = -(q[3] * (q[4] * q[7] - q[5] * q[5])
+                - q[1] * (q[6] * q[7] - q[5] * q[8])
+                + q[2] * (q[6] * q[5] - q[4] * q[8])) / det;
+        edge->position[1] = -(q[0] * (q[6] * q[7] - q[8] * q[5])
+                - q[3] * (q[1] * q[7] - q[5] * q[2])
+                + q[2] * (q[1] * q[8] - q[6] * q[2])) / det;
+        edge->position[2] = -(q[0] * (q[4] * q[8] - q[5] * q[6])
+                - q[1] * (q[1] * q[8] - q[6] * q[2])
+                + q[3] * (q[1] * q[5] - q[4] * q[2])) / det;
+        edge->cost = quadric_error(q, edge->position);
+        return;
+    }
+
+    p1 = mesh->position + v1 * 3;
+    p2 = mesh->position + v2 * 3;
+    edge->cost = -1.0;
+    for (k = 0; k < 3; k++)
+    {
+        for (i = 0; i < 3; i++)
+        {
+            candidate[i] = (k == 0) ? p1[i]
+                : ((k == 1) ? p2[i] : 0.5 * (p1[i] + p2[i]));
+        }
+        cost = quadric_error(q, candidate);
+        if ((edge->cost < 0.0) || (cost < edge->cost))
+        {
+            edge->cost = cost;
+            memcpy(edge->position, candidate, sizeof(candidate));
+        }
+    }
+}
+
+static double quadric_error(const double *q, const double *p)
+{
+    double error;
+
+    error = q[0] * p[0] * p[0] + 2.0 * q[1] * p[0] * p[1]
+        + 2.0 * q[2] * p[0] * p[2] + 2.0 * q[3] * p[0]
+        + q[4] * p[1] * p[1] + 2.0 * q[5] * p[1] * p[2] + 2.0 * q[6] * p[1]
+        + q[7] * p[2] * p[2] + 2.0 * q[8] * p[2] + q[9];
+
+    /* rounding can make the error of an exact fit slightly negative */
+    return (error > 0.0) ? error : 0.0;
+}
+
+static int32_t push_edge(Mesh *mesh, int32_t v1, int32_t v2)
+{
+    HeapKey *grownHeap;
+    EdgeCollapse *grownPool;
+    int32_t collapse, child, parent;
+
+    /* the pool never holds more entries than the heap */
+    if (mesh->heapSize == mesh->heapCapacity)
+    {
+        grownHeap = (HeapKey *)realloc(mesh->heap,
+                2 * mesh->heapCapacity * sizeof(HeapKey));
+        if (grownHeap == NULL)
+        {
+            return MESH_DECIMATE_FAILURE;
+        }
+        mesh->heap = grownHeap;
+        grownPool = (EdgeCollapse *)realloc(mesh->pool,
+                2 * mesh->heapCapacity * sizeof(EdgeCollapse));
+        if (grownPool == NULL)
+        {
+            return MESH_DECIMATE_FAILURE;
+        }
+        mesh->pool = grownPool;
+        mesh->heapCapacity *= 2;
+    }
+
+    if (mesh->freeCollapse != NO_COLLAPSE)
+    {
+        collapse = mesh->freeCollapse;
+        mesh->freeCollapse = mesh->pool[collapse].vertex[0];
+    }
+    else
+    {
+        collapse = mesh->poolSize++;
+    }
+    evaluate_edge(mesh, v1, v2, &mesh->pool[collapse]);
+
+    child = mesh->heapSize++;
+    while (child > 0)
+    {
+        parent = (child - 1) / HEAP_ARITY;
+        if (mesh->heap[parent].cost <= mesh->pool[collapse].cost)
+            break;
+        mesh->heap[child] = mesh->heap[parent];
+        child = parent;
+    }
+    mesh->heap[child].cost = mesh->pool[collapse].cost;
+    mesh->heap[child].collapse = collapse;
+    return MESH_DECIMATE_SUCCESS;
+}
+
+static void pop_edge(Mesh *mesh, EdgeCollapse *edge)
+{
+    *edge = mesh->pool[mesh->heap[0].collapse];
+    mesh->pool[mesh->heap[0].collapse].vertex[0] = mesh->freeCollapse;
+    mesh->freeCollapse = mesh->heap[0].collapse;
+
+    mesh->heapSize--;
+    sift_down(mesh, 0, mesh->heap[mesh->heapSize]);
+}
+
+/*
+ * place key at or below parent
+ */
+static void sift_down(Mesh *mesh, int32_t parent, HeapKey key)
+{
+    int32_t child, first, end;
+
+    while ((first = HEAP_ARITY * parent + 1) < mesh->heapSize)
+    {
+        end = (first + HEAP_ARITY < mesh->heapSize)
+            ? first + HEAP_ARITY : mesh->heapSize;
+        child = first;
+        for (first++; first < end; first++)
+        {
+            if (mesh->heap[first].cost < mesh->heap[child].cost)
+                child = first;
+        }
+        if (mesh->heap[child].cost >= key.cost)
+            break;
+        mesh->heap[parent] = mesh->heap[child];
+        parent = child;
+    }
+    mesh->heap[parent] = key;
+}
+
+/*
+ * every collapse leaves the queued edges of its vertices out of date,
+ * dropping them in one pass is cheaper than popping them one by one
+ */
+static void compact_heap(Mesh *mesh)
+{
+    int32_t i, kept, collapse;
+
+    kept = 0;
+    for (i = 0; i < mesh->heapSize; i++)
+    {
+        collapse = mesh->heap[i].collapse;
+        if (edge_is_current(mesh, &mesh->pool[collapse]))
+        {
+            mesh->heap[kept++] = mesh->heap[i];
+        }
+        else
+        {
+            mesh->pool[collapse].vertex[0] = mesh->freeCollapse;
+            mesh->freeCollapse = collapse;
+        }
+    }
+    mesh->heapSize = kept;
+
+    for (i = (kept - 2) / HEAP_ARITY; i >= 0; i--)
+    {
+        sift_down(mesh, i, mesh->heap[i]);
+    }
+}
+
+static int32_t edge_is_current(const Mesh *mesh, const EdgeCollapse *edge)
+{
+    return mesh->vertexAlive[edge->vertex[0]]
+        && mesh->vertexAlive[edge->vertex[1]]
+        && (mesh->stamp[edge->vertex[0]] == edge->stamp[0])
+        && (mesh->stamp[edge->vertex[1]] == edge->stamp[1]);
+}
+
+/*
+ * an edge can be collapsed if both vertices are unchanged since it was
+ * queued, the vertices only share the neighbours of their common facets
+ * (so the mesh stays manifold) and none of the remaining facets around
+ * them flips over
+ */
+static int32_t collapse_is_valid(Mesh *mesh, const EdgeCollapse *edge)
+{
+    double before[3], after[3];
+    const double *p[3];
+    int32_t v1, v2, c, k, f, moved, v, shared, common, firstMark;
+
+    v1 = edge->vertex[0];
+    v2 = edge->vertex[1];
+    if (!edge_is_current(mesh, edge))
+    {
+        return 0;
+    }
+
+    /* mark the neighbours of v1, then count the ones v2 also has */
+    firstMark = ++mesh->markId;
+    for (c = mesh->head[v1]; c != NO_CORNER; c = mesh->next[c])
+    {
+        f = c / 3;
+        if (!mesh->facetAlive[f])
+            continue;
+        for (k = 0; k < 3; k++)
+        {
+            mesh->mark[mesh->corner[f * 3 + k]] = firstMark;
+        }
+    }
+    ++mesh->markId;
+    shared = 0;
+    common = 0;
+    for (c = mesh->head[v2]; c != NO_CORNER; c = mesh->next[c])
+    {
+        f = c / 3;
+        if (!mesh->facetAlive[f])
+            continue;
+        for (k = 0; k < 3; k++)
+        {
+            v = mesh->corner[f * 3 + k];
+            if (v == v1)
+                shared++;
+            else if ((v != v2) && (mesh->mark[v] == firstMark))
+            {
+                mesh->mark[v] = mesh->markId;
+                common++;
+            }
+        }
+    }
+    if ((shared == 0) || (common > shared))
+    {
+        return 0;
+    }
+
+    /* the facets that are only moved must keep their orientation */
+    for (moved = 0; moved < 2; moved++)
+    {
+        for (c = mesh->head[edge->vertex[moved]]; c != NO_CORNER;
+                c = mesh->next[c])
+        {
+            f = c / 3;
+            if (!mesh->facetAlive[f])
+                continue;
+            for (k = 0; k < 3; k++)
+            {
+                v = mesh->corner[f * 3 + k];
+                if (v == edge->vertex[1 - moved])
+                    break;
+                p[k] = mesh->position + v * 3;
+            }
+            if (k < 3)
+                continue;
+            facet_normal(p[0], p[1], p[2], before);
+            p[c % 3] = edge->position;
+            facet_normal(p[0], p[1], p[2], after);
+            if ((before[0] * after[0] + before[1] * after[1]
+                        + before[2] * after[2]) <= 0.0)
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/*
+ * move v1 to the collapse point, remove the facets of the edge, hand the
+ * facets of v2 to v1 and queue the edges around v1 again
+ */
+static int32_t collapse_edge(Mesh *mesh, const EdgeCollapse *edge)
+{
+    double area;
+    int32_t v1, v2, c, previous, k, f, v;
+
+    v1 = edge->vertex[0];
+    v2 = edge->vertex[1];
+
+    for (c = mesh->head[v2]; c != NO_CORNER; c = mesh->next[c])
+    {
+        f = c / 3;
+        if (!mesh->facetAlive[f])
+            continue;
+        if ((mesh->corner[f * 3] == v1) || (mesh->corner[f * 3 + 1] == v1)
+                || (mesh->corner[f * 3 + 2] == v1))
+        {
+            mesh->facetAlive[f] = 0;
+            mesh->liveFacets--;
+        }
+        else
+        {
+            mesh->corner[c] = v1;
+        }
+    }
+    if (mesh->tail[v1] == NO_CORNER)
+    {
+        mesh->head[v1] = mesh->head[v2];
+        mesh->tail[v1] = mesh->tail[v2];
+    }
+    else if (mesh->head[v2] != NO_CORNER)
+    {
+        mesh->next[mesh->tail[v1]] = mesh->head[v2];
+        mesh->tail[v1] = mesh->tail[v2];
+    }
+    mesh->head[v2] = NO_CORNER;
+    mesh->tail[v2] = NO_CORNER;
+    mesh->vertexAlive[v2] = 0;
+
+    memcpy(mesh->position + v1 * 3, edge->position, 3 * sizeof(double));
+    for (k = 0; k < QUADRIC_SIZE; k++)
+    {
+        mesh->quadric[v1 * QUADRIC_SIZE + k] +=
+            mesh->quadric[v2 * QUADRIC_SIZE + k];
+    }
+    mesh->stamp[v1]++;
+
+    area = mesh->quadric[v1 * QUADRIC_SIZE + QUADRIC_AREA];
+    if ((area > 0.0) && (edge->cost / area > mesh->maxCost))
+    {
+        mesh->maxCost = edge->cost / area;
+    }
+
+    /* drop the removed facets from the list of v1 and queue its edges */
+    ++mesh->markId;
+    mesh->mark[v1] = mesh->markId;
+    previous = NO_CORNER;
+    for (c = mesh->head[v1]; c != NO_CORNER; c = mesh->next[c])
+    {
+        f = c / 3;
+        if (!mesh->facetAlive[f])
+        {
+            if (previous == NO_CORNER)
+                mesh->head[v1] = mesh->next[c];
+            else
+                mesh->next[previous] = mesh->next[c];
+            if (mesh->tail[v1] == c)
+                mesh->tail[v1] = previous;
+            continue;
+        }
+        previous = c;
+        for (k = 0; k < 3; k++)
+        {
+            v = mesh->corner[f * 3 + k];
+            if (mesh->mark[v] == mesh->markId)
+                continue;
+            mesh->mark[v] = mesh->markId;
+            if (push_edge(mesh, v1, v) != MESH_DECIMATE_SUCCESS)
+            {
+                return MESH_DECIMATE_FAILURE;
+            }
+        }
+    }
+    return MESH_DECIMATE_SUCCESS;
+}
+
+/*
+ * copy the live facets and the vertices they use to a level
+ */
+static int32_t save_level(const Mesh *mesh, MeshLevel *level)
+{
+    int32_t *remap;
+    int32_t i, k, v;
+
+    level->facets = (int32_t *)malloc((mesh->liveFacets * 3 + 1)
+            * sizeof(int32_t));
+    level->vertices = (float *)malloc((mesh->numVertices * 3 + 1)
+            * sizeof(float));
+    remap = (int32_t *)malloc((mesh->numVertices + 1) * sizeof(int32_t));
+    if ((level->facets == NULL) || (level->vertices == NULL)
+            || (remap == NULL))
+    {
+        free(remap);
+        return MESH_DECIMATE_FAILURE;
+    }
+    memset(remap, 0xff, mesh->numVertices * sizeof(int32_t));
+
+    level->numFacets = 0;
+    level->numVertices = 0;
+    for (i = 0; i < mesh->numFacets; i++)
+    {
+        if (!mesh->facetAlive[i])
+            continue;
+        for (k = 0; k < 3; k++)
+        {
+            v = mesh->corner[i * 3 + k];
+            if (remap[v] < 0)
+            {
+                remap[v] = level->numVertices++;
+                level->vertices[remap[v] * 3] = (float)mesh->position[v * 3];
+                level->vertices[remap[v] * 3 + 1] =
+                    (float)mesh->position[v * 3 + 1];
+                level->vertices[remap[v] * 3 + 2] =
+                    (float)mesh->position[v * 3 + 2];
+            }
+            level->facets[level->numFacets * 3 + k] = remap[v];
+        }
+        level->numFacets++;
+    }
+    level->maxError = sqrt(mesh->maxCost);
+
+    free(remap);
+    return MESH_DECIMATE_SUCCESS;
+}
+
+/*
+ * (p1 - p0) x (p2 - p0), twice the area of the facet in length
+ */
+static void facet_normal(const double *p0, const double *p1,
+        const double *p2, double *normal)
+{
+    double a[3], b[3];
+
+    a[0] = p1[0] - p0[0];
+    a[1] = p1[1] - p0[1];
+    a[2] = p1[2] - p0[2];
+    b[0] = p2[0] - p0[0];
+    b[1] = p2[1] - p0[1];
+    b[2] = p2[2] - p0[2];
+    normal[0] = a[1] * b[2] - a[2] * b[1];
+    normal[1] = a[2] * b[0] - a[0] * b[2];
+    normal[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+/*------------ END OF FILE ------------- */
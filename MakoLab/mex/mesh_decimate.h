@@ -0,0 +1,59 @@
+/****h* /mesh_decimate.h ***
+ * NAME
+ * 		mesh_decimate.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Simplification of indexed triangle meshes by quadric
+ *              error metric edge collapses, producing a series of
+ *              levels of detail.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __MESH_DECIMATE_H__ /* make sure that mesh_decimate is not redeclared */
+#define __MESH_DECIMATE_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#endif
+
+/* defines */
+#define MESH_DECIMATE_SUCCESS 1
+#define MESH_DECIMATE_FAILURE -1
+
+/* most levels of detail produced by one call */
+#define MESH_MAX_LEVELS 32
+
+/* one level of detail, the vertices are compacted to the ones used by */
+/* the facets and the facets index them from 0 */
+typedef struct {
+    int32_t numFacets;
+    int32_t numVertices;
+    int32_t *facets;            /* 3 per facet */
+    float *vertices;            /* 3 per vertex */
+    double maxError;            /* largest collapse error, in distance */
+} MeshLevel;
+
+/* function definations */
+int32_t mesh_decimate(const int32_t *facets, int32_t numFacets,
+        const float *vertices, int32_t numVertices,
+        const int32_t *targetFacets, int32_t numLevels, MeshLevel *levels);
+
+void mesh_free_levels(MeshLevel *levels, int32_t numLevels);
+
+#endif /* __MESH_DECIMATE_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
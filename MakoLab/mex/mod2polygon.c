@@ -23,15 +23,39 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define snprintf _snprintf
+#endif
 
 
 #define DEBUG 1
 #define FALSE 0
 #define TRUE 1
 #define MODALITY_LEN 7
+#define MAX_LEGACY_TRIANGLES 65536
+/* default maxTriPerVox of the legacy layout when it is not given */
 #define MAX_TRI_PER_VOX 29
+#define GRID_CHANGED 0
 #define MM2M 0.001;
 #define EPSILON 1e-12
+/* relative padding applied to the triangle/box rejection test so that */
+/* float round off can never reject a voxel the exact test would keep */
+#define SAT_TOLERANCE 1e-3f
+
+/* on disk voxel cache, bump the version whenever the voxel data */
+/* produced for a given input changes */
+#define VOXEL_CACHE_MAGIC "M2PVOXEL"
+#define VOXEL_CACHE_VERSION 2
+#define VOXEL_CACHE_EXT ".vox"
+#define VOXEL_CACHE_ALIGN 8
+#define MAX_CACHE_NAME_LEN 1024
+
+/* coarse levels of the voxel pyramid are added until no grid dimension */
+/* exceeds PYRAMID_MIN_DIM cells */
+#define PYRAMID_MIN_DIM 2
+#define MAX_PYRAMID_LEVELS 16
 
 
 #define x_6n(n, x) \
@@ -70,18 +94,52 @@ typedef struct {
     int numtriangles;
     float stdTrans[4][4];
     float regTrans[4][4];
-    unsigned short *voxelPtr;
+    unsigned int *voxelStart;   /* nvoxels+1 offsets into voxelTri */
+    unsigned int *voxelTri;     /* triangle ids, grouped by voxel */
+    int maxOccupancy;           /* largest number of triangles in a voxel */
     unsigned char *voxelMap;
     float *facetPtr;
     unsigned short maxPix;
     unsigned short minPix;
 } Polygon;
 
+/* growable list of (voxel, triangle) intersections */
 typedef struct{
-    float x;
-    float y;
-    float z;
-}Point;
+    int *voxel;
+    int *triangle;
+    int count;
+    int capacity;
+}VoxelPairList;
+
+/* header of a voxel cache file.  The voxel data, facet data and voxel */
+/* map follow at the given (8 byte aligned) offsets so the file can be */
+/* used directly from a memory mapped view */
+typedef struct{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t key;
+    int32_t numtriangles;
+    int32_t numvertices;
+    int32_t maxTriPerVox;
+    int32_t nvoxels;
+    float scaleFactor;
+    float resolution;
+    int32_t maxOccupancy;
+    int32_t overflowVoxels;
+    uint64_t voxelOffset, voxelBytes;
+    uint64_t facetOffset, facetBytes;
+    uint64_t voxelMapOffset, voxelMapBytes;
+    double vsize[3];
+    double hwi[3];
+}VoxelCacheHeader;
+
+/* per triangle data reused by the triangle/box separating axis test */
+typedef struct{
+    float vert[3][3];
+    float edge[3][3];
+    float normal[3];
+}SatTriangle;
 
 /*
  * Prototypes for functions referenced only in this file
@@ -92,29 +150,74 @@ int model2Polygon (
 		int numtriangles,
 		int numvertices,
 		int *triIndex,
-		int maxTriPerVox,
 		float scaleFactor,
 		float *vertex,
 		float resolution,
-		unsigned char *voxelDataOut,
-		unsigned char *facetDataOut,
-		double *vsizeDataOut,
-		double *hwiDataOut,
-        unsigned char *voxelMapOut);
+		Polygon *vPtr,
+		float haptic_wrt_implant[]);
+
+int setupPolygon (
+		char *volName,
+		int numtriangles,
+		int numvertices,
+		int *triIndex,
+		float scaleFactor,
+		float *vertex,
+		float resolution,
+		Polygon *vPtr,
+		float haptic_wrt_implant[],
+		float **triSurfaceOut);
+
+int updatePolygon (
+		char *volName,
+		int numtriangles,
+		int numvertices,
+		int *triIndex,
+		float scaleFactor,
+		float *vertex,
+		float resolution,
+		unsigned int *prevVoxelData,
+		unsigned char *prevVoxelMap,
+		double *prevVsize,
+		double *prevHwi,
+		int *changed,
+		int numChanged,
+		Polygon *vPtr,
+		float haptic_wrt_implant[]);
+
+void freePolygon(Polygon *vPtr);
+
+int createPolygonOutputs(Polygon *vPtr, int maxTriPerVox,
+        float haptic_wrt_implant[], mxArray *plhs[]);
+
+mxArray *createPyramidOutput(const mxArray *voxelData,
+        const mxArray *vsizeData, int maxTriPerVox);
 
 void computeModelBounds (int numtriangles,
 		float triSurface[][3][3],
 		float maxBound[3],
 		float minBound[3]);
 
-void generatePolygonMap(Polygon *vPtr,
+int generatePolygonMap(Polygon *vPtr,
 		int numtriangles,
-		int maxTrianglePerVoxel,
 		float triSurface[][3][3],
-		float maxBounds[],
-		float minBounds[],
 		float haptic_wrt_implant[]);
 
+int voxelizeTriangles(Polygon *vPtr,
+		float triSurface[][3][3],
+		int *triList,
+		int numList,
+		VoxelPairList *pairs);
+
+void computeFacetData(Polygon *vPtr,
+		int numtriangles,
+		float triSurface[][3][3],
+		float haptic_wrt_implant[]);
+
+int addVoxelPair(VoxelPairList *pairs, int voxel, int triangle);
+
+int buildVoxelLists(Polygon *vPtr, VoxelPairList *pairs);
+
 void computeFacetBounds(float triangle[3][3],
 		float minBounds[3],
 		float maxBounds[3]);
@@ -128,24 +231,33 @@ void projectOnTriangleEdge(float *c,
 		float *p, float *q,
 		float *cproj);
 
-int get_num_of_voxels(
-		int numtriangles,
-		int numvertices,
-		int *triIndex,
-		float scaleFactor,
-		float *vertex,
-		float resolution);
-void ComputeVoxelMap (int x,int y, int z,Polygon *vPtr, int maxTrianglePerVoxel);
+void ComputeVoxelMap (int x,int y, int z,Polygon *vPtr);
 int ClosestPointOnTriangle(float *p, float *a, float *b, float *c, float *ip);
-void GenerateVoxelMap(Polygon *vPtr, int maxTrianglePerVoxel);
-int CheckDuplicateVox (Point *voxelList, int nVoxels, int x, int y, int z);
+int GenerateVoxelMap(Polygon *vPtr);
+void FloodOutsideVoxels(Polygon *vPtr, int *queue, int queueLength);
+void InitSatTriangle(SatTriangle *tri, float *a, float *b, float *c);
+int TriangleBoxOverlap(SatTriangle *tri, float *boxCenter, float boxHalfSize);
+int fillLegacyVoxelData(Polygon *vPtr, int maxTriPerVox,
+        unsigned short *voxels);
+uint64_t computeVoxelCacheKey(int numtriangles, int numvertices,
+        int *triIndex, int maxTriPerVox, float scaleFactor,
+        float *vertex, float resolution);
+int readVoxelCache(const char *cacheFile, VoxelCacheHeader *expected,
+        mxArray *plhs[]);
+void writeVoxelCache(const char *cacheFile, VoxelCacheHeader *header,
+        mxArray *plhs[]);
 /*
  *------------------------------------------------------------------------
  *  mexFunction
  *
  *
  * Description:
- *
+ *     Voxelize the mesh and return the voxel data in either the compact
+ *     layout (maxTriPerVox 0) or the legacy fixed stride layout
+ *     (maxTriPerVox > 0, MAX_TRI_PER_VOX when omitted).  See mod2polygon.m for the layouts.
+ *     With a previous result and a list of changed triangles only those
+ *     triangles are voxelized again.  A seventh output returns the
+ *     coarse levels of the voxel pyramid.
  *
  * Results:
  *
@@ -166,35 +278,45 @@ void mexFunction(int nlhs, mxArray *plhs[],
     float *vertex;
     float resolution;
      
-    unsigned char *voxelDataOut;
-    unsigned char *facetDataOut;
-    double *vsizeDataOut;
-    double *hwiDataOut;
-    unsigned char *voxelMapOut;
-	int dims[2];
-    
+    Polygon polygon;
+    float haptic_wrt_implant[3];
     
+    int i;
+    int status;
     int lengthName;
     int nvoxels;
     int maxTriPerVox;
-    
-    lengthName=(int)mxGetN(prhs[0])+1;
-    
-    volName=(char*)mxCalloc(lengthName,sizeof(char));
+    const mxArray *prevVoxelData = NULL, *prevVoxelMap = NULL;
+    const mxArray *prevVsize = NULL, *prevHwi = NULL;
+    int *changed;
+    int numChanged;
+    int maxOccupancy;
+    int overflowVoxels;
+    char errorMsg[256];
+    char cacheDir[MAX_CACHE_NAME_LEN];
+    char cacheFile[MAX_CACHE_NAME_LEN];
+    int useCache = FALSE;
+    VoxelCacheHeader cacheHeader;
     
     /*get the input arguments */
 	/*check for proper number of input and output arguments */
     if(nrhs == 7){
-		/* default the maxTriPerVox */
+		/* default the maxTriPerVox, legacy layout */
 		maxTriPerVox = MAX_TRI_PER_VOX;
     }
-	else if (nrhs == 8) {
+	else if (nrhs == 8 || nrhs == 9 || nrhs == 10) {
 		maxTriPerVox = (int)mxGetScalar(prhs[7]);
 	}
 	else {
         mexErrMsgTxt("Invalid number of arguments for mex function <mod2polygon>");
+        return;
 	}
+    if (maxTriPerVox < 0) {
+        mexErrMsgTxt("maxTriPerVox must be 0 (compact layout) or positive");
+    }
 
+    lengthName=(int)mxGetN(prhs[0])+1;
+    volName=(char*)mxCalloc(lengthName,sizeof(char));
 
     mxGetString(prhs[0],volName,lengthName);
     numtriangles=(int)mxGetScalar(prhs[1]);
@@ -204,103 +326,193 @@ void mexFunction(int nlhs, mxArray *plhs[],
     vertex=(float *)mxGetPr(prhs[5]);
     resolution=(float)mxGetScalar(prhs[6]);
     
-    /*get number of voxels */
-    nvoxels= get_num_of_voxels(
-			numtriangles,
-			numvertices,
-			triIndex,
-			scaleFactor,
-			vertex,
-			resolution);
+    /* the legacy layout stores triangle ids as unsigned short */
+    if (maxTriPerVox > 0 && numtriangles > MAX_LEGACY_TRIANGLES) {
+        sprintf(errorMsg, "mod2polygon: %d triangles cannot be indexed by "
+                "the legacy layout (max %d), use the compact layout",
+                numtriangles, MAX_LEGACY_TRIANGLES);
+        mexErrMsgTxt(errorMsg);
+    }
     
-	dims[0]=1;
-	dims[1]=nvoxels*(maxTriPerVox+1)*sizeof(unsigned short);    
-	plhs[0]=mxCreateNumericArray(2, dims,mxUINT8_CLASS, mxREAL);
+    /* incremental update of a previous result */
+    if (nrhs == 10) {
+        if (maxTriPerVox != 0)
+            mexErrMsgTxt("mod2polygon: incremental updates need the compact layout (maxTriPerVox 0)");
+        if (!mxIsStruct(prhs[8])
+                || (prevVoxelData = mxGetField(prhs[8], 0, "voxelData")) == NULL
+                || (prevVoxelMap = mxGetField(prhs[8], 0, "voxelMap")) == NULL
+                || (prevVsize = mxGetField(prhs[8], 0, "vsizeData")) == NULL
+                || (prevHwi = mxGetField(prhs[8], 0, "hwiData")) == NULL
+                || mxGetClassID(prevVoxelData) != mxUINT8_CLASS
+                || mxGetClassID(prevVoxelMap) != mxUINT8_CLASS
+                || !mxIsDouble(prevVsize) || mxGetNumberOfElements(prevVsize) != 3
+                || !mxIsDouble(prevHwi) || mxGetNumberOfElements(prevHwi) != 3)
+            mexErrMsgTxt("mod2polygon: previous result must be a struct with "
+                    "uint8 voxelData, voxelMap and double vsizeData, hwiData");
+        nvoxels = (int)(mxGetPr(prevVsize)[0] * mxGetPr(prevVsize)[1]
+                * mxGetPr(prevVsize)[2]);
+        if ((int)mxGetNumberOfElements(prevVoxelMap) != nvoxels
+                || mxGetNumberOfElements(prevVoxelData)
+                    < (nvoxels + 1) * sizeof(unsigned int)
+                || mxGetNumberOfElements(prevVoxelData) != (nvoxels + 1
+                    + ((unsigned int *)mxGetData(prevVoxelData))[nvoxels])
+                    * sizeof(unsigned int))
+            mexErrMsgTxt("mod2polygon: previous voxelData is not a compact layout of the previous grid");
+        if (!mxIsInt32(prhs[9]) && !mxIsDouble(prhs[9]))
+            mexErrMsgTxt("mod2polygon: changed triangles must be int32 or double");
 
-	dims[1]=numtriangles*12*sizeof(float);
-	plhs[1]=mxCreateNumericArray(2, dims,mxUINT8_CLASS, mxREAL);
-	
-    dims[1]=3;
-	plhs[2]=mxCreateNumericArray(2, dims,mxDOUBLE_CLASS, mxREAL);
-	plhs[3]=mxCreateNumericArray(2, dims,mxDOUBLE_CLASS, mxREAL);   
+        /* zero based ids, same as ifacets */
+        numChanged = (int)mxGetNumberOfElements(prhs[9]);
+        changed = (int *)mxCalloc(numChanged > 0 ? numChanged : 1, sizeof(int));
+        for (i = 0; i < numChanged; i++) {
+            changed[i] = mxIsInt32(prhs[9]) ? ((int *)mxGetData(prhs[9]))[i]
+                : (int)mxGetPr(prhs[9])[i];
+            if (changed[i] < 0 || changed[i] >= numtriangles)
+                mexErrMsgTxt("mod2polygon: changed triangle index out of range");
+        }
+
+        status = updatePolygon(volName, numtriangles, numvertices, triIndex,
+                scaleFactor, vertex, resolution,
+                (unsigned int *)mxGetData(prevVoxelData),
+                (unsigned char *)mxGetData(prevVoxelMap),
+                mxGetPr(prevVsize), mxGetPr(prevHwi),
+                changed, numChanged, &polygon, haptic_wrt_implant);
+        mxFree(changed);
+
+        /* the grid moved or grew, only a full voxelization will do */
+        if (status == GRID_CHANGED)
+            status = model2Polygon (volName, numtriangles, numvertices,
+                    triIndex, scaleFactor, vertex, resolution,
+                    &polygon, haptic_wrt_implant);
+        if (status != 1)
+            mexErrMsgTxt("mod2polygon: unable to allocate memory for the voxel data");
+
+        maxOccupancy = polygon.maxOccupancy;
+        createPolygonOutputs(&polygon, 0, haptic_wrt_implant, plhs);
+        freePolygon(&polygon);
+        mxFree(volName);
+        if (nlhs > 5) {
+            plhs[5] = mxCreateDoubleScalar((double)maxOccupancy);
+        }
+        if (nlhs > 6) {
+            plhs[6] = createPyramidOutput(plhs[0], plhs[2], 0);
+        }
+        return;
+    }
     
-    dims[1]=nvoxels;
-    plhs[4]=mxCreateNumericArray(2, dims, mxUINT8_CLASS, mxREAL);
+    /* optional cache directory, an empty string disables the cache */
+    if (nrhs == 9 && !mxIsEmpty(prhs[8])) {
+        if (!mxIsChar(prhs[8])
+                || mxGetString(prhs[8], cacheDir, MAX_CACHE_NAME_LEN - 32)) {
+            mexErrMsgTxt("Cache directory must be a string shorter than 990 chars");
+        }
+        memset(&cacheHeader, 0, sizeof(cacheHeader));
+        memcpy(cacheHeader.magic, VOXEL_CACHE_MAGIC, sizeof(cacheHeader.magic));
+        cacheHeader.version = VOXEL_CACHE_VERSION;
+        cacheHeader.headerSize = sizeof(VoxelCacheHeader);
+        cacheHeader.numtriangles = numtriangles;
+        cacheHeader.numvertices = numvertices;
+        cacheHeader.maxTriPerVox = maxTriPerVox;
+        cacheHeader.scaleFactor = scaleFactor;
+        cacheHeader.resolution = resolution;
+        cacheHeader.key = computeVoxelCacheKey(numtriangles, numvertices,
+                triIndex, maxTriPerVox, scaleFactor, vertex, resolution);
+        /* a name that does not fit disables the cache */
+        status = snprintf(cacheFile, sizeof(cacheFile), "%s/%08x%08x%s",
+                cacheDir, (unsigned int)(cacheHeader.key >> 32),
+                (unsigned int)(cacheHeader.key & 0xffffffff),
+                VOXEL_CACHE_EXT);
+        useCache = (status >= 0) && (status < (int)sizeof(cacheFile));
+    }
     
-    voxelDataOut=(unsigned char*)mxGetPr(plhs[0]);
-    facetDataOut=(unsigned char*)mxGetPr(plhs[1]);
-    vsizeDataOut=mxGetPr(plhs[2]);
-    hwiDataOut=mxGetPr(plhs[3]);
-    voxelMapOut=(unsigned char *)mxGetPr(plhs[4]);
-   
-    model2Polygon (
-			volName,
-			numtriangles,
-			numvertices,
-			triIndex,
-			maxTriPerVox,
-			scaleFactor,
-			vertex,
-			resolution,
-			voxelDataOut,
-			facetDataOut,
-			vsizeDataOut,
-			hwiDataOut,
-            voxelMapOut);  
+    if (useCache && readVoxelCache(cacheFile, &cacheHeader, plhs)) {
+        maxOccupancy = cacheHeader.maxOccupancy;
+        overflowVoxels = cacheHeader.overflowVoxels;
+    }
+    else {
+        if (model2Polygon (
+                    volName,
+                    numtriangles,
+                    numvertices,
+                    triIndex,
+                    scaleFactor,
+                    vertex,
+                    resolution,
+                    &polygon,
+                    haptic_wrt_implant) != 1) {
+            mexErrMsgTxt("mod2polygon: unable to allocate memory for the voxel data");
+        }
+        nvoxels = polygon.xDim * polygon.yDim * polygon.zDim;
+        maxOccupancy = polygon.maxOccupancy;
+        overflowVoxels = createPolygonOutputs(&polygon, maxTriPerVox,
+                haptic_wrt_implant, plhs);
+        freePolygon(&polygon);
+
+        if (useCache) {
+            cacheHeader.nvoxels = nvoxels;
+            cacheHeader.maxOccupancy = maxOccupancy;
+            cacheHeader.overflowVoxels = overflowVoxels;
+            writeVoxelCache(cacheFile, &cacheHeader, plhs);
+        }
+    }
+    mxFree(volName);
+
+    /* never hand out a truncated legacy layout */
+    if (overflowVoxels > 0) {
+        sprintf(errorMsg, "mod2polygon: %d voxels hold more than %d "
+                "triangles (max %d), increase maxTriPerVox or use the "
+                "compact layout", overflowVoxels, maxTriPerVox, maxOccupancy);
+        mexErrMsgTxt(errorMsg);
+    }
+    if (nlhs > 5) {
+        plhs[5] = mxCreateDoubleScalar((double)maxOccupancy);
+    }
+    if (nlhs > 6) {
+        plhs[6] = createPyramidOutput(plhs[0], plhs[2], maxTriPerVox);
+    }
 }
 
 /*
  *------------------------------------------------------------------------
- *  Model2Polygon
+ *  setupPolygon
  *
  *
  * Description:
- *
+ *     Map the mesh into voxel coordinates, size the voxel grid and
+ *     allocate the voxel map and facet data of vPtr.
  *
  * Results:
- *
+ *     1 on success, -1 if memory could not be allocated
  *
  * Side effects:
- *     None
+ *     On success vPtr owns memory that must be released with
+ *     freePolygon and *triSurfaceOut must be freed by the caller
  *
  *------------------------------------------------------------------------
  */
 
-int model2Polygon (
+int setupPolygon (
 		char *volName,
 		int numtriangles,
 		int numvertices,
 		int *triIndex,
-		int maxTrianglePerVoxel,
 		float scaleFactor,
 		float *vertex,
 		float resolution,
-		unsigned char *voxelDataOut,
-		unsigned char *facetDataOut,
-		double *vsizeDataOut,
-		double *hwiDataOut,
-        unsigned char *voxelMapOut)
+		Polygon *vPtr,
+		float haptic_wrt_implant[],
+		float **triSurfaceOut)
 {
-    Polygon *vPtr;
     float *triSurface;
     
     int i, j, idx;
     int xDim, yDim, zDim, nvoxels;
     
     float maxBounds[3], minBounds[3];
-    unsigned short voxel_size[3];
-    float haptic_wrt_implant[3];
-    
-    unsigned short *voxels;
-    float *facets;
     
+    memset(vPtr, 0, sizeof(Polygon));
     
-    if ((vPtr = (Polygon *) malloc (sizeof (Polygon))) == NULL) {
-        perror ("Can't alloc memory for polygon structure");
-        return -1;
-    }
-    
-    if ((triSurface = (float *) malloc (numvertices*3*sizeof (float))) == NULL) {
+    if ((triSurface = (float *) malloc (numtriangles*9*sizeof (float))) == NULL) {
         perror ("Can't alloc memory for triangle array");
         return -1;
     }
@@ -343,14 +555,10 @@ int model2Polygon (
     yDim = (int)ceil(maxBounds[1]) - (int)floor(minBounds[1]);
     zDim = (int)ceil(maxBounds[2]) - (int)floor(minBounds[2]);
     
-    voxel_size[0]=(unsigned short)xDim;
-    voxel_size[1]=(unsigned short)yDim;
-    voxel_size[2]=(unsigned short)zDim;
-    
     nvoxels = xDim * yDim * zDim;
     
     vPtr->volName = (char *) malloc (strlen (volName) + 1);
-    memcpy (vPtr->volName, volName,strlen(volName));
+    strcpy (vPtr->volName, volName);
     vPtr->scale = scaleFactor;
     vPtr->xDim = xDim;
     vPtr->yDim = yDim;
@@ -360,70 +568,556 @@ int model2Polygon (
     vPtr->zRes = resolution;
     vPtr->numtriangles=numtriangles;
     
-    /* each voxel has maxTrianglePerVoxel + 1 elements */
-    vPtr->voxelPtr = (unsigned short *) malloc (
-			nvoxels * (maxTrianglePerVoxel+1) *
-			sizeof (unsigned short));
-    memset (vPtr->voxelPtr, 0,
-			nvoxels * (maxTrianglePerVoxel+1) *
-			sizeof(unsigned short));
     /* memory for voxel map */
-    vPtr->voxelMap = (unsigned char *) malloc (nvoxels *sizeof(unsigned char));
-    memset (vPtr->voxelMap, 0, nvoxels * sizeof(unsigned char));
+    vPtr->voxelMap = (unsigned char *) calloc (nvoxels, sizeof(unsigned char));
     
+  /* each facet has 12 elements, 3 for normal and 9 for three vertices */
+    vPtr->facetPtr = (float *)calloc(numtriangles * 12, sizeof(float));
     
-  /* intialize the memory for voxel data map */
-    for (i=0;i<nvoxels*(maxTrianglePerVoxel+1);i++) {
-        vPtr->voxelPtr[i] = 0;
+    if (vPtr->volName == NULL || vPtr->voxelMap == NULL
+            || vPtr->facetPtr == NULL) {
+        perror ("Can't alloc memory for polygon data");
+        freePolygon(vPtr);
+        free (triSurface);
+        return -1;
     }
     
-  /* each facet has 12 elements, 3 for normal and 9 for three vertices */
-    vPtr->facetPtr = (float *)malloc(numtriangles * 12 * sizeof(float));
-    memset (vPtr->facetPtr, 0, numtriangles * 12 * sizeof(float));
-    
   /* this variable is not used, but need to be deleted later */
     vPtr->orientValid = 1;;
+ 
+    *triSurfaceOut = triSurface;
+    return 1;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *  Model2Polygon
+ *
+ *
+ * Description:
+ *     Map the mesh into voxel coordinates and voxelize it into vPtr.
+ *
+ * Results:
+ *     1 on success, -1 if memory could not be allocated
+ *
+ * Side effects:
+ *     On success vPtr owns memory that must be released with
+ *     freePolygon
+ *
+ *------------------------------------------------------------------------
+ */
+
+int model2Polygon (
+		char *volName,
+		int numtriangles,
+		int numvertices,
+		int *triIndex,
+		float scaleFactor,
+		float *vertex,
+		float resolution,
+		Polygon *vPtr,
+		float haptic_wrt_implant[])
+{
+    float *triSurface;
+    
+    if (setupPolygon(volName, numtriangles, numvertices, triIndex,
+                scaleFactor, vertex, resolution, vPtr, haptic_wrt_implant,
+                &triSurface) != 1)
+        return -1;
+    
   /* generate polygon map */
-    generatePolygonMap(vPtr, numtriangles, maxTrianglePerVoxel,
-			(float (*)[3][3]) triSurface,
-			maxBounds, minBounds,haptic_wrt_implant);
+    if (generatePolygonMap(vPtr, numtriangles,
+			(float (*)[3][3]) triSurface, haptic_wrt_implant) != 1) {
+        freePolygon(vPtr);
+        free (triSurface);
+        return -1;
+    }
  
-    if ((voxels = (unsigned short *)malloc(
-    nvoxels * (maxTrianglePerVoxel + 1) *
-    sizeof (unsigned short)))==NULL) {
-        perror("Can't allocate voxel data");
+    free (triSurface);
+    return 1;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *  updatePolygon
+ *
+ *
+ * Description:
+ *     Incremental version of model2Polygon.  The voxel lists of the
+ *     previous result (compact layout) are reused, only the changed
+ *     triangles are voxelized again and merged back in triangle order,
+ *     so the result is the same as a full voxelization.  The outside
+ *     map is only flooded from the voxels that became empty, it is
+ *     recomputed from scratch only when a triangle moved into a voxel
+ *     that was outside.
+ *
+ * Results:
+ *     1 on success, -1 if memory could not be allocated, GRID_CHANGED
+ *     if the mesh no longer fits the previous grid (vPtr is left empty)
+ *
+ * Side effects:
+ *     On success vPtr owns memory that must be released with
+ *     freePolygon
+ *
+ *------------------------------------------------------------------------
+ */
+int updatePolygon (
+		char *volName,
+		int numtriangles,
+		int numvertices,
+		int *triIndex,
+		float scaleFactor,
+		float *vertex,
+		float resolution,
+		unsigned int *prevVoxelData,
+		unsigned char *prevVoxelMap,
+		double *prevVsize,
+		double *prevHwi,
+		int *changed,
+		int numChanged,
+		Polygon *vPtr,
+		float haptic_wrt_implant[])
+{
+    float *triSurface;
+    Polygon added;
+    VoxelPairList pairs;
+    unsigned char *isChanged;
+    int *changedList, *queue;
+    unsigned int *prevStart, *prevTri, *newTri;
+    int i, j, k, v, it, nvoxels, numChangedList, count, queueLength;
+    int ix, iy, iz, nx, ny, nz;
+    int wasEmpty, isEmpty, fullMap;
+    double hwi;
+    
+    if (setupPolygon(volName, numtriangles, numvertices, triIndex,
+                scaleFactor, vertex, resolution, vPtr, haptic_wrt_implant,
+                &triSurface) != 1)
+        return -1;
+    
+  /* the voxel coordinates of the unchanged triangles are only valid if */
+  /* the grid origin and size did not change */
+    for (i = 0; i < 3; i++) {
+        hwi = (double)(haptic_wrt_implant[i])*MM2M;
+        if (hwi != prevHwi[i]) {
+            freePolygon(vPtr);
+            free(triSurface);
+            return GRID_CHANGED;
+        }
+    }
+    if ((double)vPtr->xDim != prevVsize[0] || (double)vPtr->yDim != prevVsize[1]
+            || (double)vPtr->zDim != prevVsize[2]) {
+        freePolygon(vPtr);
+        free(triSurface);
+        return GRID_CHANGED;
+    }
+    nvoxels = vPtr->xDim * vPtr->yDim * vPtr->zDim;
+    prevStart = prevVoxelData;
+    prevTri = prevVoxelData + nvoxels + 1;
+    
+    memset(&pairs, 0, sizeof(pairs));
+    memset(&added, 0, sizeof(added));
+    isChanged = (unsigned char *) calloc(numtriangles > 0 ? numtriangles : 1,
+            sizeof(unsigned char));
+    changedList = (int *) malloc((numChanged > 0 ? numChanged : 1) * sizeof(int));
+    queue = (int *) malloc(nvoxels * sizeof(int));
+    vPtr->voxelStart = (unsigned int *) calloc(nvoxels + 1, sizeof(unsigned int));
+    if (isChanged == NULL || changedList == NULL || queue == NULL
+            || vPtr->voxelStart == NULL) {
+        perror ("Can't alloc memory for voxel update");
+        free(isChanged);
+        free(changedList);
+        free(queue);
+        freePolygon(vPtr);
+        free(triSurface);
         return -1;
     }
-    for (i=0;i<nvoxels*(maxTrianglePerVoxel+1);i++) {
-        voxels[i] = (unsigned short)(vPtr->voxelPtr[i]);
+    
+  /* sorted list of the changed triangles without duplicates */
+    for (i = 0; i < numChanged; i++)
+        isChanged[changed[i]] = 1;
+    numChangedList = 0;
+    for (it = 0; it < numtriangles; it++)
+        if (isChanged[it])
+            changedList[numChangedList++] = it;
+    
+  /* voxelize the changed triangles only */
+    added.xDim = vPtr->xDim;
+    added.yDim = vPtr->yDim;
+    added.zDim = vPtr->zDim;
+    if (voxelizeTriangles(vPtr, (float (*)[3][3]) triSurface, changedList,
+                numChangedList, &pairs) != 1
+            || buildVoxelLists(&added, &pairs) != 1) {
+        free(pairs.voxel);
+        free(pairs.triangle);
+        free(added.voxelStart);
+        free(added.voxelTri);
+        free(isChanged);
+        free(changedList);
+        free(queue);
+        freePolygon(vPtr);
+        free(triSurface);
+        return -1;
     }
-    if ((facets =
-    (float *)malloc( numtriangles * 12* sizeof (float)))==NULL) {
-        perror ("Can't allocate facet data");
+    free(pairs.voxel);
+    free(pairs.triangle);
+    
+  /* size the merged lists: kept previous entries plus the new ones */
+    for (v = 0; v < nvoxels; v++) {
+        count = (int)(added.voxelStart[v + 1] - added.voxelStart[v]);
+        for (k = (int)prevStart[v]; k < (int)prevStart[v + 1]; k++) {
+            if ((int)prevTri[k] >= numtriangles)
+                break;
+            if (!isChanged[prevTri[k]])
+                count++;
+        }
+        if (k < (int)prevStart[v + 1])
+            break;
+        vPtr->voxelStart[v + 1] = vPtr->voxelStart[v] + count;
+    }
+    
+  /* the previous result belongs to a mesh with more triangles */
+    if (v < nvoxels) {
+        free(added.voxelStart);
+        free(added.voxelTri);
+        free(isChanged);
+        free(changedList);
+        free(queue);
+        freePolygon(vPtr);
+        free(triSurface);
+        return GRID_CHANGED;
+    }
+    newTri = (unsigned int *) malloc((vPtr->voxelStart[nvoxels] > 0 ?
+                vPtr->voxelStart[nvoxels] : 1) * sizeof(unsigned int));
+    if (newTri == NULL) {
+        perror ("Can't alloc memory for voxel update");
+        free(added.voxelStart);
+        free(added.voxelTri);
+        free(isChanged);
+        free(changedList);
+        free(queue);
+        freePolygon(vPtr);
+        free(triSurface);
         return -1;
     }
-    for (i=0;i<numtriangles*12;i++) {
-        facets[i] = (float)(vPtr->facetPtr[i]);
+    vPtr->voxelTri = newTri;
+    
+  /* merge both sorted lists of every voxel */
+    vPtr->maxOccupancy = 0;
+    for (v = 0; v < nvoxels; v++) {
+        j = (int)vPtr->voxelStart[v];
+        k = (int)prevStart[v];
+        i = (int)added.voxelStart[v];
+        while (k < (int)prevStart[v + 1] || i < (int)added.voxelStart[v + 1]) {
+            if (k < (int)prevStart[v + 1] && isChanged[prevTri[k]]) {
+                k++;
+            }
+            else if (i >= (int)added.voxelStart[v + 1]
+                    || (k < (int)prevStart[v + 1]
+                        && prevTri[k] < added.voxelTri[i])) {
+                newTri[j++] = prevTri[k++];
+            }
+            else {
+                newTri[j++] = added.voxelTri[i++];
+            }
+        }
+        count = (int)(vPtr->voxelStart[v + 1] - vPtr->voxelStart[v]);
+        if (count > vPtr->maxOccupancy)
+            vPtr->maxOccupancy = count;
+    }
+    
+  /* update the outside map.  A voxel that became occupied while it was */
+  /* outside may split the outside region, only a full flood handles it */
+    memcpy(vPtr->voxelMap, prevVoxelMap, nvoxels * sizeof(unsigned char));
+    fullMap = FALSE;
+    for (v = 0; v < nvoxels && !fullMap; v++) {
+        wasEmpty = (prevStart[v + 1] == prevStart[v]);
+        isEmpty = (vPtr->voxelStart[v + 1] == vPtr->voxelStart[v]);
+        if (wasEmpty && !isEmpty && prevVoxelMap[v])
+            fullMap = TRUE;
     }
-    memcpy(voxelDataOut,voxels,nvoxels*(maxTrianglePerVoxel+1)*sizeof(unsigned short));
-    memcpy(facetDataOut,facets,numtriangles*12*sizeof(float));    
-    memcpy(voxelMapOut,vPtr->voxelMap, nvoxels * sizeof(char));   
     
-    for(i=0;i<3;i++)
-    {
-        vsizeDataOut[i]=(double)(voxel_size[i]);
-        hwiDataOut[i]=(double)(haptic_wrt_implant[i])*MM2M;
-    }    
+    if (fullMap) {
+        if (GenerateVoxelMap(vPtr) != 1) {
+            free(added.voxelStart);
+            free(added.voxelTri);
+            free(isChanged);
+            free(changedList);
+            free(queue);
+            freePolygon(vPtr);
+            free(triSurface);
+            return -1;
+        }
+    }
+    else {
+    /* voxels that became empty next to the outside join the outside */
+        queueLength = 0;
+        for (v = 0; v < nvoxels; v++) {
+            wasEmpty = (prevStart[v + 1] == prevStart[v]);
+            isEmpty = (vPtr->voxelStart[v + 1] == vPtr->voxelStart[v]);
+            if (wasEmpty || !isEmpty)
+                continue;
+            ix = v % vPtr->xDim;
+            iy = (v / vPtr->xDim) % vPtr->yDim;
+            iz = v / (vPtr->xDim * vPtr->yDim);
+            for (k = 0; k < 6; k++) {
+                nx = x_6n(k, ix);
+                ny = y_6n(k, iy);
+                nz = z_6n(k, iz);
+                if (nx >=0 && nx < vPtr->xDim && ny >=0 && ny < vPtr->yDim
+                        && nz >=0 && nz < vPtr->zDim
+                        && vPtr->voxelMap[nx + ny * vPtr->xDim
+                            + nz * vPtr->xDim * vPtr->yDim]) {
+                    vPtr->voxelMap[v] = 1;
+                    queue[queueLength++] = v;
+                    break;
+                }
+            }
+        }
+        FloodOutsideVoxels(vPtr, queue, queueLength);
+    }
     
+    computeFacetData(vPtr, numtriangles, (float (*)[3][3]) triSurface,
+            haptic_wrt_implant);
+    
+    free(added.voxelStart);
+    free(added.voxelTri);
+    free(isChanged);
+    free(changedList);
+    free(queue);
+    free(triSurface);
+    return 1;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *  createPolygonOutputs
+ *
+ *
+ * Description:
+ *     Create the voxel data, facet data, grid size, haptic origin and
+ *     voxel map outputs of the mex function from vPtr.
+ *
+ * Results:
+ *     number of voxels truncated in the legacy layout
+ *
+ * Side effects:
+ *     None
+ *
+ *------------------------------------------------------------------------
+ */
+int createPolygonOutputs(Polygon *vPtr, int maxTriPerVox,
+        float haptic_wrt_implant[], mxArray *plhs[])
+{
+    int i, nvoxels, overflowVoxels = 0;
+    int dims[2];
+    unsigned int *compactData;
+
+    nvoxels = vPtr->xDim * vPtr->yDim * vPtr->zDim;
+
+    dims[0]=1;
+    if (maxTriPerVox > 0) {
+        dims[1]=nvoxels*(maxTriPerVox+1)*sizeof(unsigned short);
+        plhs[0]=mxCreateNumericArray(2, dims,mxUINT8_CLASS, mxREAL);
+        overflowVoxels = fillLegacyVoxelData(vPtr, maxTriPerVox,
+                (unsigned short *)mxGetData(plhs[0]));
+    }
+    else {
+        dims[1]=(nvoxels + 1 + vPtr->voxelStart[nvoxels])
+            * sizeof(unsigned int);
+        plhs[0]=mxCreateNumericArray(2, dims,mxUINT8_CLASS, mxREAL);
+        compactData = (unsigned int *)mxGetData(plhs[0]);
+        memcpy(compactData, vPtr->voxelStart,
+                (nvoxels + 1) * sizeof(unsigned int));
+        memcpy(compactData + nvoxels + 1, vPtr->voxelTri,
+                vPtr->voxelStart[nvoxels] * sizeof(unsigned int));
+    }
+
+    dims[1]=vPtr->numtriangles*12*sizeof(float);
+    plhs[1]=mxCreateNumericArray(2, dims,mxUINT8_CLASS, mxREAL);
+    memcpy(mxGetData(plhs[1]), vPtr->facetPtr,
+            vPtr->numtriangles * 12 * sizeof(float));
+
+    dims[1]=3;
+    plhs[2]=mxCreateNumericArray(2, dims,mxDOUBLE_CLASS, mxREAL);
+    plhs[3]=mxCreateNumericArray(2, dims,mxDOUBLE_CLASS, mxREAL);
+    mxGetPr(plhs[2])[0]=(double)(unsigned short)vPtr->xDim;
+    mxGetPr(plhs[2])[1]=(double)(unsigned short)vPtr->yDim;
+    mxGetPr(plhs[2])[2]=(double)(unsigned short)vPtr->zDim;
+    for(i=0;i<3;i++)
+        mxGetPr(plhs[3])[i]=(double)(haptic_wrt_implant[i])*MM2M;
+
+    dims[1]=nvoxels;
+    plhs[4]=mxCreateNumericArray(2, dims, mxUINT8_CLASS, mxREAL);
+    memcpy(mxGetData(plhs[4]), vPtr->voxelMap,
+            nvoxels * sizeof(unsigned char));
+
+    return overflowVoxels;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *  createPyramidOutput
+ *
+ *
+ * Description:
+ *     Build the coarse levels of the voxel pyramid from the voxel data
+ *     output (compact or legacy layout).  Each level halves the grid of
+ *     the level below it, a cell covers 2x2x2 cells of the next finer
+ *     level and the finest coarse level covers the voxels.  A cell is
+ *     occupied if any voxel below it holds a triangle.  For every cell
+ *     the linear indices of its occupied children are stored in the
+ *     compact layout of the voxel data (ncells+1 uint32 offsets followed
+ *     by the uint32 child indices), so a query can skip empty regions
+ *     and descend only into occupied blocks.
+ *
+ * Results:
+ *     1xL struct array, coarsest level first, with the fields cellSize
+ *     (edge of a cell in voxels), vsizeData and cellData.  L is 0 if the
+ *     grid is already small enough.
+ *
+ * Side effects:
+ *     None
+ *
+ *------------------------------------------------------------------------
+ */
+mxArray *createPyramidOutput(const mxArray *voxelData,
+        const mxArray *vsizeData, int maxTriPerVox)
+{
+    const char *fieldNames[] = {"cellSize", "vsizeData", "cellData"};
+    mxArray *pyramid, *cellData, *cellDims;
+    unsigned char *childOcc, *parentOcc;
+    unsigned int *cellStart, *cursor, *childList, *voxelStart;
+    unsigned short *legacyData;
+    int childDims[3], cellDim[3], levelDims[MAX_PYRAMID_LEVELS][3];
+    int dims[2];
+    int i, level, numLevels, nchildren, ncells, parent, ix, iy, iz;
+
+    for (i = 0; i < 3; i++)
+        childDims[i] = (int)mxGetPr(vsizeData)[i];
+    nchildren = childDims[0] * childDims[1] * childDims[2];
+
+  /* size of every level, finest coarse level last */
+    numLevels = 0;
+    for (i = 0; i < 3; i++)
+        cellDim[i] = childDims[i];
+    while (numLevels < MAX_PYRAMID_LEVELS
+            && (cellDim[0] > PYRAMID_MIN_DIM || cellDim[1] > PYRAMID_MIN_DIM
+                || cellDim[2] > PYRAMID_MIN_DIM)) {
+        for (i = 0; i < 3; i++)
+            cellDim[i] = (cellDim[i] + 1) / 2;
+        numLevels++;
+    }
+    pyramid = mxCreateStructMatrix(1, numLevels, 3, fieldNames);
+    if (numLevels == 0)
+        return pyramid;
+    for (i = 0; i < 3; i++)
+        levelDims[numLevels - 1][i] = (childDims[i] + 1) / 2;
+    for (level = numLevels - 2; level >= 0; level--)
+        for (i = 0; i < 3; i++)
+            levelDims[level][i] = (levelDims[level + 1][i] + 1) / 2;
+
+  /* occupancy of the voxels */
+    childOcc = (unsigned char *)mxCalloc(nchildren, sizeof(unsigned char));
+    if (maxTriPerVox > 0) {
+        legacyData = (unsigned short *)mxGetData(voxelData);
+        for (i = 0; i < nchildren; i++)
+            childOcc[i] = (legacyData[i * (maxTriPerVox + 1)] > 0);
+    }
+    else {
+        voxelStart = (unsigned int *)mxGetData(voxelData);
+        for (i = 0; i < nchildren; i++)
+            childOcc[i] = (voxelStart[i + 1] > voxelStart[i]);
+    }
+
+  /* build the levels bottom up, the children are visited in linear */
+  /* order so the child list of every cell is sorted */
+    for (level = numLevels - 1; level >= 0; level--) {
+        ncells = levelDims[level][0] * levelDims[level][1]
+            * levelDims[level][2];
+        cellStart = (unsigned int *)mxCalloc(ncells + 1, sizeof(unsigned int));
+        cursor = (unsigned int *)mxCalloc(ncells, sizeof(unsigned int));
+        parentOcc = (unsigned char *)mxCalloc(ncells, sizeof(unsigned char));
+
+        for (iz = 0; iz < childDims[2]; iz++)
+            for (iy = 0; iy < childDims[1]; iy++)
+                for (ix = 0; ix < childDims[0]; ix++)
+                    if (childOcc[ix + (iy + iz * childDims[1]) * childDims[0]]) {
+                        parent = ix / 2 + (iy / 2 + (iz / 2)
+                                * levelDims[level][1]) * levelDims[level][0];
+                        cellStart[parent + 1]++;
+                        parentOcc[parent] = 1;
+                    }
+        for (i = 0; i < ncells; i++) {
+            cellStart[i + 1] += cellStart[i];
+            cursor[i] = cellStart[i];
+        }
+
+        dims[0] = 1;
+        dims[1] = (ncells + 1 + cellStart[ncells]) * sizeof(unsigned int);
+        cellData = mxCreateNumericArray(2, dims, mxUINT8_CLASS, mxREAL);
+        memcpy(mxGetData(cellData), cellStart,
+                (ncells + 1) * sizeof(unsigned int));
+        childList = (unsigned int *)mxGetData(cellData) + ncells + 1;
+        for (iz = 0; iz < childDims[2]; iz++)
+            for (iy = 0; iy < childDims[1]; iy++)
+                for (ix = 0; ix < childDims[0]; ix++) {
+                    i = ix + (iy + iz * childDims[1]) * childDims[0];
+                    if (childOcc[i]) {
+                        parent = ix / 2 + (iy / 2 + (iz / 2)
+                                * levelDims[level][1]) * levelDims[level][0];
+                        childList[cursor[parent]++] = (unsigned int)i;
+                    }
+                }
+
+        dims[1] = 3;
+        cellDims = mxCreateNumericArray(2, dims, mxDOUBLE_CLASS, mxREAL);
+        for (i = 0; i < 3; i++)
+            mxGetPr(cellDims)[i] = (double)levelDims[level][i];
+        mxSetField(pyramid, level, "cellSize",
+                mxCreateDoubleScalar((double)(1 << (numLevels - level))));
+        mxSetField(pyramid, level, "vsizeData", cellDims);
+        mxSetField(pyramid, level, "cellData", cellData);
+
+        mxFree(cellStart);
+        mxFree(cursor);
+        mxFree(childOcc);
+        childOcc = parentOcc;
+        for (i = 0; i < 3; i++)
+            childDims[i] = levelDims[level][i];
+    }
+    mxFree(childOcc);
+
+    return pyramid;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *  freePolygon
+ *
+ *
+ * Description:
+ *     Release the memory owned by a polygon filled by model2Polygon.
+ *
+ * Results:
+ *     None
+ *
+ * Side effects:
+ *     None
+ *
+ *------------------------------------------------------------------------
+ */
+void freePolygon(Polygon *vPtr)
+{
     free(vPtr->volName);
-    free(vPtr->voxelPtr);
+    free(vPtr->voxelStart);
+    free(vPtr->voxelTri);
     free(vPtr->facetPtr);
     free(vPtr->voxelMap);
-    free (vPtr);
-    free (triSurface);
-    free ((void *) voxels);
-    free ((void *) facets);
-    return 1;
+    vPtr->volName = NULL;
+    vPtr->voxelStart = NULL;
+    vPtr->voxelTri = NULL;
+    vPtr->facetPtr = NULL;
+    vPtr->voxelMap = NULL;
 }
 
 
@@ -488,45 +1182,78 @@ float minBound[3])
  *
  *
  * Description:
- *
+ *     Find the voxels touched by each triangle, build the per voxel
+ *     triangle lists, the outside voxel map and the facet data.
  *
  * Results:
- *
+ *     1 on success, -1 if memory could not be allocated
  *
  * Side effects:
- *     None
+ *     triSurface is translated back into the original space
  *
  *------------------------------------------------------------------------
  */
-void generatePolygonMap(Polygon *vPtr,
+int generatePolygonMap(Polygon *vPtr,
 int numtriangles,
-int maxTrianglePerVoxel,
 float triSurface[][3][3],
-float maxBounds[],
-float minBounds[],
 float haptic_wrt_implant[])
 {
-    unsigned short *voxels = vPtr->voxelPtr;
-    float *facets = vPtr->facetPtr;
-    int i, j, it, ix, iy, iz;
+    VoxelPairList pairs;
+    
+    memset(&pairs, 0, sizeof(pairs));
+    
+    if (voxelizeTriangles(vPtr, triSurface, NULL, numtriangles, &pairs) != 1
+            || buildVoxelLists(vPtr, &pairs) != 1) {
+        free(pairs.voxel);
+        free(pairs.triangle);
+        return -1;
+    }
+    free(pairs.voxel);
+    free(pairs.triangle);
+
+    /* generate voxel map */
+    /* ComputeVoxelMap(0,0,0,vPtr); */
+    if (GenerateVoxelMap(vPtr) != 1)
+        return -1;
+
+    computeFacetData(vPtr, numtriangles, triSurface, haptic_wrt_implant);
+    return 1;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *  voxelizeTriangles
+ *
+ *
+ * Description:
+ *     Add a (voxel, triangle) pair for every voxel whose center is
+ *     within colDistance of a triangle.  triList selects the triangles
+ *     to process, NULL means triangles 0 to numList-1.
+ *
+ * Results:
+ *     1 on success, -1 if memory could not be allocated
+ *
+ * Side effects:
+ *     None
+ *
+ *------------------------------------------------------------------------
+ */
+int voxelizeTriangles(Polygon *vPtr,
+float triSurface[][3][3],
+int *triList,
+int numList,
+VoxelPairList *pairs)
+{
+    int i, j, k, it, ix, iy, iz;
     int xDim = vPtr->xDim, yDim = vPtr->yDim, zDim = vPtr->zDim;
-    float nvec[3], t1vec[3], t2vec[3],*normals;
     float triangle[3][3], minB[3], maxB[3];
-    float magVec;
-    int lBound[3],uBound[3],ip;
-    unsigned int offset;
+    int lBound[3],uBound[3];
     float scale=vPtr->scale, resolution[3];
-    float colDistance;
-    float triVert0[3], triVert1[3], triVert2[3], triNormal[3];
+    float colDistance, satHalfSize;
+    float triVert0[3], triVert1[3], triVert2[3];
+    SatTriangle satTri;
     float voxelCenter[3], intersectPos[3], intersectVec[3], intersectDistance;
-    int addFlag, num_triangles, voxel_map_size;
-    int maxTriangles, maxTriangleVoxelIndex;
-    int maxTriangleVoxelXYZ[3];
     int voxel_size[3];
-    FILE *fid;
-    
-    maxTriangles =0;
-    maxTriangleVoxelIndex=0;
     
     resolution[0]=vPtr->xRes;
     resolution[1]=vPtr->yRes;
@@ -545,40 +1272,16 @@ float haptic_wrt_implant[])
     resolution[1] * resolution[1] +
     resolution[2] * resolution[2]))/2.0;
     
-    normals = (float *) malloc(numtriangles * 3 * sizeof(float));
-    memset (normals, 0, numtriangles * 3 * sizeof(float));
-    
-    voxel_map_size = xDim * yDim * zDim * (maxTrianglePerVoxel + 1);
-    for (i = 0; i < voxel_map_size; i++) {
-        voxels[i] = 0;
-    }
+  /* any triangle closer than colDistance to the voxel center must cut */
+  /* the cube of half size colDistance around it.  This cube is used to */
+  /* reject voxels before the closest point computation */
+    satHalfSize = colDistance * (1.0f + SAT_TOLERANCE);
     
-  /* compute normal for each triangle */
-    for (it = 0; it < numtriangles; it++) {
-        t1vec[0] = triSurface[it][1][0] - triSurface[it][0][0];
-        t1vec[1] = triSurface[it][1][1] - triSurface[it][0][1];
-        t1vec[2] = triSurface[it][1][2] - triSurface[it][0][2];
-        t2vec[0] = triSurface[it][2][0] - triSurface[it][0][0];
-        t2vec[1] = triSurface[it][2][1] - triSurface[it][0][1];
-        t2vec[2] = triSurface[it][2][2] - triSurface[it][0][2];
-        nvec[0] =  t1vec[1] * t2vec[2] - t1vec[2] * t2vec[1];
-        nvec[1] =  t1vec[2] * t2vec[0] - t1vec[0] * t2vec[2];
-        nvec[2] =  t1vec[0] * t2vec[1] - t1vec[1] * t2vec[0];
-        
-        magVec = sqrt(nvec[0] * nvec[0] +
-        nvec[1] * nvec[1] +
-        nvec[2] * nvec[2]);
-        magVec = (magVec>0) ? magVec : 1.0;
-        for (i = 0; i < 3; i++)
-            normals[it * 3 + i] = nvec[i]/magVec;
-        
-        for (i = 0; i < 3; i++)
-            facets[it * 12 + i] = normals[it * 3 + i];
-    }
   /*******************************************************
    * Compute the Bounding Box for each triangle
    * *****************************************************/
-    for (it = 0; it < numtriangles; it++) {
+    for (k = 0; k < numList; k++) {
+        it = (triList != NULL) ? triList[k] : k;
     /* Select a triangle */
         for (i = 0; i < 3; i++) {
             triangle[i][0] = triSurface[it][i][0];
@@ -588,8 +1291,8 @@ float haptic_wrt_implant[])
             triVert0[i] = triSurface[it][0][i] * resolution[0] /scale;
             triVert1[i] = triSurface[it][1][i] * resolution[1] /scale;
             triVert2[i] = triSurface[it][2][i] * resolution[2] /scale;
-            triNormal[i] = normals[it * 3 + i];
         }
+        InitSatTriangle(&satTri, triVert0, triVert1, triVert2);
     /* Compute the bounding box for triangle */
         computeFacetBounds(triangle, minB, maxB);
         for (j = 0; j < 3; j++) {
@@ -617,8 +1320,12 @@ float haptic_wrt_implant[])
                     voxelCenter[0] = (float)ix * resolution[0] + resolution[0]/2.0;
                     voxelCenter[1] = (float)iy * resolution[1] + resolution[1]/2.0;
                     voxelCenter[2] = (float)iz * resolution[2] + resolution[2]/2.0;
+                    /* skip the voxels the triangle cannot reach, this */
+                    /* prunes most of the bounding box of slanted or */
+                    /* sliver triangles */
+                    if (!TriangleBoxOverlap(&satTri, voxelCenter, satHalfSize))
+                        continue;
                     ClosestPointOnTriangle(voxelCenter, triVert0, triVert1, triVert2, intersectPos);
-                    /*ClosestPointOnTriangle(voxelCenter, triVert0, triVert1, triVert2, intersectPos);*/
                     /* compute the distance from the center of voxel */
                     /* to the closest point on a triangle */
                     intersectDistance = 0.0;
@@ -629,60 +1336,234 @@ float haptic_wrt_implant[])
                     }
                     intersectDistance = (float)sqrt((double)intersectDistance);
                     if ( intersectDistance < colDistance) { /* intersected */
-                        ip = (ix + iy * xDim + iz * xDim * yDim) * (maxTrianglePerVoxel + 1);
-                        num_triangles = (int)((unsigned short *)voxels)[ip];
-                        if (num_triangles == 0) { /* No triangle was registered in this voxel */
-                            voxels[ip+1] = (unsigned short)it;
-                            voxels[ip+0] = (unsigned short)1;
-                        }
-                        else {
-                            addFlag = 1;
-                            for (i = 0; i < num_triangles; i++) {
-                                if (it == (int)((unsigned short *)voxels)[ip + 1 + i])
-                                    addFlag = 0;
-                            }
-                            if (addFlag == 1) {
-                                voxels[ip + 1 + i] = it;
-                                voxels[ip + 0] = num_triangles + 1;
-                                if (num_triangles+1>maxTriangles) {
-                                    maxTriangles = num_triangles+1;
-                                    maxTriangleVoxelIndex = ip;
-                                    maxTriangleVoxelXYZ[0]=ix;
-                                    maxTriangleVoxelXYZ[1]=iy;
-                                    maxTriangleVoxelXYZ[2]=iz;
-                                }
-                            }                            
+                        /* a triangle visits every voxel only once so */
+                        /* no duplicate check is needed */
+                        if (addVoxelPair(pairs,
+                                    ix + iy * xDim + iz * xDim * yDim,
+                                    it) != 1) {
+                            return -1;
                         }
                     }
                 }
             }
         }
     }
+    return 1;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *  computeFacetData
+ *
+ *
+ * Description:
+ *     Fill the facet data (unit normal followed by the three vertices
+ *     in m) of every triangle.
+ *
+ * Results:
+ *     None
+ *
+ * Side effects:
+ *     triSurface is translated back into the original space
+ *
+ *------------------------------------------------------------------------
+ */
+void computeFacetData(Polygon *vPtr,
+int numtriangles,
+float triSurface[][3][3],
+float haptic_wrt_implant[])
+{
+    float *facets = vPtr->facetPtr;
+    int i, j, it;
+    float nvec[3], t1vec[3], t2vec[3];
+    float magVec;
+    float scale=vPtr->scale, resolution[3];
+    
+    resolution[0]=vPtr->xRes;
+    resolution[1]=vPtr->yRes;
+    resolution[2]=vPtr->zRes;
+    
+  /* compute normal for each triangle */
+    for (it = 0; it < numtriangles; it++) {
+        t1vec[0] = triSurface[it][1][0] - triSurface[it][0][0];
+        t1vec[1] = triSurface[it][1][1] - triSurface[it][0][1];
+        t1vec[2] = triSurface[it][1][2] - triSurface[it][0][2];
+        t2vec[0] = triSurface[it][2][0] - triSurface[it][0][0];
+        t2vec[1] = triSurface[it][2][1] - triSurface[it][0][1];
+        t2vec[2] = triSurface[it][2][2] - triSurface[it][0][2];
+        nvec[0] =  t1vec[1] * t2vec[2] - t1vec[2] * t2vec[1];
+        nvec[1] =  t1vec[2] * t2vec[0] - t1vec[0] * t2vec[2];
+        nvec[2] =  t1vec[0] * t2vec[1] - t1vec[1] * t2vec[0];
+        
+        magVec = sqrt(nvec[0] * nvec[0] +
+        nvec[1] * nvec[1] +
+        nvec[2] * nvec[2]);
+        magVec = (magVec>0) ? magVec : 1.0;
+        for (i = 0; i < 3; i++)
+            facets[it * 12 + i] = nvec[i]/magVec;
+    }
+
+  /* translate the vertex in the voxel space into the original space */
+    for (it = 0; it < numtriangles; it++) {
+        for ( i = 0; i< 3; i++) {
+            for (j=0;j<3;j++) {
+                triSurface[it][i][j] = triSurface[it][i][j]+haptic_wrt_implant[j];
+            }
+        }
+    }
+    for (it = 0; it < numtriangles; it++) {
+    /* STL file created in mm unit, so need to scale to m */
+        for (i = 0; i < 3; i++)
+            for (j = 0; j < 3; j++)
+                facets[it * 12 + i * 3 + j + 3] = (float)
+                triSurface[it][i][j] *
+                resolution[j] / scale / 1000.0;
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *  addVoxelPair
+ *
+ *
+ * Description:
+ *     Record that triangle intersects voxel, growing the list as needed.
+ *
+ * Results:
+ *     1 on success, -1 if memory could not be allocated
+ *
+ * Side effects:
+ *     None
+ *
+ *------------------------------------------------------------------------
+ */
+int addVoxelPair(VoxelPairList *pairs, int voxel, int triangle)
+{
+    int newCapacity;
+    int *newVoxel, *newTriangle;
+
+    if (pairs->count == pairs->capacity) {
+        newCapacity = (pairs->capacity > 0) ? pairs->capacity * 2 : 4096;
+        if ((newVoxel = (int *) realloc(pairs->voxel,
+                        newCapacity * sizeof(int))) == NULL) {
+            perror ("Can't alloc memory for voxel list");
+            return -1;
+        }
+        pairs->voxel = newVoxel;
+        if ((newTriangle = (int *) realloc(pairs->triangle,
+                        newCapacity * sizeof(int))) == NULL) {
+            perror ("Can't alloc memory for voxel list");
+            return -1;
+        }
+        pairs->triangle = newTriangle;
+        pairs->capacity = newCapacity;
+    }
+    pairs->voxel[pairs->count] = voxel;
+    pairs->triangle[pairs->count] = triangle;
+    pairs->count++;
+    return 1;
+}
 
-    /* generate voxel map */
-    /* ComputeVoxelMap(0,0,0,vPtr, maxTrianglePerVoxel); */
-   GenerateVoxelMap(vPtr, maxTrianglePerVoxel); 
+/*
+ *------------------------------------------------------------------------
+ *  buildVoxelLists
+ *
+ *
+ * Description:
+ *     Counting sort of the (voxel, triangle) pairs: count the triangles
+ *     of every voxel, turn the counts into offsets and fill the lists.
+ *     The sort is stable so each list stays in triangle order.
+ *
+ * Results:
+ *     1 on success, -1 if memory could not be allocated
+ *
+ * Side effects:
+ *     Sets voxelStart, voxelTri and maxOccupancy of vPtr
+ *
+ *------------------------------------------------------------------------
+ */
+int buildVoxelLists(Polygon *vPtr, VoxelPairList *pairs)
+{
+    int i, count;
+    int nvoxels = vPtr->xDim * vPtr->yDim * vPtr->zDim;
+    unsigned int *fill;
 
-  /* translate the vertex in the voxel space into the original space */
-    for (it = 0; it < numtriangles; it++) {
-        for ( i = 0; i< 3; i++) {
-            for (j=0;j<3;j++) {
-                triSurface[it][i][j] = triSurface[it][i][j]+haptic_wrt_implant[j];
-            }
-        }
+    vPtr->voxelStart = (unsigned int *) calloc(nvoxels + 1,
+            sizeof(unsigned int));
+    vPtr->voxelTri = (unsigned int *) malloc(
+            (pairs->count > 0 ? pairs->count : 1) * sizeof(unsigned int));
+    fill = (unsigned int *) malloc(nvoxels * sizeof(unsigned int));
+    if (vPtr->voxelStart == NULL || vPtr->voxelTri == NULL || fill == NULL) {
+        perror ("Can't alloc memory for voxel data");
+        free(fill);
+        return -1;
     }
-    for (it = 0; it < numtriangles; it++) {
-    /* STL file created in mm unit, so need to scale to m */
-        for (i = 0; i < 3; i++)
-            for (j = 0; j < 3; j++)
-                facets[it * 12 + i * 3 + j + 3] = (float)
-                triSurface[it][i][j] *
-                resolution[j] / scale / 1000.0;
+
+    /* first pass, count */
+    for (i = 0; i < pairs->count; i++)
+        vPtr->voxelStart[pairs->voxel[i] + 1]++;
+
+    vPtr->maxOccupancy = 0;
+    for (i = 0; i < nvoxels; i++) {
+        count = (int)vPtr->voxelStart[i + 1];
+        if (count > vPtr->maxOccupancy)
+            vPtr->maxOccupancy = count;
+        vPtr->voxelStart[i + 1] += vPtr->voxelStart[i];
+        fill[i] = vPtr->voxelStart[i];
     }
 
-    free ((void *) normals);
+    /* second pass, fill */
+    for (i = 0; i < pairs->count; i++)
+        vPtr->voxelTri[fill[pairs->voxel[i]]++] =
+            (unsigned int)pairs->triangle[i];
+
+    free(fill);
+    return 1;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *  fillLegacyVoxelData
+ *
+ *
+ * Description:
+ *     Write the voxel lists in the legacy layout, maxTriPerVox + 1
+ *     unsigned shorts per voxel (count followed by the triangle ids).
+ *     Lists longer than maxTriPerVox are truncated, never spilled into
+ *     the next voxel.
+ *
+ * Results:
+ *     number of voxels whose list had to be truncated
+ *
+ * Side effects:
+ *     None
+ *
+ *------------------------------------------------------------------------
+ */
+int fillLegacyVoxelData(Polygon *vPtr, int maxTriPerVox,
+        unsigned short *voxels)
+{
+    int i, j, count, overflowVoxels = 0;
+    int nvoxels = vPtr->xDim * vPtr->yDim * vPtr->zDim;
+    unsigned short *voxel;
+    unsigned int *triangles;
+
+    for (i = 0; i < nvoxels; i++) {
+        voxel = voxels + i * (maxTriPerVox + 1);
+        triangles = vPtr->voxelTri + vPtr->voxelStart[i];
+        count = (int)(vPtr->voxelStart[i + 1] - vPtr->voxelStart[i]);
+        if (count > maxTriPerVox) {
+            count = maxTriPerVox;
+            overflowVoxels++;
+        }
+        voxel[0] = (unsigned short)count;
+        for (j = 0; j < count; j++)
+            voxel[j + 1] = (unsigned short)triangles[j];
+    }
+    return overflowVoxels;
 }
 
+
 /*
  *------------------------------------------------------------------------
  *  computeFacetBounds
@@ -844,92 +1725,11 @@ void projectOnTriangleEdge(float *c, float *p, float *q, float *cproj)
         *(cproj+i) = p[i] + lamda * qp[i];
 }
 
-/*
- *------------------------------------------------------------------------
- *  get_num_of_voxels
- *
- *
- * Description:
- *
- *
- * Results:
- *
- *
- * Side effects:
- *     None
- *
- *------------------------------------------------------------------------
- */
-int get_num_of_voxels(
-int numtriangles,
-int numvertices,
-int *triIndex,
-float scaleFactor,
-float *vertex,
-float resolution
-)
-{
-    float maxBounds[3], minBounds[3];
-    int idx;
-    int i,j;
-    float *triSurface;
-    int xDim,yDim,zDim;
-    int nvoxels;
-    
-    
-    if ((triSurface = (float *) malloc (numvertices*3*sizeof (float))) == NULL) {
-        perror ("Can't alloc memory for triangle array");
-        return -1;
-    }
-
-    
-  /* map into voxel coordinate */
-    for (i = 0; i < numtriangles; i++) {
-        for (j = 0; j < 3; j++) {
-            idx = triIndex[i * 3 + j];
-            if (idx < 0 || idx > (numvertices - 1))
-                fprintf (stderr, "ERROR: triangle %d vertex %d not defined!\n", i, j);
-            else
-            {
-                triSurface[i * 9 + j * 3 + 0] = scaleFactor * vertex[idx * 3 + 0] / resolution;
-                triSurface[i * 9 + j * 3 + 1] = scaleFactor * vertex[idx * 3 + 1] / resolution;
-                triSurface[i * 9 + j * 3 + 2] = scaleFactor * vertex[idx * 3 + 2] / resolution;
-            }
-        }
-    }
-  /* compute object bounds */
-    computeModelBounds (numtriangles, (float (*)[3][3]) triSurface,
-    maxBounds, minBounds);
-  /* translate triangle coords to be within minimum bounds */
-    for (i = 0; i < numtriangles; i++) {
-        for (j = 0; j < 3; j++) {
-            triSurface[i * 9 + j * 3 + 0] = triSurface[i * 9 + j * 3 + 0] - minBounds[0];
-            triSurface[i * 9 + j * 3 + 1] = triSurface[i * 9 + j * 3 + 1] - minBounds[1];
-            triSurface[i * 9 + j * 3 + 2] = triSurface[i * 9 + j * 3 + 2] - minBounds[2];
-        }
-    }
-    
-  /* re-compute object bounds */
-    computeModelBounds (numtriangles, (float (*)[3][3]) triSurface,
-    maxBounds, minBounds);
-  /* Initialize Voxel */
-    xDim = (int)ceil(maxBounds[0]) - (int)floor(minBounds[0]);
-    yDim = (int)ceil(maxBounds[1]) - (int)floor(minBounds[1]);
-    zDim = (int)ceil(maxBounds[2]) - (int)floor(minBounds[2]);
-    
-    nvoxels = xDim * yDim * zDim;
-    
-    free(triSurface);
-    
-    return nvoxels;
-}
-
-void ComputeVoxelMap (int x,int y, int z,Polygon *vPtr, int maxTrianglePerVoxel)
+void ComputeVoxelMap (int x,int y, int z,Polygon *vPtr)
 {
   int i, ix, iy, iz;
   int voxLoc = x + y * vPtr->xDim + z*vPtr->xDim * vPtr->yDim;
-  int triLoc = voxLoc * (maxTrianglePerVoxel + 1);
-  if (vPtr->voxelPtr[triLoc] < 1)
+  if (vPtr->voxelStart[voxLoc + 1] == vPtr->voxelStart[voxLoc])
     {
       vPtr->voxelMap[voxLoc] = 1;
          /* printf("\{%d %d %d\} ", x, y, z); */
@@ -941,67 +1741,56 @@ void ComputeVoxelMap (int x,int y, int z,Polygon *vPtr, int maxTrianglePerVoxel)
             && iz >=0 && iz < vPtr->zDim) {
           voxLoc = ix + iy * vPtr->xDim + iz * vPtr->xDim * vPtr->yDim;
           if (vPtr->voxelMap[voxLoc] == 0) {
-            ComputeVoxelMap (ix,iy,iz,vPtr, maxTrianglePerVoxel);
+            ComputeVoxelMap (ix,iy,iz,vPtr);
           }
         }
       }
     }
 }
-/* function used by GenerateVoxelMap() */
-int CheckDuplicateVox (Point *voxelList, int nVoxels, int x, int y, int z) {
-  int i;
-  for (i = 0; i < nVoxels; i++) {
-    if (voxelList[i].x == x && voxelList[i].y == y 
-        && voxelList[i].z == z) {
-      return 1;
-    }
+/* this is a improved boundary search algo: breadth first flood of the */
+/* empty voxels connected to the grid corner, which is always empty */
+/* because of the 2 voxel margin around the model */
+int GenerateVoxelMap(Polygon *vPtr) {
+  int *queue;
+  int nvoxels = vPtr->xDim * vPtr->yDim * vPtr->zDim;
+
+  if ((queue = (int *) malloc (nvoxels * sizeof(int))) == NULL) {
+    perror ("Can't alloc memory for voxel map");
+    return -1;
   }
-  return 0;
+  memset (vPtr->voxelMap, 0, nvoxels * sizeof(unsigned char));
+  vPtr->voxelMap[0] = 1;
+  queue[0] = 0;
+  FloodOutsideVoxels(vPtr, queue, 1);
+  free((void *)queue);
+  return 1;
 }
 
-/* this is a improved boundary search algo */
-void GenerateVoxelMap(Polygon *vPtr, int maxTrianglePerVoxel) {
-  Point *oldVoxels, *newVoxels;
-  int nVoxToCheck, i, j, k, nVoxToAdd, voxLoc, triLoc, ix, iy, iz;
-  nVoxToCheck = 1;
-  oldVoxels = (Point *) malloc (nVoxToCheck * sizeof(Point));
-  oldVoxels[0].x = 0;
-  oldVoxels[0].y = 0;
-  oldVoxels[0].z = 0;
-  while (nVoxToCheck > 0) {
-    for (i = 0; i < nVoxToCheck; i++) {
-      /* set those points to be outside */
-      voxLoc = oldVoxels[i].x + oldVoxels[i].y*vPtr->xDim
-        + oldVoxels[i].z*vPtr->xDim*vPtr->yDim;
-      vPtr->voxelMap[voxLoc] = 1;
-    }
-    newVoxels = (Point *) malloc (nVoxToCheck * 6 * sizeof(Point));
-    nVoxToAdd = 0;
-    for (i = 0; i < nVoxToCheck; i++) {
-      /* Add the neighbours of voxToCheck to newVoxels list. */
-      for (j = 0; j < 6; j++) {
-        ix = x_6n(j, oldVoxels[i].x);
-        iy = y_6n(j, oldVoxels[i].y);
-        iz = z_6n(j, oldVoxels[i].z);
-        if (ix >=0 && ix < vPtr->xDim && iy >=0 && iy < vPtr->yDim 
-            && iz >=0 && iz < vPtr->zDim) {
-          voxLoc = ix + iy*vPtr->xDim + iz*vPtr->xDim*vPtr->yDim;
-          triLoc = voxLoc * (maxTrianglePerVoxel + 1);
-          if (vPtr->voxelMap[voxLoc] == 0 && vPtr->voxelPtr[triLoc] < 1) {
-            if (!CheckDuplicateVox(newVoxels, nVoxToAdd, ix, iy, iz)) {
-              newVoxels[nVoxToAdd].x = ix;
-              newVoxels[nVoxToAdd].y = iy;
-              newVoxels[nVoxToAdd++].z = iz;
-            }
-          }
+/* expand the outside region from the queued voxels, which must already */
+/* be flagged as outside.  A voxel is flagged when it is queued so it */
+/* is queued at most once and the queue never exceeds nvoxels entries */
+void FloodOutsideVoxels(Polygon *vPtr, int *queue, int queueLength) {
+  int head, j, voxLoc, ix, iy, iz, x, y, z;
+  for (head = 0; head < queueLength; head++) {
+    x = queue[head] % vPtr->xDim;
+    y = (queue[head] / vPtr->xDim) % vPtr->yDim;
+    z = queue[head] / (vPtr->xDim * vPtr->yDim);
+    /* Add the empty neighbours to the queue. */
+    for (j = 0; j < 6; j++) {
+      ix = x_6n(j, x);
+      iy = y_6n(j, y);
+      iz = z_6n(j, z);
+      if (ix >=0 && ix < vPtr->xDim && iy >=0 && iy < vPtr->yDim 
+          && iz >=0 && iz < vPtr->zDim) {
+        voxLoc = ix + iy*vPtr->xDim + iz*vPtr->xDim*vPtr->yDim;
+        if (vPtr->voxelMap[voxLoc] == 0
+            && vPtr->voxelStart[voxLoc + 1] == vPtr->voxelStart[voxLoc]) {
+          vPtr->voxelMap[voxLoc] = 1;
+          queue[queueLength++] = voxLoc;
         }
       }
     }
-    free((void *)oldVoxels);
-    oldVoxels = newVoxels;
-    nVoxToCheck = nVoxToAdd;
   }
-  free((void *)oldVoxels);
 }
 
 
@@ -1160,4 +1949,303 @@ int ClosestPointOnTriangle(float *p, float *a, float *b, float *c, float *ip)
      }
 }
 
+/*
+ *------------------------------------------------------------------------
+ *  InitSatTriangle
+ *
+ *
+ * Description:
+ *     Cache the vertices, edges and (unnormalized) plane normal of a
+ *     triangle for repeated use by TriangleBoxOverlap.
+ *
+ * Results:
+ *     None
+ *
+ * Side effects:
+ *     None
+ *
+ *------------------------------------------------------------------------
+ */
+void InitSatTriangle(SatTriangle *tri, float *a, float *b, float *c)
+{
+    int i;
+
+    for (i = 0; i < 3; i++)
+    {
+        tri->vert[0][i] = a[i];
+        tri->vert[1][i] = b[i];
+        tri->vert[2][i] = c[i];
+        tri->edge[0][i] = b[i] - a[i];
+        tri->edge[1][i] = c[i] - b[i];
+        tri->edge[2][i] = a[i] - c[i];
+    }
+    tri->normal[0] = tri->edge[0][1] * tri->edge[1][2] - tri->edge[0][2] * tri->edge[1][1];
+    tri->normal[1] = tri->edge[0][2] * tri->edge[1][0] - tri->edge[0][0] * tri->edge[1][2];
+    tri->normal[2] = tri->edge[0][0] * tri->edge[1][1] - tri->edge[0][1] * tri->edge[1][0];
+}
+
+/*
+ *------------------------------------------------------------------------
+ *  TriangleBoxOverlap
+ *
+ *
+ * Description:
+ *     Separating axis test between a triangle and an axis aligned cube
+ *     (Akenine-Moller).  The candidate axes are the three box normals,
+ *     the triangle normal and the nine cross products of the box axes
+ *     with the triangle edges.
+ *
+ * Results:
+ *     0 if a separating axis exists, 1 if the triangle and box overlap
+ *     (touching counts as overlap)
+ *
+ * Side effects:
+ *     None
+ *
+ *------------------------------------------------------------------------
+ */
+int TriangleBoxOverlap(SatTriangle *tri, float *boxCenter, float boxHalfSize)
+{
+    int i, j;
+    float v[3][3], axis[3];
+    float p0, p1, p2, pmin, pmax, r, dist;
+
+    /* move the triangle so that the box is centered at the origin */
+    for (i = 0; i < 3; i++)
+    {
+        v[i][0] = tri->vert[i][0] - boxCenter[0];
+        v[i][1] = tri->vert[i][1] - boxCenter[1];
+        v[i][2] = tri->vert[i][2] - boxCenter[2];
+    }
+
+    /* box normals, same as an aabb overlap test */
+    for (j = 0; j < 3; j++)
+    {
+        pmin = pmax = v[0][j];
+        if (v[1][j] < pmin) pmin = v[1][j];
+        if (v[1][j] > pmax) pmax = v[1][j];
+        if (v[2][j] < pmin) pmin = v[2][j];
+        if (v[2][j] > pmax) pmax = v[2][j];
+        if (pmin > boxHalfSize || pmax < -boxHalfSize)
+            return 0;
+    }
+
+    /* triangle plane */
+    dist = tri->normal[0] * v[0][0] + tri->normal[1] * v[0][1]
+        + tri->normal[2] * v[0][2];
+    r = boxHalfSize * ((float)fabs(tri->normal[0])
+            + (float)fabs(tri->normal[1]) + (float)fabs(tri->normal[2]));
+    if (dist > r || dist < -r)
+        return 0;
+
+    /* cross products of the box axes with the triangle edges */
+    for (i = 0; i < 3; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            /* axis = e_j x edge_i */
+            axis[j] = 0.0f;
+            axis[(j + 1) % 3] = -tri->edge[i][(j + 2) % 3];
+            axis[(j + 2) % 3] = tri->edge[i][(j + 1) % 3];
+
+            p0 = axis[0] * v[0][0] + axis[1] * v[0][1] + axis[2] * v[0][2];
+            p1 = axis[0] * v[1][0] + axis[1] * v[1][1] + axis[2] * v[1][2];
+            p2 = axis[0] * v[2][0] + axis[1] * v[2][1] + axis[2] * v[2][2];
+            pmin = pmax = p0;
+            if (p1 < pmin) pmin = p1;
+            if (p1 > pmax) pmax = p1;
+            if (p2 < pmin) pmin = p2;
+            if (p2 > pmax) pmax = p2;
+            r = boxHalfSize * ((float)fabs(axis[0]) + (float)fabs(axis[1])
+                    + (float)fabs(axis[2]));
+            if (pmin > r || pmax < -r)
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *  computeVoxelCacheKey
+ *
+ *
+ * Description:
+ *     Hash every input that affects the voxelization, together with the
+ *     cache version, into the key used to name the cache file.
+ *
+ * Results:
+ *     64 bit cache key
+ *
+ * Side effects:
+ *     None
+ *
+ *------------------------------------------------------------------------
+ */
+uint64_t computeVoxelCacheKey(int numtriangles, int numvertices,
+        int *triIndex, int maxTriPerVox, float scaleFactor,
+        float *vertex, float resolution)
+{
+    uint64_t key = MAPPED_FILE_HASH_SEED;
+    int32_t params[4];
+    float scales[2];
+
+    params[0] = VOXEL_CACHE_VERSION;
+    params[1] = numtriangles;
+    params[2] = numvertices;
+    params[3] = maxTriPerVox;
+    scales[0] = scaleFactor;
+    scales[1] = resolution;
+
+    key = hash_bytes(key, params, sizeof(params));
+    key = hash_bytes(key, scales, sizeof(scales));
+    key = hash_bytes(key, triIndex, (size_t)numtriangles * 3 * sizeof(int));
+    key = hash_bytes(key, vertex, (size_t)numvertices * 3 * sizeof(float));
+    return key;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *  readVoxelCache
+ *
+ *
+ * Description:
+ *     Map the cache file and, if its header matches the expected one,
+ *     create the mex outputs straight from the mapped data.
+ *
+ * Results:
+ *     TRUE on a cache hit (plhs populated and the occupancy fields of
+ *     expected updated), FALSE otherwise
+ *
+ * Side effects:
+ *     None, a missing, stale or truncated file is treated as a miss
+ *
+ *------------------------------------------------------------------------
+ */
+int readVoxelCache(const char *cacheFile, VoxelCacheHeader *expected,
+        mxArray *plhs[])
+{
+    MappedFile cache;
+    VoxelCacheHeader header;
+    int i, dims[2];
+
+    if (map_file_read(cacheFile, &cache) != MAPPED_FILE_SUCCESS)
+        return FALSE;
+
+    if (cache.size < sizeof(VoxelCacheHeader)) {
+        unmap_file(&cache);
+        return FALSE;
+    }
+    memcpy(&header, cache.data, sizeof(VoxelCacheHeader));
+
+    if (memcmp(header.magic, expected->magic, sizeof(header.magic))
+            || header.version != expected->version
+            || header.headerSize != expected->headerSize
+            || header.key != expected->key
+            || header.numtriangles != expected->numtriangles
+            || header.numvertices != expected->numvertices
+            || header.maxTriPerVox != expected->maxTriPerVox
+            || header.scaleFactor != expected->scaleFactor
+            || header.resolution != expected->resolution
+            || header.voxelOffset + header.voxelBytes > cache.size
+            || header.facetOffset + header.facetBytes > cache.size
+            || header.voxelMapOffset + header.voxelMapBytes > cache.size) {
+        unmap_file(&cache);
+        return FALSE;
+    }
+
+    expected->nvoxels = header.nvoxels;
+    expected->maxOccupancy = header.maxOccupancy;
+    expected->overflowVoxels = header.overflowVoxels;
+
+    dims[0]=1;
+    dims[1]=(int)header.voxelBytes;
+    plhs[0]=mxCreateNumericArray(2, dims, mxUINT8_CLASS, mxREAL);
+    memcpy(mxGetData(plhs[0]), cache.data + header.voxelOffset,
+            (size_t)header.voxelBytes);
+
+    dims[1]=(int)header.facetBytes;
+    plhs[1]=mxCreateNumericArray(2, dims, mxUINT8_CLASS, mxREAL);
+    memcpy(mxGetData(plhs[1]), cache.data + header.facetOffset,
+            (size_t)header.facetBytes);
+
+    dims[1]=3;
+    plhs[2]=mxCreateNumericArray(2, dims, mxDOUBLE_CLASS, mxREAL);
+    plhs[3]=mxCreateNumericArray(2, dims, mxDOUBLE_CLASS, mxREAL);
+    for (i = 0; i < 3; i++) {
+        mxGetPr(plhs[2])[i] = header.vsize[i];
+        mxGetPr(plhs[3])[i] = header.hwi[i];
+    }
+
+    dims[1]=(int)header.voxelMapBytes;
+    plhs[4]=mxCreateNumericArray(2, dims, mxUINT8_CLASS, mxREAL);
+    memcpy(mxGetData(plhs[4]), cache.data + header.voxelMapOffset,
+            (size_t)header.voxelMapBytes);
+
+    unmap_file(&cache);
+    return TRUE;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *  writeVoxelCache
+ *
+ *
+ * Description:
+ *     Store the mex outputs in the cache file described by header.
+ *
+ * Results:
+ *     None
+ *
+ * Side effects:
+ *     Creates cacheFile.  Failing to write the cache only produces a
+ *     warning, the voxelization result is still returned
+ *
+ *------------------------------------------------------------------------
+ */
+void writeVoxelCache(const char *cacheFile, VoxelCacheHeader *header,
+        mxArray *plhs[])
+{
+    static const unsigned char padding[VOXEL_CACHE_ALIGN] = {0};
+    const void *blocks[6];
+    size_t blockSizes[6];
+    int i;
+
+    header->voxelBytes = mxGetNumberOfElements(plhs[0]);
+    header->facetBytes = mxGetNumberOfElements(plhs[1]);
+    header->voxelMapBytes = mxGetNumberOfElements(plhs[4]);
+    for (i = 0; i < 3; i++) {
+        header->vsize[i] = mxGetPr(plhs[2])[i];
+        header->hwi[i] = mxGetPr(plhs[3])[i];
+    }
+
+    /* each block starts on an aligned offset */
+    header->voxelOffset = sizeof(VoxelCacheHeader);
+    header->facetOffset = (header->voxelOffset + header->voxelBytes
+            + VOXEL_CACHE_ALIGN - 1) & ~(uint64_t)(VOXEL_CACHE_ALIGN - 1);
+    header->voxelMapOffset = (header->facetOffset + header->facetBytes
+            + VOXEL_CACHE_ALIGN - 1) & ~(uint64_t)(VOXEL_CACHE_ALIGN - 1);
+
+    blocks[0] = header;
+    blockSizes[0] = sizeof(VoxelCacheHeader);
+    blocks[1] = mxGetData(plhs[0]);
+    blockSizes[1] = (size_t)header->voxelBytes;
+    blocks[2] = padding;
+    blockSizes[2] = (size_t)(header->facetOffset - header->voxelOffset
+            - header->voxelBytes);
+    blocks[3] = mxGetData(plhs[1]);
+    blockSizes[3] = (size_t)header->facetBytes;
+    blocks[4] = padding;
+    blockSizes[4] = (size_t)(header->voxelMapOffset - header->facetOffset
+            - header->facetBytes);
+    blocks[5] = mxGetData(plhs[4]);
+    blockSizes[5] = (size_t)header->voxelMapBytes;
+
+    if (write_file_atomic(cacheFile, blocks, blockSizes, 6)
+            != MAPPED_FILE_SUCCESS) {
+        mexWarnMsgTxt("mod2polygon: unable to write voxel cache file");
+    }
+}
+
 /*-------- END OF FILE -------- */
@@ -0,0 +1,72 @@
+%MOD2POLYGON Voxelize a triangle mesh into Polygon haptic object data
+%
+% Syntax:
+%   [voxelData,facetData,vsizeData,hwiData,voxelMap] = mod2polygon(volName,...
+%       nfacets,nvertices,ifacets,scaleFactor,vertices,resolution)
+%       voxelizes the mesh described by the zero based int32 index list
+%       ifacets and the single precision vertex list vertices (as returned
+%       by hgs_haptic/private/read_stl).  facetData holds the normal and
+%       vertices of each facet (float), vsizeData the voxel grid size,
+%       hwiData the position of the haptic origin w.r.t. the implant (m)
+%       and voxelMap flags the voxels outside the mesh.  All data buffers
+%       are returned as uint8 arrays.
+%       voxelData uses the legacy layout used by the Polygon haptic
+%       object with 29 triangles per voxel, see maxTriPerVoxel.
+%   [...] = mod2polygon(...,maxTriPerVoxel)
+%       a positive maxTriPerVoxel selects the legacy layout:
+%       maxTriPerVoxel+1 uint16 per voxel, the number of triangles
+%       followed by the triangle indices.
+%       0 selects the compact layout: nvoxels+1 uint32 offsets followed
+%       by the uint32 triangle indices of all the voxels.  The triangles
+%       of voxel i (zero based) are the entries offset(i+1) to
+%       offset(i+2)-1 of the index list.
+%   [...] = mod2polygon(...,maxTriPerVoxel,cacheDir)
+%       cacheDir is a directory used to cache voxelization results.  The
+%       inputs are hashed and, if a matching cache file exists in cacheDir,
+%       the result is read from it instead of voxelizing the mesh again.
+%       Otherwise the result is computed and saved to cacheDir.  Pass an
+%       empty string to disable the cache.
+%   [...] = mod2polygon(...,0,previous,changedFacets)
+%       incremental update of a previous compact result after an edit of
+%       the mesh.  previous is a struct with the fields voxelData,
+%       voxelMap, vsizeData and hwiData of the previous call and
+%       changedFacets the zero based indices (int32 or double) of the
+%       facets whose vertices moved.  Only these facets are voxelized
+%       again and the outside map is updated locally.  The result is the
+%       same as a full voxelization of the edited mesh.
+%   [...,maxOccupancy] = mod2polygon(...)
+%       maxOccupancy is the largest number of triangles found in a voxel.
+%   [...,maxOccupancy,pyramid] = mod2polygon(...)
+%       pyramid holds the coarse levels of a voxel pyramid, coarsest
+%       first.  Each level halves the grid of the level below it and the
+%       last level covers the voxels.  pyramid(k).cellSize is the edge of
+%       a cell in voxels, pyramid(k).vsizeData the grid size and
+%       pyramid(k).cellData lists for every cell the zero based linear
+%       indices of the occupied cells (voxels for the last level) of the
+%       next finer level, in the compact layout of voxelData.  A cell
+%       without children contains no triangle.  Levels are added until no
+%       dimension exceeds 2 cells.
+%
+% Notes:
+%   In the legacy layout a voxel holding more than maxTriPerVoxel
+%   triangles is an error, the message gives maxOccupancy.  The legacy
+%   layout can only index 65536 triangles.
+%   The cache files are named after the hash of the inputs and can be
+%   deleted at any time.  The directory must already exist.
+%   For incremental updates the number of facets must not change and
+%   changedFacets must list every facet using a moved vertex.  If the
+%   edit changes the bounds of the voxel grid the mesh is voxelized from
+%   scratch.  The cache is not used for incremental updates.
+%
+% See also:
+%    hgs_haptic/create, show_stl
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
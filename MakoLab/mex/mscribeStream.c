@@ -0,0 +1,372 @@
+/****h* /mscribeStream.c ***
+ * NAME
+ *      mscribeStream.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function samples the MicroScribe arm at a fixed rate in a
+ *      background thread (mscribe_stream.c); matlab drains the samples in
+ *      blocks.  The streams stay open between calls, the mex file is
+ *      locked in memory while a stream is open.
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mscribe_stream.h"
+#include "stream_clock.h"
+
+/* defines */
+#define MS_MAX_STREAMS 4
+#define COMMAND_LENGTH 16
+#define OPTION_LENGTH 32
+#define DEFAULT_CAPACITY 65536
+#define DEFAULT_SAMPLE_RATE 100
+
+/* open streams, the stream id is the index plus one */
+static MsStream *streams[MS_MAX_STREAMS];
+static int lockedStreams = 0;
+
+/* internal functions */
+static void startStream(mxArray *plhs[], int nrhs,
+        const mxArray *prhs[]);
+static void readStream(mxArray *plhs[], MsStream *stream,
+        uint32_t maxSamples);
+static void streamStatus(mxArray *plhs[], MsStream *stream);
+static void stopStream(int index);
+static void stopAllStreams(void);
+static int getStreamIndex(const mxArray *idArray);
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    char command[COMMAND_LENGTH];
+    uint32_t maxSamples;
+    int index;
+
+    /* first check the inputs */
+    if ((nrhs < 1) || !mxIsChar(prhs[0])
+            || (mxGetString(prhs[0], command, COMMAND_LENGTH) != 0))
+    {
+        mexErrMsgTxt("Must specify a command: start, read, status, stop or clock");
+        return;
+    }
+
+    if (strcmp(command, "start") == 0)
+    {
+        startStream(plhs, nrhs - 1, prhs + 1);
+    }
+    else if (strcmp(command, "clock") == 0)
+    {
+        plhs[0] = mxCreateDoubleScalar(stream_clock());
+    }
+    else if ((strcmp(command, "stop") == 0) && (nrhs == 1))
+    {
+        stopAllStreams();
+    }
+    else if ((strcmp(command, "read") == 0)
+            || (strcmp(command, "status") == 0)
+            || (strcmp(command, "stop") == 0))
+    {
+        if (nrhs < 2)
+        {
+            mexErrMsgTxt("Must specify the stream id");
+            return;
+        }
+        index = getStreamIndex(prhs[1]);
+        if (strcmp(command, "stop") == 0)
+        {
+            stopStream(index);
+        }
+        else if (strcmp(command, "status") == 0)
+        {
+            streamStatus(plhs, streams[index]);
+        }
+        else
+        {
+            maxSamples = 0xffffffffU;
+            if ((nrhs > 2) && mxIsNumeric(prhs[2])
+                    && (mxGetScalar(prhs[2]) >= 0))
+            {
+                maxSamples = (uint32_t)mxGetScalar(prhs[2]);
+            }
+            readStream(plhs, streams[index], maxSamples);
+        }
+    }
+    else
+    {
+        mexErrMsgTxt("Unknown command, use start, read, status, stop or clock");
+    }
+    return;
+}
+
+/*
+ * id = mscribeStream('start','parameter',value,...)
+ */
+static void startStream(mxArray *plhs[], int nrhs,
+        const mxArray *prhs[])
+{
+    char option[OPTION_LENGTH];
+    const mxArray *replay = NULL;
+    MsSource source;
+    MsStream *stream;
+    double sampleRate = DEFAULT_SAMPLE_RATE;
+    uint32_t capacity = DEFAULT_CAPACITY;
+    int32_t loop = 0;
+    int32_t opened;
+    int index, i;
+
+    if (nrhs % 2 != 0)
+    {
+        mexErrMsgTxt("Must specify parameter/value pairs");
+        return;
+    }
+    for (i = 0; i < nrhs; i += 2)
+    {
+        if (!mxIsChar(prhs[i])
+                || (mxGetString(prhs[i], option, OPTION_LENGTH) != 0))
+        {
+            mexErrMsgTxt("Parameter names must be strings");
+            return;
+        }
+        if (strcmp(option, "Replay") == 0)
+        {
+            if (!mxIsDouble(prhs[i + 1]) || mxIsEmpty(prhs[i + 1])
+                    || (mxGetN(prhs[i + 1]) != MS_REPLAY_COLUMNS))
+            {
+                mexErrMsgTxt("Replay must be a matrix of 21 columns: timer, buttons, 7 encoders, 6 joint angles, tip and direction");
+                return;
+            }
+            replay = prhs[i + 1];
+        }
+        else if (!mxIsNumeric(prhs[i + 1]) && !mxIsLogical(prhs[i + 1]))
+        {
+            mexErrMsgTxt("Parameter values must be numeric");
+            return;
+        }
+        else if (strcmp(option, "SampleRate") == 0)
+        {
+            sampleRate = mxGetScalar(prhs[i + 1]);
+            if (!(sampleRate > 0))
+            {
+                mexErrMsgTxt("SampleRate must be positive");
+                return;
+            }
+        }
+        else if (strcmp(option, "Capacity") == 0)
+        {
+            capacity = (mxGetScalar(prhs[i + 1]) >= 1)
+                ? (uint32_t)mxGetScalar(prhs[i + 1]) : 1;
+        }
+        else if (strcmp(option, "Loop") == 0)
+        {
+            loop = (mxGetScalar(prhs[i + 1]) != 0);
+        }
+        else
+        {
+            mexErrMsgTxt("Unknown parameter, use SampleRate, Capacity, Replay or Loop");
+            return;
+        }
+    }
+
+    for (index = 0; index < MS_MAX_STREAMS; index++)
+    {
+        if (streams[index] == NULL)
+            break;
+    }
+    if (index == MS_MAX_STREAMS)
+    {
+        mexErrMsgTxt("Too many open streams, stop one first");
+        return;
+    }
+
+    /* the recorded arm records stand in for the DLL */
+    if (replay != NULL)
+    {
+        opened = ms_replay_open(&source, mxGetPr(replay),
+                (uint32_t)mxGetM(replay), loop);
+    }
+    else
+    {
+        opened = ms_dll_open(&source, sampleRate);
+    }
+    if (opened != MS_STREAM_SUCCESS)
+    {
+        mexErrMsgTxt((replay != NULL) ? "Unable to allocate the replay"
+                : "MicroScribe not connected, connect with mscribe first or specify a Replay");
+        return;
+    }
+
+    /* the stream lives until stopped, outside of the matlab memory */
+    stream = (MsStream *)malloc(sizeof(MsStream));
+    if ((stream == NULL) || (ms_stream_start(stream, &source, sampleRate,
+                    capacity) != MS_STREAM_SUCCESS))
+    {
+        if (stream == NULL)
+            source.close(&source);
+        free(stream);
+        mexErrMsgTxt("Unable to start the stream");
+        return;
+    }
+    streams[index] = stream;
+    if (lockedStreams++ == 0)
+    {
+        mexLock();
+        mexAtExit(stopAllStreams);
+    }
+    plhs[0] = mxCreateDoubleScalar(index + 1);
+}
+
+/*
+ * samples = mscribeStream('read',id,maxSamples)
+ */
+static void readStream(mxArray *plhs[], MsStream *stream,
+        uint32_t maxSamples)
+{
+    static const char *fieldNames[] = {"timestamp", "sequence", "timer",
+        "buttons", "encoder", "joint", "position", "orientation",
+        "transform"};
+    MsSample *samples;
+    mxArray *timestamp, *sequence, *timer, *buttons, *encoder, *joint;
+    mxArray *position, *orientation, *transform;
+    int dims[3];
+    uint32_t numSamples, i, j;
+
+    numSamples = ring_count(&stream->ring);
+    if (numSamples > maxSamples)
+    {
+        numSamples = maxSamples;
+    }
+    samples = (MsSample *)mxMalloc((numSamples + 1) * sizeof(MsSample));
+    numSamples = ms_stream_read(stream, samples, numSamples);
+
+    /* one row per sample, the transforms are 4x4xN */
+    timestamp = mxCreateDoubleMatrix(numSamples, 1, mxREAL);
+    sequence = mxCreateDoubleMatrix(numSamples, 1, mxREAL);
+    timer = mxCreateDoubleMatrix(numSamples, 1, mxREAL);
+    buttons = mxCreateDoubleMatrix(numSamples, 1, mxREAL);
+    encoder = mxCreateDoubleMatrix(numSamples, MS_NUM_ENCODERS, mxREAL);
+    joint = mxCreateDoubleMatrix(numSamples, MS_NUM_JOINTS, mxREAL);
+    position = mxCreateDoubleMatrix(numSamples, 3, mxREAL);
+    orientation = mxCreateDoubleMatrix(numSamples, 3, mxREAL);
+    dims[0] = 4;
+    dims[1] = 4;
+    dims[2] = numSamples;
+    transform = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+
+    for (i = 0; i < numSamples; i++)
+    {
+        mxGetPr(timestamp)[i] = samples[i].timestamp;
+        mxGetPr(sequence)[i] = samples[i].sequence;
+        mxGetPr(timer)[i] = samples[i].timer;
+        mxGetPr(buttons)[i] = samples[i].buttons;
+        for (j = 0; j < MS_NUM_ENCODERS; j++)
+        {
+            mxGetPr(encoder)[j * numSamples + i] = samples[i].encoder[j];
+        }
+        for (j = 0; j < MS_NUM_JOINTS; j++)
+        {
+            mxGetPr(joint)[j * numSamples + i] = samples[i].joint[j];
+        }
+        for (j = 0; j < 3; j++)
+        {
+            mxGetPr(position)[j * numSamples + i] = samples[i].tip[j];
+            mxGetPr(orientation)[j * numSamples + i] =
+                samples[i].direction[j];
+        }
+        ms_sample_transform(&samples[i], mxGetPr(transform) + 16 * i);
+    }
+    mxFree(samples);
+
+    plhs[0] = mxCreateStructMatrix(1, 1,
+            sizeof(fieldNames) / sizeof(fieldNames[0]), fieldNames);
+    mxSetField(plhs[0], 0, "timestamp", timestamp);
+    mxSetField(plhs[0], 0, "sequence", sequence);
+    mxSetField(plhs[0], 0, "timer", timer);
+    mxSetField(plhs[0], 0, "buttons", buttons);
+    mxSetField(plhs[0], 0, "encoder", encoder);
+    mxSetField(plhs[0], 0, "joint", joint);
+    mxSetField(plhs[0], 0, "position", position);
+    mxSetField(plhs[0], 0, "orientation", orientation);
+    mxSetField(plhs[0], 0, "transform", transform);
+}
+
+/*
+ * status = mscribeStream('status',id)
+ */
+static void streamStatus(mxArray *plhs[], MsStream *stream)
+{
+    static const char *fieldNames[] = {"running", "ended", "error",
+        "queued", "produced", "dropped"};
+
+    plhs[0] = mxCreateStructMatrix(1, 1, 6, fieldNames);
+    mxSetField(plhs[0], 0, "running",
+            mxCreateLogicalScalar(stream->status == MS_STREAM_RUNNING));
+    mxSetField(plhs[0], 0, "ended",
+            mxCreateLogicalScalar(stream->status == MS_STREAM_ENDED));
+    mxSetField(plhs[0], 0, "error",
+            mxCreateLogicalScalar(stream->status == MS_STREAM_ERROR));
+    mxSetField(plhs[0], 0, "queued",
+            mxCreateDoubleScalar(ring_count(&stream->ring)));
+    mxSetField(plhs[0], 0, "produced",
+            mxCreateDoubleScalar(stream->produced));
+    mxSetField(plhs[0], 0, "dropped",
+            mxCreateDoubleScalar(stream->dropped));
+}
+
+/*
+ * stop and free a stream, the mex file is unlocked with the last one
+ */
+static void stopStream(int index)
+{
+    ms_stream_stop(streams[index]);
+    free(streams[index]);
+    streams[index] = NULL;
+    if (--lockedStreams == 0)
+    {
+        mexUnlock();
+    }
+}
+
+static void stopAllStreams(void)
+{
+    int index;
+
+    for (index = 0; index < MS_MAX_STREAMS; index++)
+    {
+        if (streams[index] != NULL)
+            stopStream(index);
+    }
+}
+
+/*
+ * index of an open stream, errors out on an invalid id
+ */
+static int getStreamIndex(const mxArray *idArray)
+{
+    int index;
+
+    index = mxIsNumeric(idArray) ? (int)mxGetScalar(idArray) - 1 : -1;
+    if ((index < 0) || (index >= MS_MAX_STREAMS) || (streams[index] == NULL))
+    {
+        mexErrMsgTxt("Invalid stream id");
+        return 0;
+    }
+    return index;
+}
+
+/*----------- END OF FILE ------------ */
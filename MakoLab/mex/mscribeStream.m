@@ -0,0 +1,80 @@
+%MSCRIBESTREAM Sample the MicroScribe arm in a background thread
+%
+% Syntax:
+%   id = mscribeStream('start','parameter',value,...)
+%       starts a background thread copying the arm record of the
+%       MicroScribe DLL at a fixed rate and queuing the timestamped
+%       samples.  The arm must be connected with mscribe first.  The
+%       parameters are:
+%           SampleRate   samples per second (default 100)
+%           Capacity     samples queued between two reads (default 65536)
+%           Replay       Nx21 matrix of recorded arm records replayed at
+%                        the sample rate instead of the arm, one record per
+%                        row: timer, buttons, 7 encoders, 6 joint angles
+%                        (radians), tip position (mm) and tip roll, pitch
+%                        and yaw (radians)
+%           Loop         true to restart the replay at its end (default
+%                        false, the stream ends with the records)
+%       returns the id of the stream.
+%   samples = mscribeStream('read',id)
+%       returns the queued samples, one row per sample.  samples is a
+%       structure with the fields
+%           timestamp     time in seconds of mscribeStream('clock') when
+%                         the record was copied
+%           sequence      sample number since the start
+%           timer         running counter of the arm
+%           buttons       button bits
+%           encoder       Nx7 encoder counts
+%           joint         Nx6 joint angles, radians
+%           position      Nx3 tip position, mm
+%           orientation   Nx3 tip roll, pitch and yaw, radians
+%           transform     4x4xN tip transforms, as mscribe/get 'transform'
+%       Never waits, the fields are empty if no sample is queued.
+%   samples = mscribeStream('read',id,maxSamples)
+%       returns at most maxSamples of the oldest queued samples.
+%   status = mscribeStream('status',id)
+%       returns a structure with the fields running, ended (the replay is
+%       over), error, queued (samples ready to read), produced (samples
+%       taken) and dropped (samples lost to a full queue).
+%   mscribeStream('stop',id)
+%       stops the thread and discards the queued samples.
+%   mscribeStream('stop')
+%       stops all the streams.
+%   t = mscribeStream('clock')
+%       current time of the clock used for the timestamps, the same clock
+%       as ftStream and ndiStream.
+%
+% Notes:
+%   The whole arm record is copied at once instead of one library call per
+%   value, so the encoders, joints and tip of a sample belong to the same
+%   packet of the arm.  A sample taken late is not made up for, the period
+%   is kept from then on.
+%   The stream expects the DLL in millimeters and radians, the units set
+%   by mscribe, and sets them again in case they were changed.  The DLL
+%   updates the tip and the joint angles with every packet until the last
+%   stream is stopped, which restores the ARM_6DOF update set by mscribe.
+%   The arm stays connected when the stream is stopped, see
+%   mscribe/disconnect.
+%   The MicroScribe DLL is only available on windows, elsewhere use Replay.
+%   The mex file stays locked in memory while a stream is open.
+%
+% Example:
+%   msArm = mscribe();
+%   id = mscribeStream('start','SampleRate',200);
+%   pause(1);
+%   samples = mscribeStream('read',id);
+%   mscribeStream('stop',id);
+%   plot3(samples.position(:,1),samples.position(:,2),samples.position(:,3));
+%
+% See also:
+%    mscribe/stream, mscribe/get, ftStream, ndiStream, fusionBuffer
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
@@ -0,0 +1,210 @@
+/****h* /mscribe_dll.cpp ***
+ * NAME
+ *      mscribe_dll.cpp	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      MicroScribe DLL source of the sampler (windows only).  The arm
+ *      record (arm_rec) of the DLL loaded and connected by mscribe is
+ *      copied directly, the DLL read thread keeps it up to date.
+ *      Compiled as C++ because armdll32.h is not valid C.
+ *
+ * SEE ALSO
+ *      mscribe_stream.c, extern/mscribe/armdll32.h
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <windows.h>
+#include <string.h>
+
+#include "armdll32.h"
+
+extern "C" {
+#include "mscribe_stream.h"
+}
+
+/* defines */
+#ifdef _WIN64
+#define ARM_DLL_NAME "armdll64.dll"
+#else
+#define ARM_DLL_NAME "armdll32.dll"
+#endif
+
+/* copies of a record changed by the DLL thread while being copied */
+#define MAX_COPY_ATTEMPTS 3
+
+typedef void *(__stdcall *ArmGetArmRecFunction)(void);
+typedef void (__stdcall *ArmSetUnitsFunction)(int type);
+typedef int (__stdcall *ArmSetUpdateExFunction)(int type,
+        UINT minUpdatePeriodms);
+typedef int (__stdcall *ArmSetUpdateFunction)(int type);
+
+/* DLL sources open, the last one to close restores the update type */
+static int openSources = 0;
+
+/* internal functions */
+static int32_t dll_read(MsSource *source, MsSample *sample);
+static void dll_close(MsSource *source);
+static void copy_record(const volatile arm_rec *arm, MsSample *sample);
+
+/****f*  mscribe_dll.cpp/ms_dll_open ******
+ * NAME
+ *	    ms_dll_open
+ *
+ * SYNOPSIS
+ *      int32_t ms_dll_open(MsSource *source, double sampleRate)
+ *
+ * INPUTS
+ *      double sampleRate
+ *              samples per second, the DLL is asked to update the record
+ *              at least as often
+ *
+ * OUTPUT
+ *      MsSource *source
+ *              source copying the arm record of the DLL
+ *      Returns MS_STREAM_SUCCESS, or MS_STREAM_FAILURE if the DLL is not
+ *      loaded (see mscribe) or not connected to an arm
+ *
+ * NOTES
+ *      Sets the DLL to millimeters and radians, the units mscribe sets
+ *      as well, so the units seen by the other users of the DLL do not
+ *      change.  The DLL is asked to update the stylus and the 6 joint
+ *      angles with every packet until the last DLL source is closed,
+ *      which restores the ARM_6DOF update set by mscribe
+ *
+ **********************************
+ */
+extern "C" int32_t ms_dll_open(MsSource *source, double sampleRate)
+{
+    HMODULE module;
+    ArmGetArmRecFunction armGetArmRec;
+    ArmSetUnitsFunction armSetLengthUnits, armSetAngleUnits;
+    ArmSetUpdateExFunction armSetUpdateEx;
+    arm_rec *arm;
+    UINT period;
+
+    module = GetModuleHandleA(ARM_DLL_NAME);
+    if (module == NULL)
+    {
+        return MS_STREAM_FAILURE;
+    }
+    armGetArmRec = (ArmGetArmRecFunction)GetProcAddress(module,
+            "ArmGetArmRec");
+    armSetLengthUnits = (ArmSetUnitsFunction)GetProcAddress(module,
+            "ArmSetLengthUnits");
+    armSetAngleUnits = (ArmSetUnitsFunction)GetProcAddress(module,
+            "ArmSetAngleUnits");
+    armSetUpdateEx = (ArmSetUpdateExFunction)GetProcAddress(module,
+            "ArmSetUpdateEx");
+    if ((armGetArmRec == NULL) || (armSetLengthUnits == NULL)
+            || (armSetAngleUnits == NULL) || (armSetUpdateEx == NULL))
+    {
+        return MS_STREAM_FAILURE;
+    }
+    arm = (arm_rec *)armGetArmRec();
+    if (arm == NULL)
+    {
+        return MS_STREAM_FAILURE;
+    }
+
+    period = (UINT)(1000 / sampleRate);
+    if (period < MINIMUM_PERIOD_UPDATE)
+    {
+        period = MINIMUM_PERIOD_UPDATE;
+    }
+    if (period > MAXIMUM_PERIOD_UPDATE)
+    {
+        period = MAXIMUM_PERIOD_UPDATE;
+    }
+    armSetLengthUnits(ARM_MM);
+    armSetAngleUnits(ARM_RADIANS);
+    if (armSetUpdateEx(ARM_6DOF | ARM_6JOINT, period) != ARM_SUCCESS)
+    {
+        return MS_STREAM_FAILURE;
+    }
+
+    source->read = dll_read;
+    source->close = dll_close;
+    source->context = arm;
+    openSources++;
+    return MS_STREAM_SUCCESS;
+}
+
+/*
+ * read function of the DLL source, the record is copied again if the
+ * timer of the arm changed during the copy
+ */
+static int32_t dll_read(MsSource *source, MsSample *sample)
+{
+    const volatile arm_rec *arm = (const volatile arm_rec *)source->context;
+    long timer;
+    int attempt;
+
+    for (attempt = 0; attempt < MAX_COPY_ATTEMPTS; attempt++)
+    {
+        timer = arm->hci.timer;
+        MemoryBarrier();
+        copy_record(arm, sample);
+        MemoryBarrier();
+        if (arm->hci.timer == timer)
+        {
+            break;
+        }
+    }
+    return 1;
+}
+
+/*
+ * the DLL and the arm stay connected, see mscribe/disconnect.  The update
+ * type goes back to the one set by mscribe
+ */
+static void dll_close(MsSource *source)
+{
+    HMODULE module;
+    ArmSetUpdateFunction armSetUpdate;
+
+    source->context = NULL;
+    if ((--openSources > 0)
+            || ((module = GetModuleHandleA(ARM_DLL_NAME)) == NULL))
+    {
+        return;
+    }
+    armSetUpdate = (ArmSetUpdateFunction)GetProcAddress(module,
+            "ArmSetUpdate");
+    if (armSetUpdate != NULL)
+    {
+        armSetUpdate(ARM_6DOF);
+    }
+}
+
+static void copy_record(const volatile arm_rec *arm, MsSample *sample)
+{
+    int i;
+
+    sample->timer = (int32_t)arm->hci.timer;
+    sample->buttons = (int32_t)arm->hci.buttons;
+    for (i = 0; i < MS_NUM_ENCODERS; i++)
+    {
+        sample->encoder[i] = (int32_t)arm->hci.encoder[i];
+    }
+    for (i = 0; i < MS_NUM_JOINTS; i++)
+    {
+        sample->joint[i] = arm->joint_rad[i];
+    }
+    sample->tip[0] = arm->stylus_tip.x;
+    sample->tip[1] = arm->stylus_tip.y;
+    sample->tip[2] = arm->stylus_tip.z;
+    sample->direction[0] = arm->stylus_dir.x;
+    sample->direction[1] = arm->stylus_dir.y;
+    sample->direction[2] = arm->stylus_dir.z;
+}
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,389 @@
+/****h* /mscribe_stream.c ***
+ * NAME
+ *      mscribe_stream.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      MicroScribe sampler thread.  Instead of one library call per value
+ *      from matlab, the thread copies the whole arm record at a fixed
+ *      period and queues it with its timestamp; matlab drains the samples
+ *      in blocks.  The replay source plays back recorded arm records at
+ *      the sample rate, as a stand in for the MicroScribe DLL.
+ *
+ * SEE ALSO
+ *      mscribe_stream.h, mscribe_dll.cpp, mscribeStream.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif /* _WIN32 */
+
+#include "mscribe_stream.h"
+#include "stream_clock.h"
+
+typedef struct {
+    MsSample *records;
+    uint32_t numRecords;
+    uint32_t next;              /* next record to replay */
+    int32_t loop;               /* restart at the end of the records */
+} ReplaySource;
+
+/* internal functions */
+#ifdef _WIN32
+static DWORD WINAPI sampler_thread(LPVOID argument);
+#else
+static void *sampler_thread(void *argument);
+#endif /* _WIN32 */
+static void sample(MsStream *stream);
+static int32_t replay_read(MsSource *source, MsSample *sample);
+static void replay_close(MsSource *source);
+
+/****f*  mscribe_stream.c/ms_stream_start ******
+ * NAME
+ *	    ms_stream_start
+ *
+ * SYNOPSIS
+ *      int32_t ms_stream_start(MsStream *stream, const MsSource *source,
+ *              double sampleRate, uint32_t capacity)
+ *
+ * INPUTS
+ *      const MsSource *source
+ *              opened source, owned by the stream from now on (closed by
+ *              ms_stream_stop, or here on failure)
+ *      double sampleRate
+ *              samples per second
+ *      uint32_t capacity
+ *              samples buffered between the sampler and the consumer
+ *
+ * OUTPUT
+ *      MsStream *stream
+ *              running stream, to be stopped by ms_stream_stop
+ *      Returns MS_STREAM_SUCCESS or MS_STREAM_FAILURE
+ *
+ **********************************
+ */
+int32_t ms_stream_start(MsStream *stream, const MsSource *source,
+        double sampleRate, uint32_t capacity)
+{
+    int32_t started;
+
+    memset(stream, 0, sizeof(MsStream));
+    stream->source = *source;
+    if (!(sampleRate > 0) || (ring_create(&stream->ring, capacity,
+                    sizeof(MsSample)) != RING_BUFFER_SUCCESS))
+    {
+        stream->source.close(&stream->source);
+        return MS_STREAM_FAILURE;
+    }
+    stream->period = 1 / sampleRate;
+
+    stream->running = 1;
+    stream->status = MS_STREAM_RUNNING;
+#ifdef _WIN32
+    stream->thread = CreateThread(NULL, 0, sampler_thread, stream, 0, NULL);
+    started = (stream->thread != NULL);
+#else
+    started = (pthread_create(&stream->thread, NULL, sampler_thread,
+                stream) == 0);
+#endif /* _WIN32 */
+    if (!started)
+    {
+        ring_destroy(&stream->ring);
+        stream->source.close(&stream->source);
+        stream->running = 0;
+        return MS_STREAM_FAILURE;
+    }
+    return MS_STREAM_SUCCESS;
+}
+
+/****f*  mscribe_stream.c/ms_stream_read ******
+ * NAME
+ *	    ms_stream_read
+ *
+ * SYNOPSIS
+ *      uint32_t ms_stream_read(MsStream *stream, MsSample *samples,
+ *              uint32_t maxSamples)
+ *
+ * OUTPUT
+ *      MsSample *samples
+ *              oldest queued samples, at most maxSamples
+ *      Returns the number of samples, 0 if none is queued
+ *
+ **********************************
+ */
+uint32_t ms_stream_read(MsStream *stream, MsSample *samples,
+        uint32_t maxSamples)
+{
+    return ring_pop(&stream->ring, samples, maxSamples);
+}
+
+/****f*  mscribe_stream.c/ms_stream_stop ******
+ * NAME
+ *	    ms_stream_stop
+ *
+ * SYNOPSIS
+ *      void ms_stream_stop(MsStream *stream)
+ *
+ * PURPOSE
+ *	    Stop the sampler, close the source and free the queued samples
+ *
+ **********************************
+ */
+void ms_stream_stop(MsStream *stream)
+{
+    stream->running = 0;
+#ifdef _WIN32
+    WaitForSingleObject(stream->thread, INFINITE);
+    CloseHandle(stream->thread);
+#else
+    pthread_join(stream->thread, NULL);
+#endif /* _WIN32 */
+    stream->source.close(&stream->source);
+    ring_destroy(&stream->ring);
+}
+
+/****f*  mscribe_stream.c/ms_replay_open ******
+ * NAME
+ *	    ms_replay_open
+ *
+ * SYNOPSIS
+ *      int32_t ms_replay_open(MsSource *source, const double *records,
+ *              uint32_t numRecords, int32_t loop)
+ *
+ * INPUTS
+ *      const double *records
+ *              numRecords x MS_REPLAY_COLUMNS matrix, column major as in
+ *              matlab, one arm record per row: timer, buttons, encoders,
+ *              joint angles, tip and direction
+ *      int32_t loop
+ *              non zero to restart at the end of the records
+ *
+ * OUTPUT
+ *      MsSource *source
+ *              source replaying a record per sample
+ *      Returns MS_STREAM_SUCCESS or MS_STREAM_FAILURE
+ *
+ **********************************
+ */
+int32_t ms_replay_open(MsSource *source, const double *records,
+        uint32_t numRecords, int32_t loop)
+{
+    ReplaySource *replay;
+    MsSample *record;
+    const double *row;
+    uint32_t i, j;
+
+    if (numRecords == 0)
+    {
+        return MS_STREAM_FAILURE;
+    }
+    replay = (ReplaySource *)calloc(1, sizeof(ReplaySource));
+    if (replay != NULL)
+    {
+        replay->records = (MsSample *)calloc(numRecords, sizeof(MsSample));
+    }
+    if ((replay == NULL) || (replay->records == NULL))
+    {
+        free(replay);
+        return MS_STREAM_FAILURE;
+    }
+
+    /* row i, column j is records[j * numRecords + i] */
+    for (i = 0; i < numRecords; i++)
+    {
+        record = &replay->records[i];
+        row = records + i;
+        record->timer = (int32_t)row[0];
+        record->buttons = (int32_t)row[numRecords];
+        row += 2 * numRecords;
+        for (j = 0; j < MS_NUM_ENCODERS; j++)
+            record->encoder[j] = (int32_t)row[j * numRecords];
+        row += MS_NUM_ENCODERS * numRecords;
+        for (j = 0; j < MS_NUM_JOINTS; j++)
+            record->joint[j] = (float)row[j * numRecords];
+        row += MS_NUM_JOINTS * numRecords;
+        for (j = 0; j < 3; j++)
+        {
+            record->tip[j] = (float)row[j * numRecords];
+            record->direction[j] = (float)row[(j + 3) * numRecords];
+        }
+    }
+    replay->numRecords = numRecords;
+    replay->loop = loop;
+
+    source->read = replay_read;
+    source->close = replay_close;
+    source->context = replay;
+    return MS_STREAM_SUCCESS;
+}
+
+/****f*  mscribe_stream.c/ms_sample_transform ******
+ * NAME
+ *	    ms_sample_transform
+ *
+ * SYNOPSIS
+ *      void ms_sample_transform(const MsSample *sample,
+ *              double transform[16])
+ *
+ * OUTPUT
+ *      double transform[16]
+ *              4x4 homogeneous transform of the stylus, column major as in
+ *              matlab
+ *
+ * NOTES
+ *      Same as the transform option of mscribe/get, the rotation is
+ *      rotz(yaw) * roty(pitch) * rotx(roll) of the stylus direction
+ *
+ **********************************
+ */
+void ms_sample_transform(const MsSample *sample, double transform[16])
+{
+    double cx, sx, cy, sy, cz, sz;
+
+    cx = cos(sample->direction[0]);
+    sx = sin(sample->direction[0]);
+    cy = cos(sample->direction[1]);
+    sy = sin(sample->direction[1]);
+    cz = cos(sample->direction[2]);
+    sz = sin(sample->direction[2]);
+
+    transform[0] = cz * cy;
+    transform[1] = sz * cy;
+    transform[2] = -sy;
+    transform[3] = 0;
+    transform[4] = cz * sy * sx - sz * cx;
+    transform[5] = sz * sy * sx + cz * cx;
+    transform[6] = cy * sx;
+    transform[7] = 0;
+    transform[8] = cz * sy * cx + sz * sx;
+    transform[9] = sz * sy * cx - cz * sx;
+    transform[10] = cy * cx;
+    transform[11] = 0;
+    transform[12] = sample->tip[0];
+    transform[13] = sample->tip[1];
+    transform[14] = sample->tip[2];
+    transform[15] = 1;
+}
+
+#ifndef _WIN32
+/*
+ * the MicroScribe DLL is windows only (mscribe_dll.cpp), elsewhere the
+ * replay source stands in for it
+ */
+int32_t ms_dll_open(MsSource *source, double sampleRate)
+{
+    (void)sampleRate;
+    source->context = NULL;
+    return MS_STREAM_FAILURE;
+}
+#endif /* _WIN32 */
+
+#ifdef _WIN32
+static DWORD WINAPI sampler_thread(LPVOID argument)
+{
+    sample((MsStream *)argument);
+    return 0;
+}
+#else
+static void *sampler_thread(void *argument)
+{
+    sample((MsStream *)argument);
+    return NULL;
+}
+#endif /* _WIN32 */
+
+/*
+ * sampler loop: copy a record every period until stopped or the source
+ * ends.  A late sample is taken at once, the samples missed meanwhile are
+ * skipped instead of taken in a burst
+ */
+static void sample(MsStream *stream)
+{
+    MsSample current;
+    double now, next;
+    int32_t result;
+
+    memset(&current, 0, sizeof(current));
+    next = stream_clock();
+    while (stream->running)
+    {
+        now = stream_clock();
+        if (now < next)
+        {
+            stream_sleep();
+            continue;
+        }
+        next += stream->period;
+        if (next < now)
+        {
+            next = now + stream->period;
+        }
+
+        result = stream->source.read(&stream->source, &current);
+        if (result < 0)
+        {
+            stream->status = (result == MS_SOURCE_END) ? MS_STREAM_ENDED
+                : MS_STREAM_ERROR;
+            break;
+        }
+        if (result == 0)
+        {
+            continue;
+        }
+        current.timestamp = now;
+        current.sequence = stream->produced;
+        stream->produced++;
+
+        /* the arm does not wait for the consumer */
+        if (ring_push(&stream->ring, &current, 1) == 0)
+        {
+            stream->dropped++;
+        }
+    }
+}
+
+/*
+ * read function of the replay source
+ */
+static int32_t replay_read(MsSource *source, MsSample *sample)
+{
+    ReplaySource *replay = (ReplaySource *)source->context;
+
+    if (replay->next == replay->numRecords)
+    {
+        if (!replay->loop)
+        {
+            return MS_SOURCE_END;
+        }
+        replay->next = 0;
+    }
+    *sample = replay->records[replay->next++];
+    return 1;
+}
+
+static void replay_close(MsSource *source)
+{
+    ReplaySource *replay = (ReplaySource *)source->context;
+
+    if (replay != NULL)
+    {
+        free(replay->records);
+        free(replay);
+    }
+    source->context = NULL;
+}
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,114 @@
+/****h* /mscribe_stream.h ***
+ * NAME
+ * 		mscribe_stream.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Sampling of the MicroScribe arm in a background thread.  At
+ *              every period the fields of the arm record maintained by the
+ *              MicroScribe DLL (encoders, joint angles, stylus tip and
+ *              direction, buttons, timer) are copied into a timestamped
+ *              sample and queued in a lock free ring buffer.  A replay
+ *              source stands in for the DLL where it is not available.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __MSCRIBE_STREAM_H__ /* make sure that mscribe_stream is not redeclared */
+#define __MSCRIBE_STREAM_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#include <pthread.h>
+#endif
+
+#include "ring_buffer.h"
+
+/* defines */
+#define MS_STREAM_SUCCESS 1
+#define MS_STREAM_FAILURE -1
+
+#define MS_NUM_ENCODERS 7
+#define MS_NUM_JOINTS 6
+
+/* status of the sampler */
+#define MS_STREAM_RUNNING 1
+#define MS_STREAM_ENDED 2
+#define MS_STREAM_ERROR 3
+
+/* values returned by the read function of a source */
+#define MS_SOURCE_END -1
+#define MS_SOURCE_ERROR -2
+
+/* replay record: timer, buttons, encoders, joints, tip and direction */
+#define MS_REPLAY_COLUMNS (2 + MS_NUM_ENCODERS + MS_NUM_JOINTS + 6)
+
+typedef struct {
+    double timestamp;           /* seconds of stream_clock */
+    uint32_t sequence;          /* sample number since the start */
+    int32_t timer;              /* running counter of the arm */
+    int32_t buttons;            /* button bits */
+    int32_t encoder[MS_NUM_ENCODERS];
+    float joint[MS_NUM_JOINTS]; /* joint angles, radians */
+    float tip[3];               /* stylus tip, mm */
+    float direction[3];         /* stylus roll, pitch and yaw, radians */
+} MsSample;
+
+typedef struct MsSource MsSource;
+
+/* a source of arm records, read by the sampler thread only */
+struct MsSource {
+    /* fills the fields of the current record except the timestamp and */
+    /* the sequence, returns 1, 0 if no record is available yet, */
+    /* MS_SOURCE_END or MS_SOURCE_ERROR */
+    int32_t (*read)(MsSource *source, MsSample *sample);
+    void (*close)(MsSource *source);
+    void *context;
+};
+
+typedef struct {
+    MsSource source;
+    double period;              /* seconds between samples */
+    RingBuffer ring;
+#ifdef _WIN32
+    void *thread;
+#else
+    pthread_t thread;
+#endif
+    volatile int32_t running;   /* cleared to stop the sampler */
+    volatile int32_t status;    /* MS_STREAM_RUNNING, _ENDED or _ERROR */
+    volatile uint32_t produced; /* samples taken */
+    volatile uint32_t dropped;  /* samples lost because the ring was full */
+} MsStream;
+
+/* function definations */
+int32_t ms_stream_start(MsStream *stream, const MsSource *source,
+        double sampleRate, uint32_t capacity);
+
+uint32_t ms_stream_read(MsStream *stream, MsSample *samples,
+        uint32_t maxSamples);
+
+void ms_stream_stop(MsStream *stream);
+
+int32_t ms_replay_open(MsSource *source, const double *records,
+        uint32_t numRecords, int32_t loop);
+
+int32_t ms_dll_open(MsSource *source, double sampleRate);
+
+void ms_sample_transform(const MsSample *sample, double transform[16]);
+
+#endif /* __MSCRIBE_STREAM_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,382 @@
+/****h* /ndiStream.c ***
+ * NAME
+ *      ndiStream.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function tracks with the NDI camera continuously: a background
+ *      thread (ndi_stream.c) sends the BX command back to back on the
+ *      serial port and queues the timestamped poses, matlab drains them in
+ *      blocks.  The streams stay open between calls, the mex file is
+ *      locked in memory while a stream is open.
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ndi_stream.h"
+#include "stream_clock.h"
+
+/* defines */
+#define NDI_MAX_STREAMS 4
+#define COMMAND_LENGTH 16
+#define OPTION_LENGTH 32
+#define PORT_NAME_LENGTH 256
+#define DEFAULT_CAPACITY 4096
+#define DEFAULT_BAUD_RATE 115200
+
+typedef struct {
+    NdiStream stream;
+    double scale;
+} NdiStreamEntry;
+
+/* open streams, the stream id is the index plus one */
+static NdiStreamEntry *streams[NDI_MAX_STREAMS];
+static int lockedStreams = 0;
+
+/* internal functions */
+static void startStream(mxArray *plhs[], int nrhs,
+        const mxArray *prhs[]);
+static void readStream(mxArray *plhs[], NdiStreamEntry *entry,
+        uint32_t maxPoses);
+static void streamStatus(mxArray *plhs[], NdiStream *stream);
+static void stopStream(int index);
+static void stopAllStreams(void);
+static int getStreamIndex(const mxArray *idArray);
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    char command[COMMAND_LENGTH];
+    uint32_t maxPoses;
+    int index;
+
+    /* first check the inputs */
+    if ((nrhs < 1) || !mxIsChar(prhs[0])
+            || (mxGetString(prhs[0], command, COMMAND_LENGTH) != 0))
+    {
+        mexErrMsgTxt("Must specify a command: start, read, status, stop or clock");
+        return;
+    }
+
+    if (strcmp(command, "start") == 0)
+    {
+        startStream(plhs, nrhs - 1, prhs + 1);
+    }
+    else if (strcmp(command, "clock") == 0)
+    {
+        plhs[0] = mxCreateDoubleScalar(stream_clock());
+    }
+    else if ((strcmp(command, "stop") == 0) && (nrhs == 1))
+    {
+        stopAllStreams();
+    }
+    else if ((strcmp(command, "read") == 0)
+            || (strcmp(command, "status") == 0)
+            || (strcmp(command, "stop") == 0))
+    {
+        if (nrhs < 2)
+        {
+            mexErrMsgTxt("Must specify the stream id");
+            return;
+        }
+        index = getStreamIndex(prhs[1]);
+        if (strcmp(command, "stop") == 0)
+        {
+            stopStream(index);
+        }
+        else if (strcmp(command, "status") == 0)
+        {
+            streamStatus(plhs, &streams[index]->stream);
+        }
+        else
+        {
+            maxPoses = 0xffffffffU;
+            if ((nrhs > 2) && mxIsNumeric(prhs[2])
+                    && (mxGetScalar(prhs[2]) >= 0))
+            {
+                maxPoses = (uint32_t)mxGetScalar(prhs[2]);
+            }
+            readStream(plhs, streams[index], maxPoses);
+        }
+    }
+    else
+    {
+        mexErrMsgTxt("Unknown command, use start, read, status, stop or clock");
+    }
+    return;
+}
+
+/*
+ * id = ndiStream('start',port,'parameter',value,...)
+ */
+static void startStream(mxArray *plhs[], int nrhs,
+        const mxArray *prhs[])
+{
+    char portName[PORT_NAME_LENGTH];
+    char option[OPTION_LENGTH];
+    char trackCommand[NDI_STREAM_COMMAND_LENGTH];
+    NdiTransport transport;
+    NdiStreamEntry *entry;
+    int32_t baudRate = DEFAULT_BAUD_RATE;
+    uint32_t capacity = DEFAULT_CAPACITY;
+    double scale = 1;
+    int index, i;
+
+    if ((nrhs < 1) || (nrhs % 2 != 1) || !mxIsChar(prhs[0])
+            || (mxGetString(prhs[0], portName, PORT_NAME_LENGTH) != 0))
+    {
+        mexErrMsgTxt("Must specify the serial port and parameter/value pairs");
+        return;
+    }
+
+    strcpy(trackCommand, "BX 0801");
+    for (i = 1; i < nrhs; i += 2)
+    {
+        if (!mxIsChar(prhs[i])
+                || (mxGetString(prhs[i], option, OPTION_LENGTH) != 0))
+        {
+            mexErrMsgTxt("Parameter names must be strings");
+            return;
+        }
+        if (strcmp(option, "Command") == 0)
+        {
+            if (!mxIsChar(prhs[i + 1]) || (mxGetString(prhs[i + 1],
+                            trackCommand, NDI_STREAM_COMMAND_LENGTH - 1) != 0)
+                    || (strncmp(trackCommand, "BX", 2) != 0))
+            {
+                mexErrMsgTxt("Command must be a BX command, such as 'BX 0801'");
+                return;
+            }
+        }
+        else if (!mxIsNumeric(prhs[i + 1]) || mxIsEmpty(prhs[i + 1]))
+        {
+            mexErrMsgTxt("Parameter values must be numeric");
+            return;
+        }
+        else if (strcmp(option, "BaudRate") == 0)
+        {
+            baudRate = (int32_t)mxGetScalar(prhs[i + 1]);
+        }
+        else if (strcmp(option, "Capacity") == 0)
+        {
+            capacity = (mxGetScalar(prhs[i + 1]) >= 1)
+                ? (uint32_t)mxGetScalar(prhs[i + 1]) : 1;
+        }
+        else if (strcmp(option, "Scale") == 0)
+        {
+            scale = mxGetScalar(prhs[i + 1]);
+        }
+        else
+        {
+            mexErrMsgTxt("Unknown parameter, use BaudRate, Command, Capacity or Scale");
+            return;
+        }
+    }
+
+    for (index = 0; index < NDI_MAX_STREAMS; index++)
+    {
+        if (streams[index] == NULL)
+            break;
+    }
+    if (index == NDI_MAX_STREAMS)
+    {
+        mexErrMsgTxt("Too many open streams, stop one first");
+        return;
+    }
+
+    if (ndi_serial_open(&transport, portName, baudRate)
+            != NDI_STREAM_SUCCESS)
+    {
+        mexErrMsgTxt("Unable to open the serial port, check that it is not "
+                "open in matlab and the baud rate");
+        return;
+    }
+
+    /* the stream lives until stopped, outside of the matlab memory */
+    entry = (NdiStreamEntry *)malloc(sizeof(NdiStreamEntry));
+    if ((entry == NULL) || (ndi_stream_start(&entry->stream, &transport,
+                    trackCommand, capacity) != NDI_STREAM_SUCCESS))
+    {
+        if (entry == NULL)
+            transport.close(&transport);
+        free(entry);
+        mexErrMsgTxt("Unable to start the stream");
+        return;
+    }
+    entry->scale = scale;
+    streams[index] = entry;
+    if (lockedStreams++ == 0)
+    {
+        mexLock();
+        mexAtExit(stopAllStreams);
+    }
+    plhs[0] = mxCreateDoubleScalar(index + 1);
+}
+
+/*
+ * poses = ndiStream('read',id,maxPoses)
+ */
+static void readStream(mxArray *plhs[], NdiStreamEntry *entry,
+        uint32_t maxPoses)
+{
+    static const char *fieldNames[] = {"timestamp", "latency", "reply",
+        "handle", "status", "quaternion", "position", "error", "portStatus",
+        "frame", "transform"};
+    NdiPose *poses;
+    NdiBxTool *tool;
+    mxArray *timestamp, *latency, *reply, *handle, *status, *quaternion;
+    mxArray *position, *error, *portStatus, *frame, *transform;
+    int dims[3];
+    uint32_t numPoses, i, j;
+
+    numPoses = ring_count(&entry->stream.ring);
+    if (numPoses > maxPoses)
+    {
+        numPoses = maxPoses;
+    }
+    poses = (NdiPose *)mxMalloc((numPoses + 1) * sizeof(NdiPose));
+    numPoses = ndi_stream_read(&entry->stream, poses, numPoses);
+
+    /* one row per pose, the transforms are 4x4xN */
+    timestamp = mxCreateDoubleMatrix(numPoses, 1, mxREAL);
+    latency = mxCreateDoubleMatrix(numPoses, 1, mxREAL);
+    reply = mxCreateDoubleMatrix(numPoses, 1, mxREAL);
+    handle = mxCreateDoubleMatrix(numPoses, 1, mxREAL);
+    status = mxCreateDoubleMatrix(numPoses, 1, mxREAL);
+    quaternion = mxCreateDoubleMatrix(numPoses, 4, mxREAL);
+    position = mxCreateDoubleMatrix(numPoses, 3, mxREAL);
+    error = mxCreateDoubleMatrix(numPoses, 1, mxREAL);
+    portStatus = mxCreateDoubleMatrix(numPoses, 1, mxREAL);
+    frame = mxCreateDoubleMatrix(numPoses, 1, mxREAL);
+    dims[0] = 4;
+    dims[1] = 4;
+    dims[2] = numPoses;
+    transform = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+
+    for (i = 0; i < numPoses; i++)
+    {
+        tool = &poses[i].tool;
+        mxGetPr(timestamp)[i] = poses[i].timestamp;
+        mxGetPr(latency)[i] = poses[i].latency;
+        mxGetPr(reply)[i] = poses[i].reply;
+        mxGetPr(handle)[i] = tool->handle;
+        mxGetPr(status)[i] = tool->status;
+        for (j = 0; j < 4; j++)
+        {
+            mxGetPr(quaternion)[j * numPoses + i] = tool->quaternion[j];
+        }
+        for (j = 0; j < 3; j++)
+        {
+            mxGetPr(position)[j * numPoses + i] =
+                tool->position[j] * entry->scale;
+        }
+        mxGetPr(error)[i] = tool->error;
+        mxGetPr(portStatus)[i] = tool->portStatus;
+        mxGetPr(frame)[i] = tool->frame;
+
+        /* the transform of a tool not visible stays 0 */
+        if (tool->status == NDI_BX_VISIBLE)
+        {
+            ndi_quaternion_to_transform(tool->quaternion, tool->position,
+                    entry->scale, mxGetPr(transform) + 16 * i);
+        }
+    }
+    mxFree(poses);
+
+    plhs[0] = mxCreateStructMatrix(1, 1,
+            sizeof(fieldNames) / sizeof(fieldNames[0]), fieldNames);
+    mxSetField(plhs[0], 0, "timestamp", timestamp);
+    mxSetField(plhs[0], 0, "latency", latency);
+    mxSetField(plhs[0], 0, "reply", reply);
+    mxSetField(plhs[0], 0, "handle", handle);
+    mxSetField(plhs[0], 0, "status", status);
+    mxSetField(plhs[0], 0, "quaternion", quaternion);
+    mxSetField(plhs[0], 0, "position", position);
+    mxSetField(plhs[0], 0, "error", error);
+    mxSetField(plhs[0], 0, "portStatus", portStatus);
+    mxSetField(plhs[0], 0, "frame", frame);
+    mxSetField(plhs[0], 0, "transform", transform);
+}
+
+/*
+ * status = ndiStream('status',id)
+ */
+static void streamStatus(mxArray *plhs[], NdiStream *stream)
+{
+    static const char *fieldNames[] = {"running", "error", "queued",
+        "replies", "repeated", "errors", "dropped"};
+
+    plhs[0] = mxCreateStructMatrix(1, 1, 7, fieldNames);
+    mxSetField(plhs[0], 0, "running",
+            mxCreateLogicalScalar(stream->status == NDI_STREAM_RUNNING));
+    mxSetField(plhs[0], 0, "error",
+            mxCreateLogicalScalar(stream->status == NDI_STREAM_ERROR));
+    mxSetField(plhs[0], 0, "queued",
+            mxCreateDoubleScalar(ring_count(&stream->ring)));
+    mxSetField(plhs[0], 0, "replies",
+            mxCreateDoubleScalar(stream->replies));
+    mxSetField(plhs[0], 0, "repeated",
+            mxCreateDoubleScalar(stream->repeated));
+    mxSetField(plhs[0], 0, "errors",
+            mxCreateDoubleScalar(stream->errors));
+    mxSetField(plhs[0], 0, "dropped",
+            mxCreateDoubleScalar(stream->dropped));
+}
+
+/*
+ * stop and free a stream, the mex file is unlocked with the last one
+ */
+static void stopStream(int index)
+{
+    ndi_stream_stop(&streams[index]->stream);
+    free(streams[index]);
+    streams[index] = NULL;
+    if (--lockedStreams == 0)
+    {
+        mexUnlock();
+    }
+}
+
+static void stopAllStreams(void)
+{
+    int index;
+
+    for (index = 0; index < NDI_MAX_STREAMS; index++)
+    {
+        if (streams[index] != NULL)
+            stopStream(index);
+    }
+}
+
+/*
+ * index of an open stream, errors out on an invalid id
+ */
+static int getStreamIndex(const mxArray *idArray)
+{
+    int index;
+
+    index = mxIsNumeric(idArray) ? (int)mxGetScalar(idArray) - 1 : -1;
+    if ((index < 0) || (index >= NDI_MAX_STREAMS) || (streams[index] == NULL))
+    {
+        mexErrMsgTxt("Invalid stream id");
+        return 0;
+    }
+    return index;
+}
+
+/*----------- END OF FILE ------------ */
@@ -0,0 +1,75 @@
+%NDISTREAM Stream NDI tracking poses from a background reader
+%
+% Syntax:
+%   id = ndiStream('start',port,'parameter',value,...)
+%       opens the serial port of the camera (COM2, /dev/ttyS0...) and starts
+%       a background reader that sends the BX command again as soon as the
+%       previous reply is complete, and queues the timestamped pose of
+%       every handle.  The port must not be open in matlab.  The
+%       parameters are:
+%           BaudRate     local baud rate, as set by the last COMM command
+%                        (default 115200)
+%           Command      tracking command (default 'BX 0801'), the reply
+%                        options must be 0801 or 0001
+%           Capacity     poses queued between two reads (default 4096)
+%           Scale        multiplies the positions and the translations, for
+%                        example 0.001 for meters (default 1, mm)
+%       returns the id of the stream.
+%   poses = ndiStream('read',id)
+%       returns the queued poses, one row per pose.  poses is a structure
+%       with the fields of parseNdiBxReply (handle, status, quaternion,
+%       position, error, portStatus, frame, transform) and
+%           timestamp     time in seconds of ndiStream('clock') when the
+%                         reply was received
+%           latency       seconds from sending the command to the reply
+%           reply         reply number since the start, the same for the
+%                         handles of a reply
+%       Never waits, the fields are empty if no pose is queued.
+%   poses = ndiStream('read',id,maxPoses)
+%       returns at most maxPoses of the oldest queued poses.
+%   status = ndiStream('status',id)
+%       returns a structure with the fields running, error (the port
+%       failed), queued (poses ready to read), replies (valid replies),
+%       repeated (replies of a frame already queued), errors (error,
+%       corrupted or missing replies) and dropped (replies lost to a full
+%       queue).
+%   ndiStream('stop',id)
+%       stops the reader, closes the port and discards the queued poses.
+%   ndiStream('stop')
+%       stops all the streams.
+%   t = ndiStream('clock')
+%       current time of the clock used for the timestamps, the same clock
+%       as ftStream.
+%
+% Notes:
+%   Replies are framed from the length in their header and their CRCs are
+%   checked, instead of waiting a fixed time for the reply as ndi_camera/comm,
+%   so the camera is sampled at its frame rate (20 to 60 Hz) with the
+%   latency of the reply only.  Replies repeating the camera frame of the
+%   last queued reply are not queued.  After an error reply or a corrupted
+%   one the reader waits for the line to be quiet and sends the command
+%   again.
+%   Only the camera on a local serial port is supported, see
+%   ndi_camera/stream to hand the port of an ndi_camera object over.
+%   The mex file stays locked in memory while a stream is open.
+%
+% Example:
+%   id = ndiStream('start','COM2','BaudRate',115200,'Scale',0.001);
+%   pause(1);
+%   poses = ndiStream('read',id);
+%   ndiStream('stop',id);
+%   tool = (poses.handle==1) & (poses.status==1);
+%   plot(poses.timestamp(tool),poses.position(tool,:));
+%
+% See also:
+%    ndi_camera/stream, parseNdiBxReply, ftStream
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
@@ -0,0 +1,287 @@
+/****h* /ndi_bx.c ***
+ * NAME
+ *      ndi_bx.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      Decode a complete binary BX reply of the NDI camera in one pass:
+ *      framing, CRC checks and the data of every handle.  The values are
+ *      assembled from little endian bytes, independently of the host.
+ *
+ * SEE ALSO
+ *      ndi_bx.h, parseNdiBxReply.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <string.h>
+
+#include "ndi_bx.h"
+
+/* internal functions */
+static uint16_t get_uint16(const unsigned char *bytes);
+static uint32_t get_uint32(const unsigned char *bytes);
+static float get_float(const unsigned char *bytes);
+
+/****f*  ndi_bx.c/ndi_bx_frame_length ******
+ * NAME
+ *	    ndi_bx_frame_length
+ *
+ * SYNOPSIS
+ *      int32_t ndi_bx_frame_length(const unsigned char *bytes,
+ *              uint32_t length)
+ *
+ * INPUTS
+ *      const unsigned char *bytes
+ *              start of a reply, length bytes received so far
+ *
+ * OUTPUT
+ *      Returns the size in bytes of the whole reply (header, data and
+ *      CRC), 0 if the header is not complete yet, NDI_BX_BAD_START or
+ *      NDI_BX_BAD_CRC if the bytes are not the header of a binary reply
+ *
+ **********************************
+ */
+int32_t ndi_bx_frame_length(const unsigned char *bytes, uint32_t length)
+{
+    if ((length >= 1) && (bytes[0] != (NDI_BX_START & 0xff)))
+    {
+        return NDI_BX_BAD_START;
+    }
+    if ((length >= 2) && (get_uint16(bytes) != NDI_BX_START))
+    {
+        return NDI_BX_BAD_START;
+    }
+    if (length < NDI_BX_HEADER_SIZE)
+    {
+        return 0;
+    }
+    if (ndi_crc16(bytes, 4) != get_uint16(bytes + 4))
+    {
+        return NDI_BX_BAD_CRC;
+    }
+    return NDI_BX_HEADER_SIZE + get_uint16(bytes + 2) + NDI_BX_CRC_SIZE;
+}
+
+/****f*  ndi_bx.c/ndi_bx_parse ******
+ * NAME
+ *	    ndi_bx_parse
+ *
+ * SYNOPSIS
+ *      int32_t ndi_bx_parse(const unsigned char *bytes, uint32_t length,
+ *              NdiBxReply *reply)
+ *
+ * INPUTS
+ *      const unsigned char *bytes
+ *              complete reply, bytes after the reply CRC are ignored
+ *
+ * OUTPUT
+ *      NdiBxReply *reply
+ *              the handles in the order of the reply
+ *      Returns NDI_BX_SUCCESS, or NDI_BX_TRUNCATED, NDI_BX_BAD_START,
+ *      NDI_BX_BAD_CRC or NDI_BX_BAD_STATUS
+ *
+ **********************************
+ */
+int32_t ndi_bx_parse(const unsigned char *bytes, uint32_t length,
+        NdiBxReply *reply)
+{
+    const unsigned char *data, *end;
+    NdiBxTool *tool;
+    int32_t frameLength;
+    int32_t i, j;
+
+    reply->numHandles = 0;
+    reply->systemStatus = 0;
+    frameLength = ndi_bx_frame_length(bytes, length);
+    if (frameLength < 0)
+    {
+        return frameLength;
+    }
+    if ((frameLength == 0) || ((uint32_t)frameLength > length))
+    {
+        return NDI_BX_TRUNCATED;
+    }
+
+    /* the CRC of the data follows it */
+    data = bytes + NDI_BX_HEADER_SIZE;
+    end = bytes + frameLength - NDI_BX_CRC_SIZE;
+    if (ndi_crc16(data, (uint32_t)(end - data)) != get_uint16(end))
+    {
+        return NDI_BX_BAD_CRC;
+    }
+
+    if (data + 1 > end)
+    {
+        return NDI_BX_TRUNCATED;
+    }
+    reply->numHandles = *data++;
+    for (i = 0; i < reply->numHandles; i++)
+    {
+        tool = &reply->tools[i];
+        memset(tool, 0, sizeof(NdiBxTool));
+        if (data + 2 > end)
+        {
+            return NDI_BX_TRUNCATED;
+        }
+        tool->handle = data[0];
+        tool->status = data[1];
+        data += 2;
+
+        switch (tool->status)
+        {
+            case NDI_BX_VISIBLE:
+                if (data + 40 > end)
+                {
+                    return NDI_BX_TRUNCATED;
+                }
+                for (j = 0; j < 4; j++)
+                {
+                    tool->quaternion[j] = get_float(data + 4 * j);
+                }
+                for (j = 0; j < 3; j++)
+                {
+                    tool->position[j] = get_float(data + 16 + 4 * j);
+                }
+                tool->error = get_float(data + 28);
+                tool->portStatus = get_uint32(data + 32);
+                tool->frame = get_uint32(data + 36);
+                data += 40;
+                break;
+            case NDI_BX_MISSING:
+                if (data + 8 > end)
+                {
+                    return NDI_BX_TRUNCATED;
+                }
+                tool->portStatus = get_uint32(data);
+                tool->frame = get_uint32(data + 4);
+                data += 8;
+                break;
+            case NDI_BX_DISABLED:
+                break;
+            default:
+                /* the size of the handle data is unknown */
+                return NDI_BX_BAD_STATUS;
+        }
+    }
+
+    if (data + 2 > end)
+    {
+        return NDI_BX_TRUNCATED;
+    }
+    reply->systemStatus = get_uint16(data);
+    return NDI_BX_SUCCESS;
+}
+
+/****f*  ndi_bx.c/ndi_crc16 ******
+ * NAME
+ *	    ndi_crc16
+ *
+ * SYNOPSIS
+ *      uint16_t ndi_crc16(const unsigned char *bytes, uint32_t length)
+ *
+ * OUTPUT
+ *      Returns the CRC of the bytes as computed by the NDI camera (CRC-16,
+ *      polynomial 0x8005 reflected, initial value 0)
+ *
+ **********************************
+ */
+uint16_t ndi_crc16(const unsigned char *bytes, uint32_t length)
+{
+    uint16_t crc = 0;
+    uint32_t i;
+    int bit;
+
+    for (i = 0; i < length; i++)
+    {
+        crc ^= bytes[i];
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001)
+                : (uint16_t)(crc >> 1);
+        }
+    }
+    return crc;
+}
+
+/****f*  ndi_bx.c/ndi_quaternion_to_transform ******
+ * NAME
+ *	    ndi_quaternion_to_transform
+ *
+ * SYNOPSIS
+ *      void ndi_quaternion_to_transform(const float quaternion[4],
+ *              const float position[3], double scale, double transform[16])
+ *
+ * INPUTS
+ *      const float quaternion[4]
+ *              unit quaternion q0 qx qy qz
+ *      const float position[3]
+ *              translation, multiplied by scale
+ *
+ * OUTPUT
+ *      double transform[16]
+ *              4x4 homogeneous transform, column major as in matlab
+ *
+ * NOTES
+ *      Same rotation as q2tr of the robot toolbox, the quaternion is not
+ *      normalized
+ *
+ **********************************
+ */
+void ndi_quaternion_to_transform(const float quaternion[4],
+        const float position[3], double scale, double transform[16])
+{
+    double s, x, y, z;
+
+    s = quaternion[0];
+    x = quaternion[1];
+    y = quaternion[2];
+    z = quaternion[3];
+
+    transform[0] = 1 - 2 * (y * y + z * z);
+    transform[1] = 2 * (x * y + s * z);
+    transform[2] = 2 * (x * z - s * y);
+    transform[3] = 0;
+    transform[4] = 2 * (x * y - s * z);
+    transform[5] = 1 - 2 * (x * x + z * z);
+    transform[6] = 2 * (y * z + s * x);
+    transform[7] = 0;
+    transform[8] = 2 * (x * z + s * y);
+    transform[9] = 2 * (y * z - s * x);
+    transform[10] = 1 - 2 * (x * x + y * y);
+    transform[11] = 0;
+    transform[12] = position[0] * scale;
+    transform[13] = position[1] * scale;
+    transform[14] = position[2] * scale;
+    transform[15] = 1;
+}
+
+static uint16_t get_uint16(const unsigned char *bytes)
+{
+    return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+static uint32_t get_uint32(const unsigned char *bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8)
+        | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static float get_float(const unsigned char *bytes)
+{
+    uint32_t bits;
+    float value;
+
+    bits = get_uint32(bytes);
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,92 @@
+/****h* /ndi_bx.h ***
+ * NAME
+ * 		ndi_bx.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Decoding of the binary replies of the NDI camera to the BX
+ *              command (reply option 0x0001, transformation data, with or
+ *              without 0x0800, transformations out of volume).  The reply is
+ *              little endian:
+ *                  header      A5C4, reply length, header CRC (2 bytes each)
+ *                  handles     number of handles (1 byte), then per handle
+ *                              the handle and its status (1 byte each) and
+ *                      visible   Q0 Qx Qy Qz Tx Ty Tz error (floats), port
+ *                                status and frame number (4 bytes each)
+ *                      missing   port status and frame number
+ *                      disabled  nothing more
+ *                  trailer     system status, reply CRC (2 bytes each)
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __NDI_BX_H__ /* make sure that ndi_bx is not redeclared */
+#define __NDI_BX_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#endif
+
+/* defines */
+#define NDI_BX_SUCCESS 1
+#define NDI_BX_TRUNCATED -1         /* the reply is shorter than announced */
+#define NDI_BX_BAD_START -2         /* the reply does not start with A5C4 */
+#define NDI_BX_BAD_CRC -3           /* header or reply CRC mismatch */
+#define NDI_BX_BAD_STATUS -4        /* unknown handle status */
+
+#define NDI_BX_START 0xA5C4
+#define NDI_BX_HEADER_SIZE 6
+#define NDI_BX_CRC_SIZE 2
+#define NDI_BX_MAX_HANDLES 255
+
+/* handle status */
+#define NDI_BX_VISIBLE 1
+#define NDI_BX_MISSING 2
+#define NDI_BX_DISABLED 4
+
+/* bits of the port status */
+#define NDI_BX_OUT_OF_VOLUME 0x40
+#define NDI_BX_PARTIALLY_OUT_OF_VOLUME 0x80
+
+typedef struct {
+    uint8_t handle;
+    uint8_t status;             /* NDI_BX_VISIBLE, _MISSING or _DISABLED */
+    float quaternion[4];        /* q0 qx qy qz, 0 unless visible */
+    float position[3];          /* mm, 0 unless visible */
+    float error;                /* rms fit error in mm */
+    uint32_t portStatus;
+    uint32_t frame;             /* frame number of the camera */
+} NdiBxTool;
+
+typedef struct {
+    int32_t numHandles;
+    NdiBxTool tools[NDI_BX_MAX_HANDLES];
+    uint16_t systemStatus;
+} NdiBxReply;
+
+/* function definations */
+int32_t ndi_bx_frame_length(const unsigned char *bytes, uint32_t length);
+
+int32_t ndi_bx_parse(const unsigned char *bytes, uint32_t length,
+        NdiBxReply *reply);
+
+uint16_t ndi_crc16(const unsigned char *bytes, uint32_t length);
+
+void ndi_quaternion_to_transform(const float quaternion[4],
+        const float position[3], double scale, double transform[16]);
+
+#endif /* __NDI_BX_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,587 @@
+/****h* /ndi_stream.c ***
+ * NAME
+ *      ndi_stream.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      Continuous tracking with the NDI camera in a background thread.
+ *      Instead of waiting a fixed time for the reply, the reader frames
+ *      it from the length in its header and checks its CRCs, so the next
+ *      command goes out as soon as a reply is complete and the camera is
+ *      sampled at its own frame rate.  The poses are queued in a single
+ *      producer, single consumer ring buffer with the time the reply was
+ *      received.
+ *
+ * SEE ALSO
+ *      ndi_stream.h, ndi_bx.c, ring_buffer.c, ndiStream.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif /* _WIN32 */
+
+#include "ndi_stream.h"
+#include "stream_clock.h"
+
+/* defines */
+#define ASCII_REPLY_END '\r'
+
+typedef struct {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    int fd;
+#endif /* _WIN32 */
+} SerialPort;
+
+/* internal functions */
+#ifdef _WIN32
+static DWORD WINAPI reader_thread(LPVOID argument);
+#else
+static void *reader_thread(void *argument);
+#endif /* _WIN32 */
+static void track(NdiStream *stream);
+static int32_t receive_reply(NdiStream *stream, unsigned char *reply,
+        double sent);
+static void flush_transport(NdiStream *stream);
+static void queue_poses(NdiStream *stream, const NdiBxReply *bxReply,
+        double sent, double received);
+static int32_t serial_write(NdiTransport *transport,
+        const unsigned char *bytes, uint32_t length);
+static int32_t serial_read(NdiTransport *transport, unsigned char *bytes,
+        uint32_t maxBytes);
+static void serial_close(NdiTransport *transport);
+
+/****f*  ndi_stream.c/ndi_stream_start ******
+ * NAME
+ *	    ndi_stream_start
+ *
+ * SYNOPSIS
+ *      int32_t ndi_stream_start(NdiStream *stream,
+ *              const NdiTransport *transport, const char *command,
+ *              uint32_t capacity)
+ *
+ * INPUTS
+ *      const NdiTransport *transport
+ *              opened link to the camera, owned by the stream from now on
+ *              (closed by ndi_stream_stop, or here on failure)
+ *      const char *command
+ *              tracking command with binary transformation data, such as
+ *              BX 0801, without the CR
+ *      uint32_t capacity
+ *              poses buffered between the reader and the consumer
+ *
+ * OUTPUT
+ *      NdiStream *stream
+ *              running stream, to be stopped by ndi_stream_stop
+ *      Returns NDI_STREAM_SUCCESS or NDI_STREAM_FAILURE
+ *
+ **********************************
+ */
+int32_t ndi_stream_start(NdiStream *stream, const NdiTransport *transport,
+        const char *command, uint32_t capacity)
+{
+    int32_t started;
+
+    memset(stream, 0, sizeof(NdiStream));
+    stream->transport = *transport;
+    if ((strlen(command) + 2 > NDI_STREAM_COMMAND_LENGTH)
+            || (ring_create(&stream->ring, capacity, sizeof(NdiPose))
+                != RING_BUFFER_SUCCESS))
+    {
+        stream->transport.close(&stream->transport);
+        return NDI_STREAM_FAILURE;
+    }
+    sprintf(stream->command, "%s\r", command);
+
+    stream->running = 1;
+    stream->status = NDI_STREAM_RUNNING;
+#ifdef _WIN32
+    stream->thread = CreateThread(NULL, 0, reader_thread, stream, 0, NULL);
+    started = (stream->thread != NULL);
+#else
+    started = (pthread_create(&stream->thread, NULL, reader_thread,
+                stream) == 0);
+#endif /* _WIN32 */
+    if (!started)
+    {
+        ring_destroy(&stream->ring);
+        stream->transport.close(&stream->transport);
+        stream->running = 0;
+        return NDI_STREAM_FAILURE;
+    }
+    return NDI_STREAM_SUCCESS;
+}
+
+/****f*  ndi_stream.c/ndi_stream_read ******
+ * NAME
+ *	    ndi_stream_read
+ *
+ * SYNOPSIS
+ *      uint32_t ndi_stream_read(NdiStream *stream, NdiPose *poses,
+ *              uint32_t maxPoses)
+ *
+ * OUTPUT
+ *      NdiPose *poses
+ *              oldest queued poses, at most maxPoses; the poses of a reply
+ *              are consecutive
+ *      Returns the number of poses, 0 if none is queued
+ *
+ **********************************
+ */
+uint32_t ndi_stream_read(NdiStream *stream, NdiPose *poses,
+        uint32_t maxPoses)
+{
+    return ring_pop(&stream->ring, poses, maxPoses);
+}
+
+/****f*  ndi_stream.c/ndi_stream_stop ******
+ * NAME
+ *	    ndi_stream_stop
+ *
+ * SYNOPSIS
+ *      void ndi_stream_stop(NdiStream *stream)
+ *
+ * PURPOSE
+ *	    Stop the reader after the current reply, close the transport and
+ *	    free the queued poses
+ *
+ **********************************
+ */
+void ndi_stream_stop(NdiStream *stream)
+{
+    stream->running = 0;
+#ifdef _WIN32
+    WaitForSingleObject(stream->thread, INFINITE);
+    CloseHandle(stream->thread);
+#else
+    pthread_join(stream->thread, NULL);
+#endif /* _WIN32 */
+    stream->transport.close(&stream->transport);
+    ring_destroy(&stream->ring);
+}
+
+/****f*  ndi_stream.c/ndi_serial_open ******
+ * NAME
+ *	    ndi_serial_open
+ *
+ * SYNOPSIS
+ *      int32_t ndi_serial_open(NdiTransport *transport,
+ *              const char *portName, int32_t baudRate)
+ *
+ * INPUTS
+ *      const char *portName
+ *              COM1... on windows, device path (/dev/ttyS0...) otherwise
+ *      int32_t baudRate
+ *              local baud rate, the one set by the last COMM command
+ *
+ * OUTPUT
+ *      NdiTransport *transport
+ *              8N1 serial link without flow control
+ *      Returns NDI_STREAM_SUCCESS or NDI_STREAM_FAILURE if the port can not
+ *      be opened or the baud rate is not supported
+ *
+ **********************************
+ */
+int32_t ndi_serial_open(NdiTransport *transport, const char *portName,
+        int32_t baudRate)
+{
+    SerialPort *port;
+#ifdef _WIN32
+    char deviceName[64];
+    DCB settings;
+    COMMTIMEOUTS timeouts;
+#else
+    struct termios settings;
+    speed_t speed;
+#endif /* _WIN32 */
+
+    port = (SerialPort *)malloc(sizeof(SerialPort));
+    if (port == NULL)
+    {
+        return NDI_STREAM_FAILURE;
+    }
+
+#ifdef _WIN32
+    /* the device name is needed for the ports above COM9 */
+    if (strlen(portName) + 5 > sizeof(deviceName))
+    {
+        free(port);
+        return NDI_STREAM_FAILURE;
+    }
+    sprintf(deviceName, "\\\\.\\%s", portName);
+    port->handle = CreateFileA(deviceName, GENERIC_READ | GENERIC_WRITE, 0,
+            NULL, OPEN_EXISTING, 0, NULL);
+    if (port->handle == INVALID_HANDLE_VALUE)
+    {
+        free(port);
+        return NDI_STREAM_FAILURE;
+    }
+    memset(&settings, 0, sizeof(settings));
+    settings.DCBlength = sizeof(settings);
+
+    /* a read returns as soon as bytes are there, or after 100 ms */
+    timeouts.ReadIntervalTimeout = MAXDWORD;
+    timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+    timeouts.ReadTotalTimeoutConstant = 100;
+    timeouts.WriteTotalTimeoutMultiplier = 0;
+    timeouts.WriteTotalTimeoutConstant = 1000;
+    if (!GetCommState(port->handle, &settings))
+    {
+        CloseHandle(port->handle);
+        free(port);
+        return NDI_STREAM_FAILURE;
+    }
+    settings.BaudRate = baudRate;
+    settings.ByteSize = 8;
+    settings.Parity = NOPARITY;
+    settings.StopBits = ONESTOPBIT;
+    settings.fBinary = TRUE;
+    settings.fParity = FALSE;
+    settings.fOutxCtsFlow = FALSE;
+    settings.fOutxDsrFlow = FALSE;
+    settings.fDtrControl = DTR_CONTROL_ENABLE;
+    settings.fRtsControl = RTS_CONTROL_ENABLE;
+    settings.fOutX = FALSE;
+    settings.fInX = FALSE;
+    if (!SetCommState(port->handle, &settings)
+            || !SetCommTimeouts(port->handle, &timeouts))
+    {
+        CloseHandle(port->handle);
+        free(port);
+        return NDI_STREAM_FAILURE;
+    }
+    PurgeComm(port->handle, PURGE_RXCLEAR | PURGE_TXCLEAR);
+#else
+    switch (baudRate)
+    {
+        case 9600:
+            speed = B9600;
+            break;
+        case 19200:
+            speed = B19200;
+            break;
+        case 38400:
+            speed = B38400;
+            break;
+        case 57600:
+            speed = B57600;
+            break;
+        case 115200:
+            speed = B115200;
+            break;
+        case 230400:
+            speed = B230400;
+            break;
+        default:
+            free(port);
+            return NDI_STREAM_FAILURE;
+    }
+    port->fd = open(portName, O_RDWR | O_NOCTTY);
+    if (port->fd < 0)
+    {
+        free(port);
+        return NDI_STREAM_FAILURE;
+    }
+
+    /* raw 8N1, a read returns as soon as bytes are there, or after 100 ms */
+    if (tcgetattr(port->fd, &settings) != 0)
+    {
+        close(port->fd);
+        free(port);
+        return NDI_STREAM_FAILURE;
+    }
+    settings.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR
+            | ICRNL | IXON | IXOFF);
+    settings.c_oflag &= ~OPOST;
+    settings.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+    settings.c_cflag &= ~(CSIZE | PARENB | CSTOPB);
+    settings.c_cflag |= CS8 | CLOCAL | CREAD;
+    settings.c_cc[VMIN] = 0;
+    settings.c_cc[VTIME] = 1;
+    if ((cfsetispeed(&settings, speed) != 0)
+            || (cfsetospeed(&settings, speed) != 0)
+            || (tcsetattr(port->fd, TCSANOW, &settings) != 0))
+    {
+        close(port->fd);
+        free(port);
+        return NDI_STREAM_FAILURE;
+    }
+    tcflush(port->fd, TCIOFLUSH);
+#endif /* _WIN32 */
+
+    transport->write = serial_write;
+    transport->read = serial_read;
+    transport->close = serial_close;
+    transport->context = port;
+    return NDI_STREAM_SUCCESS;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI reader_thread(LPVOID argument)
+{
+    track((NdiStream *)argument);
+    return 0;
+}
+#else
+static void *reader_thread(void *argument)
+{
+    track((NdiStream *)argument);
+    return NULL;
+}
+#endif /* _WIN32 */
+
+/*
+ * reader loop: send the command, wait for the complete reply and queue its
+ * poses, until stopped or the transport fails
+ */
+static void track(NdiStream *stream)
+{
+    unsigned char reply[NDI_STREAM_MAX_REPLY];
+    NdiBxReply *bxReply;
+    double sent, received;
+    int32_t length;
+
+    bxReply = (NdiBxReply *)malloc(sizeof(NdiBxReply));
+    if (bxReply == NULL)
+    {
+        stream->status = NDI_STREAM_ERROR;
+        return;
+    }
+
+    while (stream->running)
+    {
+        if (stream->transport.write(&stream->transport,
+                    (const unsigned char *)stream->command,
+                    (uint32_t)strlen(stream->command)) != NDI_STREAM_SUCCESS)
+        {
+            stream->status = NDI_STREAM_ERROR;
+            break;
+        }
+        sent = stream_clock();
+
+        length = receive_reply(stream, reply, sent);
+        received = stream_clock();
+        if (length == NDI_STREAM_FAILURE)
+        {
+            stream->status = NDI_STREAM_ERROR;
+            break;
+        }
+        if (length == 0)
+        {
+            /* stopped while waiting */
+            break;
+        }
+
+        /* an error reply or a corrupted one, start over on a clean line */
+        if ((length < 0)
+                || (ndi_bx_parse(reply, (uint32_t)length, bxReply)
+                    != NDI_BX_SUCCESS))
+        {
+            stream->errors++;
+            flush_transport(stream);
+            continue;
+        }
+        stream->replies++;
+        queue_poses(stream, bxReply, sent, received);
+    }
+    free(bxReply);
+}
+
+/*
+ * read a reply, returns its length, 0 if stopped, -2 for an ascii reply
+ * (ERROR...), a reply that can not be framed or none in time, or
+ * NDI_STREAM_FAILURE if the transport failed
+ */
+static int32_t receive_reply(NdiStream *stream, unsigned char *reply,
+        double sent)
+{
+    uint32_t received;
+    int32_t count, frameLength;
+
+    received = 0;
+    frameLength = 0;
+    while (stream->running)
+    {
+        count = stream->transport.read(&stream->transport, reply + received,
+                NDI_STREAM_MAX_REPLY - received);
+        if (count < 0)
+        {
+            return NDI_STREAM_FAILURE;
+        }
+        received += count;
+
+        if (received > 0)
+        {
+            frameLength = ndi_bx_frame_length(reply, received);
+            if (frameLength == NDI_BX_BAD_START)
+            {
+                /* an ascii reply ends with a CR */
+                if (memchr(reply, ASCII_REPLY_END, received) != NULL)
+                {
+                    return -2;
+                }
+            }
+            else if ((frameLength < 0)
+                    || (frameLength > NDI_STREAM_MAX_REPLY))
+            {
+                return -2;
+            }
+            else if ((frameLength > 0) && (received >= (uint32_t)frameLength))
+            {
+                return frameLength;
+            }
+        }
+        if ((received == NDI_STREAM_MAX_REPLY)
+                || (stream_clock() - sent > NDI_STREAM_REPLY_TIMEOUT))
+        {
+            return -2;
+        }
+    }
+    return 0;
+}
+
+/*
+ * discard the bytes until the line is quiet
+ */
+static void flush_transport(NdiStream *stream)
+{
+    unsigned char bytes[256];
+
+    while (stream->running && (stream->transport.read(&stream->transport,
+                    bytes, sizeof(bytes)) > 0))
+    {
+    }
+}
+
+/*
+ * queue a pose per handle, all or none, unless the reply repeats the frame
+ * of the last one queued
+ */
+static void queue_poses(NdiStream *stream, const NdiBxReply *bxReply,
+        double sent, double received)
+{
+    NdiPose poses[NDI_BX_MAX_HANDLES];
+    uint32_t frame, numPoses, i;
+
+    frame = 0;
+    numPoses = (uint32_t)bxReply->numHandles;
+    for (i = 0; i < numPoses; i++)
+    {
+        if (bxReply->tools[i].frame > frame)
+        {
+            frame = bxReply->tools[i].frame;
+        }
+    }
+    if ((frame != 0) && (frame == stream->lastFrame))
+    {
+        stream->repeated++;
+        return;
+    }
+    stream->lastFrame = frame;
+
+    /* only the reader adds poses, the free space can only grow */
+    if (stream->ring.capacity - ring_count(&stream->ring) < numPoses)
+    {
+        stream->dropped++;
+        return;
+    }
+    for (i = 0; i < numPoses; i++)
+    {
+        poses[i].timestamp = received;
+        poses[i].latency = received - sent;
+        poses[i].reply = stream->replies - 1;
+        poses[i].tool = bxReply->tools[i];
+    }
+    ring_push(&stream->ring, poses, numPoses);
+}
+
+/*
+ * serial transport
+ */
+static int32_t serial_write(NdiTransport *transport,
+        const unsigned char *bytes, uint32_t length)
+{
+    SerialPort *port = (SerialPort *)transport->context;
+#ifdef _WIN32
+    DWORD written;
+
+    if (!WriteFile(port->handle, bytes, length, &written, NULL)
+            || (written != length))
+    {
+        return NDI_STREAM_FAILURE;
+    }
+#else
+    ssize_t written;
+
+    while (length > 0)
+    {
+        written = write(port->fd, bytes, length);
+        if (written <= 0)
+        {
+            return NDI_STREAM_FAILURE;
+        }
+        bytes += written;
+        length -= (uint32_t)written;
+    }
+#endif /* _WIN32 */
+    return NDI_STREAM_SUCCESS;
+}
+
+static int32_t serial_read(NdiTransport *transport, unsigned char *bytes,
+        uint32_t maxBytes)
+{
+    SerialPort *port = (SerialPort *)transport->context;
+#ifdef _WIN32
+    DWORD count;
+
+    if (!ReadFile(port->handle, bytes, maxBytes, &count, NULL))
+    {
+        return NDI_STREAM_FAILURE;
+    }
+#else
+    ssize_t count;
+
+    count = read(port->fd, bytes, maxBytes);
+    if (count < 0)
+    {
+        return NDI_STREAM_FAILURE;
+    }
+#endif /* _WIN32 */
+    return (int32_t)count;
+}
+
+static void serial_close(NdiTransport *transport)
+{
+    SerialPort *port = (SerialPort *)transport->context;
+
+    if (port != NULL)
+    {
+#ifdef _WIN32
+        CloseHandle(port->handle);
+#else
+        close(port->fd);
+#endif /* _WIN32 */
+        free(port);
+    }
+    transport->context = NULL;
+}
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,109 @@
+/****h* /ndi_stream.h ***
+ * NAME
+ * 		ndi_stream.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Continuous tracking with the NDI camera.  A background
+ *              thread sends the BX command as soon as the previous reply
+ *              is complete, frames the binary replies by their length and
+ *              CRC, and queues the timestamped pose of every handle in a
+ *              lock free ring buffer.  Replies repeating the last camera
+ *              frame are not queued.  The transport is pluggable, a serial
+ *              port transport is provided.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __NDI_STREAM_H__ /* make sure that ndi_stream is not redeclared */
+#define __NDI_STREAM_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#include <pthread.h>
+#endif
+
+#include "ndi_bx.h"
+#include "ring_buffer.h"
+
+/* defines */
+#define NDI_STREAM_SUCCESS 1
+#define NDI_STREAM_FAILURE -1
+
+#define NDI_STREAM_COMMAND_LENGTH 32
+#define NDI_STREAM_MAX_REPLY 4096
+
+/* seconds without a complete reply before the command is sent again */
+#define NDI_STREAM_REPLY_TIMEOUT 1.0
+
+/* status of the reader */
+#define NDI_STREAM_RUNNING 1
+#define NDI_STREAM_ERROR 3
+
+typedef struct {
+    double timestamp;           /* seconds of stream_clock, reply received */
+    double latency;             /* seconds from the command to the reply */
+    uint32_t reply;             /* reply number since the start */
+    NdiBxTool tool;
+} NdiPose;
+
+typedef struct NdiTransport NdiTransport;
+
+/* a link to the camera, used by the reader thread only */
+struct NdiTransport {
+    /* writes all the bytes, returns NDI_STREAM_SUCCESS or _FAILURE */
+    int32_t (*write)(NdiTransport *transport, const unsigned char *bytes,
+            uint32_t length);
+    /* reads up to maxBytes, waits at most about 100 ms for the first one */
+    /* returns the number of bytes, 0 on timeout or NDI_STREAM_FAILURE */
+    int32_t (*read)(NdiTransport *transport, unsigned char *bytes,
+            uint32_t maxBytes);
+    void (*close)(NdiTransport *transport);
+    void *context;
+};
+
+typedef struct {
+    NdiTransport transport;
+    char command[NDI_STREAM_COMMAND_LENGTH]; /* with the trailing CR */
+    RingBuffer ring;
+#ifdef _WIN32
+    void *thread;
+#else
+    pthread_t thread;
+#endif
+    volatile int32_t running;   /* cleared to stop the reader */
+    volatile int32_t status;    /* NDI_STREAM_RUNNING or _ERROR */
+    volatile uint32_t replies;  /* valid replies received */
+    volatile uint32_t repeated; /* replies of a frame already queued */
+    volatile uint32_t errors;   /* error, corrupted or missing replies */
+    volatile uint32_t dropped;  /* replies lost because the ring was full */
+    uint32_t lastFrame;
+} NdiStream;
+
+/* function definations */
+int32_t ndi_stream_start(NdiStream *stream, const NdiTransport *transport,
+        const char *command, uint32_t capacity);
+
+uint32_t ndi_stream_read(NdiStream *stream, NdiPose *poses,
+        uint32_t maxPoses);
+
+void ndi_stream_stop(NdiStream *stream);
+
+int32_t ndi_serial_open(NdiTransport *transport, const char *portName,
+        int32_t baudRate);
+
+#endif /* __NDI_STREAM_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
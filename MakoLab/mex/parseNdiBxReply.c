@@ -0,0 +1,142 @@
+/****h* /parseNdiBxReply.c ***
+ * NAME
+ *      parseNdiBxReply.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function parses a complete binary reply of the NDI camera to
+ *      the BX command in a single call, all the handles are returned as
+ *      packed arrays with their homogeneous transforms
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+#include <string.h>
+
+#include "ndi_bx.h"
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    static const char *fieldNames[] = {"handle", "status", "quaternion",
+        "position", "error", "portStatus", "frame", "transform",
+        "systemStatus"};
+    NdiBxReply *reply;
+    NdiBxTool *tool;
+    mxArray *handle, *status, *quaternion, *position, *error;
+    mxArray *portStatus, *frame, *transform;
+    double scale;
+    int dims[3];
+    int numHandles, i, j;
+    int32_t result;
+
+    /* first check the inputs */
+    if (nrhs < 1)
+    {
+        mexErrMsgTxt("Must specify the reply to parse");
+        return;
+    }
+    if (mxGetClassID(prhs[0]) != mxUINT8_CLASS)
+    {
+        mexErrMsgTxt("Datatype must be uint8");
+        return;
+    }
+    scale = 1;
+    if (nrhs > 1)
+    {
+        if (!mxIsNumeric(prhs[1]) || mxIsEmpty(prhs[1]))
+        {
+            mexErrMsgTxt("Scale must be a number");
+            return;
+        }
+        scale = mxGetScalar(prhs[1]);
+    }
+
+    reply = (NdiBxReply *)mxMalloc(sizeof(NdiBxReply));
+    result = ndi_bx_parse((const unsigned char *)mxGetData(prhs[0]),
+            (uint32_t)mxGetNumberOfElements(prhs[0]), reply);
+    switch (result)
+    {
+        case NDI_BX_SUCCESS:
+            break;
+        case NDI_BX_BAD_START:
+            mexErrMsgTxt("Not a binary reply, the reply does not start with A5C4");
+            return;
+        case NDI_BX_BAD_CRC:
+            mexErrMsgTxt("CRC mismatch, the reply is corrupted");
+            return;
+        case NDI_BX_BAD_STATUS:
+            mexErrMsgTxt("Unknown handle status, only reply option 0801 or 0001 is supported");
+            return;
+        default:
+            mexErrMsgTxt("Reply truncated");
+            return;
+    }
+
+    /* one row per handle, the transforms are 4x4xN */
+    numHandles = reply->numHandles;
+    handle = mxCreateDoubleMatrix(numHandles, 1, mxREAL);
+    status = mxCreateDoubleMatrix(numHandles, 1, mxREAL);
+    quaternion = mxCreateDoubleMatrix(numHandles, 4, mxREAL);
+    position = mxCreateDoubleMatrix(numHandles, 3, mxREAL);
+    error = mxCreateDoubleMatrix(numHandles, 1, mxREAL);
+    portStatus = mxCreateDoubleMatrix(numHandles, 1, mxREAL);
+    frame = mxCreateDoubleMatrix(numHandles, 1, mxREAL);
+    dims[0] = 4;
+    dims[1] = 4;
+    dims[2] = numHandles;
+    transform = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+
+    for (i = 0; i < numHandles; i++)
+    {
+        tool = &reply->tools[i];
+        mxGetPr(handle)[i] = tool->handle;
+        mxGetPr(status)[i] = tool->status;
+        for (j = 0; j < 4; j++)
+        {
+            mxGetPr(quaternion)[j * numHandles + i] = tool->quaternion[j];
+        }
+        for (j = 0; j < 3; j++)
+        {
+            mxGetPr(position)[j * numHandles + i] = tool->position[j] * scale;
+        }
+        mxGetPr(error)[i] = tool->error;
+        mxGetPr(portStatus)[i] = tool->portStatus;
+        mxGetPr(frame)[i] = tool->frame;
+
+        /* the transform of a tool not visible stays 0 */
+        if (tool->status == NDI_BX_VISIBLE)
+        {
+            ndi_quaternion_to_transform(tool->quaternion, tool->position,
+                    scale, mxGetPr(transform) + 16 * i);
+        }
+    }
+
+    plhs[0] = mxCreateStructMatrix(1, 1,
+            sizeof(fieldNames) / sizeof(fieldNames[0]), fieldNames);
+    mxSetField(plhs[0], 0, "handle", handle);
+    mxSetField(plhs[0], 0, "status", status);
+    mxSetField(plhs[0], 0, "quaternion", quaternion);
+    mxSetField(plhs[0], 0, "position", position);
+    mxSetField(plhs[0], 0, "error", error);
+    mxSetField(plhs[0], 0, "portStatus", portStatus);
+    mxSetField(plhs[0], 0, "frame", frame);
+    mxSetField(plhs[0], 0, "transform", transform);
+    mxSetField(plhs[0], 0, "systemStatus",
+            mxCreateDoubleScalar(reply->systemStatus));
+    mxFree(reply);
+    return;
+}
+
+/*----------- END OF FILE ------------ */
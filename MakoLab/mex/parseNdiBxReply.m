@@ -0,0 +1,44 @@
+%PARSENDIBXREPLY Parse a binary BX reply of the NDI camera
+%
+% Syntax:
+%   data = parseNdiBxReply(reply)
+%       parses the complete reply (uint8 array, starting with the A5C4
+%       header) of the NDI camera to the BX 0801 or BX 0001 command.  The
+%       header and reply CRCs are checked.  data is a structure with one
+%       row per handle, in the order of the reply:
+%           handle        handle number
+%           status        1 visible, 2 missing, 4 disabled
+%           quaternion    Nx4 [q0 qx qy qz]
+%           position      Nx3 [x y z] (mm)
+%           error         rms error of the fit (mm)
+%           portStatus    port status, bit 7 (0x40) out of volume, bit 8
+%                         (0x80) partially out of volume
+%           frame         frame number of the camera
+%           transform     4x4xN homogeneous transforms (rotation as q2tr),
+%                         zeros if the tool is not visible
+%           systemStatus  system status of the reply
+%       The data of the handles not visible is 0.
+%   data = parseNdiBxReply(reply,scale)
+%       multiplies the positions and the translations by scale, for
+%       example 0.001 for meters.
+%
+% Notes:
+%   Replaces decoding the reply byte by byte with convertBytesToFloat.  The
+%   values are little endian whatever the host.
+%
+% Example:
+%   data = parseNdiBxReply(uint8(comm(ndi,'BX 0801',1,true)),0.001);
+%   visible = (data.status==1);
+%
+% See also:
+%    ndi_camera/bx, convertBytesToFloat
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
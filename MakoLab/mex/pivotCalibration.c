@@ -0,0 +1,308 @@
+/****h* /pivotCalibration.c ***
+ * NAME
+ *      pivotCalibration.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function finds the tool center point and the pivot point of
+ *      poses of a tool pivoting about a fixed point (pivot_calibration.c),
+ *      from a batch of poses or incrementally as the poses arrive.  The
+ *      incremental calibrations stay in memory between calls, the mex file
+ *      is locked in memory while one exists.
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pivot_calibration.h"
+
+/* defines */
+#define PIVOT_MAX_CALIBRATIONS 8
+#define COMMAND_LENGTH 16
+#define OPTION_LENGTH 32
+
+/* open calibrations, the id is the index plus one */
+static PivotState *calibrations[PIVOT_MAX_CALIBRATIONS];
+static int lockedCalibrations = 0;
+
+/* internal functions */
+static void createCalibration(mxArray *plhs[], int nrhs,
+        const mxArray *prhs[]);
+static void addPoses(int nlhs, mxArray *plhs[], PivotState *state,
+        const mxArray *transformArray);
+static uint32_t getNumPoses(const mxArray *transformArray);
+static void destroyCalibration(int index);
+static void destroyAllCalibrations(void);
+static int getCalibrationIndex(const mxArray *idArray);
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    char command[COMMAND_LENGTH];
+    PivotState state;
+    int index;
+
+    /* first check the inputs */
+    if (nrhs < 1)
+    {
+        mexErrMsgTxt("Must specify the transforms or a command: create, add, reset or destroy");
+        return;
+    }
+
+    /* batch calibration */
+    if (!mxIsChar(prhs[0]))
+    {
+        pivot_init(&state, 1);
+        addPoses(nlhs, plhs, &state, prhs[0]);
+        return;
+    }
+
+    if (mxGetString(prhs[0], command, COMMAND_LENGTH) != 0)
+    {
+        mexErrMsgTxt("Unknown command, use create, add, reset or destroy");
+        return;
+    }
+    if (strcmp(command, "create") == 0)
+    {
+        createCalibration(plhs, nrhs - 1, prhs + 1);
+        return;
+    }
+    if ((strcmp(command, "destroy") == 0) && (nrhs == 1))
+    {
+        destroyAllCalibrations();
+        return;
+    }
+    if ((strcmp(command, "add") != 0) && (strcmp(command, "reset") != 0)
+            && (strcmp(command, "destroy") != 0))
+    {
+        mexErrMsgTxt("Unknown command, use create, add, reset or destroy");
+        return;
+    }
+    if (nrhs < 2)
+    {
+        mexErrMsgTxt("Must specify the calibration id");
+        return;
+    }
+    index = getCalibrationIndex(prhs[1]);
+
+    if (strcmp(command, "add") == 0)
+    {
+        if (nrhs < 3)
+        {
+            mexErrMsgTxt("Must specify the transforms");
+            return;
+        }
+        addPoses(nlhs, plhs, calibrations[index], prhs[2]);
+    }
+    else if (strcmp(command, "reset") == 0)
+    {
+        pivot_init(calibrations[index], calibrations[index]->forgetting);
+    }
+    else
+    {
+        destroyCalibration(index);
+    }
+    return;
+}
+
+/*
+ * id = pivotCalibration('create','Forgetting',factor)
+ */
+static void createCalibration(mxArray *plhs[], int nrhs,
+        const mxArray *prhs[])
+{
+    char option[OPTION_LENGTH];
+    PivotState *state;
+    double forgetting = 1;
+    int index, i;
+
+    if (nrhs % 2 != 0)
+    {
+        mexErrMsgTxt("Must specify parameter/value pairs");
+        return;
+    }
+    for (i = 0; i < nrhs; i += 2)
+    {
+        if (!mxIsChar(prhs[i])
+                || (mxGetString(prhs[i], option, OPTION_LENGTH) != 0))
+        {
+            mexErrMsgTxt("Parameter names must be strings");
+            return;
+        }
+        if (strcmp(option, "Forgetting") == 0)
+        {
+            forgetting = mxIsNumeric(prhs[i + 1])
+                ? mxGetScalar(prhs[i + 1]) : 0;
+            if (!(forgetting > 0) || (forgetting > 1))
+            {
+                mexErrMsgTxt("Forgetting must be between 0 (excluded) and 1");
+                return;
+            }
+        }
+        else
+        {
+            mexErrMsgTxt("Unknown parameter, use Forgetting");
+            return;
+        }
+    }
+
+    for (index = 0; index < PIVOT_MAX_CALIBRATIONS; index++)
+    {
+        if (calibrations[index] == NULL)
+            break;
+    }
+    if (index == PIVOT_MAX_CALIBRATIONS)
+    {
+        mexErrMsgTxt("Too many calibrations, destroy one first");
+        return;
+    }
+    state = (PivotState *)malloc(sizeof(PivotState));
+    if (state == NULL)
+    {
+        mexErrMsgTxt("Unable to allocate the calibration");
+        return;
+    }
+    pivot_init(state, forgetting);
+
+    calibrations[index] = state;
+    if (lockedCalibrations++ == 0)
+    {
+        mexLock();
+        mexAtExit(destroyAllCalibrations);
+    }
+    plhs[0] = mxCreateDoubleScalar(index + 1);
+}
+
+/*
+ * [tool,pivot,rmsError,residuals,info] of the state with the new poses,
+ * the residuals are those of the new poses
+ */
+static void addPoses(int nlhs, mxArray *plhs[], PivotState *state,
+        const mxArray *transformArray)
+{
+    static const char *fieldNames[] = {"numPoses", "rank",
+        "conditionNumber"};
+    PivotSolution solution;
+    uint32_t numPoses, i;
+    int solved, j;
+
+    numPoses = getNumPoses(transformArray);
+    pivot_add(state, mxGetPr(transformArray), numPoses);
+    solved = (pivot_solve(state, &solution) == PIVOT_SUCCESS);
+
+    plhs[0] = mxCreateDoubleMatrix(1, 3, mxREAL);
+    if (nlhs > 1)
+        plhs[1] = mxCreateDoubleMatrix(1, 3, mxREAL);
+    for (j = 0; j < 3; j++)
+    {
+        mxGetPr(plhs[0])[j] = solved ? solution.tool[j] : mxGetNaN();
+        if (nlhs > 1)
+            mxGetPr(plhs[1])[j] = solved ? solution.pivot[j] : mxGetNaN();
+    }
+    if (nlhs > 2)
+        plhs[2] = mxCreateDoubleScalar(solved ? solution.rmsError
+                : mxGetNaN());
+    if (nlhs > 3)
+    {
+        plhs[3] = mxCreateDoubleMatrix(numPoses, 1, mxREAL);
+        if (solved)
+        {
+            pivot_residuals(mxGetPr(transformArray), numPoses, &solution,
+                    mxGetPr(plhs[3]));
+        }
+        else
+        {
+            for (i = 0; i < numPoses; i++)
+                mxGetPr(plhs[3])[i] = mxGetNaN();
+        }
+    }
+    if (nlhs > 4)
+    {
+        plhs[4] = mxCreateStructMatrix(1, 1, 3, fieldNames);
+        mxSetField(plhs[4], 0, "numPoses",
+                mxCreateDoubleScalar(state->numPoses));
+        mxSetField(plhs[4], 0, "rank",
+                mxCreateDoubleScalar(solved ? solution.rank : 0));
+        mxSetField(plhs[4], 0, "conditionNumber",
+                mxCreateDoubleScalar(solved ? solution.conditionNumber
+                    : mxGetInf()));
+    }
+}
+
+/*
+ * number of 4x4 transforms of a 4x4xN array, errors out otherwise
+ */
+static uint32_t getNumPoses(const mxArray *transformArray)
+{
+    const mwSize *dims;
+
+    if (mxIsEmpty(transformArray) && mxIsDouble(transformArray))
+    {
+        return 0;
+    }
+    dims = mxGetDimensions(transformArray);
+    if (!mxIsDouble(transformArray) || mxIsComplex(transformArray)
+            || (mxGetNumberOfDimensions(transformArray) > 3)
+            || (dims[0] != 4) || (dims[1] != 4))
+    {
+        mexErrMsgTxt("Transforms must be a 4x4xN double array");
+        return 0;
+    }
+    return (uint32_t)(mxGetNumberOfElements(transformArray) / 16);
+}
+
+/*
+ * free a calibration, the mex file is unlocked with the last one
+ */
+static void destroyCalibration(int index)
+{
+    free(calibrations[index]);
+    calibrations[index] = NULL;
+    if (--lockedCalibrations == 0)
+    {
+        mexUnlock();
+    }
+}
+
+static void destroyAllCalibrations(void)
+{
+    int index;
+
+    for (index = 0; index < PIVOT_MAX_CALIBRATIONS; index++)
+    {
+        if (calibrations[index] != NULL)
+            destroyCalibration(index);
+    }
+}
+
+/*
+ * index of an existing calibration, errors out on an invalid id
+ */
+static int getCalibrationIndex(const mxArray *idArray)
+{
+    int index;
+
+    index = mxIsNumeric(idArray) ? (int)mxGetScalar(idArray) - 1 : -1;
+    if ((index < 0) || (index >= PIVOT_MAX_CALIBRATIONS)
+            || (calibrations[index] == NULL))
+    {
+        mexErrMsgTxt("Invalid calibration id");
+        return 0;
+    }
+    return index;
+}
+
+/*----------- END OF FILE ------------ */
@@ -0,0 +1,70 @@
+%PIVOTCALIBRATION Tool center point and pivot point from pivoting poses
+%
+% Syntax:
+%   [tool,pivot,rmsError,residuals,info] = pivotCalibration(transforms)
+%       transforms is a 4x4xN array of the poses of a tool pivoting about
+%       a fixed point (flange or tracker transforms).  Returns the least
+%       squares solution of transform * [tool 1]' = [pivot 1]':
+%           tool          1x3 tool center point in the tool frame
+%           pivot         1x3 pivot point in the base frame
+%           rmsError      rms distance of the tips to the pivot point
+%           residuals     Nx1 distance of the tip of every pose to the
+%                         pivot point
+%           info          structure with the fields numPoses, rank
+%                         (observable directions of the tool, 3 when the
+%                         poses are rotated about more than one axis) and
+%                         conditionNumber of the normal equations
+%   id = pivotCalibration('create','parameter',value)
+%       creates an incremental calibration.  The parameter is:
+%           Forgetting   factor applied to the weight of the previous poses
+%                        for every new pose (default 1, all the poses
+%                        weigh the same).  Less than 1 follows a live pose
+%                        stream, the poses older than 1/(1-Forgetting)
+%                        poses fade out.
+%   [tool,pivot,rmsError,residuals,info] = pivotCalibration('add',id,transforms)
+%       adds the poses to the calibration and returns the solution of all
+%       the poses added so far, the residuals are those of the new poses.
+%       transforms can be empty to get the current solution.
+%   pivotCalibration('reset',id)
+%       forgets all the poses.
+%   pivotCalibration('destroy',id)
+%       frees the calibration.
+%   pivotCalibration('destroy')
+%       frees all the calibrations.
+%
+% Notes:
+%   The pivot point is eliminated from the normal equations, leaving a 3x3
+%   system built from running sums of the poses, so adding a pose costs
+%   the same whatever the number of poses and the poses are not kept.
+%   Directions of the tool center point that the rotations do not observe
+%   (rotations about a single axis) are left at 0 as with pinv, and the
+%   rank is less than 3.  Less than 2 poses return NaN.
+%   rmsError is the same as the spread of the tips about their mean used
+%   by pivotCheck.
+%   The mex file stays locked in memory while a calibration exists.
+%
+% Example:
+%   % continuous TCP estimate from a microscribe stream
+%   streamId = stream(msArm,'start','SampleRate',50);
+%   id = pivotCalibration('create','Forgetting',0.99);
+%   for i=1:100
+%       pause(0.1);
+%       samples = stream(msArm,'read',streamId);
+%       [tool,pivot,rmsError] = pivotCalibration('add',id,samples.transform);
+%       fprintf('TCP %8.3f %8.3f %8.3f  rms %6.3f mm\n',tool,rmsError);
+%   end
+%   pivotCalibration('destroy',id);
+%   stream(msArm,'stop',streamId);
+%
+% See also:
+%    computeTCP, pivotCheck, mscribeStream
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
@@ -0,0 +1,363 @@
+/****h* /pivot_calibration.c ***
+ * NAME
+ *      pivot_calibration.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      This library solves the pivot calibration in the least squares
+ *      sense: the tool center point t and the pivot point c minimizing
+ *      sum w |R t + p - c|^2 over the poses (R, p) of the tool.  For a
+ *      given t the best c is the weighted mean of the tips, which leaves
+ *      the 3x3 normal equations
+ *          (W I - SR' SR / W) t = SR' Sp / W - sum w R' p
+ *      with W = sum w, SR = sum w R and Sp = sum w p.  Only these sums and
+ *      sum w p' p (for the rms error) are kept, each pose adds to them at
+ *      a constant cost.  The symmetric 3x3 matrix is inverted through its
+ *      eigen decomposition (Jacobi) so unobservable directions are
+ *      dropped as pinv would, and its condition number tells how well the
+ *      poses span the rotations.
+ *
+ * SEE ALSO
+ *      pivot_calibration.h, pivotCalibration.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <math.h>
+#include <string.h>
+
+#include "pivot_calibration.h"
+
+/* Jacobi sweeps before giving up on the off diagonal terms */
+#define MAX_JACOBI_SWEEPS 50
+
+/* internal functions */
+static void jacobi_eigen(double a[3][3], double vectors[3][3],
+        double values[3]);
+
+/****f*  pivot_calibration.c/pivot_init ******
+ * NAME
+ *	    pivot_init
+ *
+ * SYNOPSIS
+ *      void pivot_init(PivotState *state, double forgetting)
+ *
+ * INPUTS
+ *      double forgetting
+ *              factor applied to the weight of the previous poses when a
+ *              pose is added, 1 to weight all the poses the same, less
+ *              than 1 to follow a live stream of poses
+ *
+ * OUTPUT
+ *      PivotState *state
+ *              empty state
+ *
+ **********************************
+ */
+void pivot_init(PivotState *state, double forgetting)
+{
+    memset(state, 0, sizeof(PivotState));
+    state->forgetting = forgetting;
+}
+
+/****f*  pivot_calibration.c/pivot_add ******
+ * NAME
+ *	    pivot_add
+ *
+ * SYNOPSIS
+ *      void pivot_add(PivotState *state, const double *transforms,
+ *              uint32_t numPoses)
+ *
+ * INPUTS
+ *      const double *transforms
+ *              numPoses 4x4 homogeneous transforms of the tool, column
+ *              major as in matlab
+ *
+ * OUTPUT
+ *      PivotState *state
+ *              sums updated with the poses
+ *
+ **********************************
+ */
+void pivot_add(PivotState *state, const double *transforms,
+        uint32_t numPoses)
+{
+    const double *transform;
+    double p[3], f;
+    uint32_t i;
+    int j, k;
+
+    for (i = 0; i < numPoses; i++)
+    {
+        transform = transforms + 16 * i;
+        if (state->numPoses == 0)
+        {
+            for (j = 0; j < 3; j++)
+            {
+                state->origin[j] = transform[12 + j];
+            }
+        }
+        if ((state->forgetting != 1) && (state->numPoses > 0))
+        {
+            f = state->forgetting;
+            state->weight *= f;
+            state->sumPP *= f;
+            for (j = 0; j < 9; j++)
+            {
+                state->sumR[j] *= f;
+            }
+            for (j = 0; j < 3; j++)
+            {
+                state->sumRtp[j] *= f;
+                state->sumP[j] *= f;
+            }
+        }
+
+        for (j = 0; j < 3; j++)
+        {
+            p[j] = transform[12 + j] - state->origin[j];
+        }
+        state->weight += 1;
+        state->sumPP += p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+        for (k = 0; k < 3; k++)
+        {
+            for (j = 0; j < 3; j++)
+            {
+                state->sumR[3 * k + j] += transform[4 * k + j];
+            }
+            /* column k of R is row k of R' */
+            state->sumRtp[k] += transform[4 * k] * p[0]
+                + transform[4 * k + 1] * p[1] + transform[4 * k + 2] * p[2];
+            state->sumP[k] += p[k];
+        }
+        state->numPoses++;
+    }
+}
+
+/****f*  pivot_calibration.c/pivot_solve ******
+ * NAME
+ *	    pivot_solve
+ *
+ * SYNOPSIS
+ *      int32_t pivot_solve(const PivotState *state,
+ *              PivotSolution *solution)
+ *
+ * OUTPUT
+ *      PivotSolution *solution
+ *              tool center point, pivot point, rms error, rank and
+ *              condition number of the normal equations
+ *      Returns PIVOT_SUCCESS, or PIVOT_FAILURE with less than 2 poses or
+ *      without any rotation between them
+ *
+ **********************************
+ */
+int32_t pivot_solve(const PivotState *state, PivotSolution *solution)
+{
+    double a[3][3], vectors[3][3], values[3], h[3], u[3];
+    double w, maxValue, minValue, projection, sum;
+    int j, k, l;
+
+    memset(solution, 0, sizeof(PivotSolution));
+    w = state->weight;
+    if (state->numPoses < 2)
+    {
+        return PIVOT_FAILURE;
+    }
+
+    /* a = W I - SR' SR / W, h = SR' Sp / W - sum w R' p */
+    for (j = 0; j < 3; j++)
+    {
+        for (k = 0; k < 3; k++)
+        {
+            sum = 0;
+            for (l = 0; l < 3; l++)
+            {
+                sum += state->sumR[3 * j + l] * state->sumR[3 * k + l];
+            }
+            a[j][k] = ((j == k) ? w : 0) - sum / w;
+        }
+        sum = 0;
+        for (l = 0; l < 3; l++)
+        {
+            sum += state->sumR[3 * j + l] * state->sumP[l];
+        }
+        h[j] = sum / w - state->sumRtp[j];
+    }
+    jacobi_eigen(a, vectors, values);
+
+    maxValue = 0;
+    for (j = 0; j < 3; j++)
+    {
+        if (values[j] > maxValue)
+            maxValue = values[j];
+    }
+    if (maxValue <= 0)
+    {
+        return PIVOT_FAILURE;
+    }
+    minValue = maxValue;
+    for (j = 0; j < 3; j++)
+    {
+        if (values[j] <= PIVOT_RANK_TOLERANCE * maxValue)
+        {
+            continue;
+        }
+        solution->rank++;
+        if (values[j] < minValue)
+            minValue = values[j];
+        projection = 0;
+        for (l = 0; l < 3; l++)
+        {
+            projection += vectors[l][j] * h[l];
+        }
+        for (l = 0; l < 3; l++)
+        {
+            solution->tool[l] += projection / values[j] * vectors[l][j];
+        }
+    }
+    solution->conditionNumber = (solution->rank == 3)
+        ? maxValue / minValue : HUGE_VAL;
+
+    /* pivot c = (SR t + Sp) / W, J = W |t|^2 + Spp + 2 t' SRtp - |u|^2 / W */
+    /* with u = SR t + Sp */
+    sum = w * (solution->tool[0] * solution->tool[0]
+            + solution->tool[1] * solution->tool[1]
+            + solution->tool[2] * solution->tool[2]) + state->sumPP;
+    for (j = 0; j < 3; j++)
+    {
+        u[j] = state->sumP[j];
+        for (l = 0; l < 3; l++)
+        {
+            u[j] += state->sumR[3 * l + j] * solution->tool[l];
+        }
+        solution->pivot[j] = u[j] / w + state->origin[j];
+        sum += 2 * solution->tool[j] * state->sumRtp[j] - u[j] * u[j] / w;
+    }
+    solution->rmsError = (sum > 0) ? sqrt(sum / w) : 0;
+    return PIVOT_SUCCESS;
+}
+
+/****f*  pivot_calibration.c/pivot_residuals ******
+ * NAME
+ *	    pivot_residuals
+ *
+ * SYNOPSIS
+ *      void pivot_residuals(const double *transforms, uint32_t numPoses,
+ *              const PivotSolution *solution, double *residuals)
+ *
+ * OUTPUT
+ *      double *residuals
+ *              distance of the tip of every pose (transform * tool) to
+ *              the pivot point
+ *
+ **********************************
+ */
+void pivot_residuals(const double *transforms, uint32_t numPoses,
+        const PivotSolution *solution, double *residuals)
+{
+    const double *transform;
+    const double *t = solution->tool;
+    double d, sum;
+    uint32_t i;
+    int j;
+
+    for (i = 0; i < numPoses; i++)
+    {
+        transform = transforms + 16 * i;
+        sum = 0;
+        for (j = 0; j < 3; j++)
+        {
+            d = transform[j] * t[0] + transform[4 + j] * t[1]
+                + transform[8 + j] * t[2] + transform[12 + j]
+                - solution->pivot[j];
+            sum += d * d;
+        }
+        residuals[i] = sqrt(sum);
+    }
+}
+
+/*
+ * eigen values and vectors (columns) of a symmetric 3x3 matrix by cyclic
+ * Jacobi rotations, a is destroyed
+ */
+static void jacobi_eigen(double a[3][3], double vectors[3][3],
+        double values[3])
+{
+    double off, theta, t, c, s, tau, h, g, apq;
+    int sweep, p, q, k;
+
+    for (p = 0; p < 3; p++)
+    {
+        for (q = 0; q < 3; q++)
+        {
+            vectors[p][q] = (p == q);
+        }
+    }
+    for (sweep = 0; sweep < MAX_JACOBI_SWEEPS; sweep++)
+    {
+        off = fabs(a[0][1]) + fabs(a[0][2]) + fabs(a[1][2]);
+        if (off == 0)
+        {
+            break;
+        }
+        for (p = 0; p < 2; p++)
+        {
+            for (q = p + 1; q < 3; q++)
+            {
+                apq = a[p][q];
+                g = 100 * fabs(apq);
+                if ((fabs(a[p][p]) + g == fabs(a[p][p]))
+                        && (fabs(a[q][q]) + g == fabs(a[q][q])))
+                {
+                    a[p][q] = a[q][p] = 0;
+                    continue;
+                }
+                h = a[q][q] - a[p][p];
+                if (fabs(h) + g == fabs(h))
+                {
+                    t = apq / h;
+                }
+                else
+                {
+                    theta = 0.5 * h / apq;
+                    t = 1 / (fabs(theta) + sqrt(1 + theta * theta));
+                    if (theta < 0)
+                        t = -t;
+                }
+                c = 1 / sqrt(1 + t * t);
+                s = t * c;
+                tau = s / (1 + c);
+                a[p][p] -= t * apq;
+                a[q][q] += t * apq;
+                a[p][q] = a[q][p] = 0;
+                for (k = 0; k < 3; k++)
+                {
+                    if ((k != p) && (k != q))
+                    {
+                        g = a[k][p];
+                        h = a[k][q];
+                        a[k][p] = a[p][k] = g - s * (h + g * tau);
+                        a[k][q] = a[q][k] = h + s * (g - h * tau);
+                    }
+                    g = vectors[k][p];
+                    h = vectors[k][q];
+                    vectors[k][p] = g - s * (h + g * tau);
+                    vectors[k][q] = h + s * (g - h * tau);
+                }
+            }
+        }
+    }
+    for (p = 0; p < 3; p++)
+    {
+        values[p] = a[p][p];
+    }
+}
+
+/*------------ END OF FILE ------------- */
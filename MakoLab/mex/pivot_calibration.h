@@ -0,0 +1,78 @@
+/****h* /pivot_calibration.h ***
+ * NAME
+ * 		pivot_calibration.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Pivot calibration: the tool center point (in the tool
+ *              frame) and the pivot point (in the base frame) that best
+ *              fit poses of a tool rotated about a fixed point.  The poses
+ *              are reduced to a few running sums as they arrive, so the
+ *              solution can be updated with every new pose at a constant
+ *              cost, optionally forgetting the older poses.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __PIVOT_CALIBRATION_H__ /* make sure that pivot_calibration is not redeclared */
+#define __PIVOT_CALIBRATION_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#endif
+
+/* defines */
+#define PIVOT_SUCCESS 1
+#define PIVOT_FAILURE -1
+
+/* directions of the tool center point whose curvature is below this */
+/* fraction of the largest one are not observable (rotations about a */
+/* single axis), their component is left at zero as pinv would */
+#define PIVOT_RANK_TOLERANCE 1.0e-10
+
+typedef struct {
+    double forgetting;          /* weight of the older poses per new pose */
+    double origin[3];           /* first position, the sums are relative */
+    double weight;              /* sum of the weights */
+    double sumR[9];             /* sum w R, 3x3 column major */
+    double sumRtp[3];           /* sum w R' p */
+    double sumP[3];             /* sum w p */
+    double sumPP;               /* sum w p' p */
+    uint32_t numPoses;
+} PivotState;
+
+typedef struct {
+    double tool[3];             /* tool center point in the tool frame */
+    double pivot[3];            /* pivot point in the base frame */
+    double rmsError;            /* weighted rms distance of the tips */
+                                /* to the pivot point */
+    double conditionNumber;     /* Inf when some direction is unobservable */
+    int32_t rank;               /* observable directions of the tool, 0-3 */
+} PivotSolution;
+
+/* function definations */
+void pivot_init(PivotState *state, double forgetting);
+
+void pivot_add(PivotState *state, const double *transforms,
+        uint32_t numPoses);
+
+int32_t pivot_solve(const PivotState *state, PivotSolution *solution);
+
+void pivot_residuals(const double *transforms, uint32_t numPoses,
+        const PivotSolution *solution, double *residuals);
+
+#endif /* __PIVOT_CALIBRATION_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
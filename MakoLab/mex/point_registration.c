@@ -0,0 +1,884 @@
+/****h* /point_registration.c ***
+ * NAME
+ *      point_registration.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      This library registers paired point sets with a rigid transform.
+ *      The least squares rotation is the eigenvector of the largest
+ *      eigenvalue of the symmetric 4x4 matrix built from the covariance
+ *      of the centered pairs (Horn's closed form with unit quaternions),
+ *      found by Jacobi rotations.  It is always a proper rotation, even
+ *      for planar or nearly degenerate sets.  Outliers are rejected either
+ *      by RANSAC on minimal samples of 3 pairs, scored with the truncated
+ *      squared residuals (MSAC) and refined on their inliers, or by
+ *      trimmed least squares that refits the given fraction of the pairs
+ *      with the smallest residuals until that set is stable.
+ *
+ * SEE ALSO
+ *      point_registration.h, registerPointPairs.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif /* _WIN32 */
+
+#include "point_registration.h"
+
+/* Jacobi sweeps before giving up on the off diagonal terms */
+#define MAX_JACOBI_SWEEPS 50
+
+/* samples whose triangle is flatter than this (squared sine of the */
+/* angle between its sides) are degenerate and skipped */
+#define MIN_SAMPLE_SINE2 1.0e-6
+
+typedef void (*JobFunction)(void *job);
+
+/* a thread of pr_register_all: problems first, first + step, ... */
+typedef struct {
+    PrProblem *problems;
+    uint32_t numProblems;
+    uint32_t first;
+    uint32_t step;
+    const PrOptions *options;
+} BatchJob;
+
+/* a thread of RANSAC: samples first to first + count - 1 */
+typedef struct {
+    const PrProblem *problem;
+    const PrOptions *options;
+    uint32_t first;
+    uint32_t count;
+    double *residuals;
+    double bestCost;
+    double bestTransform[16];
+    int32_t found;
+} SampleJob;
+
+typedef struct {
+    double residual;
+    uint32_t index;
+} RankedPair;
+
+typedef struct {
+    JobFunction function;
+    void *job;
+} ThreadJob;
+
+/* internal functions */
+static int32_t register_problem(PrProblem *problem,
+        const PrOptions *options, int32_t numThreads);
+static int32_t ransac(PrProblem *problem, const PrOptions *options,
+        int32_t numThreads, uint32_t *indices);
+static int32_t trimmed(PrProblem *problem, const PrOptions *options,
+        uint32_t *indices);
+static void finish_problem(PrProblem *problem);
+static void batch_job(void *job);
+static void sample_job(void *job);
+static int32_t draw_sample(const PrProblem *problem, uint32_t seed,
+        uint32_t sample, uint32_t *indices);
+static uint64_t mix_bits(uint64_t value);
+static int compare_ranked(const void *first, const void *second);
+static void jacobi_eigen(double a[4][4], double vectors[4][4],
+        double values[4]);
+static void run_jobs(JobFunction function, void *jobs, size_t jobSize,
+        int32_t numJobs);
+
+/****f*  point_registration.c/pr_fit ******
+ * NAME
+ *	    pr_fit
+ *
+ * SYNOPSIS
+ *      int32_t pr_fit(const double *pointsA, const double *pointsB,
+ *              uint32_t numPoints, const uint32_t *indices, uint32_t count,
+ *              double transform[16])
+ *
+ * INPUTS
+ *      const double *pointsA, *pointsB
+ *              paired points, numPoints x 3 column major
+ *      const uint32_t *indices
+ *              the count pairs to fit, NULL for all the pairs
+ *
+ * OUTPUT
+ *      double transform[16]
+ *              least squares rigid transform with B = T * A, 4x4 column
+ *              major
+ *      Returns PR_SUCCESS, or PR_FAILURE without any pair
+ *
+ **********************************
+ */
+int32_t pr_fit(const double *pointsA, const double *pointsB,
+        uint32_t numPoints, const uint32_t *indices, uint32_t count,
+        double transform[16])
+{
+    double centroidA[3], centroidB[3], a[3], b[3];
+    double s[3][3], n[4][4], vectors[4][4], values[4];
+    double w, x, y, z;
+    uint32_t i, k, index;
+    int j, best;
+
+    if (indices == NULL)
+    {
+        count = numPoints;
+    }
+    if (count == 0)
+    {
+        return PR_FAILURE;
+    }
+
+    for (j = 0; j < 3; j++)
+    {
+        centroidA[j] = 0;
+        centroidB[j] = 0;
+    }
+    for (i = 0; i < count; i++)
+    {
+        index = (indices != NULL) ? indices[i] : i;
+        for (j = 0; j < 3; j++)
+        {
+            centroidA[j] += pointsA[j * numPoints + index];
+            centroidB[j] += pointsB[j * numPoints + index];
+        }
+    }
+    for (j = 0; j < 3; j++)
+    {
+        centroidA[j] /= count;
+        centroidB[j] /= count;
+    }
+
+    /* covariance of the centered pairs, s[j][k] = sum a[j] * b[k] */
+    memset(s, 0, sizeof(s));
+    for (i = 0; i < count; i++)
+    {
+        index = (indices != NULL) ? indices[i] : i;
+        for (j = 0; j < 3; j++)
+        {
+            a[j] = pointsA[j * numPoints + index] - centroidA[j];
+            b[j] = pointsB[j * numPoints + index] - centroidB[j];
+        }
+        for (j = 0; j < 3; j++)
+        {
+            for (k = 0; k < 3; k++)
+            {
+                s[j][k] += a[j] * b[k];
+            }
+        }
+    }
+
+    n[0][0] = s[0][0] + s[1][1] + s[2][2];
+    n[1][1] = s[0][0] - s[1][1] - s[2][2];
+    n[2][2] = -s[0][0] + s[1][1] - s[2][2];
+    n[3][3] = -s[0][0] - s[1][1] + s[2][2];
+    n[0][1] = n[1][0] = s[1][2] - s[2][1];
+    n[0][2] = n[2][0] = s[2][0] - s[0][2];
+    n[0][3] = n[3][0] = s[0][1] - s[1][0];
+    n[1][2] = n[2][1] = s[0][1] + s[1][0];
+    n[1][3] = n[3][1] = s[2][0] + s[0][2];
+    n[2][3] = n[3][2] = s[1][2] + s[2][1];
+    jacobi_eigen(n, vectors, values);
+
+    best = 0;
+    for (j = 1; j < 4; j++)
+    {
+        if (values[j] > values[best])
+            best = j;
+    }
+    w = vectors[0][best];
+    x = vectors[1][best];
+    y = vectors[2][best];
+    z = vectors[3][best];
+
+    transform[0] = w * w + x * x - y * y - z * z;
+    transform[1] = 2 * (x * y + w * z);
+    transform[2] = 2 * (x * z - w * y);
+    transform[3] = 0;
+    transform[4] = 2 * (x * y - w * z);
+    transform[5] = w * w - x * x + y * y - z * z;
+    transform[6] = 2 * (y * z + w * x);
+    transform[7] = 0;
+    transform[8] = 2 * (x * z + w * y);
+    transform[9] = 2 * (y * z - w * x);
+    transform[10] = w * w - x * x - y * y + z * z;
+    transform[11] = 0;
+    for (j = 0; j < 3; j++)
+    {
+        transform[12 + j] = centroidB[j] - (transform[j] * centroidA[0]
+                + transform[4 + j] * centroidA[1]
+                + transform[8 + j] * centroidA[2]);
+    }
+    transform[15] = 1;
+    return PR_SUCCESS;
+}
+
+/****f*  point_registration.c/pr_residuals ******
+ * NAME
+ *	    pr_residuals
+ *
+ * SYNOPSIS
+ *      void pr_residuals(const double *pointsA, const double *pointsB,
+ *              uint32_t numPoints, const double transform[16],
+ *              double *residuals)
+ *
+ * OUTPUT
+ *      double *residuals
+ *              distance from every point of B to its pair of A moved by
+ *              the transform
+ *
+ **********************************
+ */
+void pr_residuals(const double *pointsA, const double *pointsB,
+        uint32_t numPoints, const double transform[16], double *residuals)
+{
+    double a0, a1, a2, d, sum;
+    uint32_t i;
+    int j;
+
+    for (i = 0; i < numPoints; i++)
+    {
+        a0 = pointsA[i];
+        a1 = pointsA[numPoints + i];
+        a2 = pointsA[2 * numPoints + i];
+        sum = 0;
+        for (j = 0; j < 3; j++)
+        {
+            d = pointsB[j * numPoints + i] - (transform[j] * a0
+                    + transform[4 + j] * a1 + transform[8 + j] * a2
+                    + transform[12 + j]);
+            sum += d * d;
+        }
+        residuals[i] = sqrt(sum);
+    }
+}
+
+/****f*  point_registration.c/pr_register ******
+ * NAME
+ *	    pr_register
+ *
+ * SYNOPSIS
+ *      int32_t pr_register(PrProblem *problem, const PrOptions *options)
+ *
+ * INPUTS
+ *      PrProblem *problem
+ *              points and output arrays of the problem
+ *      const PrOptions *options
+ *              method and its parameters, RANSAC samples are spread over
+ *              numThreads threads
+ *
+ * OUTPUT
+ *      PrProblem *problem
+ *              transform, residuals of all the pairs, inliers (all the
+ *              pairs for least squares, the kept ones for trimmed) and
+ *              rms error of the inliers
+ *      Returns PR_SUCCESS, or PR_FAILURE with less than 3 pairs, if no
+ *      RANSAC sample was valid or on a memory allocation failure
+ *
+ **********************************
+ */
+int32_t pr_register(PrProblem *problem, const PrOptions *options)
+{
+    return register_problem(problem, options, options->numThreads);
+}
+
+/****f*  point_registration.c/pr_register_all ******
+ * NAME
+ *	    pr_register_all
+ *
+ * SYNOPSIS
+ *      void pr_register_all(PrProblem *problems, uint32_t numProblems,
+ *              const PrOptions *options)
+ *
+ * PURPOSE
+ *	    Register independent problems, spread over options->numThreads
+ *      threads.  A single problem is registered with pr_register so the
+ *      RANSAC samples are spread instead.  The status of each problem is
+ *      set
+ *
+ **********************************
+ */
+void pr_register_all(PrProblem *problems, uint32_t numProblems,
+        const PrOptions *options)
+{
+    BatchJob jobs[PR_MAX_THREADS];
+    int32_t numJobs, i;
+
+    if (numProblems == 1)
+    {
+        problems->status = pr_register(problems, options);
+        return;
+    }
+
+    numJobs = options->numThreads;
+    if (numJobs > PR_MAX_THREADS)
+    {
+        numJobs = PR_MAX_THREADS;
+    }
+    if ((uint32_t)numJobs > numProblems)
+    {
+        numJobs = (int32_t)numProblems;
+    }
+    if (numJobs < 1)
+    {
+        numJobs = 1;
+    }
+
+    /* interleaved, the problems are often sorted by size */
+    for (i = 0; i < numJobs; i++)
+    {
+        jobs[i].problems = problems;
+        jobs[i].numProblems = numProblems;
+        jobs[i].first = (uint32_t)i;
+        jobs[i].step = (uint32_t)numJobs;
+        jobs[i].options = options;
+    }
+    run_jobs(batch_job, jobs, sizeof(BatchJob), numJobs);
+}
+
+/****f*  point_registration.c/pr_number_of_processors ******
+ * NAME
+ *	    pr_number_of_processors
+ *
+ * SYNOPSIS
+ *      int32_t pr_number_of_processors(void)
+ *
+ * OUTPUT
+ *      Returns the number of processors, the default number of threads
+ *
+ **********************************
+ */
+int32_t pr_number_of_processors(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return (int32_t)systemInfo.dwNumberOfProcessors;
+#else
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    return (processors > 0) ? (int32_t)processors : 1;
+#endif /* _WIN32 */
+}
+
+static int32_t register_problem(PrProblem *problem,
+        const PrOptions *options, int32_t numThreads)
+{
+    uint32_t *indices;
+    int32_t result;
+
+    problem->numInliers = 0;
+    problem->rmsError = 0;
+    if (problem->numPoints < 3)
+    {
+        return PR_FAILURE;
+    }
+
+    if (options->method == PR_LEAST_SQUARES)
+    {
+        pr_fit(problem->pointsA, problem->pointsB, problem->numPoints, NULL,
+                0, problem->transform);
+        memset(problem->inliers, 1, problem->numPoints);
+        finish_problem(problem);
+        return PR_SUCCESS;
+    }
+
+    indices = (uint32_t *)malloc(problem->numPoints * sizeof(uint32_t));
+    if (indices == NULL)
+    {
+        return PR_FAILURE;
+    }
+    if (options->method == PR_RANSAC)
+    {
+        result = ransac(problem, options, numThreads, indices);
+    }
+    else
+    {
+        result = trimmed(problem, options, indices);
+    }
+    free(indices);
+    if (result == PR_SUCCESS)
+    {
+        finish_problem(problem);
+    }
+    return result;
+}
+
+/*
+ * best MSAC sample over all the threads, then least squares refits of its
+ * inliers until the inliers do not change
+ */
+static int32_t ransac(PrProblem *problem, const PrOptions *options,
+        int32_t numThreads, uint32_t *indices)
+{
+    SampleJob jobs[PR_MAX_THREADS];
+    uint32_t numPoints = problem->numPoints;
+    uint32_t count, refit, i;
+    int32_t numJobs, best, j, changed;
+
+    numJobs = numThreads;
+    if (numJobs > PR_MAX_THREADS)
+    {
+        numJobs = PR_MAX_THREADS;
+    }
+    if ((uint32_t)numJobs > options->iterations)
+    {
+        numJobs = (int32_t)options->iterations;
+    }
+    if (numJobs < 1)
+    {
+        numJobs = 1;
+    }
+
+    for (j = 0; j < numJobs; j++)
+    {
+        jobs[j].problem = problem;
+        jobs[j].options = options;
+        jobs[j].first = (uint32_t)((uint64_t)options->iterations * j
+                / numJobs);
+        jobs[j].count = (uint32_t)((uint64_t)options->iterations * (j + 1)
+                / numJobs) - jobs[j].first;
+        jobs[j].found = 0;
+        jobs[j].residuals = (j == 0) ? problem->residuals
+            : (double *)malloc(numPoints * sizeof(double));
+        if (jobs[j].residuals == NULL)
+        {
+            numJobs = j;
+            break;
+        }
+    }
+    if (numJobs == 0)
+    {
+        return PR_FAILURE;
+    }
+    run_jobs(sample_job, jobs, sizeof(SampleJob), numJobs);
+
+    /* the earliest sample wins a tie, whatever the number of threads */
+    best = -1;
+    for (j = 0; j < numJobs; j++)
+    {
+        if (jobs[j].found && ((best < 0)
+                    || (jobs[j].bestCost < jobs[best].bestCost)))
+        {
+            best = j;
+        }
+        if (j > 0)
+        {
+            free(jobs[j].residuals);
+        }
+    }
+    if (best < 0)
+    {
+        return PR_FAILURE;
+    }
+    memcpy(problem->transform, jobs[best].bestTransform,
+            sizeof(problem->transform));
+
+    pr_residuals(problem->pointsA, problem->pointsB, numPoints,
+            problem->transform, problem->residuals);
+    for (i = 0; i < numPoints; i++)
+    {
+        problem->inliers[i] = (problem->residuals[i] <= options->threshold);
+    }
+    for (refit = 0; refit < PR_MAX_REFITS; refit++)
+    {
+        count = 0;
+        for (i = 0; i < numPoints; i++)
+        {
+            if (problem->inliers[i])
+                indices[count++] = i;
+        }
+        if (count < 3)
+        {
+            break;
+        }
+        pr_fit(problem->pointsA, problem->pointsB, numPoints, indices,
+                count, problem->transform);
+        pr_residuals(problem->pointsA, problem->pointsB, numPoints,
+                problem->transform, problem->residuals);
+        changed = 0;
+        for (i = 0; i < numPoints; i++)
+        {
+            if (problem->inliers[i]
+                    != (problem->residuals[i] <= options->threshold))
+            {
+                problem->inliers[i] = !problem->inliers[i];
+                changed = 1;
+            }
+        }
+        if (!changed)
+        {
+            break;
+        }
+    }
+    return PR_SUCCESS;
+}
+
+/*
+ * least squares fit of all the pairs, then of the kept fraction with the
+ * smallest residuals until that set does not change
+ */
+static int32_t trimmed(PrProblem *problem, const PrOptions *options,
+        uint32_t *indices)
+{
+    RankedPair *ranked;
+    uint32_t numPoints = problem->numPoints;
+    uint32_t keep, refit, i;
+    int32_t changed;
+
+    keep = (uint32_t)ceil(options->trim * numPoints);
+    if (keep < 3)
+    {
+        keep = 3;
+    }
+    if (keep > numPoints)
+    {
+        keep = numPoints;
+    }
+    ranked = (RankedPair *)malloc(numPoints * sizeof(RankedPair));
+    if (ranked == NULL)
+    {
+        return PR_FAILURE;
+    }
+
+    pr_fit(problem->pointsA, problem->pointsB, numPoints, NULL, 0,
+            problem->transform);
+    memset(problem->inliers, 1, numPoints);
+    for (refit = 0; (keep < numPoints) && (refit < PR_MAX_REFITS); refit++)
+    {
+        pr_residuals(problem->pointsA, problem->pointsB, numPoints,
+                problem->transform, problem->residuals);
+        for (i = 0; i < numPoints; i++)
+        {
+            ranked[i].residual = problem->residuals[i];
+            ranked[i].index = i;
+        }
+        qsort(ranked, numPoints, sizeof(RankedPair), compare_ranked);
+
+        changed = 0;
+        for (i = 0; i < numPoints; i++)
+        {
+            if (problem->inliers[ranked[i].index] != (i < keep))
+            {
+                problem->inliers[ranked[i].index] = (i < keep);
+                changed = 1;
+            }
+        }
+        if (!changed)
+        {
+            break;
+        }
+        for (i = 0; i < keep; i++)
+        {
+            indices[i] = ranked[i].index;
+        }
+        pr_fit(problem->pointsA, problem->pointsB, numPoints, indices, keep,
+                problem->transform);
+    }
+    free(ranked);
+    return PR_SUCCESS;
+}
+
+/*
+ * residuals of the final transform and rms error of the inliers
+ */
+static void finish_problem(PrProblem *problem)
+{
+    double sum = 0;
+    uint32_t i;
+
+    pr_residuals(problem->pointsA, problem->pointsB, problem->numPoints,
+            problem->transform, problem->residuals);
+    problem->numInliers = 0;
+    for (i = 0; i < problem->numPoints; i++)
+    {
+        if (problem->inliers[i])
+        {
+            sum += problem->residuals[i] * problem->residuals[i];
+            problem->numInliers++;
+        }
+    }
+    problem->rmsError = (problem->numInliers > 0)
+        ? sqrt(sum / problem->numInliers) : 0;
+}
+
+static void batch_job(void *job)
+{
+    BatchJob *batch = (BatchJob *)job;
+    uint32_t i;
+
+    for (i = batch->first; i < batch->numProblems; i += batch->step)
+    {
+        batch->problems[i].status = register_problem(batch->problems + i,
+                batch->options, 1);
+    }
+}
+
+/*
+ * fit and score the samples of one thread, the cost is the sum of the
+ * squared residuals truncated at the threshold
+ */
+static void sample_job(void *job)
+{
+    SampleJob *samples = (SampleJob *)job;
+    const PrProblem *problem = samples->problem;
+    double threshold2, cost, r2, transform[16];
+    uint32_t indices[3];
+    uint32_t sample, i;
+
+    threshold2 = samples->options->threshold * samples->options->threshold;
+    for (sample = samples->first;
+            sample < samples->first + samples->count; sample++)
+    {
+        if (!draw_sample(problem, samples->options->seed, sample, indices))
+        {
+            continue;
+        }
+        pr_fit(problem->pointsA, problem->pointsB, problem->numPoints,
+                indices, 3, transform);
+        pr_residuals(problem->pointsA, problem->pointsB, problem->numPoints,
+                transform, samples->residuals);
+        cost = 0;
+        for (i = 0; i < problem->numPoints; i++)
+        {
+            r2 = samples->residuals[i] * samples->residuals[i];
+            cost += (r2 < threshold2) ? r2 : threshold2;
+        }
+        if (!samples->found || (cost < samples->bestCost))
+        {
+            samples->found = 1;
+            samples->bestCost = cost;
+            memcpy(samples->bestTransform, transform, sizeof(transform));
+        }
+    }
+}
+
+/*
+ * 3 distinct pairs drawn from the seed and the sample number only, so the
+ * samples do not depend on the threads.  Returns 0 for a flat triangle
+ */
+static int32_t draw_sample(const PrProblem *problem, uint32_t seed,
+        uint32_t sample, uint32_t *indices)
+{
+    const double *a = problem->pointsA;
+    uint32_t n = problem->numPoints;
+    uint64_t state;
+    double u[3], v[3], c[3], uu, vv, cc;
+    int32_t drawn;
+    int j;
+
+    state = ((uint64_t)seed << 32) | sample;
+    drawn = 0;
+    while (drawn < 3)
+    {
+        state = mix_bits(state + 0x9E3779B97F4A7C15ULL);
+        indices[drawn] = (uint32_t)(state % n);
+        if (((drawn > 0) && (indices[drawn] == indices[0]))
+                || ((drawn > 1) && (indices[drawn] == indices[1])))
+        {
+            continue;
+        }
+        drawn++;
+    }
+
+    for (j = 0; j < 3; j++)
+    {
+        u[j] = a[j * n + indices[1]] - a[j * n + indices[0]];
+        v[j] = a[j * n + indices[2]] - a[j * n + indices[0]];
+    }
+    c[0] = u[1] * v[2] - u[2] * v[1];
+    c[1] = u[2] * v[0] - u[0] * v[2];
+    c[2] = u[0] * v[1] - u[1] * v[0];
+    uu = u[0] * u[0] + u[1] * u[1] + u[2] * u[2];
+    vv = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+    cc = c[0] * c[0] + c[1] * c[1] + c[2] * c[2];
+    return (cc > MIN_SAMPLE_SINE2 * uu * vv);
+}
+
+/*
+ * splitmix64 finalizer
+ */
+static uint64_t mix_bits(uint64_t value)
+{
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+static int compare_ranked(const void *first, const void *second)
+{
+    const RankedPair *a = (const RankedPair *)first;
+    const RankedPair *b = (const RankedPair *)second;
+
+    if (a->residual != b->residual)
+    {
+        return (a->residual < b->residual) ? -1 : 1;
+    }
+    return (a->index < b->index) ? -1 : (a->index > b->index);
+}
+
+/*
+ * eigen values and vectors (columns) of a symmetric 4x4 matrix by cyclic
+ * Jacobi rotations, a is destroyed
+ */
+static void jacobi_eigen(double a[4][4], double vectors[4][4],
+        double values[4])
+{
+    double off, theta, t, c, s, tau, h, g, apq;
+    int sweep, p, q, k;
+
+    for (p = 0; p < 4; p++)
+    {
+        for (q = 0; q < 4; q++)
+        {
+            vectors[p][q] = (p == q);
+        }
+    }
+    for (sweep = 0; sweep < MAX_JACOBI_SWEEPS; sweep++)
+    {
+        off = 0;
+        for (p = 0; p < 3; p++)
+        {
+            for (q = p + 1; q < 4; q++)
+            {
+                off += fabs(a[p][q]);
+            }
+        }
+        if (off == 0)
+        {
+            break;
+        }
+        for (p = 0; p < 3; p++)
+        {
+            for (q = p + 1; q < 4; q++)
+            {
+                apq = a[p][q];
+                g = 100 * fabs(apq);
+                if ((fabs(a[p][p]) + g == fabs(a[p][p]))
+                        && (fabs(a[q][q]) + g == fabs(a[q][q])))
+                {
+                    a[p][q] = a[q][p] = 0;
+                    continue;
+                }
+                h = a[q][q] - a[p][p];
+                if (fabs(h) + g == fabs(h))
+                {
+                    t = apq / h;
+                }
+                else
+                {
+                    theta = 0.5 * h / apq;
+                    t = 1 / (fabs(theta) + sqrt(1 + theta * theta));
+                    if (theta < 0)
+                        t = -t;
+                }
+                c = 1 / sqrt(1 + t * t);
+                s = t * c;
+                tau = s / (1 + c);
+                a[p][p] -= t * apq;
+                a[q][q] += t * apq;
+                a[p][q] = a[q][p] = 0;
+                for (k = 0; k < 4; k++)
+                {
+                    if ((k != p) && (k != q))
+                    {
+                        g = a[k][p];
+                        h = a[k][q];
+                        a[k][p] = a[p][k] = g - s * (h + g * tau);
+                        a[k][q] = a[q][k] = h + s * (g - h * tau);
+                    }
+                    g = vectors[k][p];
+                    h = vectors[k][q];
+                    vectors[k][p] = g - s * (h + g * tau);
+                    vectors[k][q] = h + s * (g - h * tau);
+                }
+            }
+        }
+    }
+    for (p = 0; p < 4; p++)
+    {
+        values[p] = a[p][p];
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI job_thread(LPVOID argument)
+{
+    ThreadJob *thread = (ThreadJob *)argument;
+    thread->function(thread->job);
+    return 0;
+}
+#else
+static void *job_thread(void *argument)
+{
+    ThreadJob *thread = (ThreadJob *)argument;
+    thread->function(thread->job);
+    return NULL;
+}
+#endif /* _WIN32 */
+
+/*
+ * run function on all the jobs, the first job in the calling thread and
+ * the others in their own thread.  A job whose thread could not be
+ * started is run by the calling thread
+ */
+static void run_jobs(JobFunction function, void *jobs, size_t jobSize,
+        int32_t numJobs)
+{
+    ThreadJob threadJobs[PR_MAX_THREADS];
+    int32_t started[PR_MAX_THREADS];
+#ifdef _WIN32
+    HANDLE threads[PR_MAX_THREADS];
+#else
+    pthread_t threads[PR_MAX_THREADS];
+#endif /* _WIN32 */
+    int32_t i;
+
+    for (i = 1; i < numJobs; i++)
+    {
+        threadJobs[i].function = function;
+        threadJobs[i].job = (char *)jobs + i * jobSize;
+#ifdef _WIN32
+        threads[i] = CreateThread(NULL, 0, job_thread, threadJobs + i, 0,
+                NULL);
+        started[i] = (threads[i] != NULL);
+#else
+        started[i] = (pthread_create(threads + i, NULL, job_thread,
+                    threadJobs + i) == 0);
+#endif /* _WIN32 */
+    }
+
+    if (numJobs > 0)
+    {
+        function(jobs);
+    }
+
+    for (i = 1; i < numJobs; i++)
+    {
+        if (!started[i])
+        {
+            function((char *)jobs + i * jobSize);
+            continue;
+        }
+#ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif /* _WIN32 */
+    }
+}
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,87 @@
+/****h* /point_registration.h ***
+ * NAME
+ * 		point_registration.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Rigid registration of paired point sets.  The closed form
+ *              least squares fit (Horn) is used on its own, inside RANSAC
+ *              on minimal samples of 3 pairs, or iterated on the pairs
+ *              with the smallest residuals (trimmed least squares).  Many
+ *              problems are registered in one call, spread over threads.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __POINT_REGISTRATION_H__ /* make sure that point_registration is not redeclared */
+#define __POINT_REGISTRATION_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#endif
+
+/* defines */
+#define PR_SUCCESS 1
+#define PR_FAILURE -1
+
+#define PR_LEAST_SQUARES 0
+#define PR_RANSAC 1
+#define PR_TRIMMED 2
+
+#define PR_MAX_THREADS 16
+
+/* least squares refits of the inliers after RANSAC, and of the kept */
+/* pairs by trimmed least squares, stop when the set is stable */
+#define PR_MAX_REFITS 20
+
+typedef struct {
+    int32_t method;             /* PR_LEAST_SQUARES, PR_RANSAC or _TRIMMED */
+    double threshold;           /* RANSAC inlier distance */
+    uint32_t iterations;        /* RANSAC samples */
+    double trim;                /* fraction of the pairs kept by trimmed */
+    uint32_t seed;              /* RANSAC samples, same seed same result */
+    int32_t numThreads;
+} PrOptions;
+
+typedef struct {
+    const double *pointsA;      /* numPoints x 3, column major as matlab */
+    const double *pointsB;      /* pairs of pointsA, same layout */
+    uint32_t numPoints;
+    double transform[16];       /* B = T * A, 4x4 column major */
+    double *residuals;          /* numPoints distances, caller allocated */
+    uint8_t *inliers;           /* numPoints flags, caller allocated */
+    uint32_t numInliers;
+    double rmsError;            /* rms of the inlier residuals */
+    int32_t status;             /* PR_SUCCESS or PR_FAILURE */
+} PrProblem;
+
+/* function definations */
+int32_t pr_fit(const double *pointsA, const double *pointsB,
+        uint32_t numPoints, const uint32_t *indices, uint32_t count,
+        double transform[16]);
+
+void pr_residuals(const double *pointsA, const double *pointsB,
+        uint32_t numPoints, const double transform[16], double *residuals);
+
+int32_t pr_register(PrProblem *problem, const PrOptions *options);
+
+void pr_register_all(PrProblem *problems, uint32_t numProblems,
+        const PrOptions *options);
+
+int32_t pr_number_of_processors(void);
+
+#endif /* __POINT_REGISTRATION_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,310 @@
+/****h* /registerPointPairs.c ***
+ * NAME
+ *      registerPointPairs.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function registers one or many pairs of point sets with rigid
+ *      transforms (point_registration.c), by least squares or with outlier
+ *      rejection, and returns the residual of every pair of points.
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+#include <string.h>
+
+#include "point_registration.h"
+
+/* defines */
+#define OPTION_LENGTH 16
+#define DEFAULT_ITERATIONS 1000
+#define DEFAULT_TRIM 0.8
+
+/* internal functions */
+static void parseOptions(int nrhs, const mxArray *prhs[],
+        PrOptions *options);
+static const mxArray *getPointSet(const mxArray *pointSets, int isCell,
+        uint32_t index, uint32_t *numPoints);
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    PrOptions options;
+    PrProblem *problems;
+    const mxArray *setA, *setB;
+    mxArray *residuals, *inliers;
+    const mwSize *dimsA;
+    uint32_t numProblems, numPoints, numPointsB, pointStride, k, i;
+    int isCell;
+    int dims[3];
+
+    /* first check the inputs */
+    if (nrhs < 2)
+    {
+        mexErrMsgTxt("Must specify the two point sets");
+        return;
+    }
+    isCell = mxIsCell(prhs[0]);
+    if (isCell)
+    {
+        if (!mxIsCell(prhs[1]) || (mxGetNumberOfElements(prhs[0])
+                    != mxGetNumberOfElements(prhs[1])))
+        {
+            mexErrMsgTxt("Point sets must be two cell arrays of the same size");
+            return;
+        }
+        numProblems = (uint32_t)mxGetNumberOfElements(prhs[0]);
+        pointStride = 0;
+    }
+    else
+    {
+        if (!mxIsDouble(prhs[0]) || !mxIsDouble(prhs[1])
+                || mxIsComplex(prhs[0]) || mxIsComplex(prhs[1])
+                || (mxGetNumberOfDimensions(prhs[0]) > 3)
+                || (mxGetNumberOfDimensions(prhs[0])
+                    != mxGetNumberOfDimensions(prhs[1]))
+                || (mxGetNumberOfElements(prhs[0])
+                    != mxGetNumberOfElements(prhs[1]))
+                || (mxGetM(prhs[0]) != mxGetM(prhs[1])))
+        {
+            mexErrMsgTxt("Point sets must be Nx3 or Nx3xK double arrays of the same size");
+            return;
+        }
+        dimsA = mxGetDimensions(prhs[0]);
+        numProblems = (mxGetNumberOfDimensions(prhs[0]) == 3)
+            ? (uint32_t)dimsA[2] : 1;
+        pointStride = (uint32_t)mxGetM(prhs[0]) * 3;
+    }
+    parseOptions(nrhs - 2, prhs + 2, &options);
+
+    /* the problems point to the matlab arrays, the outputs are */
+    /* allocated before registering so nothing can fail afterwards */
+    problems = (PrProblem *)mxCalloc(numProblems + 1, sizeof(PrProblem));
+    if (isCell)
+    {
+        residuals = mxCreateCellMatrix(mxGetM(prhs[0]), mxGetN(prhs[0]));
+        inliers = mxCreateCellMatrix(mxGetM(prhs[0]), mxGetN(prhs[0]));
+    }
+    else
+    {
+        residuals = mxCreateDoubleMatrix(mxGetM(prhs[0]), numProblems,
+                mxREAL);
+        inliers = mxCreateLogicalMatrix(mxGetM(prhs[0]), numProblems);
+    }
+    for (k = 0; k < numProblems; k++)
+    {
+        setA = getPointSet(prhs[0], isCell, k, &numPoints);
+        setB = getPointSet(prhs[1], isCell, k, &numPointsB);
+        if (numPoints != numPointsB)
+        {
+            mexErrMsgTxt("Paired point sets must have the same number of points");
+            return;
+        }
+        if (numPoints < 3)
+        {
+            mexErrMsgTxt("Point sets must have at least 3 points");
+            return;
+        }
+        problems[k].numPoints = numPoints;
+        problems[k].pointsA = mxGetPr(setA) + k * pointStride;
+        problems[k].pointsB = mxGetPr(setB) + k * pointStride;
+        if (isCell)
+        {
+            mxSetCell(residuals, k, mxCreateDoubleMatrix(numPoints, 1,
+                        mxREAL));
+            mxSetCell(inliers, k, mxCreateLogicalMatrix(numPoints, 1));
+            problems[k].residuals = mxGetPr(mxGetCell(residuals, k));
+            problems[k].inliers =
+                (uint8_t *)mxGetLogicals(mxGetCell(inliers, k));
+        }
+        else
+        {
+            problems[k].residuals = mxGetPr(residuals) + k * numPoints;
+            problems[k].inliers =
+                (uint8_t *)mxGetLogicals(inliers) + k * numPoints;
+        }
+    }
+
+    pr_register_all(problems, numProblems, &options);
+
+    dims[0] = 4;
+    dims[1] = 4;
+    dims[2] = numProblems;
+    plhs[0] = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+    if (nlhs > 1)
+        plhs[1] = mxCreateDoubleMatrix(numProblems, 1, mxREAL);
+    for (k = 0; k < numProblems; k++)
+    {
+        /* a failed problem is all NaN and without inliers */
+        if (problems[k].status != PR_SUCCESS)
+        {
+            for (i = 0; i < 16; i++)
+            {
+                problems[k].transform[i] = mxGetNaN();
+            }
+            for (i = 0; i < problems[k].numPoints; i++)
+            {
+                problems[k].residuals[i] = mxGetNaN();
+                problems[k].inliers[i] = 0;
+            }
+            problems[k].rmsError = mxGetNaN();
+        }
+        memcpy(mxGetPr(plhs[0]) + 16 * k, problems[k].transform,
+                16 * sizeof(double));
+        if (nlhs > 1)
+            mxGetPr(plhs[1])[k] = problems[k].rmsError;
+    }
+    mxFree(problems);
+
+    if (nlhs > 2)
+        plhs[2] = residuals;
+    else
+        mxDestroyArray(residuals);
+    if (nlhs > 3)
+        plhs[3] = inliers;
+    else
+        mxDestroyArray(inliers);
+    return;
+}
+
+/*
+ * method and parameters from the parameter/value pairs
+ */
+static void parseOptions(int nrhs, const mxArray *prhs[],
+        PrOptions *options)
+{
+    char option[OPTION_LENGTH];
+    char method[OPTION_LENGTH];
+    int hasThreshold = 0;
+    int i;
+
+    options->method = PR_LEAST_SQUARES;
+    options->threshold = 0;
+    options->iterations = DEFAULT_ITERATIONS;
+    options->trim = DEFAULT_TRIM;
+    options->seed = 0;
+    options->numThreads = pr_number_of_processors();
+
+    if (nrhs % 2 != 0)
+    {
+        mexErrMsgTxt("Must specify parameter/value pairs");
+        return;
+    }
+    for (i = 0; i < nrhs; i += 2)
+    {
+        if (!mxIsChar(prhs[i])
+                || (mxGetString(prhs[i], option, OPTION_LENGTH) != 0))
+        {
+            mexErrMsgTxt("Parameter names must be strings");
+            return;
+        }
+        if (strcmp(option, "Method") == 0)
+        {
+            if (!mxIsChar(prhs[i + 1])
+                    || (mxGetString(prhs[i + 1], method, OPTION_LENGTH) != 0))
+            {
+                mexErrMsgTxt("Method must be lsq, ransac or trimmed");
+                return;
+            }
+            if (strcmp(method, "lsq") == 0)
+                options->method = PR_LEAST_SQUARES;
+            else if (strcmp(method, "ransac") == 0)
+                options->method = PR_RANSAC;
+            else if (strcmp(method, "trimmed") == 0)
+                options->method = PR_TRIMMED;
+            else
+            {
+                mexErrMsgTxt("Method must be lsq, ransac or trimmed");
+                return;
+            }
+        }
+        else if (!mxIsNumeric(prhs[i + 1]) || mxIsEmpty(prhs[i + 1]))
+        {
+            mexErrMsgTxt("Parameter values must be numeric");
+            return;
+        }
+        else if (strcmp(option, "Threshold") == 0)
+        {
+            options->threshold = mxGetScalar(prhs[i + 1]);
+            hasThreshold = 1;
+        }
+        else if (strcmp(option, "Iterations") == 0)
+        {
+            options->iterations = (mxGetScalar(prhs[i + 1]) >= 1)
+                ? (uint32_t)mxGetScalar(prhs[i + 1]) : 1;
+        }
+        else if (strcmp(option, "Trim") == 0)
+        {
+            options->trim = mxGetScalar(prhs[i + 1]);
+            if (!(options->trim > 0) || (options->trim > 1))
+            {
+                mexErrMsgTxt("Trim must be a fraction between 0 and 1");
+                return;
+            }
+        }
+        else if (strcmp(option, "Seed") == 0)
+        {
+            options->seed = (uint32_t)mxGetScalar(prhs[i + 1]);
+        }
+        else if (strcmp(option, "Threads") == 0)
+        {
+            options->numThreads = (mxGetScalar(prhs[i + 1]) >= 1)
+                ? (int32_t)mxGetScalar(prhs[i + 1]) : 1;
+        }
+        else
+        {
+            mexErrMsgTxt("Unknown parameter, use Method, Threshold, Iterations, Trim, Seed or Threads");
+            return;
+        }
+    }
+
+    if ((options->method == PR_RANSAC)
+            && (!hasThreshold || !(options->threshold > 0)))
+    {
+        mexErrMsgTxt("RANSAC needs a positive inlier Threshold");
+        return;
+    }
+}
+
+/*
+ * point set k of a cell array, or the whole array (Nx3xK) otherwise
+ */
+static const mxArray *getPointSet(const mxArray *pointSets, int isCell,
+        uint32_t index, uint32_t *numPoints)
+{
+    const mxArray *pointSet = pointSets;
+
+    if (isCell)
+    {
+        pointSet = mxGetCell(pointSets, index);
+        if ((pointSet == NULL) || !mxIsDouble(pointSet)
+                || mxIsComplex(pointSet)
+                || (mxGetNumberOfDimensions(pointSet) != 2)
+                || (mxGetN(pointSet) != 3))
+        {
+            mexErrMsgTxt("Point sets must be Nx3 double arrays");
+            return NULL;
+        }
+    }
+    else if ((mxGetNumberOfDimensions(pointSet) < 2)
+            || (mxGetDimensions(pointSet)[1] != 3))
+    {
+        mexErrMsgTxt("Point sets must be Nx3 or Nx3xK double arrays of the same size");
+        return NULL;
+    }
+    *numPoints = (uint32_t)mxGetM(pointSet);
+    return pointSet;
+}
+
+/*----------- END OF FILE ------------ */
@@ -0,0 +1,64 @@
+%REGISTERPOINTPAIRS Rigid registration of paired point sets
+%
+% Syntax:
+%   [transform,rmsError,residuals,inliers] = registerPointPairs(pointSetA,pointSetB)
+%       returns the least squares rigid transform from pointSetA to
+%       pointSetB (pointSetB = transform * pointSetA), both Nx3 double
+%       arrays of paired points (N >= 3).
+%           transform     4x4 homogeneous transform
+%           rmsError      rms of the residuals of the inliers
+%           residuals     Nx1 distance of every point of pointSetB to its
+%                         pair of pointSetA moved by the transform
+%           inliers       Nx1 logical, the pairs used by the final fit
+%                         (all the pairs for the least squares fit)
+%   [...] = registerPointPairs(pointSetsA,pointSetsB)
+%       registers many problems in one call, spread over the processors.
+%       The point sets are either Nx3xK arrays, the transforms are then
+%       4x4xK, rmsError Kx1 and residuals and inliers NxK, or cell arrays
+%       of Nx3 arrays (N can differ between problems), residuals and
+%       inliers are then cell arrays of the same size.
+%   [...] = registerPointPairs(...,'parameter',value,...)
+%       the parameters are:
+%           Method       'lsq' (default) least squares fit of all pairs,
+%                        'ransac' least squares fit of the inliers of the
+%                        best sample of 3 pairs, or 'trimmed' least
+%                        squares fit of the pairs with the smallest
+%                        residuals
+%           Threshold    ransac inlier distance, required for ransac
+%           Iterations   ransac samples (default 1000)
+%           Trim         trimmed fraction of the pairs kept (default 0.8)
+%           Seed         ransac random seed (default 0)
+%           Threads      number of threads (default one per processor)
+%
+% Notes:
+%   The rotation is the closed form least squares solution of Horn (unit
+%   quaternions), always a proper rotation even for planar or collinear
+%   points, where an SVD fit can return a reflection.
+%   Ransac samples are scored with the residuals truncated at the
+%   threshold (MSAC) and the best one is refined by least squares fits
+%   of its inliers until they do not change.  The samples only depend on
+%   the seed, the result is the same whatever the number of threads.  A
+%   single problem spreads its samples over the threads, many problems are
+%   spread over the threads instead.
+%   Trimmed fits all pairs, then refits the kept fraction with the
+%   smallest residuals until that set does not change (at most 20 times).
+%   A problem that can not be registered (no valid ransac sample, all the
+%   points collinear) returns NaN.
+%
+% Example:
+%   [transform,rmsError,residuals] = registerPointPairs(cameraPoints,...
+%       armPoints,'Method','ransac','Threshold',0.5);
+%   bar(residuals);
+%
+% See also:
+%    pointPairMatching
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
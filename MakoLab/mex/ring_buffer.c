@@ -0,0 +1,253 @@
+/****h* /ring_buffer.c ***
+ * NAME
+ *      ring_buffer.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      Lock free single producer, single consumer ring buffer.  The head
+ *      and tail are free running counters, each written by one thread
+ *      only; a memory barrier separates the copy of the elements from the
+ *      update of the counter that publishes them, so no lock is needed.
+ *      Elements are copied in blocks to amortize the barriers.
+ *
+ * SEE ALSO
+ *      ring_buffer.h
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define RING_BARRIER() MemoryBarrier()
+#else
+#define RING_BARRIER() __sync_synchronize()
+#endif /* _WIN32 */
+
+#include "ring_buffer.h"
+
+/* internal functions */
+static void copy_elements(RingBuffer *ring, uint32_t position,
+        void *elements, uint32_t count, int32_t toRing);
+
+/****f*  ring_buffer.c/ring_create ******
+ * NAME
+ *	    ring_create
+ *
+ * SYNOPSIS
+ *      int32_t ring_create(RingBuffer *ring, uint32_t capacity,
+ *              uint32_t elementSize)
+ *
+ * INPUTS
+ *      uint32_t capacity
+ *              minimum number of elements, rounded up to a power of 2
+ *      uint32_t elementSize
+ *              size of an element in bytes
+ *
+ * OUTPUT
+ *      RingBuffer *ring
+ *              empty ring buffer, to be freed by ring_destroy
+ *      Returns RING_BUFFER_SUCCESS or RING_BUFFER_FAILURE if the memory
+ *      could not be allocated
+ *
+ **********************************
+ */
+int32_t ring_create(RingBuffer *ring, uint32_t capacity,
+        uint32_t elementSize)
+{
+    uint32_t size;
+
+    memset(ring, 0, sizeof(RingBuffer));
+    if ((capacity == 0) || (capacity > 0x80000000U) || (elementSize == 0))
+    {
+        return RING_BUFFER_FAILURE;
+    }
+    size = 1;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    ring->data = (unsigned char *)malloc((size_t)size * elementSize);
+    if (ring->data == NULL)
+    {
+        return RING_BUFFER_FAILURE;
+    }
+    ring->capacity = size;
+    ring->elementSize = elementSize;
+    return RING_BUFFER_SUCCESS;
+}
+
+/****f*  ring_buffer.c/ring_destroy ******
+ * NAME
+ *	    ring_destroy
+ *
+ * SYNOPSIS
+ *      void ring_destroy(RingBuffer *ring)
+ *
+ * PURPOSE
+ *	    Free the elements, neither thread may use the ring afterwards
+ *
+ **********************************
+ */
+void ring_destroy(RingBuffer *ring)
+{
+    free(ring->data);
+    ring->data = NULL;
+    ring->capacity = 0;
+}
+
+/****f*  ring_buffer.c/ring_push ******
+ * NAME
+ *	    ring_push
+ *
+ * SYNOPSIS
+ *      uint32_t ring_push(RingBuffer *ring, const void *elements,
+ *              uint32_t count)
+ *
+ * INPUTS
+ *      const void *elements
+ *              count elements to add
+ *
+ * OUTPUT
+ *      Returns the number of elements added, less than count if the ring
+ *      is full
+ *
+ * NOTES
+ *      Producer thread only
+ *
+ **********************************
+ */
+uint32_t ring_push(RingBuffer *ring, const void *elements, uint32_t count)
+{
+    uint32_t head, tail, space;
+
+    head = ring->head;
+    tail = ring->tail;
+    /* the consumer is done with the elements before tail */
+    RING_BARRIER();
+
+    space = ring->capacity - (head - tail);
+    if (count > space)
+    {
+        count = space;
+    }
+    if (count == 0)
+    {
+        return 0;
+    }
+    copy_elements(ring, head, (void *)elements, count, 1);
+
+    /* the elements are written before they are published */
+    RING_BARRIER();
+    ring->head = head + count;
+    return count;
+}
+
+/****f*  ring_buffer.c/ring_pop ******
+ * NAME
+ *	    ring_pop
+ *
+ * SYNOPSIS
+ *      uint32_t ring_pop(RingBuffer *ring, void *elements,
+ *              uint32_t maxCount)
+ *
+ * OUTPUT
+ *      void *elements
+ *              oldest elements, at most maxCount
+ *      Returns the number of elements removed
+ *
+ * NOTES
+ *      Consumer thread only
+ *
+ **********************************
+ */
+uint32_t ring_pop(RingBuffer *ring, void *elements, uint32_t maxCount)
+{
+    uint32_t head, tail, count;
+
+    tail = ring->tail;
+    head = ring->head;
+    /* the elements before head are written */
+    RING_BARRIER();
+
+    count = head - tail;
+    if (count > maxCount)
+    {
+        count = maxCount;
+    }
+    if (count == 0)
+    {
+        return 0;
+    }
+    copy_elements(ring, tail, elements, count, 0);
+
+    /* the elements are read before their space is released */
+    RING_BARRIER();
+    ring->tail = tail + count;
+    return count;
+}
+
+/****f*  ring_buffer.c/ring_count ******
+ * NAME
+ *	    ring_count
+ *
+ * SYNOPSIS
+ *      uint32_t ring_count(const RingBuffer *ring)
+ *
+ * OUTPUT
+ *      Returns the number of elements in the ring, which can only grow
+ *      for the consumer and only shrink for the producer
+ *
+ **********************************
+ */
+uint32_t ring_count(const RingBuffer *ring)
+{
+    return ring->head - ring->tail;
+}
+
+/*
+ * copy count elements between the ring, from position, and elements.  The
+ * block wraps around the end of the ring in at most two pieces
+ */
+static void copy_elements(RingBuffer *ring, uint32_t position,
+        void *elements, uint32_t count, int32_t toRing)
+{
+    uint32_t first, firstCount;
+    size_t elementSize;
+    unsigned char *ringData;
+    unsigned char *data;
+
+    elementSize = ring->elementSize;
+    first = position & (ring->capacity - 1);
+    firstCount = ring->capacity - first;
+    if (firstCount > count)
+    {
+        firstCount = count;
+    }
+    ringData = ring->data + first * elementSize;
+    data = (unsigned char *)elements;
+
+    if (toRing)
+    {
+        memcpy(ringData, data, firstCount * elementSize);
+        memcpy(ring->data, data + firstCount * elementSize,
+                (count - firstCount) * elementSize);
+    }
+    else
+    {
+        memcpy(data, ringData, firstCount * elementSize);
+        memcpy(data + firstCount * elementSize, ring->data,
+                (count - firstCount) * elementSize);
+    }
+}
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,67 @@
+/****h* /ring_buffer.h ***
+ * NAME
+ * 		ring_buffer.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Lock free ring buffer for one producer thread and one
+ *              consumer thread.  Used by the mex functions that acquire
+ *              data in a background thread and hand it to matlab in
+ *              blocks.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __RING_BUFFER_H__ /* make sure that ring_buffer is not redeclared */
+#define __RING_BUFFER_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#endif
+
+/* defines */
+#define RING_BUFFER_SUCCESS 1
+#define RING_BUFFER_FAILURE -1
+
+/* the counters are written by different threads, keep them on separate */
+/* cache lines */
+#define RING_BUFFER_CACHE_LINE 64
+
+typedef struct {
+    unsigned char *data;        /* capacity elements */
+    uint32_t capacity;          /* number of elements, a power of 2 */
+    uint32_t elementSize;       /* size of an element in bytes */
+    unsigned char pad0[RING_BUFFER_CACHE_LINE];
+    volatile uint32_t head;     /* elements written, producer only */
+    unsigned char pad1[RING_BUFFER_CACHE_LINE];
+    volatile uint32_t tail;     /* elements read, consumer only */
+    unsigned char pad2[RING_BUFFER_CACHE_LINE];
+} RingBuffer;
+
+/* function definations */
+int32_t ring_create(RingBuffer *ring, uint32_t capacity,
+        uint32_t elementSize);
+
+void ring_destroy(RingBuffer *ring);
+
+uint32_t ring_push(RingBuffer *ring, const void *elements, uint32_t count);
+
+uint32_t ring_pop(RingBuffer *ring, void *elements, uint32_t maxCount);
+
+uint32_t ring_count(const RingBuffer *ring);
+
+#endif /* __RING_BUFFER_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
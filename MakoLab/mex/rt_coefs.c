@@ -0,0 +1,180 @@
+/****h* /rt_coefs.c ***
+ * NAME
+ *      rt_coefs.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      Read the realtime ATI F/T coefficients from a matlab structure with
+ *      the field names of RTCoefs (working_matrix, bias_vector, ...), as
+ *      returned by loadFTCalibration
+ *
+ * SEE ALSO
+ *      rt_coefs.h, convertVoltagesToFT.c, ftStream.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <stdio.h>
+#include <string.h>
+
+#include "rt_coefs.h"
+
+/* internal functions */
+static int get_coefficients(const mxArray *coefStruct, const char *fieldName,
+        float *values, int maxValues, int required, char *errorMessage);
+
+/****f*  rt_coefs.c/get_rt_coefs ******
+ * NAME
+ *	    get_rt_coefs
+ *
+ * SYNOPSIS
+ *      int get_rt_coefs(const mxArray *coefStruct, int numChannels,
+ *              int tempComp, RTCoefs *coefs, char *errorMessage)
+ *
+ * INPUTS
+ *      const mxArray *coefStruct
+ *              structure with the field working_matrix (one row per axis
+ *              and a column per gauge) and optionally bias_vector,
+ *              TCbias_vector, bias_slopes, gain_slopes, thermistor and
+ *              NumChannels
+ *      int numChannels
+ *              number of channels of the voltages (gauges and thermistor),
+ *              0 to take it from the NumChannels field, or the columns of
+ *              working_matrix plus the thermistor
+ *      int tempComp
+ *              non zero if the temperature compensation will be used, the
+ *              slopes and the thermistor are then required
+ *
+ * OUTPUT
+ *      RTCoefs *coefs
+ *              coefficients, the missing optional ones are 0
+ *      char *errorMessage
+ *              RT_COEFS_ERROR_LENGTH characters, the reason of a failure
+ *      Returns RT_COEFS_SUCCESS or RT_COEFS_FAILURE
+ *
+ **********************************
+ */
+int get_rt_coefs(const mxArray *coefStruct, int numChannels, int tempComp,
+        RTCoefs *coefs, char *errorMessage)
+{
+    const mxArray *matrixField;
+    const mxArray *channelField;
+    int numGauges, numAxes;
+    int i, j;
+
+    memset(coefs, 0, sizeof(RTCoefs));
+    if (!mxIsStruct(coefStruct))
+    {
+        strcpy(errorMessage, "Calibration coefficients must be a structure");
+        return RT_COEFS_FAILURE;
+    }
+
+    /* the working matrix has one row per axis and a column per gauge */
+    matrixField = mxGetField(coefStruct, 0, "working_matrix");
+    if ((matrixField == NULL)
+            || (!mxIsDouble(matrixField) && !mxIsSingle(matrixField))
+            || (mxGetM(matrixField) < 1) || (mxGetM(matrixField) > MAX_AXES)
+            || (mxGetN(matrixField) < 1) || (mxGetN(matrixField) > MAX_GAUGES))
+    {
+        strcpy(errorMessage, "working_matrix must be a double or single "
+                "array with up to 6 rows and a column per gauge");
+        return RT_COEFS_FAILURE;
+    }
+    if (numChannels <= 0)
+    {
+        channelField = mxGetField(coefStruct, 0, "NumChannels");
+        numChannels = ((channelField != NULL) && !mxIsEmpty(channelField))
+            ? (int)mxGetScalar(channelField) : (int)mxGetN(matrixField) + 1;
+    }
+    numGauges = numChannels - 1;
+    if ((numGauges < 1) || (numGauges > MAX_GAUGES)
+            || ((int)mxGetN(matrixField) < numGauges))
+    {
+        sprintf(errorMessage, "working_matrix must have a column for each "
+                "of the %d gauges", numGauges);
+        return RT_COEFS_FAILURE;
+    }
+    numAxes = (int)mxGetM(matrixField);
+    for (j = 0; j < numAxes; j++)
+    {
+        for (i = 0; i < numGauges; i++)
+        {
+            coefs->working_matrix[j][i] = (float)(mxIsDouble(matrixField)
+                    ? mxGetPr(matrixField)[i * numAxes + j]
+                    : ((float *)mxGetData(matrixField))[i * numAxes + j]);
+        }
+    }
+    coefs->NumAxes = (unsigned short)numAxes;
+    coefs->NumChannels = (unsigned short)numChannels;
+
+    /* the bias defaults to 0, the compensation coefficients are only */
+    /* needed with temperature compensation */
+    if ((get_coefficients(coefStruct, "bias_vector", coefs->bias_vector,
+                    numChannels, FALSE, errorMessage) < 0)
+            || (get_coefficients(coefStruct, "TCbias_vector",
+                    coefs->TCbias_vector, numGauges, FALSE,
+                    errorMessage) < 0)
+            || (get_coefficients(coefStruct, "bias_slopes",
+                    coefs->bias_slopes, numGauges, tempComp,
+                    errorMessage) < 0)
+            || (get_coefficients(coefStruct, "gain_slopes",
+                    coefs->gain_slopes, numGauges, tempComp,
+                    errorMessage) < 0)
+            || (get_coefficients(coefStruct, "thermistor",
+                    &coefs->thermistor, 1, tempComp, errorMessage) < 0))
+    {
+        return RT_COEFS_FAILURE;
+    }
+    return RT_COEFS_SUCCESS;
+}
+
+/*
+ * copy a numeric field of the coefficient structure, returns the number
+ * of values copied or -1 on error.  Missing optional fields leave the
+ * values unchanged
+ */
+static int get_coefficients(const mxArray *coefStruct, const char *fieldName,
+        float *values, int maxValues, int required, char *errorMessage)
+{
+    const mxArray *field;
+    int numValues, i;
+
+    field = mxGetField(coefStruct, 0, fieldName);
+    if ((field == NULL) || mxIsEmpty(field))
+    {
+        if (required)
+        {
+            sprintf(errorMessage, "%s is required for temperature "
+                    "compensation", fieldName);
+            return -1;
+        }
+        return 0;
+    }
+    if (!mxIsDouble(field) && !mxIsSingle(field))
+    {
+        sprintf(errorMessage, "%s must be a double or single array",
+                fieldName);
+        return -1;
+    }
+
+    numValues = (int)mxGetNumberOfElements(field);
+    if (numValues > maxValues)
+    {
+        numValues = maxValues;
+    }
+    for (i = 0; i < numValues; i++)
+    {
+        values[i] = mxIsDouble(field) ? (float)mxGetPr(field)[i]
+            : ((float *)mxGetData(field))[i];
+    }
+    return numValues;
+}
+
+/*------------ END OF FILE ------------- */
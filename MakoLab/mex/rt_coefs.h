@@ -0,0 +1,43 @@
+/****h* /rt_coefs.h ***
+ * NAME
+ * 		rt_coefs.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Read the realtime ATI F/T coefficients (RTCoefs of ftrt.h)
+ *              from a matlab structure, as returned by loadFTCalibration.
+ *              Shared by the F/T mex functions.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __RT_COEFS_H__ /* make sure that rt_coefs is not redeclared */
+#define __RT_COEFS_H__
+
+#include <mex.h>
+
+#include "ftrt.h"
+
+/* defines */
+#define RT_COEFS_SUCCESS 1
+#define RT_COEFS_FAILURE -1
+
+#define RT_COEFS_ERROR_LENGTH 256
+
+/* function definations */
+int get_rt_coefs(const mxArray *coefStruct, int numChannels, int tempComp,
+        RTCoefs *coefs, char *errorMessage);
+
+#endif /* __RT_COEFS_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,1096 @@
+/****h* /stl_mesh.c ***
+ * NAME
+ *      stl_mesh.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      This library decodes binary and ascii STL files.  The file is
+ *      expected to be memory mapped (see mapped_file.h), it is first
+ *      inspected to find the format and the number of facets so the
+ *      caller can preallocate the output arrays, and then decoded in
+ *      one pass.  Large ascii files are split at facet boundaries and
+ *      the chunks are counted and parsed by parallel threads, each one
+ *      writing its facets straight to their final position.  The
+ *      duplicated vertices of the facets can then be welded into an
+ *      indexed mesh.  Decoded meshes can be saved to a versioned mesh
+ *      cache file that is read back from a memory mapped view.
+ *
+ * SEE ALSO
+ *      stl_mesh.h, loadStlFile.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif /* _WIN32 */
+
+#include "mapped_file.h"
+#include "stl_mesh.h"
+
+/* longest number accepted in an ascii STL file */
+#define MAX_NUMBER_LENGTH 63
+
+/* numbers with more significant digits or a larger exponent than this */
+/* are not exact in the fast path and go through strtod */
+#define MAX_FAST_DIGITS 19
+#define MAX_EXACT_MANTISSA 9007199254740992.0 /* 2^53 */
+#define MAX_EXACT_POWER 22
+
+#define CHUNK_ERROR_LENGTH 128
+
+/* the weld hash table is kept at most half full */
+#define MIN_WELD_TABLE_SIZE 16
+#define EMPTY_SLOT -1
+/* quantized coordinates are clamped to this magnitude */
+#define MAX_QUANTIZED_COORDINATE 4.0e18
+
+#define IS_SPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' \
+        || (c) == '\n' || (c) == '\f' || (c) == '\v')
+
+/* one chunk of an ascii file, handled by one thread */
+typedef struct {
+    const unsigned char *start;
+    const unsigned char *end;
+    int32_t skipFirstLine;
+    int32_t firstFacet;
+    int32_t numFacets;
+    float *vertices;
+    double *preciseVertices;    /* NULL, or replaces vertices */
+    float *normals;
+    uint16_t *attributes;
+    int32_t status;
+    char errorMessage[CHUNK_ERROR_LENGTH];
+} AsciiChunk;
+
+typedef void (*ChunkFunction)(AsciiChunk *chunk);
+
+typedef struct {
+    ChunkFunction function;
+    AsciiChunk *chunk;
+} ChunkJob;
+
+static const double powersOfTen[MAX_EXACT_POWER + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/* internal functions */
+static size_t find_chunk_start(const unsigned char *data, size_t size,
+        size_t position);
+static void count_chunk(AsciiChunk *chunk);
+static void parse_chunk(AsciiChunk *chunk);
+static void run_chunks(ChunkFunction function, AsciiChunk *chunks,
+        int32_t numChunks);
+static int32_t number_of_processors(void);
+static int32_t parse_number(const unsigned char *token, size_t tokenLength,
+        double *value);
+static const unsigned char *next_token(const unsigned char *p,
+        const unsigned char *end, size_t *tokenLength);
+static int32_t token_equals(const unsigned char *token, size_t tokenLength,
+        const char *keyword);
+static const unsigned char *parse_numbers(const unsigned char *p,
+        const unsigned char *end, double *values, int32_t numberOfValues);
+static void quantize_vertex(const float *vertex, float tolerance,
+        int64_t *key);
+static uint32_t hash_vertex_key(const int64_t *key);
+
+/****f*  stl_mesh.c/stl_inspect ******
+ * NAME
+ *	    stl_inspect
+ *
+ * SYNOPSIS
+ *      int32_t stl_inspect(const unsigned char *data, size_t size,
+ *              StlInfo *info, char *errorMessage)
+ *
+ * INPUTS
+ *      const unsigned char *data
+ *              content of the STL file
+ *      size_t size
+ *              size of the file in bytes
+ *
+ * OUTPUT
+ *      StlInfo *info
+ *              format, number of facets and name of the file
+ *      char *errorMessage
+ *              reason of the failure (at least 256 chars)
+ *
+ *      int32_t  status
+ *              STL_SUCCESS or STL_FAILURE
+ *
+ * PURPOSE
+ *	    Find the format of the STL file.  A file whose size matches the
+ *	    facet count of the binary header is binary, even if the header
+ *	    starts with "solid" (some CAD tools write that).  Otherwise a
+ *	    file starting with "solid" is ascii and the facets are counted.
+ *	    A binary file with trailing bytes is accepted.
+ *
+ * NOTES
+ *      The name is the 80 byte header for binary files and the first
+ *      line (without the end of line) for ascii files.  Ascii files are
+ *      split in chunks here and the facets of each chunk are counted
+ *      in parallel
+ *
+ **********************************
+ */
+int32_t stl_inspect(const unsigned char *data, size_t size, StlInfo *info,
+        char *errorMessage)
+{
+    uint32_t binaryFacets = 0;
+    int32_t hasBinarySize = 0;
+    size_t i, start;
+    const unsigned char *p;
+    AsciiChunk chunks[STL_MAX_CHUNKS];
+    int32_t chunk, numChunks;
+
+    memset(info, 0, sizeof(StlInfo));
+
+    /* facet count of the binary header (little endian) */
+    if (size >= STL_HEADER_SIZE + STL_COUNT_SIZE)
+    {
+        binaryFacets = (uint32_t)data[STL_HEADER_SIZE]
+            | ((uint32_t)data[STL_HEADER_SIZE + 1] << 8)
+            | ((uint32_t)data[STL_HEADER_SIZE + 2] << 16)
+            | ((uint32_t)data[STL_HEADER_SIZE + 3] << 24);
+        hasBinarySize = (binaryFacets <= (uint32_t)((size - STL_HEADER_SIZE
+                        - STL_COUNT_SIZE) / STL_FACET_SIZE))
+            && (binaryFacets <= 0x7fffffff / 9);
+    }
+
+    /* skip leading white space looking for the ascii keyword */
+    p = data;
+    while ((p < data + size) && IS_SPACE(*p))
+    {
+        p++;
+    }
+
+    if (hasBinarySize && ((STL_HEADER_SIZE + STL_COUNT_SIZE
+                    + (size_t)binaryFacets * STL_FACET_SIZE == size)
+                || ((size_t)(data + size - p) < STL_ASCII_KEYWORD_LENGTH)
+                || strncmp((const char *)p, STL_ASCII_KEYWORD,
+                    STL_ASCII_KEYWORD_LENGTH)))
+    {
+        info->format = STL_FORMAT_BINARY;
+        info->numFacets = (int32_t)binaryFacets;
+        info->nameLength = STL_HEADER_SIZE;
+        memcpy(info->name, data, STL_HEADER_SIZE);
+        return STL_SUCCESS;
+    }
+
+    if (((size_t)(data + size - p) < STL_ASCII_KEYWORD_LENGTH)
+            || strncmp((const char *)p, STL_ASCII_KEYWORD,
+                STL_ASCII_KEYWORD_LENGTH))
+    {
+        sprintf(errorMessage, "file is neither an ascii STL file nor a "
+                "binary STL file of the expected size");
+        return STL_FAILURE;
+    }
+
+    info->format = STL_FORMAT_ASCII;
+    for (i = 0; (i < size) && (i < STL_MAX_NAME_LENGTH)
+            && (data[i] != '\n') && (data[i] != '\r'); i++)
+    {
+        info->name[i] = (char)data[i];
+    }
+    info->nameLength = (int32_t)i;
+
+    /* one chunk per processor, each chunk starts at a facet keyword */
+    numChunks = number_of_processors();
+    if ((size_t)numChunks > size / STL_MIN_CHUNK_SIZE)
+        numChunks = (int32_t)(size / STL_MIN_CHUNK_SIZE);
+    if (numChunks > STL_MAX_CHUNKS)
+        numChunks = STL_MAX_CHUNKS;
+    if (numChunks < 1)
+        numChunks = 1;
+    info->numChunks = 0;
+    info->chunkStart[0] = 0;
+    for (chunk = 1; chunk < numChunks; chunk++)
+    {
+        start = find_chunk_start(data, size, size / numChunks * chunk);
+        if (start > info->chunkStart[info->numChunks])
+        {
+            info->chunkStart[++info->numChunks] = start;
+        }
+    }
+    if (size > info->chunkStart[info->numChunks])
+    {
+        info->chunkStart[++info->numChunks] = size;
+    }
+
+    /* count the facets of all the chunks in parallel */
+    for (chunk = 0; chunk < info->numChunks; chunk++)
+    {
+        chunks[chunk].start = data + info->chunkStart[chunk];
+        chunks[chunk].end = data + info->chunkStart[chunk + 1];
+    }
+    run_chunks(count_chunk, chunks, info->numChunks);
+
+    info->numFacets = 0;
+    for (chunk = 0; chunk < info->numChunks; chunk++)
+    {
+        if (chunks[chunk].numFacets > 0x7fffffff / 9 - info->numFacets)
+        {
+            sprintf(errorMessage, "too many facets in ascii STL file");
+            return STL_FAILURE;
+        }
+        info->chunkFacets[chunk] = chunks[chunk].numFacets;
+        info->numFacets += chunks[chunk].numFacets;
+    }
+    return STL_SUCCESS;
+}
+
+/****f*  stl_mesh.c/stl_decode ******
+ * NAME
+ *	    stl_decode
+ *
+ * SYNOPSIS
+ *      int32_t stl_decode(const unsigned char *data, size_t size,
+ *              const StlInfo *info, float *vertices,
+ *              double *preciseVertices, float *normals,
+ *              uint16_t *attributes, char *errorMessage)
+ *
+ * INPUTS
+ *      const unsigned char *data
+ *              content of the STL file
+ *      size_t size
+ *              size of the file in bytes
+ *      const StlInfo *info
+ *              result of stl_inspect for the same data
+ *
+ * OUTPUT
+ *      float *vertices
+ *              9 floats per facet, the 3 vertices one after the other
+ *      double *preciseVertices
+ *              NULL, or 9 doubles per facet receiving the vertices of an
+ *              ascii file at full precision, vertices is then not used.
+ *              Ignored for binary files
+ *      float *normals
+ *              3 floats per facet
+ *      uint16_t *attributes
+ *              attribute (color) word of every facet, 0 for ascii files
+ *      char *errorMessage
+ *              reason of the failure (at least 256 chars)
+ *
+ *      int32_t  status
+ *              STL_SUCCESS or STL_FAILURE
+ *
+ * PURPOSE
+ *	    Decode all the facets of the file into the preallocated arrays
+ *
+ * NOTES
+ *      The binary data is copied as is, i.e. a little endian host is
+ *      assumed (the same as convertBytesToFloat)
+ *
+ **********************************
+ */
+int32_t stl_decode(const unsigned char *data, size_t size,
+        const StlInfo *info, float *vertices, double *preciseVertices,
+        float *normals, uint16_t *attributes, char *errorMessage)
+{
+    const unsigned char *p;
+    AsciiChunk chunks[STL_MAX_CHUNKS];
+    int32_t facet, chunk, firstFacet;
+
+    if (info->format == STL_FORMAT_BINARY)
+    {
+        if (size < STL_HEADER_SIZE + STL_COUNT_SIZE
+                + (size_t)info->numFacets * STL_FACET_SIZE)
+        {
+            sprintf(errorMessage, "binary STL file is truncated");
+            return STL_FAILURE;
+        }
+        p = data + STL_HEADER_SIZE + STL_COUNT_SIZE;
+        for (facet = 0; facet < info->numFacets; facet++)
+        {
+            memcpy(normals + facet * 3, p, 3 * sizeof(float));
+            memcpy(vertices + facet * 9, p + 3 * sizeof(float),
+                    9 * sizeof(float));
+            attributes[facet] = (uint16_t)(p[48] | (p[49] << 8));
+            p += STL_FACET_SIZE;
+        }
+        return STL_SUCCESS;
+    }
+
+    /* ascii: every chunk is parsed by its own thread straight into */
+    /* the output arrays */
+    firstFacet = 0;
+    for (chunk = 0; chunk < info->numChunks; chunk++)
+    {
+        chunks[chunk].start = data + info->chunkStart[chunk];
+        chunks[chunk].end = data + info->chunkStart[chunk + 1];
+        chunks[chunk].skipFirstLine = (chunk == 0);
+        chunks[chunk].firstFacet = firstFacet;
+        chunks[chunk].numFacets = info->chunkFacets[chunk];
+        chunks[chunk].vertices = vertices;
+        chunks[chunk].preciseVertices = preciseVertices;
+        chunks[chunk].normals = normals;
+        chunks[chunk].attributes = attributes;
+        firstFacet += info->chunkFacets[chunk];
+    }
+    run_chunks(parse_chunk, chunks, info->numChunks);
+
+    for (chunk = 0; chunk < info->numChunks; chunk++)
+    {
+        if (chunks[chunk].status != STL_SUCCESS)
+        {
+            strcpy(errorMessage, chunks[chunk].errorMessage);
+            return STL_FAILURE;
+        }
+    }
+    return STL_SUCCESS;
+}
+
+/****f*  stl_mesh.c/stl_weld_vertices ******
+ * NAME
+ *	    stl_weld_vertices
+ *
+ * SYNOPSIS
+ *      int32_t stl_weld_vertices(float *vertices, int32_t numVertices,
+ *              float tolerance, int32_t *ifacets, int32_t *numUnique)
+ *
+ * INPUTS
+ *      float *vertices
+ *              3 floats per vertex, as decoded by stl_decode
+ *      int32_t numVertices
+ *              number of vertices (3 per facet)
+ *      float tolerance
+ *              0 merges only identical vertices, otherwise vertices are
+ *              quantized to a grid of this spacing and merged if they
+ *              fall on the same grid point
+ *
+ * OUTPUT
+ *      float *vertices
+ *              the unique vertices are moved to the front of the array,
+ *              in order of first use
+ *      int32_t *ifacets
+ *              zero based index of the unique vertex of every input
+ *              vertex
+ *      int32_t *numUnique
+ *              number of unique vertices
+ *
+ *      int32_t  status
+ *              STL_SUCCESS or STL_FAILURE if memory could not be
+ *              allocated
+ *
+ * PURPOSE
+ *	    Weld the vertices shared by neighbouring facets using an open
+ *	    addressing (linear probing) hash table on the quantized
+ *	    coordinates.  A unique vertex keeps the coordinates of its first
+ *	    use so welding with a tolerance of 0 does not change the
+ *	    geometry.
+ *
+ * NOTES
+ *      With a tolerance vertices closer than the tolerance can still end
+ *      up on different grid points and are then not merged
+ *
+ **********************************
+ */
+int32_t stl_weld_vertices(float *vertices, int32_t numVertices,
+        float tolerance, int32_t *ifacets, int32_t *numUnique)
+{
+    int32_t *table;
+    int64_t key[3], uniqueKey[3];
+    uint32_t tableSize, slot;
+    int32_t i, unique;
+
+    for (tableSize = MIN_WELD_TABLE_SIZE;
+            tableSize < 2 * (uint32_t)numVertices; tableSize *= 2)
+        ;
+    if ((table = (int32_t *)malloc(tableSize * sizeof(int32_t))) == NULL)
+    {
+        return STL_FAILURE;
+    }
+    memset(table, 0xff, tableSize * sizeof(int32_t));
+
+    *numUnique = 0;
+    for (i = 0; i < numVertices; i++)
+    {
+        quantize_vertex(vertices + i * 3, tolerance, key);
+        slot = hash_vertex_key(key) & (tableSize - 1);
+        while ((unique = table[slot]) != EMPTY_SLOT)
+        {
+            quantize_vertex(vertices + unique * 3, tolerance, uniqueKey);
+            if ((key[0] == uniqueKey[0]) && (key[1] == uniqueKey[1])
+                    && (key[2] == uniqueKey[2]))
+            {
+                break;
+            }
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        if (unique == EMPTY_SLOT)
+        {
+            /* new vertex, the write position never passes i */
+            unique = (*numUnique)++;
+            table[slot] = unique;
+            if (unique != i)
+            {
+                memmove(vertices + unique * 3, vertices + i * 3,
+                        3 * sizeof(float));
+            }
+        }
+        ifacets[i] = unique;
+    }
+
+    free(table);
+    return STL_SUCCESS;
+}
+
+/****f*  stl_mesh.c/stl_compute_bounds ******
+ * NAME
+ *	    stl_compute_bounds
+ *
+ * SYNOPSIS
+ *      void stl_compute_bounds(const float *vertices, int32_t numVertices,
+ *              float *bounds)
+ *
+ * INPUTS
+ *      const float *vertices
+ *              3 floats per vertex
+ *      int32_t numVertices
+ *              number of vertices
+ *
+ * OUTPUT
+ *      float *bounds
+ *              minimum x y z followed by maximum x y z, all 0 if there
+ *              are no vertices
+ *
+ * PURPOSE
+ *	    Axis aligned bounding box of the mesh
+ *
+ **********************************
+ */
+void stl_compute_bounds(const float *vertices, int32_t numVertices,
+        float *bounds)
+{
+    int32_t i, j;
+
+    memset(bounds, 0, 6 * sizeof(float));
+    for (i = 0; i < numVertices; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            if ((i == 0) || (vertices[i * 3 + j] < bounds[j]))
+                bounds[j] = vertices[i * 3 + j];
+            if ((i == 0) || (vertices[i * 3 + j] > bounds[j + 3]))
+                bounds[j + 3] = vertices[i * 3 + j];
+        }
+    }
+}
+
+/****f*  stl_mesh.c/stl_cache_check ******
+ * NAME
+ *	    stl_cache_check
+ *
+ * SYNOPSIS
+ *      const StlCacheHeader *stl_cache_check(const unsigned char *data,
+ *              size_t size, uint64_t sourceSize, int64_t sourceTime,
+ *              float weldTolerance)
+ *
+ * INPUTS
+ *      const unsigned char *data
+ *              memory mapped mesh cache file
+ *      size_t size
+ *              size of the cache file
+ *      uint64_t sourceSize, int64_t sourceTime
+ *              current size and modification time of the STL file
+ *      float weldTolerance
+ *              weld tolerance requested by the caller
+ *
+ * OUTPUT
+ *      const StlCacheHeader *header
+ *              header at the start of data if the cache file is valid and
+ *              was made from the same STL file with the same tolerance,
+ *              NULL otherwise
+ *
+ * PURPOSE
+ *	    Validate a mesh cache file before its blocks are used
+ *
+ * NOTES
+ *      A mapped view is page aligned so the blocks are aligned as well
+ *
+ **********************************
+ */
+const StlCacheHeader *stl_cache_check(const unsigned char *data,
+        size_t size, uint64_t sourceSize, int64_t sourceTime,
+        float weldTolerance)
+{
+    const StlCacheHeader *header = (const StlCacheHeader *)data;
+    uint64_t numFacets, numVertices;
+
+    if ((size < sizeof(StlCacheHeader))
+            || memcmp(header->magic, STL_CACHE_MAGIC, sizeof(header->magic))
+            || (header->version != STL_CACHE_VERSION)
+            || (header->headerSize != sizeof(StlCacheHeader))
+            || (header->fileSize != size)
+            || (header->sourceSize != sourceSize)
+            || (header->sourceTime != sourceTime)
+            || (header->weldTolerance != weldTolerance)
+            || (header->numFacets < 0) || (header->numVertices < 0)
+            || (header->nameLength < 0)
+            || (header->nameLength > STL_MAX_NAME_LENGTH))
+    {
+        return NULL;
+    }
+
+    /* every block must lie inside the file */
+    numFacets = (uint64_t)header->numFacets;
+    numVertices = (uint64_t)header->numVertices;
+    if ((header->facetOffset + numFacets * 3 * sizeof(int32_t) > size)
+            || (header->vertexOffset + numVertices * 3 * sizeof(float) > size)
+            || (header->normalOffset + numFacets * 3 * sizeof(float) > size)
+            || (header->attributeOffset + numFacets * sizeof(uint16_t) > size)
+            || (header->nameOffset + (uint64_t)header->nameLength > size)
+            || (header->facetOffset % STL_CACHE_ALIGN)
+            || (header->vertexOffset % STL_CACHE_ALIGN)
+            || (header->normalOffset % STL_CACHE_ALIGN)
+            || (header->attributeOffset % STL_CACHE_ALIGN))
+    {
+        return NULL;
+    }
+    return header;
+}
+
+/****f*  stl_mesh.c/stl_cache_write ******
+ * NAME
+ *	    stl_cache_write
+ *
+ * SYNOPSIS
+ *      int32_t stl_cache_write(const char *cacheFile,
+ *              StlCacheHeader *header, const int32_t *facets,
+ *              const float *vertices, const float *normals,
+ *              const uint16_t *attributes, const char *name)
+ *
+ * INPUTS
+ *      const char *cacheFile
+ *              name of the cache file
+ *      StlCacheHeader *header
+ *              header with the source, tolerance, format, counts and
+ *              bounds filled in
+ *      const int32_t *facets ... const char *name
+ *              the mesh as returned to the caller
+ *
+ * OUTPUT
+ *      StlCacheHeader *header
+ *              magic, version and the block offsets are filled in
+ *
+ *      int32_t  status
+ *              STL_SUCCESS or STL_FAILURE
+ *
+ * PURPOSE
+ *	    Save a mesh to a cache file.  The file is written atomically so
+ *	    a concurrent reader never sees a partial file
+ *
+ **********************************
+ */
+int32_t stl_cache_write(const char *cacheFile, StlCacheHeader *header,
+        const int32_t *facets, const float *vertices, const float *normals,
+        const uint16_t *attributes, const char *name)
+{
+    static const unsigned char padding[STL_CACHE_ALIGN] = {0};
+    const void *data[5];
+    size_t dataSizes[5];
+    uint64_t *offsets[5];
+    const void *blocks[11];
+    size_t blockSizes[11];
+    uint64_t offset;
+    int32_t numBlocks, i;
+
+    memcpy(header->magic, STL_CACHE_MAGIC, sizeof(header->magic));
+    header->version = STL_CACHE_VERSION;
+    header->headerSize = sizeof(StlCacheHeader);
+    header->reserved = 0;
+
+    data[0] = facets;
+    dataSizes[0] = (size_t)header->numFacets * 3 * sizeof(int32_t);
+    offsets[0] = &header->facetOffset;
+    data[1] = vertices;
+    dataSizes[1] = (size_t)header->numVertices * 3 * sizeof(float);
+    offsets[1] = &header->vertexOffset;
+    data[2] = normals;
+    dataSizes[2] = (size_t)header->numFacets * 3 * sizeof(float);
+    offsets[2] = &header->normalOffset;
+    data[3] = attributes;
+    dataSizes[3] = (size_t)header->numFacets * sizeof(uint16_t);
+    offsets[3] = &header->attributeOffset;
+    data[4] = name;
+    dataSizes[4] = (size_t)header->nameLength;
+    offsets[4] = &header->nameOffset;
+
+    /* the header, then every block preceded by the padding aligning it */
+    blocks[0] = header;
+    blockSizes[0] = sizeof(StlCacheHeader);
+    numBlocks = 1;
+    offset = sizeof(StlCacheHeader);
+    for (i = 0; i < 5; i++)
+    {
+        blocks[numBlocks] = padding;
+        blockSizes[numBlocks] = (size_t)((STL_CACHE_ALIGN
+                    - offset % STL_CACHE_ALIGN) % STL_CACHE_ALIGN);
+        offset += blockSizes[numBlocks++];
+        *offsets[i] = offset;
+        blocks[numBlocks] = data[i];
+        blockSizes[numBlocks++] = dataSizes[i];
+        offset += dataSizes[i];
+    }
+    header->fileSize = offset;
+
+    if (write_file_atomic(cacheFile, blocks, blockSizes, numBlocks)
+            != MAPPED_FILE_SUCCESS)
+    {
+        return STL_FAILURE;
+    }
+    return STL_SUCCESS;
+}
+
+/*
+ * grid point of a vertex.  With no tolerance the bit pattern is used
+ * (with -0 folded into 0) so only identical coordinates match
+ */
+static void quantize_vertex(const float *vertex, float tolerance,
+        int64_t *key)
+{
+    double scaled;
+    float value;
+    uint32_t bits;
+    int32_t i;
+
+    for (i = 0; i < 3; i++)
+    {
+        if (tolerance > 0)
+        {
+            scaled = floor((double)vertex[i] / tolerance + 0.5);
+            if (scaled > MAX_QUANTIZED_COORDINATE)
+                scaled = MAX_QUANTIZED_COORDINATE;
+            else if (scaled < -MAX_QUANTIZED_COORDINATE)
+                scaled = -MAX_QUANTIZED_COORDINATE;
+            key[i] = (int64_t)scaled;
+        }
+        else
+        {
+            value = vertex[i] + 0.0f;
+            memcpy(&bits, &value, sizeof(bits));
+            key[i] = (int64_t)bits;
+        }
+    }
+}
+
+static uint32_t hash_vertex_key(const int64_t *key)
+{
+    uint64_t hash;
+
+    hash = (uint64_t)key[0] * 73856093u;
+    hash ^= (uint64_t)key[1] * 19349663u;
+    hash ^= (uint64_t)key[2] * 83492791u;
+    /* mix the high bits down, the table uses the low bits */
+    hash ^= hash >> 29;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 32;
+    return (uint32_t)hash;
+}
+
+/*
+ * first facet keyword at or after position, size if there is none.  The
+ * keyword must be a whole token so endfacet does not match
+ */
+static size_t find_chunk_start(const unsigned char *data, size_t size,
+        size_t position)
+{
+    const unsigned char *p = data + position;
+    const unsigned char *end = data + size;
+
+    while ((p = (const unsigned char *)memchr(p, 'f', end - p)) != NULL)
+    {
+        if (((size_t)(end - p) > 5) && !memcmp(p, "facet", 5)
+                && IS_SPACE(p[5]) && (p > data) && IS_SPACE(p[-1]))
+        {
+            return (size_t)(p - data);
+        }
+        p++;
+    }
+    return size;
+}
+
+/*
+ * count the endfacet keywords of a chunk
+ */
+static void count_chunk(AsciiChunk *chunk)
+{
+    const unsigned char *p = chunk->start;
+    const unsigned char *end = chunk->end;
+    int32_t count = 0;
+
+    while ((p = (const unsigned char *)memchr(p, 'e', end - p)) != NULL)
+    {
+        if (((size_t)(end - p) >= 8) && !memcmp(p, "endfacet", 8))
+        {
+            if (count < 0x7fffffff / 9)
+                count++;
+            p += 8;
+        }
+        else
+        {
+            p++;
+        }
+    }
+    chunk->numFacets = count;
+}
+
+/*
+ * parse the facets of a chunk.  Only the facet, vertex and endfacet
+ * keywords matter, the solid line is skipped in the first chunk
+ */
+static void parse_chunk(AsciiChunk *chunk)
+{
+    const unsigned char *p = chunk->start;
+    const unsigned char *end = chunk->end;
+    const unsigned char *token;
+    size_t tokenLength;
+    double values[3];
+    int32_t facet = 0;
+    int32_t vertex = 0;
+    int32_t index, i;
+
+    chunk->status = STL_FAILURE;
+    if (chunk->skipFirstLine)
+    {
+        while ((p < end) && (*p != '\n'))
+        {
+            p++;
+        }
+    }
+
+    while ((token = next_token(p, end, &tokenLength)) != NULL)
+    {
+        p = token + tokenLength;
+        index = chunk->firstFacet + facet;
+        if (token_equals(token, tokenLength, "facet"))
+        {
+            if (facet >= chunk->numFacets)
+            {
+                sprintf(chunk->errorMessage, "unterminated facet %d",
+                        index + 1);
+                return;
+            }
+            token = next_token(p, end, &tokenLength);
+            if ((token == NULL) || !token_equals(token, tokenLength, "normal")
+                    || ((p = parse_numbers(token + tokenLength, end,
+                                values, 3)) == NULL))
+            {
+                sprintf(chunk->errorMessage, "invalid normal in facet %d",
+                        index + 1);
+                return;
+            }
+            for (i = 0; i < 3; i++)
+            {
+                chunk->normals[index * 3 + i] = (float)values[i];
+            }
+            chunk->attributes[index] = 0;
+            vertex = 0;
+        }
+        else if (token_equals(token, tokenLength, "vertex"))
+        {
+            if ((facet >= chunk->numFacets) || (vertex >= 3)
+                    || ((p = parse_numbers(p, end, values, 3)) == NULL))
+            {
+                sprintf(chunk->errorMessage, "invalid vertex in facet %d",
+                        index + 1);
+                return;
+            }
+            for (i = 0; i < 3; i++)
+            {
+                if (chunk->preciseVertices != NULL)
+                    chunk->preciseVertices[index * 9 + vertex * 3 + i] =
+                        values[i];
+                else
+                    chunk->vertices[index * 9 + vertex * 3 + i] =
+                        (float)values[i];
+            }
+            vertex++;
+        }
+        else if (token_equals(token, tokenLength, "endfacet"))
+        {
+            if (vertex != 3)
+            {
+                sprintf(chunk->errorMessage,
+                        "facet %d does not have 3 vertices", index + 1);
+                return;
+            }
+            facet++;
+            vertex = 0;
+        }
+    }
+
+    if (facet != chunk->numFacets)
+    {
+        sprintf(chunk->errorMessage, "found %d complete facets, "
+                "expected %d", chunk->firstFacet + facet,
+                chunk->firstFacet + chunk->numFacets);
+        return;
+    }
+    chunk->status = STL_SUCCESS;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI chunk_thread(LPVOID argument)
+{
+    ChunkJob *job = (ChunkJob *)argument;
+    job->function(job->chunk);
+    return 0;
+}
+#else
+static void *chunk_thread(void *argument)
+{
+    ChunkJob *job = (ChunkJob *)argument;
+    job->function(job->chunk);
+    return NULL;
+}
+#endif /* _WIN32 */
+
+/*
+ * run function on all the chunks, the first chunk in the calling thread
+ * and the others in their own thread.  A chunk whose thread could not be
+ * started is handled by the calling thread
+ */
+static void run_chunks(ChunkFunction function, AsciiChunk *chunks,
+        int32_t numChunks)
+{
+    ChunkJob jobs[STL_MAX_CHUNKS];
+    int32_t started[STL_MAX_CHUNKS];
+#ifdef _WIN32
+    HANDLE threads[STL_MAX_CHUNKS];
+#else
+    pthread_t threads[STL_MAX_CHUNKS];
+#endif /* _WIN32 */
+    int32_t i;
+
+    for (i = 1; i < numChunks; i++)
+    {
+        jobs[i].function = function;
+        jobs[i].chunk = chunks + i;
+#ifdef _WIN32
+        threads[i] = CreateThread(NULL, 0, chunk_thread, jobs + i, 0, NULL);
+        started[i] = (threads[i] != NULL);
+#else
+        started[i] = (pthread_create(threads + i, NULL, chunk_thread,
+                    jobs + i) == 0);
+#endif /* _WIN32 */
+    }
+
+    if (numChunks > 0)
+    {
+        function(chunks);
+    }
+
+    for (i = 1; i < numChunks; i++)
+    {
+        if (!started[i])
+        {
+            function(chunks + i);
+            continue;
+        }
+#ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif /* _WIN32 */
+    }
+}
+
+static int32_t number_of_processors(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return (int32_t)systemInfo.dwNumberOfProcessors;
+#else
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    return (processors > 0) ? (int32_t)processors : 1;
+#endif /* _WIN32 */
+}
+
+/*
+ * return the start of the next white space separated token and its
+ * length, NULL at the end of the data
+ */
+static const unsigned char *next_token(const unsigned char *p,
+        const unsigned char *end, size_t *tokenLength)
+{
+    const unsigned char *token;
+
+    while ((p < end) && IS_SPACE(*p))
+    {
+        p++;
+    }
+    if (p == end)
+    {
+        return NULL;
+    }
+    token = p;
+    while ((p < end) && !IS_SPACE(*p))
+    {
+        p++;
+    }
+    *tokenLength = (size_t)(p - token);
+    return token;
+}
+
+static int32_t token_equals(const unsigned char *token, size_t tokenLength,
+        const char *keyword)
+{
+    return (strlen(keyword) == tokenLength)
+        && !memcmp(token, keyword, tokenLength);
+}
+
+/*
+ * parse numberOfValues numbers following p.  Returns the position after
+ * the last number or NULL if a token is not a number
+ */
+static const unsigned char *parse_numbers(const unsigned char *p,
+        const unsigned char *end, double *values, int32_t numberOfValues)
+{
+    const unsigned char *token;
+    size_t tokenLength;
+    int32_t i;
+
+    for (i = 0; i < numberOfValues; i++)
+    {
+        token = next_token(p, end, &tokenLength);
+        if ((token == NULL)
+                || !parse_number(token, tokenLength, values + i))
+        {
+            return NULL;
+        }
+        p = token + tokenLength;
+    }
+    return p;
+}
+
+/*
+ * convert a number token.  Decimal numbers with up to 19 significant
+ * digits whose value is mantissa * 10^exponent with an exact mantissa
+ * and power of ten are computed with one multiplication or division,
+ * which is correctly rounded, so the result is the same as strtod.  All
+ * other numbers (long mantissas, large exponents, inf, nan) go through
+ * strtod.  Returns 0 if the token is not a number
+ */
+static int32_t parse_number(const unsigned char *token, size_t tokenLength,
+        double *value)
+{
+    char number[MAX_NUMBER_LENGTH + 1];
+    char *numberEnd;
+    const unsigned char *p = token;
+    const unsigned char *end = token + tokenLength;
+    uint64_t mantissa = 0;
+    int32_t digits = 0;
+    int32_t exponent = 0;
+    int32_t explicitExponent = 0;
+    int32_t negative = 0;
+    int32_t negativeExponent = 0;
+    int32_t anyDigit = 0;
+    double result;
+
+    if ((p < end) && ((*p == '-') || (*p == '+')))
+    {
+        negative = (*p++ == '-');
+    }
+    /* leading zeros are not significant */
+    while ((p < end) && (*p == '0'))
+    {
+        p++;
+        anyDigit = 1;
+    }
+    while ((p < end) && (*p >= '0') && (*p <= '9'))
+    {
+        if (digits < MAX_FAST_DIGITS)
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+        else
+            exponent++;
+        digits++;
+        p++;
+        anyDigit = 1;
+    }
+    if ((p < end) && (*p == '.'))
+    {
+        p++;
+        if (digits == 0)
+        {
+            while ((p < end) && (*p == '0'))
+            {
+                p++;
+                exponent--;
+                anyDigit = 1;
+            }
+        }
+        while ((p < end) && (*p >= '0') && (*p <= '9'))
+        {
+            if (digits < MAX_FAST_DIGITS)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                exponent--;
+            }
+            digits++;
+            p++;
+            anyDigit = 1;
+        }
+    }
+    if (anyDigit && (p < end) && ((*p == 'e') || (*p == 'E')))
+    {
+        p++;
+        if ((p < end) && ((*p == '-') || (*p == '+')))
+        {
+            negativeExponent = (*p++ == '-');
+        }
+        if ((p == end) || (*p < '0') || (*p > '9'))
+        {
+            return 0;
+        }
+        while ((p < end) && (*p >= '0') && (*p <= '9'))
+        {
+            if (explicitExponent < 10000)
+                explicitExponent = explicitExponent * 10 + (*p - '0');
+            p++;
+        }
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+
+    if (anyDigit && (p == end) && (digits <= MAX_FAST_DIGITS)
+            && ((double)mantissa <= MAX_EXACT_MANTISSA)
+            && (exponent >= -MAX_EXACT_POWER) && (exponent <= MAX_EXACT_POWER))
+    {
+        result = (double)mantissa;
+        if (exponent < 0)
+            result /= powersOfTen[-exponent];
+        else
+            result *= powersOfTen[exponent];
+        *value = negative ? -result : result;
+        return 1;
+    }
+
+    /* slow path, the mapped data is not null terminated */
+    if (tokenLength > MAX_NUMBER_LENGTH)
+    {
+        return 0;
+    }
+    memcpy(number, token, tokenLength);
+    number[tokenLength] = '\0';
+    *value = strtod(number, &numberEnd);
+    return (numberEnd == number + tokenLength);
+}
+
+/*------------ END OF FILE ------------- */
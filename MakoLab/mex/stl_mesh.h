@@ -0,0 +1,125 @@
+/****h* /stl_mesh.h ***
+ * NAME
+ * 		stl_mesh.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Decoding of binary and ascii STL files from a memory
+ *              mapped view into preallocated facet arrays, vertex
+ *              welding and the binary mesh cache format.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __STL_MESH_H__ /* make sure that stl_mesh is not redeclared */
+#define __STL_MESH_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#endif
+
+#include <stddef.h>
+
+/* defines */
+#define STL_SUCCESS 1
+#define STL_FAILURE -1
+
+#define STL_FORMAT_BINARY 0
+#define STL_FORMAT_ASCII 1
+
+/* binary layout: 80 byte header, uint32 facet count, 50 bytes per facet */
+/* (normal, 3 vertices as little endian float32 and a uint16 attribute) */
+#define STL_HEADER_SIZE 80
+#define STL_COUNT_SIZE 4
+#define STL_FACET_SIZE 50
+
+#define STL_ASCII_KEYWORD "solid"
+#define STL_ASCII_KEYWORD_LENGTH 5
+
+/* maximum length of the name stored in StlInfo */
+#define STL_MAX_NAME_LENGTH 256
+
+/* ascii files are split in up to STL_MAX_CHUNKS chunks (one per thread) */
+/* of at least STL_MIN_CHUNK_SIZE bytes */
+#define STL_MAX_CHUNKS 16
+#define STL_MIN_CHUNK_SIZE (1 << 20)
+
+/* mesh cache file, bump the version whenever the layout or the meshes */
+/* produced for a given STL file change */
+#define STL_CACHE_MAGIC "MAKOMESH"
+#define STL_CACHE_VERSION 2
+#define STL_CACHE_EXT ".mesh"
+#define STL_CACHE_ALIGN 8
+
+typedef struct {
+    int32_t format;                     /* STL_FORMAT_BINARY or ASCII */
+    int32_t numFacets;
+    int32_t nameLength;
+    char name[STL_MAX_NAME_LENGTH + 1]; /* binary header or first line */
+    int32_t numChunks;                  /* ascii only, chunks start at */
+    size_t chunkStart[STL_MAX_CHUNKS + 1]; /* a facet keyword */
+    int32_t chunkFacets[STL_MAX_CHUNKS];
+} StlInfo;
+
+/* header of a mesh cache file.  The blocks follow at the given (8 byte */
+/* aligned) offsets so a memory mapped file can be used without any */
+/* parsing: int32 facets (3 per facet), float vertices (3 per vertex), */
+/* float normals (3 per facet), uint16 attributes and the name */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t sourceSize;        /* size and time of the STL file */
+    int64_t sourceTime;
+    float weldTolerance;        /* negative if the mesh is not welded */
+    int32_t format;
+    int32_t numFacets;
+    int32_t numVertices;
+    int32_t nameLength;
+    int32_t reserved;
+    float bounds[6];            /* min x y z, max x y z */
+    uint64_t facetOffset;
+    uint64_t vertexOffset;
+    uint64_t normalOffset;
+    uint64_t attributeOffset;
+    uint64_t nameOffset;
+    uint64_t fileSize;
+} StlCacheHeader;
+
+/* function definations */
+int32_t stl_inspect(const unsigned char *data, size_t size, StlInfo *info,
+        char *errorMessage);
+
+int32_t stl_decode(const unsigned char *data, size_t size,
+        const StlInfo *info, float *vertices, double *preciseVertices,
+        float *normals, uint16_t *attributes, char *errorMessage);
+
+int32_t stl_weld_vertices(float *vertices, int32_t numVertices,
+        float tolerance, int32_t *ifacets, int32_t *numUnique);
+
+void stl_compute_bounds(const float *vertices, int32_t numVertices,
+        float *bounds);
+
+const StlCacheHeader *stl_cache_check(const unsigned char *data,
+        size_t size, uint64_t sourceSize, int64_t sourceTime,
+        float weldTolerance);
+
+int32_t stl_cache_write(const char *cacheFile, StlCacheHeader *header,
+        const int32_t *facets, const float *vertices, const float *normals,
+        const uint16_t *attributes, const char *name);
+
+#endif /* __STL_MESH_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,73 @@
+/****h* /stream_clock.c ***
+ * NAME
+ *      stream_clock.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      Monotonic clock and short sleep of the acquisition threads, the
+ *      timebase of the F/T and tracking stream timestamps
+ *
+ * SEE ALSO
+ *      stream_clock.h, ft_stream.c, ndi_stream.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif /* _WIN32 */
+
+#include "stream_clock.h"
+
+/****f*  stream_clock.c/stream_clock ******
+ * NAME
+ *	    stream_clock, stream_sleep
+ *
+ * SYNOPSIS
+ *      double stream_clock(void)
+ *      void stream_sleep(void)
+ *
+ * OUTPUT
+ *      Returns the time in seconds of a monotonic clock, the timebase of
+ *      the sample timestamps
+ *
+ * PURPOSE
+ *	    stream_sleep gives up the processor for about a millisecond,
+ *	    while waiting for samples or for space in the ring
+ *
+ **********************************
+ */
+double stream_clock(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + now.tv_nsec * 1e-9;
+#endif /* _WIN32 */
+}
+
+void stream_sleep(void)
+{
+#ifdef _WIN32
+    Sleep(1);
+#else
+    usleep(1000);
+#endif /* _WIN32 */
+}
+
+/*------------ END OF FILE ------------- */
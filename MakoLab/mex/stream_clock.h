@@ -0,0 +1,33 @@
+/****h* /stream_clock.h ***
+ * NAME
+ * 		stream_clock.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Monotonic clock shared by the acquisition streams, so the
+ *              samples of different sensors have the same timebase.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __STREAM_CLOCK_H__ /* make sure that stream_clock is not redeclared */
+#define __STREAM_CLOCK_H__
+
+/* function definations */
+double stream_clock(void);
+
+void stream_sleep(void);
+
+#endif /* __STREAM_CLOCK_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
@@ -0,0 +1,158 @@
+/****h* /transformVertices.c ***
+ * NAME
+ *      transformVertices.c    $Revision$
+ *
+ * COPYRIGHT
+ *      Copyright (c) 2015 Mako Surgical Corp
+ *
+ * PURPOSE
+ *      This function applies 4x4 transforms to Nx3 vertex arrays, one or
+ *      many blocks of vertices in one call (vertex_transform.c).
+ *
+ * SEE ALSO
+ *      refer to m file documentation on useage
+ *
+ * CVS INFORMATION
+ *      $Revision$
+ *      $Date$
+ *      $Author$
+ *
+ ***************
+ */
+
+#include <mex.h>
+#include <string.h>
+
+#include "vertex_transform.h"
+
+/* defines */
+#define OPTION_LENGTH 16
+
+/* internal functions */
+static void checkVertices(const mxArray *vertices);
+static mxArray *createOutput(const mxArray *vertices, int numCopies);
+
+void mexFunction(int nlhs, mxArray *plhs[],
+                    int nrhs, const mxArray *prhs[])
+{
+    char option[OPTION_LENGTH];
+    VtBlock *blocks;
+    const mxArray *vertices;
+    mxArray *output;
+    const double *transforms;
+    uint32_t numTransforms, numBlocks, numVertices, k;
+    int32_t numThreads;
+    int isCell;
+
+    /* first check the inputs */
+    if ((nrhs != 2) && (nrhs != 4))
+    {
+        mexErrMsgTxt("Must specify the vertices and the transforms");
+        return;
+    }
+    if (!mxIsDouble(prhs[1]) || mxIsComplex(prhs[1])
+            || (mxGetNumberOfDimensions(prhs[1]) > 3)
+            || (mxGetDimensions(prhs[1])[0] != 4)
+            || (mxGetDimensions(prhs[1])[1] != 4)
+            || mxIsEmpty(prhs[1]))
+    {
+        mexErrMsgTxt("Transforms must be a 4x4 or 4x4xK double array");
+        return;
+    }
+    transforms = mxGetPr(prhs[1]);
+    numTransforms = (uint32_t)(mxGetNumberOfElements(prhs[1]) / 16);
+
+    numThreads = vt_number_of_processors();
+    if (nrhs == 4)
+    {
+        if (!mxIsChar(prhs[2])
+                || (mxGetString(prhs[2], option, OPTION_LENGTH) != 0)
+                || (strcmp(option, "Threads") != 0)
+                || !mxIsNumeric(prhs[3]) || mxIsEmpty(prhs[3]))
+        {
+            mexErrMsgTxt("Unknown parameter, use Threads");
+            return;
+        }
+        numThreads = (mxGetScalar(prhs[3]) >= 1)
+            ? (int32_t)mxGetScalar(prhs[3]) : 1;
+    }
+
+    isCell = mxIsCell(prhs[0]);
+    if (isCell)
+    {
+        /* one transform per block, or the same for all */
+        numBlocks = (uint32_t)mxGetNumberOfElements(prhs[0]);
+        if ((numTransforms != 1) && (numTransforms != numBlocks))
+        {
+            mexErrMsgTxt("Must specify one transform or one per block of vertices");
+            return;
+        }
+        plhs[0] = mxCreateCellMatrix(mxGetM(prhs[0]), mxGetN(prhs[0]));
+    }
+    else
+    {
+        /* every transform applied to the same vertices */
+        checkVertices(prhs[0]);
+        numBlocks = numTransforms;
+        plhs[0] = createOutput(prhs[0], (int)numTransforms);
+    }
+
+    blocks = (VtBlock *)mxCalloc(numBlocks + 1, sizeof(VtBlock));
+    for (k = 0; k < numBlocks; k++)
+    {
+        if (isCell)
+        {
+            vertices = mxGetCell(prhs[0], k);
+            checkVertices(vertices);
+            output = createOutput(vertices, 1);
+            mxSetCell(plhs[0], k, output);
+            numVertices = (uint32_t)mxGetM(vertices);
+            blocks[k].output = mxGetData(output);
+        }
+        else
+        {
+            vertices = prhs[0];
+            numVertices = (uint32_t)mxGetM(vertices);
+            blocks[k].output = (char *)mxGetData(plhs[0])
+                + (size_t)k * numVertices * 3 * mxGetElementSize(vertices);
+        }
+        blocks[k].vertices = mxGetData(vertices);
+        blocks[k].numVertices = numVertices;
+        blocks[k].isSingle = mxIsSingle(vertices);
+        blocks[k].transform = transforms
+            + ((numTransforms == 1) ? 0 : 16 * k);
+    }
+
+    vt_transform_blocks(blocks, numBlocks, numThreads);
+    mxFree(blocks);
+    return;
+}
+
+/*
+ * errors out if the vertices are not an Nx3 double or single array
+ */
+static void checkVertices(const mxArray *vertices)
+{
+    if ((vertices == NULL) || !(mxIsDouble(vertices) || mxIsSingle(vertices))
+            || mxIsComplex(vertices)
+            || (mxGetNumberOfDimensions(vertices) != 2)
+            || ((mxGetN(vertices) != 3) && !mxIsEmpty(vertices)))
+    {
+        mexErrMsgTxt("Vertices must be Nx3 double or single arrays");
+    }
+}
+
+/*
+ * Nx3xnumCopies array of the class of the vertices
+ */
+static mxArray *createOutput(const mxArray *vertices, int numCopies)
+{
+    int dims[3];
+
+    dims[0] = (int)mxGetM(vertices);
+    dims[1] = 3;
+    dims[2] = numCopies;
+    return mxCreateNumericArray(3, dims, mxGetClassID(vertices), mxREAL);
+}
+
+/*----------- END OF FILE ------------ */
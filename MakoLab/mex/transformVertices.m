@@ -0,0 +1,41 @@
+%TRANSFORMVERTICES Apply 4x4 transforms to blocks of vertices
+%
+% Syntax:
+%   transformedVerts = transformVertices(verts,transform)
+%       verts is an Nx3 double or single array of vertices (as used by
+%       patch) and transform a 4x4 homogeneous transform.  Returns the
+%       Nx3 transformed vertices, of the class of verts.
+%   transformedVerts = transformVertices(verts,transforms)
+%       transforms is a 4x4xK array, returns the Nx3xK vertices moved by
+%       each of the transforms.
+%   transformedBlocks = transformVertices(blocks,transforms)
+%       blocks is a cell array of K Nx3 vertex arrays (N can differ), each
+%       block is moved by its transform of the 4x4xK array (or all by the
+%       same 4x4 transform).  Returns a cell array of the size of blocks.
+%   [...] = transformVertices(...,'Threads',numThreads)
+%       uses at most numThreads threads (default one per processor).
+%
+% Notes:
+%   The vertices of all the blocks are split evenly over the threads;
+%   jobs of less than 65536 vertices per thread do not start threads.
+%   The last row of the transforms is ignored, as transform_vertices does.
+%
+% Example:
+%   % move all the parts of a model in one call
+%   verts = transformVertices({parts.verts},cat(3,partTransforms{:}));
+%   for k=1:length(parts)
+%       set(parts(k).patch,'Vertices',verts{k});
+%   end
+%
+% See also:
+%    transform_vertices, vec2tr, hgs_robot/plot3
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+
+% --------- END OF FILE ----------
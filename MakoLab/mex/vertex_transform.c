@@ -0,0 +1,278 @@
+/****h* /vertex_transform.c ***
+ * NAME
+ *      vertex_transform.c	$Revision$
+ *
+ * COPYRIGHT
+ * 	Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *      This library applies 4x4 transforms to blocks of vertices.  The
+ *      vertices are kept in the matlab layout (one column per coordinate)
+ *      so the inner loops run over contiguous columns with the transform
+ *      coefficients in registers, a form the compilers vectorize.  The
+ *      vertices of all the blocks are split into equal ranges, one per
+ *      thread, so a few large blocks and many small ones spread the same.
+ *
+ * SEE ALSO
+ *      vertex_transform.h, transformVertices.c
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************/
+
+/* includes */
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif /* _WIN32 */
+
+#include "vertex_transform.h"
+
+/* vertices first to first + count - 1 of all the blocks, in order */
+typedef struct {
+    const VtBlock *blocks;
+    uint32_t numBlocks;
+    uint64_t first;
+    uint64_t count;
+} RangeJob;
+
+/* internal functions */
+static void transform_range(RangeJob *job);
+static void transform_double(const VtBlock *block, uint32_t first,
+        uint32_t count);
+static void transform_single(const VtBlock *block, uint32_t first,
+        uint32_t count);
+static void run_jobs(RangeJob *jobs, int32_t numJobs);
+
+/****f*  vertex_transform.c/vt_transform_blocks ******
+ * NAME
+ *	    vt_transform_blocks
+ *
+ * SYNOPSIS
+ *      void vt_transform_blocks(VtBlock *blocks, uint32_t numBlocks,
+ *              int32_t numThreads)
+ *
+ * INPUTS
+ *      VtBlock *blocks
+ *              vertices, output and transform of every block
+ *      int32_t numThreads
+ *              most threads to use, fewer are started for small jobs
+ *
+ * OUTPUT
+ *      the output of every block, T * [x y z 1]' for each vertex
+ *
+ **********************************
+ */
+void vt_transform_blocks(VtBlock *blocks, uint32_t numBlocks,
+        int32_t numThreads)
+{
+    RangeJob jobs[VT_MAX_THREADS];
+    uint64_t total;
+    uint32_t i;
+    int32_t numJobs, j;
+
+    total = 0;
+    for (i = 0; i < numBlocks; i++)
+    {
+        total += blocks[i].numVertices;
+    }
+
+    numJobs = (int32_t)(total / VT_MIN_THREAD_VERTICES);
+    if (numJobs > numThreads)
+    {
+        numJobs = numThreads;
+    }
+    if (numJobs > VT_MAX_THREADS)
+    {
+        numJobs = VT_MAX_THREADS;
+    }
+    if (numJobs < 1)
+    {
+        numJobs = 1;
+    }
+
+    for (j = 0; j < numJobs; j++)
+    {
+        jobs[j].blocks = blocks;
+        jobs[j].numBlocks = numBlocks;
+        jobs[j].first = total * j / numJobs;
+        jobs[j].count = total * (j + 1) / numJobs - jobs[j].first;
+    }
+    run_jobs(jobs, numJobs);
+}
+
+/****f*  vertex_transform.c/vt_number_of_processors ******
+ * NAME
+ *	    vt_number_of_processors
+ *
+ * SYNOPSIS
+ *      int32_t vt_number_of_processors(void)
+ *
+ * OUTPUT
+ *      Returns the number of processors, the default number of threads
+ *
+ **********************************
+ */
+int32_t vt_number_of_processors(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return (int32_t)systemInfo.dwNumberOfProcessors;
+#else
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    return (processors > 0) ? (int32_t)processors : 1;
+#endif /* _WIN32 */
+}
+
+/*
+ * transform the part of every block that falls in the range of the job
+ */
+static void transform_range(RangeJob *job)
+{
+    const VtBlock *block;
+    uint64_t blockStart, end;
+    uint32_t i, first, count;
+
+    blockStart = 0;
+    end = job->first + job->count;
+    for (i = 0; (i < job->numBlocks) && (blockStart < end); i++)
+    {
+        block = job->blocks + i;
+        if (blockStart + block->numVertices > job->first)
+        {
+            first = (job->first > blockStart)
+                ? (uint32_t)(job->first - blockStart) : 0;
+            count = ((end < blockStart + block->numVertices)
+                    ? (uint32_t)(end - blockStart) : block->numVertices)
+                - first;
+            if (block->isSingle)
+                transform_single(block, first, count);
+            else
+                transform_double(block, first, count);
+        }
+        blockStart += block->numVertices;
+    }
+}
+
+static void transform_double(const VtBlock *block, uint32_t first,
+        uint32_t count)
+{
+    const double *t = block->transform;
+    const double *x = (const double *)block->vertices + first;
+    const double *y = x + block->numVertices;
+    const double *z = y + block->numVertices;
+    double *outX = (double *)block->output + first;
+    double *outY = outX + block->numVertices;
+    double *outZ = outY + block->numVertices;
+    double t0 = t[0], t1 = t[1], t2 = t[2], t4 = t[4], t5 = t[5];
+    double t6 = t[6], t8 = t[8], t9 = t[9], t10 = t[10];
+    double t12 = t[12], t13 = t[13], t14 = t[14];
+    double vx, vy, vz;
+    uint32_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        vx = x[i];
+        vy = y[i];
+        vz = z[i];
+        outX[i] = t0 * vx + t4 * vy + t8 * vz + t12;
+        outY[i] = t1 * vx + t5 * vy + t9 * vz + t13;
+        outZ[i] = t2 * vx + t6 * vy + t10 * vz + t14;
+    }
+}
+
+static void transform_single(const VtBlock *block, uint32_t first,
+        uint32_t count)
+{
+    const double *t = block->transform;
+    const float *x = (const float *)block->vertices + first;
+    const float *y = x + block->numVertices;
+    const float *z = y + block->numVertices;
+    float *outX = (float *)block->output + first;
+    float *outY = outX + block->numVertices;
+    float *outZ = outY + block->numVertices;
+    float t0 = (float)t[0], t1 = (float)t[1], t2 = (float)t[2];
+    float t4 = (float)t[4], t5 = (float)t[5], t6 = (float)t[6];
+    float t8 = (float)t[8], t9 = (float)t[9], t10 = (float)t[10];
+    float t12 = (float)t[12], t13 = (float)t[13], t14 = (float)t[14];
+    float vx, vy, vz;
+    uint32_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        vx = x[i];
+        vy = y[i];
+        vz = z[i];
+        outX[i] = t0 * vx + t4 * vy + t8 * vz + t12;
+        outY[i] = t1 * vx + t5 * vy + t9 * vz + t13;
+        outZ[i] = t2 * vx + t6 * vy + t10 * vz + t14;
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI range_thread(LPVOID argument)
+{
+    transform_range((RangeJob *)argument);
+    return 0;
+}
+#else
+static void *range_thread(void *argument)
+{
+    transform_range((RangeJob *)argument);
+    return NULL;
+}
+#endif /* _WIN32 */
+
+/*
+ * run the jobs, the first one in the calling thread and the others in
+ * their own thread.  A job whose thread could not be started is run by
+ * the calling thread
+ */
+static void run_jobs(RangeJob *jobs, int32_t numJobs)
+{
+    int32_t started[VT_MAX_THREADS];
+#ifdef _WIN32
+    HANDLE threads[VT_MAX_THREADS];
+#else
+    pthread_t threads[VT_MAX_THREADS];
+#endif /* _WIN32 */
+    int32_t i;
+
+    for (i = 1; i < numJobs; i++)
+    {
+#ifdef _WIN32
+        threads[i] = CreateThread(NULL, 0, range_thread, jobs + i, 0, NULL);
+        started[i] = (threads[i] != NULL);
+#else
+        started[i] = (pthread_create(threads + i, NULL, range_thread,
+                    jobs + i) == 0);
+#endif /* _WIN32 */
+    }
+
+    transform_range(jobs);
+
+    for (i = 1; i < numJobs; i++)
+    {
+        if (!started[i])
+        {
+            transform_range(jobs + i);
+            continue;
+        }
+#ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif /* _WIN32 */
+    }
+}
+
+/*------------ END OF FILE ------------- */
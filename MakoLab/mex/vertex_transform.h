@@ -0,0 +1,57 @@
+/****h* /vertex_transform.h ***
+ * NAME
+ * 		vertex_transform.h	$Revision$
+ *
+ * COPYRIGHT
+ * 		Copyright (c) 2015 Mako Surgical Corp.
+ *
+ * PURPOSE
+ *              Rigid (or affine) transforms applied to blocks of vertices
+ *              stored as in matlab, Nx3 column major: all the x, then all
+ *              the y, then all the z.  Many blocks, each with its own
+ *              transform, are handled in one call and large jobs are
+ *              split over threads.
+ *
+ * CVS INFORMATION
+ * 		$Revision$
+ * 		$Date$
+ * 		$Author$
+ *
+ ***************
+ */
+
+#ifndef __VERTEX_TRANSFORM_H__ /* make sure that vertex_transform is not redeclared */
+#define __VERTEX_TRANSFORM_H__
+
+#ifdef _WIN32
+#include "stdint.h"
+#else
+#include <inttypes.h>
+#endif
+
+/* defines */
+#define VT_MAX_THREADS 16
+
+/* vertices per thread below which no extra thread is started */
+#define VT_MIN_THREAD_VERTICES 65536
+
+typedef struct {
+    const void *vertices;       /* numVertices x 3, column major */
+    void *output;               /* same size and class, may be vertices */
+    uint32_t numVertices;
+    int32_t isSingle;           /* float instead of double vertices */
+    const double *transform;    /* 4x4 column major, last row ignored */
+} VtBlock;
+
+/* function definations */
+void vt_transform_blocks(VtBlock *blocks, uint32_t numBlocks,
+        int32_t numThreads);
+
+int32_t vt_number_of_processors(void);
+
+#endif /* __VERTEX_TRANSFORM_H__ */
+
+
+
+
+/*------------ END OF FILE ------------- */
@@ -1,6 +1,7 @@
-function [transform, rmsFitError] = pointPairMatching(pointSetA, pointSetB)
+function [transform, rmsFitError, fitErrorDist, inliers] = ...
+    pointPairMatching(pointSetA, pointSetB, varargin)
 
-% pointPairMatching Simple SVD based point pair matching
+% pointPairMatching Simple least squares point pair matching
 %
 % Simple point pair matching of 2 point clouds for identifying the
 % transfroms that describe pointSetA wrt pointSetB
@@ -9,6 +10,14 @@ function [transform, rmsFitError] = pointPairMatching(pointSetA, pointSetB)
 %   [transform, rmsFitError] = pointPairMatching(pointSetA, pointSetB)
 %       pointSetA, pointSetB
 %           Point pairs to be matched.   
+%   [transform, rmsFitError, fitErrorDist, inliers] = ...
+%           pointPairMatching(pointSetA, pointSetB, 'parameter', value, ...)
+%       fitErrorDist
+%           fit error of every point pair
+%       inliers
+%           point pairs used by the fit
+%       The parameters select the outlier rejection, see registerPointPairs.
+%       Nx3xK arrays or cell arrays of point sets are matched in one call.
 %
 
 % $Author: dmoses $
@@ -18,27 +27,13 @@ function [transform, rmsFitError] = pointPairMatching(pointSetA, pointSetB)
 %
 
 
-% Compute the centroids of each of the point set
-centroidA = mean(pointSetA);
-centroidB = mean(pointSetB);
+% the fit is done by the registerPointPairs mex function
+if ~iscell(pointSetA)
+    pointSetA = double(pointSetA);
+    pointSetB = double(pointSetB);
+end
+[transform, rmsFitError, fitErrorDist, inliers] = ...
+    registerPointPairs(pointSetA, pointSetB, varargin{:});
 
-% Compute centered vectors
-centerVectorA = pointSetA - centroidA(ones(length(pointSetA),1),:);
-centerVectorB = pointSetB - centroidB(ones(length(pointSetB),1),:);
 
-% compute the covariance matrix
-covMatrix = centerVectorA'*centerVectorB;
-
-% use SVD
-[U,~, V] = svd(covMatrix);
-
-% compute rotation and translation
-Rot = V*U';
-T = centroidB' - Rot*centroidA';
-transform = [ Rot T; 0 0 0 1];
-
-% calculate the fit error
-fitError = [pointSetB ones(length(pointSetB),1)] - (transform*([pointSetA ones(length(pointSetA),1)]'))';
-fitError = fitError(:,1:3);
-fitErrorDist = sqrt(sum(fitError.^2,2));
-rmsFitError = rms(fitErrorDist);
\ No newline at end of file
+% --------- END OF FILE ----------
@@ -0,0 +1,57 @@
+function cfgParams = readArmConfig(fileName)
+%READARMCONFIG Read the parameters of an hgs_arm.cfg file
+%
+% Syntax:
+%   cfgParams = readArmConfig(fileName)
+%       reads the hgs_arm.cfg (or hgs_arm*.cfg.default) file fileName and
+%       returns a structure with one field per parameter, laid out as
+%       commDataPair(hgs,'get_cfg_params') returns them: numeric values
+%       are row vectors with the matrices stored row by row, the other
+%       values are strings.
+%
+% Notes:
+%   Comments (#) and the .property lines are skipped.  The matrices can
+%   be reshaped as the robot parameters, e.g.
+%       dh = reshape(cfgParams.NOMINAL_DH_MATRIX,4,cfgParams.WAM_DOF)';
+%
+% Example:
+%   cfgParams = readArmConfig('extern/ServiceMfgCRISIS/hgs_arm3_0.cfg.default');
+%   T = forwardKinematics(cfgParams,zeros(1,cfgParams.WAM_DOF));
+%
+% See also:
+%   forwardKinematics, hgs_robot/plot3
+
+%
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+%
+
+fid = fopen(fileName,'r');
+if fid==-1
+    error('Unable to open the configuration file %s',fileName);
+end
+cfgText = fread(fid,inf,'*char')';
+fclose(fid);
+
+% drop the comments and the property lines
+cfgLines = regexp(cfgText,'[\r\n]+','split');
+keep = cellfun(@(x) isempty(regexp(x,'^\s*#|\.property\.','once')),cfgLines);
+cfgText = sprintf('%s\n',cfgLines{keep});
+
+% NAME { values }, the values can span lines
+tokens = regexp(cfgText,'(\w+)\s*\{([^}]*)\}','tokens');
+cfgParams = struct();
+for k=1:length(tokens)
+    valueText = strtrim(tokens{k}{2});
+    [value,count,errorMessage] = sscanf(valueText,'%f');
+    if isempty(errorMessage) && count>0
+        cfgParams.(tokens{k}{1}) = value';
+    else
+        cfgParams.(tokens{k}{1}) = valueText;
+    end
+end
+
+
+% --------- END OF FILE ----------
@@ -1,4 +1,4 @@
-function [patchHandle,face,verts] = show_stl(stlFileName)
+function [patchHandle,face,verts] = show_stl(stlFileName,previewResolution)
 %SHOW_STL display the model from an stl file
 %
 % Syntax:
@@ -7,9 +7,22 @@ function [patchHandle,face,verts] = show_stl(stlFileName)
 %   show_stl
 %       If no file is specified a dialog window will be opened and the user will
 %       be prompted to choose a file
+%   show_stl(stlFileName,previewResolution)
+%       also voxelize the model with mod2polygon at previewResolution (in
+%       the units of the STL file) and add the occupied cells of each
+%       coarse level of the voxel pyramid to the rendering options.  The
+%       coarse levels are a quick preview of large models.
+%
+% Notes:
+%   The model is drawn from levels of detail built by mesh_lods.  The
+%   level is selected from the size of a pixel in the current view and
+%   selected again when the figure is resized or zoomed, the full model
+%   is drawn when the facets are larger than a pixel.  The facet colors
+%   of the file are only shown with the full model, the coarser levels
+%   use the average color.
 %
 % See also:
-%   patch, read_stl, surface, teapotdemo
+%   patch, read_stl, surface, teapotdemo, mod2polygon, mesh_lods
 %
 
 %
@@ -32,6 +45,27 @@ end
 % Read in the STL filename
 [face, verts, color] = read_stl(stlFileName);
 
+% levels of detail for rendering, the first one is the full model
+lods = mesh_lods(face,verts);
+lodLevel = 1;
+
+% voxelize the model for the preview, only the voxel pyramid is used
+pyramid = struct('cellSize',{},'vsizeData',{},'cellData',{});
+if (nargin>1)
+    [voxelData,facetData,vsizeData,hwiData,voxelMap,maxOccupancy,pyramid] = ...
+        mod2polygon('preview',size(face,1),size(verts,1),...
+        int32(reshape(face',1,[])-1),single(1),single(reshape(verts',1,[])),...
+        single(previewResolution),0); %#ok<ASGLU>
+    % hwiData is the grid origin in voxels (scaled by 0.001)
+    gridOrigin = hwiData(:)'*1000*previewResolution;
+end
+renderingModes = [{'Solid'},{'Wireframe'},...
+        {'Transparent (50%)'},{'Transparent (25%)'}];
+for i=1:length(pyramid)
+    renderingModes{end+1} = sprintf('Voxels (%g)',...
+        pyramid(i).cellSize*previewResolution); %#ok<AGROW>
+end
+
 % Start a new figure and setup some basic properties
 figHandle = figure;
 
@@ -40,8 +74,7 @@ cameratoolbar;
 
 % Add a simple menu option to change from solid to wireframe or other views
 popupHandle = uicontrol(figHandle,...
-    'String',[{'Solid'},{'Wireframe'},...
-        {'Transparent (50%)'},{'Transparent (25%)'}],...
+    'String',renderingModes,...
     'Callback',@updateRenderingMode,...
     'Style','popupmenu',...
     'Units','normalized',...
@@ -66,14 +99,38 @@ patchHandle = patch('faces',face,...
     'FacevertexCdata',color,...
     'edgecolor','none');
 
+% the pyramid levels are drawn as boxes, hidden until selected
+pyramidHandles = zeros(1,length(pyramid));
+for i=1:length(pyramid)
+    [cellFaces,cellVerts] = pyramidCells(pyramid(i));
+    pyramidHandles(i) = patch('faces',cellFaces,...
+        'vertices',cellVerts,...
+        'facecolor',[0.6 0.6 0.9],...
+        'edgecolor','black',...
+        'visible','off');
+end
+
 % Setup options for faster rendering.  Lock the zoom and limits
 axis equal;
 set(gca,'Xlimmode','manual','ylimmode','manual');
 
+% pick the level of detail for the view, and again when it changes
+updateLevelOfDetail;
+set(figHandle,'ResizeFcn',@updateLevelOfDetail);
+addlistener(gca,'CameraViewAngle','PostSet',@updateLevelOfDetail);
+
 drawnow;
 
 function updateRenderingMode(varargin)
-    switch get(popupHandle,'value')
+    renderingMode = get(popupHandle,'value');
+    set(pyramidHandles,'visible','off');
+    if (renderingMode>4)
+        set(patchHandle,'visible','off');
+        set(pyramidHandles(renderingMode-4),'visible','on');
+        return;
+    end
+    set(patchHandle,'visible','on');
+    switch renderingMode
         case 1
             set(patchHandle,...
                 'facec','flat',...
@@ -101,6 +158,38 @@ function updateRenderingMode(varargin)
     end
 end
 
+function updateLevelOfDetail(varargin)
+    level = mesh_lods(lods,get(patchHandle,'parent'));
+    if (level==lodLevel)
+        return;
+    end
+    lodLevel = level;
+    if (level==1)
+        set(patchHandle,'vertices',verts,'faces',face,...
+            'FacevertexCdata',color);
+    else
+        set(patchHandle,'vertices',lods(level).verts,...
+            'faces',lods(level).faces,...
+            'FacevertexCdata',repmat(mean(color,1),...
+            size(lods(level).faces,1),1));
+    end
+end
+
+function [cellFaces,cellVerts] = pyramidCells(level)
+    % boxes of the occupied cells of one pyramid level
+    numCells = prod(level.vsizeData);
+    cellStart = double(typecast(level.cellData(1:4*(numCells+1)),'uint32'));
+    occupied = find(diff(cellStart)>0);
+    [ix,iy,iz] = ind2sub(level.vsizeData(:)',occupied(:));
+    cellEdge = level.cellSize*previewResolution;
+    numOccupied = length(occupied);
+    corners = [ix-1,iy-1,iz-1]*cellEdge + repmat(gridOrigin,numOccupied,1);
+    unitVerts = [0 0 0;1 0 0;1 1 0;0 1 0;0 0 1;1 0 1;1 1 1;0 1 1];
+    unitFaces = [1 2 3 4;5 6 7 8;1 2 6 5;2 3 7 6;3 4 8 7;4 1 5 8];
+    cellVerts = kron(corners,ones(8,1)) + repmat(unitVerts*cellEdge,numOccupied,1);
+    cellFaces = kron((0:numOccupied-1)'*8,ones(6,4)) + repmat(unitFaces,numOccupied,1);
+end
+
 end
 
 
@@ -0,0 +1,26 @@
+function vector = tr2vec(transform)
+%TR2VEC convert a 4x4 homogenous transform to a 16x1 vector
+%
+% Syntax:  
+%   tr2vec(transform)
+%       this converts the 4x4 transform to a 16x1 vector holding the
+%       transform row by row, the inverse of vec2tr
+%   tr2vec(transforms)
+%       transforms is a 4x4xK array, converted to a 16xK array with one
+%       vector per column in one call
+%
+% See also:
+%   vec2tr
+%
+
+% $Author$
+% $Revision$
+% $Date$
+% Copyright: MAKO Surgical corp (2015)
+
+numTransforms = numel(transform)/16;
+vector = reshape(permute(reshape(transform,4,4,numTransforms),[2 1 3]),...
+    16,numTransforms);
+
+
+%------------- END OF FILE ----------------
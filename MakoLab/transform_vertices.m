@@ -18,6 +18,10 @@ function transformedVerts = transform_vertices(verts,transform,ypr)
 %       argument.  this will be an angle vector represented in the standard
 %       ypr format
 %
+%   transfromedBlocks = transfrom_vertices(blocks,transforms)
+%       Moves every vertex array of the cell array blocks by its transform
+%       of the 4x4xK array transforms in one call, see transformVertices
+%
 % Example:
 %   This is an example of how to read and display an stl file.  For this example
 %   i will assume that there is an stl file ABCD.stl to be displayed.
@@ -35,7 +39,7 @@ function transformedVerts = transform_vertices(verts,transform,ypr)
 %   set(phandle,'vertices',transform_vertices(verts,[2 3 0]));
 %
 % See also:
-%   patch, show_stl, read_stl
+%   patch, show_stl, read_stl, transformVertices
 %
 
 %
@@ -74,10 +78,11 @@ if ((dim(1)~=4) || (dim(2)~=4))
     end     
 end
 
-dim = size(verts);
-
-transformedVerts = transform*[verts,ones(dim(1),1)]';
-transformedVerts = transformedVerts(1:3,:)';
+% the vertices are moved by the transformVertices mex function
+if ~iscell(verts) && ~isa(verts,'single')
+    verts = double(verts);
+end
+transformedVerts = transformVertices(verts,double(transform));
 
 end
 
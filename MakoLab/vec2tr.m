@@ -1,4 +1,4 @@
-function transform = vec2tr(vector,check)
+function [transform, valid] = vec2tr(vector,check)
 %VEC2TR convert a 16x1 vector to a 4x4 homogenous transform
 %
 % Syntax:  
@@ -7,6 +7,13 @@ function transform = vec2tr(vector,check)
 %   vec2tr(vector,check)
 %       setting the check to true will enable checking the transform to
 %       make sure it is a valid homogenous transform before converting
+%   [transforms, valid] = vec2tr(vectors,check)
+%       vectors is a 16xK array with one vector per column, converted to
+%       a 4x4xK array of transforms in one call.  valid is a 1xK logical
+%       array, with the check transforms is -1 if any of them is invalid
+%
+% See also:
+%   tr2vec, transformVertices
 %
 
 % $Author: rzhou $
@@ -14,12 +21,21 @@ function transform = vec2tr(vector,check)
 % $Date: 2010-02-11 15:15:37 -0500 (Thu, 11 Feb 2010) $
 % Copyright: MAKO Surgical corp 2007
 
-transform = reshape(vector,4,4)';
+% the vectors hold the transforms row by row
+numTransforms = numel(vector)/16;
+transform = permute(reshape(vector,4,4,numTransforms),[2 1 3]);
 
+valid = true(1,numTransforms);
 if nargin==2 && check
-    if (det(transform(1:3,1:3))-1)>1e-6
-        transform=-1;
-    elseif (transform(4,1:4)~=[0 0 0 1])
+    % determinant of every rotation and last row of every transform
+    r = reshape(transform(1:3,1:3,:),9,numTransforms);
+    rotationDet = r(1,:).*(r(5,:).*r(9,:)-r(6,:).*r(8,:))...
+        -r(4,:).*(r(2,:).*r(9,:)-r(3,:).*r(8,:))...
+        +r(7,:).*(r(2,:).*r(6,:)-r(3,:).*r(5,:));
+    lastRow = reshape(transform(4,1:4,:),4,numTransforms);
+    valid = (abs(rotationDet-1)<=1e-6) ...
+        & all(lastRow==repmat([0;0;0;1],1,numTransforms),1);
+    if ~all(valid)
         transform=-1;
     end
 end
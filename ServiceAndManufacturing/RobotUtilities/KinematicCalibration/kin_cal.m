@@ -258,39 +258,23 @@ drawnow;
         dhp = bbarData.nominalDH_Matrix;
         dhp_ci= zeros(size(dhp));
         dhp_ci(1,:) = ones(size(dhp_ci(1,:)));
-        for i=1:bbarData.dof,
-            dhp_desc(i,:) = {['a',num2str(i)],  ...
-                ['alpha',num2str(i)],...
-                ['d',num2str(i)],...
-                ['theta_offset',num2str(i)]}; %#ok<AGROW>
-        end
-        dhp_scaling = ones(size(dhp));
 
         lbb = bbarData.lbb;
-        lbb_scaling = 1;
         lbb_ci = 1;
-        lbb_desc = {'lbb'};
 
         basepos = bbarData.basePos(:);
         basepos_ci = [0 0 0]';
-        basepos_scaling = [1 1 1]';
-        basepos_desc = {'base_x'; 'base_y'; 'base_z'};
 
         flange = [bbarData.nominalFlangeTransform(1:3,4); ...
             Tx_2_YPR(bbarData.nominalFlangeTransform)];
         flange_ci = [0 0 1 0 0 1]';
-        flange_scaling = [1 1 1 1 1 1]';
-        flange_desc = {'fl_x'; 'fl_y';'fl_z'; 'fl_yaw';'fl_pitch';'fl_roll'};
-
-        [pinit,cinit,var_ci,var_desc,var_scaling] = packparams(dhp,dhp_ci, ...
-            dhp_desc,dhp_scaling, ...
-            flange,flange_ci, ...
-            flange_desc,flange_scaling, ...
-            lbb,lbb_ci,lbb_desc, ...
-            lbb_scaling, basepos, ...
-            basepos_ci, ...
-            basepos_desc, ...
-            basepos_scaling);
+
+        % starting parameters and the parameters held constant for
+        % kinematicCalibration
+        initial = struct('dh',dhp,'flange',flange,'lbb',lbb,...
+            'basepos',basepos);
+        constant = struct('dh',dhp_ci,'flange',flange_ci,'lbb',lbb_ci,...
+            'basepos',basepos_ci);
         allDataEEpos=[];
         allData=[];
 
@@ -331,22 +315,16 @@ drawnow;
         %[pfit ]=lmopt('ballbar_objfun',pinit,dp,dpmin,dfmin,...
         %                1,fitDataTCL,...
         %                fitDataEEposTCL,cinit,var_ci,var_scaling);
-        pinit = pinit(:); var_scaling = var_scaling(:);
-        [pfitArray, info, perf, jacobian] = sec_LM( 'ballbar_objfun',  pinit, [], [], ...
-            fitData, fitDataEEpos, ...
-            cinit, var_ci, var_scaling);
-        pfit = pfitArray(:,end);
+        [fit, resid, info] = kinematicCalibration(initial, ...
+            fitData, fitDataEEpos, 'Constant', constant);
         %toc
-        resid = ballbar_objfun(pfit, fitData, ...
-            fitDataEEpos, cinit, ...
-            var_ci, var_scaling);
         % convert residue to millimeter
         resid=resid*1000;
 
         %verify the result using another set of data points
-        resid_valid = ballbar_objfun(pfit, testData, ...
-            testDataEEpos, cinit, ...
-            var_ci, var_scaling);
+        [tmp1, resid_valid] = kinematicCalibration(fit, ...
+            testData, testDataEEpos, 'Constant', constant, ...
+            'MaxIterations', 0);
         resid_valid=resid_valid*1000;
 
         if(true)
@@ -360,13 +338,9 @@ drawnow;
             testDataEEpos = newAllDataEEpos(numFitData+1:end,:);
             updateMainButtonInfo(guiHandles,'text',...
                 'Second run ... please wait');
-            [pfitArray, info, perf, jacobian] = sec_LM( 'ballbar_objfun',  pinit, [], [], ...
-                fitData, fitDataEEpos, ...
-                cinit, var_ci, var_scaling);
-            pfit = pfitArray(:,end);
-            resid = ballbar_objfun(pfit, fitData, ...
-                fitDataEEpos, cinit, ...
-                var_ci, var_scaling)*1000;
+            [fit, resid, info] = kinematicCalibration(fit, ...
+                fitData, fitDataEEpos, 'Constant', constant);
+            resid = resid*1000;
 
             % this part is commented out but can be used with nonlin_lsq optimization
             %            [pfit, Resnorm, resid, exitFlag, outp] = ...
@@ -385,9 +359,9 @@ drawnow;
             %                  'Warning');
             %          end
             %verify the result using another set of data points
-            resid_valid = ballbar_objfun(pfit, testData, ...
-                testDataEEpos, cinit, ...
-                var_ci, var_scaling);
+            [tmp1, resid_valid] = kinematicCalibration(fit, ...
+                testData, testDataEEpos, 'Constant', constant, ...
+                'MaxIterations', 0);
             resid_valid=resid_valid*1000;
         end
         %calculate statistical information
@@ -409,7 +383,7 @@ drawnow;
 
         set(get(guiHandles.axis1,'XLabel'), 'String', 'Measurement index');
         set(get(guiHandles.axis1,'YLabel'), 'String', 'Residual error (mm)');
-        str1=sprintf('Ball-bar Calibration Result - %d Parameters', length(pinit));
+        str1=sprintf('Ball-bar Calibration Result - %d Parameters', info.numParameters);
         set(get(guiHandles.axis1,'title'),'String', [str1, str]);
 
         mean_err_testData = mean(resid_valid);
@@ -438,7 +412,10 @@ drawnow;
         set(get(guiHandles.axis2,'title'),'String', [str1, str]);
         %text(ax(1)*1.1, ax(4)*.8, str, 'FontSize',7);
 
-        [dhp,flange,lbb,basepos]=unpackparams(pfit,cinit,var_ci,var_scaling);
+        dhp = fit.dh;
+        flange = fit.flange;
+        lbb = fit.lbb;
+        basepos = fit.basepos;
 
         %make text visible
         hndls = get(guiHandles.uiPanel,'children');
@@ -461,7 +438,7 @@ drawnow;
         str=sprintf('% 7.5f   % 7.5f   %7.5f',...
             basepos(1),basepos(2),basepos(3));
         set(guiHandles.base_pos_final,'String', str);
-        condNumJ = cond(jacobian);
+        condNumJ = info.conditionNumber;
         set(guiHandles.condition_num,'String', sprintf('%6.2f', condNumJ));
 
         % return the calibration data
@@ -555,80 +532,6 @@ drawnow;
 
     end
 
-%-----------------------------------------------------------------------
-% Internal function
-% pack various parameters into a two vectors, one with vectors to
-% be identified and the other with fixed parameters
-% also see sister function unpackparams*
-% ci* specifies indices of constants for each variable (1=hold constant)
-% parameters should come in pairs, first the variable arry, then
-% the _ci array that indicates which are to be held constant
-%----------------------------------------------------------------------
-    function [vars,consts,var_ci,var_desc,var_scaling]=packparams(varargin)
-        if  nargin == 0 || mod(nargin,4) ~= 0
-            error ('Wrong number of arguments. It must a multiple of four.');
-        end;
-        vars=[];
-        consts=[];
-        var_desc=[];
-        var_scaling=[];
-        var_ci=cell(1,nargin/4);
-        for nv=1:4:nargin,
-            dat=varargin{nv};
-            dat_ci=varargin{nv+1};
-            dat_desc=varargin{nv+2};
-            dat_scale=varargin{nv+3};
-            var_ci{(nv+3)/4}=dat_ci;
-            % note: works for column or row vectors, but will
-            % output a row vector
-            [m n]=size(dat);
-            for i=1:m,
-                for j=1:n,
-                    if dat_ci(i,j)==1.0,
-                        consts=[consts dat(i,j)]; %#ok<AGROW>
-                    else
-                        vars=[vars dat(i,j)*dat_scale(i,j)]; %#ok<AGROW>
-                        var_scaling=[var_scaling dat_scale(i,j)]; %#ok<AGROW>
-                        var_desc=[var_desc dat_desc(i,j)]; %#ok<AGROW>
-                    end
-                end
-            end
-        end
-    end
-
-%-------------------------------------------------------------------
-% pack various parameters into a two vectors, one with vectors to
-% be identified and the other with fixed parameters
-% also see sister function unpackparams*
-% var_ci specifies indices of constants for each variable, and
-% should have been a return value of packparams.m
-%------------------------------------------------------------------
-    function [varargout]=unpackparams(vars,consts,var_ci,var_scaling)
-        nvars = length(var_ci);
-
-        vi=1;
-        ci=1;
-        vars=vars./var_scaling;
-        for nv=1:nvars,
-            dat_ci=var_ci{nv};
-            dat=zeros(size(dat_ci));
-            [m n]=size(dat);
-            for i=1:m,
-                for j=1:n,
-                    if dat_ci(i,j)==1.0,
-                        dat(i,j)=consts(ci);
-                        ci=ci+1;
-                    else
-                        dat(i,j)=vars(vi);
-                        vi=vi+1;
-                    end
-                end
-            end
-            varargout{nv} = dat;
-        end
-
-    end
-
 %--------------------------------------------------------------------------
 % Internal function that converts given Transformation matrix to a set of
 % yaw, pitch ,and roll angles (in radians)